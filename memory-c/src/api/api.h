@@ -27,13 +27,15 @@ typedef struct {
     size_t      max_connections;/* Max concurrent connections */
     size_t      thread_pool;    /* Thread pool size for requests */
     uint32_t    timeout_ms;     /* Request timeout in ms */
+    const char* snapshot_dir;   /* Where the snapshot method writes (NULL: disabled) */
 } api_config_t;
 
 #define API_CONFIG_DEFAULT { \
     .port = 8080, \
     .max_connections = 100, \
     .thread_pool = 4, \
-    .timeout_ms = 10000 \
+    .timeout_ms = 10000, \
+    .snapshot_dir = NULL \
 }
 
 /* RPC request (parsed) */
@@ -96,6 +98,12 @@ mem_error_t rpc_context_create(rpc_context_t** ctx,
                                search_engine_t* search,
                                embedding_engine_t* embedding);
 
+/*
+ * Enable the snapshot method, writing snapshots as named directories
+ * under dir (which must exist). NULL disables it again.
+ */
+mem_error_t rpc_context_set_snapshot_dir(rpc_context_t* ctx, const char* dir);
+
 /* Destroy RPC context */
 void rpc_context_destroy(rpc_context_t* ctx);
 
@@ -148,6 +156,16 @@ typedef struct {
     double   latency_p99_ms;
     size_t   nodes_indexed;
     size_t   memory_bytes;
+    uint64_t search_parallel_total;     /* Searches fanned out to workers */
+    uint64_t search_serial_fallbacks;   /* Fan-out skipped due to load */
+    uint64_t search_fresh_vectors;      /* Vectors waiting to be merged into HNSW */
+    uint64_t search_fresh_merged;       /* Buffered vectors merged into HNSW */
+    uint64_t query_cache_hits;
+    uint64_t query_cache_misses;
+    uint64_t query_cache_evictions;
+    uint64_t embedding_cache_hits;
+    uint64_t embedding_cache_misses;
+    size_t   embedding_cache_entries;
 } metrics_result_t;
 
 /* Get metrics */
@@ -207,6 +207,14 @@ mem_error_t api_server_create(api_server_t** server,
         free(s);
         return err;
     }
+    if (s->config.snapshot_dir) {
+        err = rpc_context_set_snapshot_dir(s->rpc_ctx, s->config.snapshot_dir);
+        if (err != MEM_OK) {
+            rpc_context_destroy(s->rpc_ctx);
+            free(s);
+            return err;
+        }
+    }
 
 #ifdef HAVE_MICROHTTPD
     /* Start HTTP daemon */
@@ -348,6 +356,26 @@ mem_error_t api_get_metrics(const api_server_t* server, metrics_result_t* metric
         metrics->latency_p99_ms = 0.0;
         metrics->nodes_indexed = server->hierarchy ? hierarchy_count(server->hierarchy) : 0;
         metrics->memory_bytes = 0;  /* TODO: track memory */
+
+        if (server->search) {
+            search_stats_t stats;
+            search_engine_get_stats(server->search, &stats);
+            metrics->search_parallel_total = stats.parallel_searches;
+            metrics->search_serial_fallbacks = stats.serial_fallbacks;
+            metrics->search_fresh_vectors = stats.fresh_vectors;
+            metrics->search_fresh_merged = stats.fresh_merged;
+            metrics->query_cache_hits = stats.cache_hits;
+            metrics->query_cache_misses = stats.cache_misses;
+            metrics->query_cache_evictions = stats.cache_evictions;
+        }
+
+        if (server->embedding) {
+            embedding_cache_stats_t cache_stats;
+            embedding_get_cache_stats(server->embedding, &cache_stats);
+            metrics->embedding_cache_hits = cache_stats.hits;
+            metrics->embedding_cache_misses = cache_stats.misses;
+            metrics->embedding_cache_entries = cache_stats.entries;
+        }
     }
 
     return MEM_OK;
@@ -363,7 +391,7 @@ mem_error_t api_format_metrics(const metrics_result_t* metrics,
     }
 
     /* Allocate buffer */
-    size_t buf_size = 4096;
+    size_t buf_size = 8192;
     char* buf = malloc(buf_size);
     MEM_CHECK_ALLOC(buf);
 
@@ -406,6 +434,67 @@ mem_error_t api_format_metrics(const metrics_result_t* metrics,
         "memory_service_nodes_indexed %lu\n\n",
         (unsigned long)metrics->nodes_indexed);
 
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_search_parallel_total Searches with per-level fan-out\n"
+        "# TYPE memory_service_search_parallel_total counter\n"
+        "memory_service_search_parallel_total %lu\n\n",
+        (unsigned long)metrics->search_parallel_total);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_search_serial_fallback_total Searches run serially under load\n"
+        "# TYPE memory_service_search_serial_fallback_total counter\n"
+        "memory_service_search_serial_fallback_total %lu\n\n",
+        (unsigned long)metrics->search_serial_fallbacks);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_search_fresh_vectors Vectors in the fresh-write buffer\n"
+        "# TYPE memory_service_search_fresh_vectors gauge\n"
+        "memory_service_search_fresh_vectors %lu\n\n",
+        (unsigned long)metrics->search_fresh_vectors);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_search_fresh_merged_total Buffered vectors merged into HNSW\n"
+        "# TYPE memory_service_search_fresh_merged_total counter\n"
+        "memory_service_search_fresh_merged_total %lu\n\n",
+        (unsigned long)metrics->search_fresh_merged);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_query_cache_hits_total Query result cache hits\n"
+        "# TYPE memory_service_query_cache_hits_total counter\n"
+        "memory_service_query_cache_hits_total %lu\n\n",
+        (unsigned long)metrics->query_cache_hits);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_query_cache_misses_total Query result cache misses\n"
+        "# TYPE memory_service_query_cache_misses_total counter\n"
+        "memory_service_query_cache_misses_total %lu\n\n",
+        (unsigned long)metrics->query_cache_misses);
+
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_query_cache_evictions_total Query result cache evictions\n"
+        "# TYPE memory_service_query_cache_evictions_total counter\n"
+        "memory_service_query_cache_evictions_total %lu\n\n",
+        (unsigned long)metrics->query_cache_evictions);
+
+    uint64_t embed_lookups = metrics->embedding_cache_hits + metrics->embedding_cache_misses;
+    pos += snprintf(buf + pos, buf_size - pos,
+        "# HELP memory_service_embedding_cache_hits_total Query embedding cache hits\n"
+        "# TYPE memory_service_embedding_cache_hits_total counter\n"
+        "memory_service_embedding_cache_hits_total %lu\n\n"
+        "# HELP memory_service_embedding_cache_misses_total Query embedding cache misses\n"
+        "# TYPE memory_service_embedding_cache_misses_total counter\n"
+        "memory_service_embedding_cache_misses_total %lu\n\n"
+        "# HELP memory_service_embedding_cache_hit_ratio Query embedding cache hit ratio\n"
+        "# TYPE memory_service_embedding_cache_hit_ratio gauge\n"
+        "memory_service_embedding_cache_hit_ratio %.4f\n\n"
+        "# HELP memory_service_embedding_cache_entries Cached query embeddings\n"
+        "# TYPE memory_service_embedding_cache_entries gauge\n"
+        "memory_service_embedding_cache_entries %lu\n\n",
+        (unsigned long)metrics->embedding_cache_hits,
+        (unsigned long)metrics->embedding_cache_misses,
+        embed_lookups ? (double)metrics->embedding_cache_hits / (double)embed_lookups : 0.0,
+        (unsigned long)metrics->embedding_cache_entries);
+
     pos += snprintf(buf + pos, buf_size - pos,
         "# HELP memory_service_memory_bytes Memory usage in bytes\n"
         "# TYPE memory_service_memory_bytes gauge\n"
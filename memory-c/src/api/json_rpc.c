@@ -14,12 +14,14 @@
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include <limits.h>
 
 /* RPC context */
 struct rpc_context {
     hierarchy_t*        hierarchy;
     search_engine_t*    search;
     embedding_engine_t* embedding;
+    char*               snapshot_dir;   /* NULL: snapshot method disabled */
 };
 
 /* Response metadata for logging (no PII) */
@@ -37,6 +39,7 @@ typedef struct {
     double  build_ms;           /* Response building */
     double  hierarchy_ms;       /* Hierarchy operations (create node, etc.) */
     double  index_ms;           /* Search index update */
+    double  commit_ms;          /* Waiting for the WAL group commit */
 } rpc_result_metadata_t;
 
 /* Helper to mark a timing checkpoint and return elapsed */
@@ -77,6 +80,7 @@ static mem_error_t handle_list_sessions(rpc_context_t* ctx, yyjson_val* params,
 static mem_error_t handle_get_context(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp);
 static mem_error_t handle_drill_down(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp);
 static mem_error_t handle_zoom_out(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp);
+static mem_error_t handle_snapshot(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp);
 
 /* Method registry */
 static const method_entry_t g_methods[] = {
@@ -89,6 +93,7 @@ static const method_entry_t g_methods[] = {
     {"get_context",   handle_get_context},
     {"drill_down",    handle_drill_down},
     {"zoom_out",      handle_zoom_out},
+    {"snapshot",      handle_snapshot},
     {NULL, NULL}
 };
 
@@ -119,10 +124,29 @@ mem_error_t rpc_context_create(rpc_context_t** ctx,
  */
 void rpc_context_destroy(rpc_context_t* ctx) {
     if (ctx) {
+        free(ctx->snapshot_dir);
         free(ctx);
     }
 }
 
+/*
+ * Enable or disable the snapshot method
+ */
+mem_error_t rpc_context_set_snapshot_dir(rpc_context_t* ctx, const char* dir) {
+    if (!ctx) {
+        MEM_RETURN_ERROR(MEM_ERR_INVALID_ARG, "ctx is NULL");
+    }
+
+    char* copy = NULL;
+    if (dir) {
+        copy = strdup(dir);
+        MEM_CHECK_ALLOC(copy);
+    }
+    free(ctx->snapshot_dir);
+    ctx->snapshot_dir = copy;
+    return MEM_OK;
+}
+
 /*
  * Parse JSON-RPC request
  */
@@ -257,6 +281,7 @@ mem_error_t rpc_execute(rpc_context_t* ctx,
     if (m->hierarchy_ms > 0.01) TIMING_SNPRINTF("hierarchy=%.2f ", m->hierarchy_ms);
     if (m->embed_ms > 0.01) TIMING_SNPRINTF("embed=%.2f ", m->embed_ms);
     if (m->index_ms > 0.01) TIMING_SNPRINTF("index=%.2f ", m->index_ms);
+    if (m->commit_ms > 0.01) TIMING_SNPRINTF("commit=%.2f ", m->commit_ms);
     if (m->search_ms > 0.01) TIMING_SNPRINTF("search=%.2f ", m->search_ms);
     if (m->build_ms > 0.01) TIMING_SNPRINTF("build=%.2f ", m->build_ms);
 #undef TIMING_SNPRINTF
@@ -387,6 +412,35 @@ static yyjson_mut_val* create_result(rpc_response_internal_t* resp) {
     return result;
 }
 
+/*
+ * Copy up to max bytes of a node's text (caller frees). NULL if it has
+ * none; *len is the length copied.
+ */
+static char* copy_text(const hierarchy_t* h, node_id_t id, size_t max, size_t* len) {
+    size_t need = 0;
+    if (!hierarchy_get_text(h, id, NULL, 0, &need)) return NULL;
+
+    for (;;) {
+        if (need > max) need = max;
+        char* text = malloc(need + 1);
+        if (!text) return NULL;
+
+        size_t full = 0;
+        if (!hierarchy_get_text(h, id, text, need + 1, &full)) {
+            free(text);
+            return NULL;
+        }
+
+        /* Rewritten with longer text in between: try again at the new size */
+        if (full <= need || need == max) {
+            *len = full < need ? full : need;
+            return text;
+        }
+        free(text);
+        need = full;
+    }
+}
+
 /* Simple tokenizer - splits on whitespace and lowercases */
 static size_t tokenize_query(const char* query, size_t len, char tokens[][64], size_t max_tokens) {
     size_t count = 0;
@@ -414,9 +468,34 @@ static size_t tokenize_query(const char* query, size_t len, char tokens[][64], s
     return count;
 }
 
-/* Helper to embed and index a node */
+/*
+ * Record a node's WordPiece token count for search_apply_budget. A
+ * message's count is also added to its session, whose content is the
+ * sum of its messages.
+ */
+static void record_token_count(rpc_context_t* ctx, node_id_t node_id,
+                               const char* text, size_t text_len) {
+    if (!ctx->embedding) return;
+
+    columns_store_t* columns = hierarchy_get_columns(ctx->hierarchy);
+    size_t tokens = embedding_count_tokens(ctx->embedding, text, text_len);
+    if (tokens > UINT32_MAX) tokens = UINT32_MAX;
+    hierarchy_set_token_count(ctx->hierarchy, node_id, (uint32_t)tokens);
+
+    if (columns_get_level(columns, node_id) == LEVEL_MESSAGE) {
+        node_id_t session = columns_get_session(columns, node_id);
+        if (session != NODE_ID_INVALID) {
+            uint64_t total = (uint64_t)columns_get_token_count(columns, session) + tokens;
+            hierarchy_set_token_count(ctx->hierarchy, session,
+                                      total > UINT32_MAX ? UINT32_MAX : (uint32_t)total);
+        }
+    }
+}
+
+/* Helper to account, embed and index a node */
 static void embed_and_index_node(rpc_context_t* ctx, node_id_t node_id,
                                   const char* text, size_t text_len) {
+    record_token_count(ctx, node_id, text, text_len);
     if (!ctx->embedding) return;
 
     float embedding[EMBEDDING_DIM];
@@ -439,6 +518,21 @@ static void embed_and_index_node(rpc_context_t* ctx, node_id_t node_id,
     }
 }
 
+/* Wait until the request's mutations are durable in the WAL */
+static bool commit_mutations(rpc_context_t* ctx, rpc_response_internal_t* resp,
+                             struct timespec* ts) {
+    mem_error_t err = hierarchy_commit(ctx->hierarchy);
+    resp->metadata.commit_ms = checkpoint_ms(ts);
+
+    if (err != MEM_OK) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_INTERNAL;
+        resp->base.error_message = "failed to persist changes";
+        return false;
+    }
+    return true;
+}
+
 /* store: Ingest a message with automatic decomposition into blocks and statements */
 static mem_error_t handle_store(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp) {
     struct timespec ts;
@@ -606,6 +700,8 @@ static mem_error_t handle_store(rpc_context_t* ctx, yyjson_val* params, rpc_resp
     resp->metadata.statements_count = total_statements;
     resp->metadata.match_count = 1;  /* 1 message stored */
 
+    if (!commit_mutations(ctx, resp, &ts)) return MEM_OK;
+
     /* Build result */
     yyjson_mut_val* result = create_result(resp);
     if (!result) {
@@ -686,6 +782,7 @@ static mem_error_t handle_store_block(rpc_context_t* ctx, yyjson_val* params, rp
         resp->base.error_message = "failed to store block content";
         return MEM_OK;
     }
+    record_token_count(ctx, block_id, content_str, content_len);
     resp->metadata.hierarchy_ms = checkpoint_ms(&ts);
 
     /* Generate embedding if embedding engine available */
@@ -713,6 +810,8 @@ static mem_error_t handle_store_block(rpc_context_t* ctx, yyjson_val* params, rp
         }
     }
 
+    if (!commit_mutations(ctx, resp, &ts)) return MEM_OK;
+
     yyjson_mut_val* result = create_result(resp);
     if (!result) {
         resp->base.is_error = true;
@@ -788,6 +887,7 @@ static mem_error_t handle_store_statement(rpc_context_t* ctx, yyjson_val* params
         resp->base.error_message = "failed to store statement content";
         return MEM_OK;
     }
+    record_token_count(ctx, stmt_id, content_str, content_len);
     resp->metadata.hierarchy_ms = checkpoint_ms(&ts);
 
     /* Generate embedding if embedding engine available */
@@ -815,6 +915,8 @@ static mem_error_t handle_store_statement(rpc_context_t* ctx, yyjson_val* params
         }
     }
 
+    if (!commit_mutations(ctx, resp, &ts)) return MEM_OK;
+
     yyjson_mut_val* result = create_result(resp);
     if (!result) {
         resp->base.is_error = true;
@@ -849,6 +951,13 @@ static hierarchy_level_t parse_level(const char* name) {
  *   level: optional single level to search (e.g., "block")
  *   top_level: highest level in hierarchy to search (default: "session")
  *   bottom_level: lowest level in hierarchy to search (default: "statement")
+ *   mode: "flat" (default) or "coarse_to_fine"
+ *   coarse_level: coarse_to_fine level searched first (default: "message")
+ *   coarse_top_n: coarse_to_fine hits whose subtrees are searched (default: 8)
+ *   agent_id: only nodes owned by this agent
+ *   session_id: only nodes in this session (under agent_id if given)
+ *   after_time: only nodes created at or after this time (ns since epoch)
+ *   before_time: only nodes created before this time (ns since epoch)
  *
  * Level hierarchy (top to bottom):
  *   session -> message -> block -> statement
@@ -920,6 +1029,56 @@ static mem_error_t handle_query(rpc_context_t* ctx, yyjson_val* params, rpc_resp
             if (lvl < LEVEL_COUNT) bottom_level = lvl;
         }
     }
+
+    /* Coarse-to-fine: search coarse_level first, then only below its top hits */
+    search_mode_t mode = SEARCH_MODE_FLAT;
+    hierarchy_level_t coarse_level = LEVEL_STATEMENT;   /* Engine default */
+    size_t coarse_top_n = 0;
+
+    yyjson_val* mode_val = yyjson_obj_get(params, "mode");
+    if (mode_val && yyjson_is_str(mode_val) &&
+        strcmp(yyjson_get_str(mode_val), "coarse_to_fine") == 0) {
+        mode = SEARCH_MODE_COARSE_TO_FINE;
+    }
+    yyjson_val* coarse_val = yyjson_obj_get(params, "coarse_level");
+    if (coarse_val && yyjson_is_str(coarse_val)) {
+        hierarchy_level_t lvl = parse_level(yyjson_get_str(coarse_val));
+        if (lvl < LEVEL_COUNT) coarse_level = lvl;
+    }
+    yyjson_val* top_n_val = yyjson_obj_get(params, "coarse_top_n");
+    if (top_n_val && yyjson_is_int(top_n_val) && yyjson_get_int(top_n_val) > 0) {
+        coarse_top_n = (size_t)yyjson_get_int(top_n_val);
+        if (coarse_top_n > 100) coarse_top_n = 100;
+    }
+
+    /* Agent/session/time filters are applied inside the search */
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    bool have_filter = false;
+    bool filter_unmatched = false;  /* Unknown agent or session: nothing can match */
+
+    yyjson_val* agent_val = yyjson_obj_get(params, "agent_id");
+    if (agent_val && yyjson_is_str(agent_val)) {
+        filter.agent = hierarchy_find_agent(ctx->hierarchy, yyjson_get_str(agent_val));
+        if (filter.agent == NODE_ID_INVALID) filter_unmatched = true;
+        have_filter = true;
+    }
+    yyjson_val* session_val = yyjson_obj_get(params, "session_id");
+    if (session_val && yyjson_is_str(session_val) && !filter_unmatched) {
+        filter.session = hierarchy_find_session(ctx->hierarchy, filter.agent,
+                                                yyjson_get_str(session_val));
+        if (filter.session == NODE_ID_INVALID) filter_unmatched = true;
+        have_filter = true;
+    }
+    yyjson_val* after_val = yyjson_obj_get(params, "after_time");
+    if (after_val && yyjson_is_uint(after_val)) {
+        filter.after_time = (timestamp_ns_t)yyjson_get_uint(after_val);
+        have_filter = true;
+    }
+    yyjson_val* before_val = yyjson_obj_get(params, "before_time");
+    if (before_val && yyjson_is_uint(before_val)) {
+        filter.before_time = (timestamp_ns_t)yyjson_get_uint(before_val);
+        have_filter = true;
+    }
     resp->metadata.parse_ms = checkpoint_ms(&ts);
 
     yyjson_mut_val* result = create_result(resp);
@@ -939,69 +1098,95 @@ static mem_error_t handle_query(rpc_context_t* ctx, yyjson_val* params, rpc_resp
     bool seen_levels[4] = {false};  /* SESSION, MESSAGE, BLOCK, STATEMENT */
     size_t total_matches = 0;
 
-    /* Semantic search using embeddings with level constraints */
-    if (ctx->embedding) {
+    /* Semantic search using embeddings with level constraints
+     * Note: search API uses min/max where min=bottom (most granular),
+     * max=top (least granular) - opposite of tree visualization
+     */
+    search_match_t* matches = calloc(max_results, sizeof(search_match_t));
+    size_t match_count = 0;
+    bool have_matches = false;
+
+    search_cache_query_t cache_query = {
+        .text = query_str,
+        .text_len = query_len,
+        .k = max_results,
+        .min_level = bottom_level,
+        .max_level = top_level,
+        .mode = mode,
+        .coarse_level = coarse_level,
+        .coarse_top_n = coarse_top_n,
+        .filter = have_filter ? &filter : NULL
+    };
+
+    /* Repeated queries skip embedding, HNSW and ranking entirely */
+    if (matches && filter_unmatched) {
+        have_matches = true;
+    } else if (matches && search_engine_cache_lookup(ctx->search, &cache_query,
+                                                     matches, &match_count)) {
+        have_matches = true;
+        resp->metadata.search_ms = checkpoint_ms(&ts);
+    } else if (matches && ctx->embedding) {
         float query_embedding[EMBEDDING_DIM];
-        mem_error_t err = embedding_generate(ctx->embedding, query_str, query_len, query_embedding);
+        mem_error_t err = embedding_generate_cached(ctx->embedding, query_str, query_len,
+                                                    query_embedding);
         resp->metadata.embed_ms = checkpoint_ms(&ts);
 
         if (err == MEM_OK) {
-            search_match_t* matches = calloc(max_results, sizeof(search_match_t));
-            if (matches) {
-                size_t match_count = 0;
-
-                /* Use full search API with level constraints
-                 * Note: search API uses min/max where min=bottom (most granular),
-                 * max=top (least granular) - opposite of tree visualization
-                 */
-                search_query_t sq = {
-                    .embedding = query_embedding,
-                    .tokens = NULL,
-                    .token_count = 0,
-                    .k = max_results,
-                    .min_level = bottom_level,  /* Most granular = bottom of tree */
-                    .max_level = top_level      /* Least granular = top of tree */
-                };
-
-                err = search_engine_search(ctx->search, &sq, matches, &match_count);
-                resp->metadata.search_ms = checkpoint_ms(&ts);
-
-                if (err == MEM_OK) {
-                    total_matches = match_count;
-                    for (size_t i = 0; i < match_count; i++) {
-                        yyjson_mut_val* match_obj = yyjson_mut_obj(resp->result_doc);
-                        yyjson_mut_obj_add_uint(resp->result_doc, match_obj, "node_id", matches[i].node_id);
-                        yyjson_mut_obj_add_str(resp->result_doc, match_obj, "level",
-                                              level_name(matches[i].level));
-                        /* Guard against NaN/Inf scores which break JSON serialization */
-                        float score = matches[i].score;
-                        if (isnan(score) || isinf(score)) score = 0.0f;
-                        yyjson_mut_obj_add_real(resp->result_doc, match_obj, "score", score);
-
-                        /* Track level for logging */
-                        if (matches[i].level < 4) seen_levels[matches[i].level] = true;
-
-                        /* Include truncated text content if available */
-                        size_t text_len;
-                        const char* text = hierarchy_get_text(ctx->hierarchy, matches[i].node_id, &text_len);
-                        if (text) {
-                            size_t content_len = text_len > MAX_CONTENT_LEN ? MAX_CONTENT_LEN : text_len;
-                            yyjson_mut_obj_add_strncpy(resp->result_doc, match_obj, "content", text, content_len);
-                        }
-
-                        /* Include children count for agent navigation */
-                        node_id_t child_ids[1];
-                        size_t child_count = hierarchy_get_children(ctx->hierarchy, matches[i].node_id, child_ids, 1);
-                        yyjson_mut_obj_add_uint(resp->result_doc, match_obj, "children_count", child_count);
-
-                        yyjson_mut_arr_add_val(results_arr, match_obj);
-                    }
-                }
-                free(matches);
+            search_query_t sq = {
+                .embedding = query_embedding,
+                .tokens = NULL,
+                .token_count = 0,
+                .k = max_results,
+                .min_level = bottom_level,  /* Most granular = bottom of tree */
+                .max_level = top_level,     /* Least granular = top of tree */
+                .mode = mode,
+                .coarse_level = coarse_level,
+                .coarse_top_n = coarse_top_n,
+                .filter = have_filter ? &filter : NULL
+            };
+
+            err = search_engine_search(ctx->search, &sq, matches, &match_count);
+            resp->metadata.search_ms = checkpoint_ms(&ts);
+
+            if (err == MEM_OK) {
+                have_matches = true;
+                search_engine_cache_store(ctx->search, &cache_query, matches, match_count);
             }
         }
     }
 
+    if (have_matches) {
+        total_matches = match_count;
+        for (size_t i = 0; i < match_count; i++) {
+            yyjson_mut_val* match_obj = yyjson_mut_obj(resp->result_doc);
+            yyjson_mut_obj_add_uint(resp->result_doc, match_obj, "node_id", matches[i].node_id);
+            yyjson_mut_obj_add_str(resp->result_doc, match_obj, "level",
+                                  level_name(matches[i].level));
+            /* Guard against NaN/Inf scores which break JSON serialization */
+            float score = matches[i].score;
+            if (isnan(score) || isinf(score)) score = 0.0f;
+            yyjson_mut_obj_add_real(resp->result_doc, match_obj, "score", score);
+
+            /* Track level for logging */
+            if (matches[i].level < 4) seen_levels[matches[i].level] = true;
+
+            /* Include truncated text content if available */
+            size_t text_len;
+            char* text = copy_text(ctx->hierarchy, matches[i].node_id, MAX_CONTENT_LEN, &text_len);
+            if (text) {
+                yyjson_mut_obj_add_strncpy(resp->result_doc, match_obj, "content", text, text_len);
+                free(text);
+            }
+
+            /* Include children count for agent navigation */
+            size_t child_count = hierarchy_get_child_count(ctx->hierarchy, matches[i].node_id);
+            yyjson_mut_obj_add_uint(resp->result_doc, match_obj, "children_count", child_count);
+
+            yyjson_mut_arr_add_val(results_arr, match_obj);
+        }
+    }
+    free(matches);
+
     yyjson_mut_obj_add_val(resp->result_doc, result, "results", results_arr);
     yyjson_mut_obj_add_uint(resp->result_doc, result, "total_matches", yyjson_mut_arr_size(results_arr));
     yyjson_mut_obj_add_str(resp->result_doc, result, "top_level", level_name(top_level));
@@ -1027,26 +1212,6 @@ static mem_error_t handle_query(rpc_context_t* ctx, yyjson_val* params, rpc_resp
     return MEM_OK;
 }
 
-/* Callback data for finding a session by session_id string */
-typedef struct {
-    const char* target_session_id;
-    node_id_t found_node_id;
-    const char* found_agent_id;
-    bool found;
-} session_find_data_t;
-
-static bool find_session_callback(node_id_t session_node_id, const char* agent_id,
-                                  const char* session_str, void* user_data) {
-    session_find_data_t* data = (session_find_data_t*)user_data;
-    if (strcmp(session_str, data->target_session_id) == 0) {
-        data->found_node_id = session_node_id;
-        data->found_agent_id = agent_id;
-        data->found = true;
-        return false;  /* Stop iteration */
-    }
-    return true;  /* Continue */
-}
-
 /* get_session: Retrieve session metadata */
 static mem_error_t handle_get_session(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp) {
     if (!ctx->hierarchy) {
@@ -1072,13 +1237,12 @@ static mem_error_t handle_get_session(rpc_context_t* ctx, yyjson_val* params, rp
     }
 
     /* Find session by session_id string */
-    session_find_data_t find_data = {
-        .target_session_id = yyjson_get_str(session_id),
-        .found = false
-    };
-    hierarchy_iter_sessions(ctx->hierarchy, find_session_callback, &find_data);
+    const char* session_str = yyjson_get_str(session_id);
+    node_id_t session_node = hierarchy_find_session(ctx->hierarchy, NODE_ID_INVALID, session_str);
+    node_info_t session_info;
 
-    if (!find_data.found) {
+    if (session_node == NODE_ID_INVALID ||
+        hierarchy_get_node(ctx->hierarchy, session_node, &session_info) != MEM_OK) {
         resp->base.is_error = true;
         resp->base.error_code = RPC_ERROR_SERVER;
         resp->base.error_message = "session not found";
@@ -1094,14 +1258,13 @@ static mem_error_t handle_get_session(rpc_context_t* ctx, yyjson_val* params, rp
         return MEM_OK;
     }
 
-    yyjson_mut_obj_add_uint(resp->result_doc, result, "node_id", find_data.found_node_id);
-    yyjson_mut_obj_add_str(resp->result_doc, result, "session_id", find_data.target_session_id);
-    yyjson_mut_obj_add_str(resp->result_doc, result, "agent_id",
-                          find_data.found_agent_id ? find_data.found_agent_id : "");
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "node_id", session_node);
+    yyjson_mut_obj_add_strcpy(resp->result_doc, result, "session_id", session_info.session_id);
+    yyjson_mut_obj_add_strcpy(resp->result_doc, result, "agent_id", session_info.agent_id);
 
     /* Get message count */
     node_id_t children[100];
-    size_t message_count = hierarchy_get_children(ctx->hierarchy, find_data.found_node_id, children, 100);
+    size_t message_count = hierarchy_get_children(ctx->hierarchy, session_node, children, 100);
     yyjson_mut_obj_add_uint(resp->result_doc, result, "message_count", message_count);
 
     resp->base.is_error = false;
@@ -1218,9 +1381,10 @@ static mem_error_t handle_get_context(rpc_context_t* ctx, yyjson_val* params, rp
 
     /* Include text content if available */
     size_t text_len;
-    const char* text = hierarchy_get_text(ctx->hierarchy, node_id, &text_len);
+    char* text = copy_text(ctx->hierarchy, node_id, SIZE_MAX, &text_len);
     if (text) {
         yyjson_mut_obj_add_strncpy(resp->result_doc, result, "content", text, text_len);
+        free(text);
     }
 
     /* Get optional expansion params */
@@ -1381,6 +1545,7 @@ static mem_error_t handle_drill_down(rpc_context_t* ctx, yyjson_val* params, rpc
     node_id_t child_ids[100];
     size_t total_children = hierarchy_get_children(ctx->hierarchy, node_id, child_ids, 100);
     size_t matched_count = 0;
+    node_id_t first_matched = NODE_ID_INVALID;
 
     for (size_t i = 0; i < total_children && matched_count < max_results; i++) {
         node_info_t child_info;
@@ -1388,13 +1553,14 @@ static mem_error_t handle_drill_down(rpc_context_t* ctx, yyjson_val* params, rpc
             continue;
         }
 
-        /* Get content */
-        size_t text_len;
-        const char* text = hierarchy_get_text(ctx->hierarchy, child_ids[i], &text_len);
+        /* Get content; the filter looks at all of it */
+        size_t text_len = 0;
+        char* text = copy_text(ctx->hierarchy, child_ids[i], SIZE_MAX, &text_len);
 
         /* Apply filter if specified */
         if (filter_str && filter_len > 0) {
             if (!text || !text_contains(text, text_len, filter_str, filter_len)) {
+                free(text);
                 continue;  /* Skip non-matching children */
             }
         }
@@ -1406,14 +1572,15 @@ static mem_error_t handle_drill_down(rpc_context_t* ctx, yyjson_val* params, rpc
         if (text) {
             size_t content_len = text_len > MAX_CONTENT_LEN ? MAX_CONTENT_LEN : text_len;
             yyjson_mut_obj_add_strncpy(resp->result_doc, child, "content", text, content_len);
+            free(text);
         }
 
         /* Include child count for further drilling */
-        node_id_t grandchild_ids[1];
-        size_t grandchild_count = hierarchy_get_children(ctx->hierarchy, child_ids[i], grandchild_ids, 1);
-        yyjson_mut_obj_add_uint(resp->result_doc, child, "children_count", grandchild_count > 0 ? grandchild_count : 0);
+        size_t grandchild_count = hierarchy_get_child_count(ctx->hierarchy, child_ids[i]);
+        yyjson_mut_obj_add_uint(resp->result_doc, child, "children_count", grandchild_count);
 
         yyjson_mut_arr_add_val(children, child);
+        if (matched_count == 0) first_matched = child_ids[i];
         matched_count++;
     }
 
@@ -1423,19 +1590,10 @@ static mem_error_t handle_drill_down(rpc_context_t* ctx, yyjson_val* params, rpc
 
     /* Populate logging metadata */
     resp->metadata.match_count = matched_count;
-    if (matched_count > 0) {
+    if (first_matched != NODE_ID_INVALID) {
         /* Get level of first child for logging */
         node_info_t first_child_info;
-        node_id_t first_matched = 0;
-        for (size_t i = 0; i < total_children; i++) {
-            size_t tl;
-            const char* t = hierarchy_get_text(ctx->hierarchy, child_ids[i], &tl);
-            if (!filter_str || !filter_len || (t && text_contains(t, tl, filter_str, filter_len))) {
-                first_matched = child_ids[i];
-                break;
-            }
-        }
-        if (first_matched && hierarchy_get_node(ctx->hierarchy, first_matched, &first_child_info) == MEM_OK) {
+        if (hierarchy_get_node(ctx->hierarchy, first_matched, &first_child_info) == MEM_OK) {
             snprintf(resp->metadata.levels, sizeof(resp->metadata.levels), "%s",
                     level_name(first_child_info.level));
         }
@@ -1501,10 +1659,10 @@ static mem_error_t handle_zoom_out(rpc_context_t* ctx, yyjson_val* params, rpc_r
     yyjson_mut_obj_add_str(resp->result_doc, result, "level", level_name(info.level));
 
     size_t text_len;
-    const char* text = hierarchy_get_text(ctx->hierarchy, node_id, &text_len);
+    char* text = copy_text(ctx->hierarchy, node_id, MAX_CONTENT_LEN, &text_len);
     if (text) {
-        size_t content_len = text_len > MAX_CONTENT_LEN ? MAX_CONTENT_LEN : text_len;
-        yyjson_mut_obj_add_strncpy(resp->result_doc, result, "content", text, content_len);
+        yyjson_mut_obj_add_strncpy(resp->result_doc, result, "content", text, text_len);
+        free(text);
     }
 
     /* Build ancestor chain (from immediate parent to root) */
@@ -1522,10 +1680,10 @@ static mem_error_t handle_zoom_out(rpc_context_t* ctx, yyjson_val* params, rpc_r
         yyjson_mut_obj_add_str(resp->result_doc, ancestor, "level", level_name(ancestor_info.level));
 
         /* Include truncated content for context */
-        const char* ancestor_text = hierarchy_get_text(ctx->hierarchy, current, &text_len);
+        char* ancestor_text = copy_text(ctx->hierarchy, current, MAX_CONTENT_LEN, &text_len);
         if (ancestor_text) {
-            size_t content_len = text_len > MAX_CONTENT_LEN ? MAX_CONTENT_LEN : text_len;
-            yyjson_mut_obj_add_strncpy(resp->result_doc, ancestor, "content", ancestor_text, content_len);
+            yyjson_mut_obj_add_strncpy(resp->result_doc, ancestor, "content", ancestor_text, text_len);
+            free(ancestor_text);
         }
 
         yyjson_mut_arr_add_val(ancestors, ancestor);
@@ -1548,11 +1706,11 @@ static mem_error_t handle_zoom_out(rpc_context_t* ctx, yyjson_val* params, rpc_r
             yyjson_mut_obj_add_uint(resp->result_doc, sibling, "node_id", sibling_ids[i]);
             yyjson_mut_obj_add_str(resp->result_doc, sibling, "level", level_name(sibling_info.level));
 
-            const char* sibling_text = hierarchy_get_text(ctx->hierarchy, sibling_ids[i], &text_len);
+            /* Truncate sibling content for overview */
+            char* sibling_text = copy_text(ctx->hierarchy, sibling_ids[i], 100, &text_len);
             if (sibling_text) {
-                /* Truncate sibling content for overview */
-                size_t max_len = text_len > 100 ? 100 : text_len;
-                yyjson_mut_obj_add_strncpy(resp->result_doc, sibling, "preview", sibling_text, max_len);
+                yyjson_mut_obj_add_strncpy(resp->result_doc, sibling, "preview", sibling_text, text_len);
+                free(sibling_text);
             }
 
             yyjson_mut_arr_add_val(siblings, sibling);
@@ -1572,3 +1730,110 @@ static mem_error_t handle_zoom_out(rpc_context_t* ctx, yyjson_val* params, rpc_r
     resp->base.is_error = false;
     return MEM_OK;
 }
+
+/* Snapshot names become directory names: no separators, no dot files */
+static bool valid_snapshot_name(const char* name, size_t len) {
+    if (len == 0 || len > 128 || name[0] == '.') return false;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* snapshot: Copy the data directory under the snapshot directory */
+static mem_error_t handle_snapshot(rpc_context_t* ctx, yyjson_val* params, rpc_response_internal_t* resp) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    if (!ctx->hierarchy) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_INTERNAL;
+        resp->base.error_message = "hierarchy not initialized";
+        return MEM_OK;
+    }
+
+    if (!ctx->snapshot_dir) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_SERVER;
+        resp->base.error_message = "snapshots not enabled";
+        return MEM_OK;
+    }
+
+    if (params && !yyjson_is_obj(params)) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_INVALID_PARAMS;
+        resp->base.error_message = "params must be an object";
+        return MEM_OK;
+    }
+
+    /* Optional: name (default from the time) and base, an earlier snapshot */
+    yyjson_val* name_val = params ? yyjson_obj_get(params, "name") : NULL;
+    yyjson_val* base_val = params ? yyjson_obj_get(params, "base") : NULL;
+    if ((name_val && (!yyjson_is_str(name_val) ||
+                      !valid_snapshot_name(yyjson_get_str(name_val), yyjson_get_len(name_val)))) ||
+        (base_val && (!yyjson_is_str(base_val) ||
+                      !valid_snapshot_name(yyjson_get_str(base_val), yyjson_get_len(base_val))))) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_INVALID_PARAMS;
+        resp->base.error_message = "invalid snapshot name";
+        return MEM_OK;
+    }
+
+    char name[160];
+    if (name_val) {
+        snprintf(name, sizeof(name), "%s", yyjson_get_str(name_val));
+    } else {
+        time_t now = time(NULL);
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(name, sizeof(name), "snapshot-%Y%m%dT%H%M%SZ", &tm);
+    }
+
+    char dest[PATH_MAX], base[PATH_MAX];
+    snprintf(dest, sizeof(dest), "%s/%s", ctx->snapshot_dir, name);
+    if (base_val) snprintf(base, sizeof(base), "%s/%s", ctx->snapshot_dir, yyjson_get_str(base_val));
+    resp->metadata.parse_ms = checkpoint_ms(&ts);
+
+    snapshot_stats_t stats;
+    mem_error_t err = hierarchy_snapshot(ctx->hierarchy, dest, base_val ? base : NULL, &stats);
+    resp->metadata.hierarchy_ms = checkpoint_ms(&ts);
+    if (err != MEM_OK) {
+        resp->base.is_error = true;
+        if (err == MEM_ERR_EXISTS) {
+            resp->base.error_code = RPC_ERROR_INVALID_PARAMS;
+            resp->base.error_message = "snapshot already exists";
+        } else if (err == MEM_ERR_NOT_FOUND) {
+            resp->base.error_code = RPC_ERROR_INVALID_PARAMS;
+            resp->base.error_message = "base snapshot not found";
+        } else {
+            resp->base.error_code = RPC_ERROR_SERVER;
+            resp->base.error_message = "snapshot failed";
+        }
+        return MEM_OK;
+    }
+
+    yyjson_mut_val* result = create_result(resp);
+    if (!result) {
+        resp->base.is_error = true;
+        resp->base.error_code = RPC_ERROR_INTERNAL;
+        resp->base.error_message = "failed to create result";
+        return MEM_OK;
+    }
+
+    yyjson_mut_obj_add_strcpy(resp->result_doc, result, "name", name);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "wal_sequence", stats.wal_sequence);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "files", stats.files);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "bytes", stats.bytes);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "copied_bytes", stats.copied_bytes);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "cloned", stats.cloned);
+    yyjson_mut_obj_add_uint(resp->result_doc, result, "linked", stats.linked);
+    yyjson_mut_obj_add_real(resp->result_doc, result, "elapsed_ms", (double)stats.elapsed_ns / 1e6);
+    resp->metadata.build_ms = checkpoint_ms(&ts);
+
+    resp->base.is_error = false;
+    return MEM_OK;
+}
@@ -20,6 +20,10 @@ _Thread_local error_context_t g_last_error = {0};
 /* Default alignment */
 #define DEFAULT_ALIGNMENT 16
 
+/* Writable mapped arenas, walked by arena_writeback_all */
+static pthread_mutex_t mapped_lock = PTHREAD_MUTEX_INITIALIZER;
+static arena_t* mapped_head = NULL;
+
 /* Error string table */
 const char* mem_error_str(mem_error_t err) {
     static const char* error_strings[] = {
@@ -75,6 +79,73 @@ const char* mem_error_str(mem_error_t err) {
     return "unknown error";
 }
 
+/*
+ * Apply an arena's access hints to bytes [from, from + len) of its mapping.
+ * Hints are advisory, so failures are logged rather than returned.
+ */
+static void apply_hints(const arena_t* a, size_t from, size_t len) {
+    uint32_t hints = a->flags & ARENA_HINT_MASK;
+    if (!hints || len == 0) return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = from & ~(page - 1);
+    char* addr = (char*)a->base + start;
+    len += from - start;
+
+#ifdef MADV_HUGEPAGE
+    if ((hints & ARENA_FLAG_HUGEPAGE) && madvise(addr, len, MADV_HUGEPAGE) < 0) {
+        LOG_DEBUG("MADV_HUGEPAGE refused for %s: %s", a->path, strerror(errno));
+    }
+#endif
+
+    if (hints & ARENA_FLAG_RANDOM) {
+        madvise(addr, len, MADV_RANDOM);
+    } else if (hints & ARENA_FLAG_SEQUENTIAL) {
+        madvise(addr, len, MADV_SEQUENTIAL);
+    }
+
+    if (hints & ARENA_FLAG_POPULATE) {
+        /* Prefault page tables where supported, else just start readahead */
+        bool populated = false;
+#ifdef MADV_POPULATE_READ
+        populated = madvise(addr, len, MADV_POPULATE_READ) == 0;
+#endif
+        if (!populated) madvise(addr, len, MADV_WILLNEED);
+    }
+
+    if ((hints & ARENA_FLAG_LOCK) && mlock(addr, len) < 0) {
+        LOG_WARN("mlock of %zu bytes of %s failed: %s", len, a->path, strerror(errno));
+    }
+}
+
+/* Start with nothing dirty; writable mappings join the writeback list */
+static void track_arena(arena_t* a) {
+    pthread_mutex_init(&a->dirty_lock, NULL);
+    a->dirty_count = 0;
+    a->next_mapped = NULL;
+    a->prev_mapped = NULL;
+
+    if (!(a->flags & ARENA_FLAG_MMAP) || (a->flags & ARENA_FLAG_READONLY)) return;
+
+    pthread_mutex_lock(&mapped_lock);
+    a->next_mapped = mapped_head;
+    if (mapped_head) mapped_head->prev_mapped = a;
+    mapped_head = a;
+    pthread_mutex_unlock(&mapped_lock);
+}
+
+/* Leave the writeback list; waits out a writeback pass using the arena */
+static void untrack_arena(arena_t* a) {
+    if ((a->flags & ARENA_FLAG_MMAP) && !(a->flags & ARENA_FLAG_READONLY)) {
+        pthread_mutex_lock(&mapped_lock);
+        if (a->prev_mapped) a->prev_mapped->next_mapped = a->next_mapped;
+        else mapped_head = a->next_mapped;
+        if (a->next_mapped) a->next_mapped->prev_mapped = a->prev_mapped;
+        pthread_mutex_unlock(&mapped_lock);
+    }
+    pthread_mutex_destroy(&a->dirty_lock);
+}
+
 mem_error_t arena_create(arena_t** arena, size_t size) {
     MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena pointer is NULL");
     MEM_CHECK_ERR(size > 0, MEM_ERR_INVALID_ARG, "size must be > 0");
@@ -94,6 +165,8 @@ mem_error_t arena_create(arena_t** arena, size_t size) {
     a->flags = 0;
     a->fd = -1;
     a->path = NULL;
+    a->reserved = 0;
+    track_arena(a);
 
     *arena = a;
     return MEM_OK;
@@ -142,6 +215,7 @@ mem_error_t arena_create_mmap(arena_t** arena, const char* path, size_t size, ui
     a->alignment = DEFAULT_ALIGNMENT;
     a->flags = flags | ARENA_FLAG_MMAP;
     a->fd = fd;
+    a->reserved = 0;
     a->path = strdup(path);
     if (!a->path) {
         munmap(base, size);
@@ -150,6 +224,8 @@ mem_error_t arena_create_mmap(arena_t** arena, const char* path, size_t size, ui
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate path string");
     }
 
+    apply_hints(a, 0, a->size);
+    track_arena(a);
     *arena = a;
     return MEM_OK;
 }
@@ -196,6 +272,7 @@ mem_error_t arena_open_mmap(arena_t** arena, const char* path, uint32_t flags) {
     a->alignment = DEFAULT_ALIGNMENT;
     a->flags = flags | ARENA_FLAG_MMAP;
     a->fd = fd;
+    a->reserved = 0;
     a->path = strdup(path);
     if (!a->path) {
         munmap(base, (size_t)st.st_size);
@@ -204,6 +281,8 @@ mem_error_t arena_open_mmap(arena_t** arena, const char* path, uint32_t flags) {
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate path string");
     }
 
+    apply_hints(a, 0, a->size);
+    track_arena(a);
     *arena = a;
     return MEM_OK;
 }
@@ -283,6 +362,13 @@ void arena_reset_secure(arena_t* arena) {
     }
 }
 
+/* Stamp the file as written; stores are only written through the mapping */
+static void touch_mtime(arena_t* arena) {
+    if (futimens(arena->fd, NULL) < 0) {
+        LOG_DEBUG("failed to update mtime of %s: %s", arena->path, strerror(errno));
+    }
+}
+
 mem_error_t arena_sync(arena_t* arena) {
     MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
 
@@ -290,30 +376,180 @@ mem_error_t arena_sync(arena_t* arena) {
         return MEM_OK;  /* Nothing to sync for heap arenas */
     }
 
+    /* Everything written so far is covered by the msync below */
+    pthread_mutex_lock(&arena->dirty_lock);
+    bool dirty = arena->dirty_count > 0;
+    arena->dirty_count = 0;
+    pthread_mutex_unlock(&arena->dirty_lock);
+
     if (msync(arena->base, arena->size, MS_SYNC) < 0) {
         MEM_RETURN_ERROR(MEM_ERR_SYNC, "msync failed");
     }
+    if (dirty) touch_mtime(arena);
 
     return MEM_OK;
 }
 
+mem_error_t arena_sync_range(arena_t* arena, size_t offset, size_t len) {
+    MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
+
+    if (!(arena->flags & ARENA_FLAG_MMAP) || len == 0 || offset >= arena->size) {
+        return MEM_OK;
+    }
+    if (len > arena->size - offset) len = arena->size - offset;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+    if (msync((char*)arena->base + start, len + (offset - start), MS_SYNC) < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_SYNC, "msync failed");
+    }
+
+    return MEM_OK;
+}
+
+/* Bytes between two ranges, 0 if they touch or overlap */
+static size_t range_gap(const arena_range_t* r, size_t from, size_t to) {
+    if (to < r->from) return r->from - to;
+    if (from > r->to) return from - r->to;
+    return 0;
+}
+
+void arena_mark_dirty(arena_t* arena, size_t offset, size_t len) {
+    if (!arena || !(arena->flags & ARENA_FLAG_MMAP) || len == 0) return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t to = offset + len;
+
+    pthread_mutex_lock(&arena->dirty_lock);
+
+    /* Extend a range within a page, else add one, else join the closest */
+    arena_range_t* r = NULL;
+    size_t best = SIZE_MAX;
+    for (size_t i = 0; i < arena->dirty_count; i++) {
+        size_t gap = range_gap(&arena->dirty[i], offset, to);
+        if (gap < best) {
+            best = gap;
+            r = &arena->dirty[i];
+        }
+    }
+    if ((!r || best > page) && arena->dirty_count < ARENA_DIRTY_RANGES) {
+        arena->dirty[arena->dirty_count++] = (arena_range_t){ offset, to };
+    } else {
+        if (offset < r->from) r->from = offset;
+        if (to > r->to) r->to = to;
+    }
+
+    pthread_mutex_unlock(&arena->dirty_lock);
+}
+
+mem_error_t arena_writeback(arena_t* arena, size_t* bytes) {
+    if (bytes) *bytes = 0;
+    MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
+
+    if (!(arena->flags & ARENA_FLAG_MMAP)) {
+        return MEM_OK;  /* Nothing to write back for heap arenas */
+    }
+
+    arena_range_t ranges[ARENA_DIRTY_RANGES];
+    pthread_mutex_lock(&arena->dirty_lock);
+    void* base = arena->base;
+    size_t count = arena->dirty_count;
+    memcpy(ranges, arena->dirty, count * sizeof(arena_range_t));
+    arena->dirty_count = 0;
+    pthread_mutex_unlock(&arena->dirty_lock);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t start = ranges[i].from & ~(page - 1);
+        size_t len = ranges[i].to - start;
+        if (platform_writeback(base, arena->fd, start, len) < 0) {
+            int saved = errno;
+            /* Retry this range and the rest on the next pass */
+            for (size_t j = i; j < count; j++) {
+                arena_mark_dirty(arena, ranges[j].from, ranges[j].to - ranges[j].from);
+            }
+            if (bytes) *bytes = total;
+            MEM_RETURN_ERROR(MEM_ERR_SYNC, "writeback of %s failed: %s",
+                             arena->path, strerror(saved));
+        }
+        total += len;
+    }
+    if (count > 0) touch_mtime(arena);
+
+    if (bytes) *bytes = total;
+    return MEM_OK;
+}
+
+mem_error_t arena_writeback_all(size_t* arenas, size_t* bytes) {
+    mem_error_t result = MEM_OK;
+    size_t count = 0;
+    size_t total = 0;
+
+    pthread_mutex_lock(&mapped_lock);
+    for (arena_t* a = mapped_head; a; a = a->next_mapped) {
+        size_t n = 0;
+        mem_error_t err = arena_writeback(a, &n);
+        if (err != MEM_OK && result == MEM_OK) result = err;
+        if (n > 0) {
+            count++;
+            total += n;
+        }
+    }
+    pthread_mutex_unlock(&mapped_lock);
+
+    if (arenas) *arenas = count;
+    if (bytes) *bytes = total;
+    return result;
+}
+
 mem_error_t arena_grow(arena_t* arena, size_t new_size) {
     MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
     MEM_CHECK_ERR(new_size > arena->size, MEM_ERR_INVALID_ARG, "new size must be larger");
 
     if (arena->flags & ARENA_FLAG_MMAP) {
+        if (arena->reserved && new_size > arena->reserved) {
+            MEM_RETURN_ERROR(MEM_ERR_FULL, "%zu bytes exceeds reserved %zu",
+                             new_size, arena->reserved);
+        }
+
         /* For mmap'd arenas, we need to remap */
         if (ftruncate(arena->fd, (off_t)new_size) < 0) {
             MEM_RETURN_ERROR(MEM_ERR_TRUNCATE, "failed to grow file");
         }
 
-        /* Use platform-specific remap implementation */
+        if (arena->reserved) {
+            /* Map the new tail over the reservation, from the last partial page */
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t from = arena->size & ~(page - 1);
+            int prot = PROT_READ;
+            if (!(arena->flags & ARENA_FLAG_READONLY)) prot |= PROT_WRITE;
+
+            void* tail = mmap((char*)arena->base + from, new_size - from, prot,
+                              MAP_SHARED | MAP_FIXED, arena->fd, (off_t)from);
+            if (tail == MAP_FAILED) {
+                MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to extend mapping");
+            }
+            apply_hints(arena, arena->size, new_size - arena->size);
+            arena->size = new_size;
+            return MEM_OK;
+        }
+
+        /* Use platform-specific remap implementation; writeback reads
+         * base under dirty_lock */
+        pthread_mutex_lock(&arena->dirty_lock);
         void* new_base = platform_mremap(arena->base, arena->size, new_size, arena->fd);
+        if (new_base != MAP_FAILED) {
+            arena->base = new_base;
+            arena->size = new_size;
+        }
+        pthread_mutex_unlock(&arena->dirty_lock);
         if (new_base == MAP_FAILED) {
             MEM_RETURN_ERROR(MEM_ERR_MMAP, "remap failed");
         }
-        arena->base = new_base;
-        arena->size = new_size;
+
+        /* The mapping may be new (macOS), so hint all of it */
+        apply_hints(arena, 0, new_size);
     } else {
         /* For heap arenas, realloc */
         void* new_base = realloc(arena->base, new_size);
@@ -326,13 +562,78 @@ mem_error_t arena_grow(arena_t* arena, size_t new_size) {
     return MEM_OK;
 }
 
+mem_error_t arena_reserve(arena_t* arena, size_t max_size) {
+    MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
+    MEM_CHECK_ERR(arena->flags & ARENA_FLAG_MMAP, MEM_ERR_INVALID_ARG,
+                  "only mmap'd arenas can reserve address space");
+    MEM_CHECK_ERR(arena->reserved == 0, MEM_ERR_INVALID_ARG, "arena already reserved");
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    max_size = (max_size + page - 1) & ~(page - 1);
+    if (max_size <= arena->size) return MEM_OK;
+
+    /* Inaccessible anonymous range; the file is mapped over its start */
+    void* range = mmap(NULL, max_size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (range == MAP_FAILED) {
+        MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to reserve %zu bytes", max_size);
+    }
+
+    int prot = PROT_READ;
+    if (!(arena->flags & ARENA_FLAG_READONLY)) prot |= PROT_WRITE;
+
+    void* base = mmap(range, arena->size, prot, MAP_SHARED | MAP_FIXED, arena->fd, 0);
+    if (base == MAP_FAILED) {
+        munmap(range, max_size);
+        MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to map into reservation");
+    }
+
+    /* Writeback reads base under dirty_lock */
+    pthread_mutex_lock(&arena->dirty_lock);
+    void* old = arena->base;
+    arena->base = base;
+    arena->reserved = max_size;
+    pthread_mutex_unlock(&arena->dirty_lock);
+
+    munmap(old, arena->size);
+    apply_hints(arena, 0, arena->size);
+    return MEM_OK;
+}
+
+mem_error_t arena_advise(arena_t* arena, uint32_t hints) {
+    MEM_CHECK_ERR(arena != NULL, MEM_ERR_INVALID_ARG, "arena is NULL");
+    MEM_CHECK_ERR(arena->flags & ARENA_FLAG_MMAP, MEM_ERR_INVALID_ARG,
+                  "hints apply to mmap'd arenas only");
+    MEM_CHECK_ERR((hints & ~ARENA_HINT_MASK) == 0, MEM_ERR_INVALID_ARG,
+                  "unknown hint flags 0x%x", hints & ~ARENA_HINT_MASK);
+    MEM_CHECK_ERR(!((hints & ARENA_FLAG_RANDOM) && (hints & ARENA_FLAG_SEQUENTIAL)),
+                  MEM_ERR_INVALID_ARG, "random and sequential hints are exclusive");
+
+    uint32_t old = arena->flags & ARENA_HINT_MASK;
+    arena->flags = (arena->flags & ~ARENA_HINT_MASK) | hints;
+
+    /* Undo hints being dropped; the rest are (re)applied below */
+    if ((old & ARENA_FLAG_LOCK) && !(hints & ARENA_FLAG_LOCK)) {
+        munlock(arena->base, arena->size);
+    }
+    uint32_t pattern = ARENA_FLAG_RANDOM | ARENA_FLAG_SEQUENTIAL;
+    if ((old & pattern) && !(hints & pattern)) {
+        madvise(arena->base, arena->size, MADV_NORMAL);
+    }
+
+    apply_hints(arena, 0, arena->size);
+    return MEM_OK;
+}
+
 void arena_destroy(arena_t* arena) {
     if (!arena) return;
 
+    untrack_arena(arena);
+
     if (arena->flags & ARENA_FLAG_MMAP) {
         if (arena->base && arena->base != MAP_FAILED) {
             msync(arena->base, arena->size, MS_SYNC);
-            munmap(arena->base, arena->size);
+            munmap(arena->base, arena->reserved ? arena->reserved : arena->size);
         }
         if (arena->fd >= 0) {
             close(arena->fd);
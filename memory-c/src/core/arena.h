@@ -10,6 +10,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "error.h"
 
 /* Arena flags */
@@ -17,6 +18,32 @@
 #define ARENA_FLAG_SHARED   (1 << 1)    /* Shared between processes */
 #define ARENA_FLAG_READONLY (1 << 2)    /* Read-only mapping */
 
+/*
+ * Access hints for mmap'd arenas. They are advisory: a hint the platform
+ * or resource limits refuse is logged and otherwise ignored. Hints carry
+ * over to pages added by arena_grow.
+ */
+#define ARENA_FLAG_HUGEPAGE   (1 << 3)  /* Prefer transparent huge pages */
+#define ARENA_FLAG_RANDOM     (1 << 4)  /* Random access: no readahead */
+#define ARENA_FLAG_SEQUENTIAL (1 << 5)  /* Streaming scans: aggressive readahead */
+#define ARENA_FLAG_POPULATE   (1 << 6)  /* Fault the mapping in up front */
+#define ARENA_FLAG_LOCK       (1 << 7)  /* mlock the mapping */
+
+#define ARENA_HINT_MASK (ARENA_FLAG_HUGEPAGE | ARENA_FLAG_RANDOM | \
+                         ARENA_FLAG_SEQUENTIAL | ARENA_FLAG_POPULATE | ARENA_FLAG_LOCK)
+
+/*
+ * Dirty ranges tracked per arena. Writes within a page of a range extend
+ * it, and past the limit a new range joins the closest one. A header and
+ * an append tail are written back separately, not as one span.
+ */
+#define ARENA_DIRTY_RANGES 4
+
+typedef struct {
+    size_t      from;
+    size_t      to;
+} arena_range_t;
+
 /* Arena structure */
 typedef struct arena {
     void*       base;           /* Base address */
@@ -26,6 +53,14 @@ typedef struct arena {
     uint32_t    flags;
     int         fd;             /* File descriptor for mmap */
     char*       path;           /* File path for mmap */
+    size_t      reserved;       /* Reserved address space (0 if none) */
+
+    /* Bytes written since the last writeback */
+    pthread_mutex_t dirty_lock;
+    arena_range_t dirty[ARENA_DIRTY_RANGES];
+    size_t      dirty_count;
+    struct arena* next_mapped;  /* List of writable mapped arenas */
+    struct arena* prev_mapped;
 } arena_t;
 
 /* Create memory arena (heap-backed) */
@@ -58,9 +93,45 @@ void arena_reset_secure(arena_t* arena);
 /* Sync to disk (for mmap'd arenas) */
 mem_error_t arena_sync(arena_t* arena);
 
-/* Grow arena */
+/* Sync bytes [offset, offset + len) to disk, widened to whole pages */
+mem_error_t arena_sync_range(arena_t* arena, size_t offset, size_t len);
+
+/*
+ * Dirty tracking for background writeback. Writers to a mapped arena
+ * record the bytes they change, and arena_writeback starts writeback of
+ * just those pages. Writeback does not make data durable; arena_sync
+ * still does, but finds little left to write.
+ *
+ * Either one that finds dirty ranges also sets the file's mtime, which
+ * not every filesystem updates for writes through a mapping, so a
+ * synced file with an old mtime is unchanged since then.
+ */
+void arena_mark_dirty(arena_t* arena, size_t offset, size_t len);
+
+/* Start writeback of the dirty ranges and clear them; bytes gets their length */
+mem_error_t arena_writeback(arena_t* arena, size_t* bytes);
+
+/*
+ * arena_writeback every writable mapped arena in the process. Arenas
+ * count those with anything to write. Returns the first error, after
+ * trying the rest.
+ */
+mem_error_t arena_writeback_all(size_t* arenas, size_t* bytes);
+
+/* Grow arena (mmap'd arenas may move unless grown within a reservation) */
 mem_error_t arena_grow(arena_t* arena, size_t new_size);
 
+/*
+ * Move an mmap'd arena into a reserved range of max_size bytes of address
+ * space. Later arena_grow calls up to max_size extend the mapping in place,
+ * so pointers into the arena stay valid; growing past it fails with
+ * MEM_ERR_FULL. Reserved pages cost no memory until the file covers them.
+ */
+mem_error_t arena_reserve(arena_t* arena, size_t max_size);
+
+/* Replace the access hints (ARENA_HINT_MASK bits) of an mmap'd arena */
+mem_error_t arena_advise(arena_t* arena, uint32_t hints);
+
 /* Destroy arena */
 void arena_destroy(arena_t* arena);
 
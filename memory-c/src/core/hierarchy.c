@@ -3,14 +3,22 @@
  */
 
 #include "hierarchy.h"
+#include "../storage/id_index.h"
+#include "../storage/text_store.h"
+#include "../storage/wal_writer.h"
 #include "../util/log.h"
+#include "../util/time.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
 
-/* Internal node metadata stored in memory */
+/* Per-node metadata record, stored in node_meta.bin */
 typedef struct {
     timestamp_ns_t  created_at;
     uint32_t        embedding_idx;
@@ -18,75 +26,128 @@ typedef struct {
     char            session_id[MAX_SESSION_ID_LEN];
 } node_meta_t;
 
-/* Text content entry */
-typedef struct {
-    char*   text;
-    size_t  len;
-} text_entry_t;
-
 struct hierarchy {
     char* base_dir;
     relations_store_t* relations;
     embeddings_store_t* embeddings;
+    columns_store_t* columns;
+    id_index_t* ids;            /* agent/session string id -> node */
+    text_store_t* text;         /* Node text, mmap'd append-only log */
 
-    /* Node metadata array (parallel to relations) */
-    node_meta_t* node_meta;
+    /* Node metadata records (parallel to relations), mmap'd */
+    arena_t* meta_arena;
+    node_meta_t* node_meta;     /* Records in meta_arena; moves when it grows */
     size_t node_meta_capacity;
+    size_t meta_dirty_from;     /* Records written since last sync: [from, to) */
+    size_t meta_dirty_to;
+
+    /* Write-ahead log, NULL until enabled */
+    wal_t* wal;
+    wal_writer_t* wal_writer;
+
+    /* Background writeback, NULL until enabled */
+    flusher_t* flusher;
+
+    /* Held by checkpoints and snapshots, which both sync the stores */
+    pthread_mutex_t snapshot_lock;
+
+    /* Mutations hold it shared; a snapshot holds it while copying */
+    pthread_rwlock_t write_gate;
 
-    /* Text content array (parallel to relations) */
-    text_entry_t* text_content;
-    size_t text_content_capacity;
+    /* Serializes node creation, so ids, store appends and the WAL follow
+     * one order: replay needs node N logged before node N + 1 */
+    pthread_mutex_t insert_lock;
 };
 
-/* Metadata file magic and version for validation */
+#define WAL_FILE "wal.log"
+#define TEXT_DIR "text"
+
+/*
+ * node_meta.bin: header followed by one fixed-size record per node_id.
+ * Records are written in place, and a sync flushes only the pages
+ * written since the previous one. metadata.dat, the version 1 format
+ * rewritten in full on every sync, is migrated on open.
+ */
+#define METADATA_FILE "node_meta.bin"
+#define LEGACY_METADATA_FILE "metadata.dat"
 #define METADATA_MAGIC 0x4D454D4F  /* 'MEMO' */
-#define METADATA_VERSION 1
+#define METADATA_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t capacity;
+} node_meta_header_t;
+
+#define META_HEADER_SIZE sizeof(node_meta_header_t)
 
-/* Save node metadata to file */
-static mem_error_t save_metadata(hierarchy_t* h) {
+static inline node_meta_header_t* meta_header(const hierarchy_t* h) {
+    return (node_meta_header_t*)h->meta_arena->base;
+}
+
+/* Point node_meta at the records after mapping or growing the file */
+static void map_meta_records(hierarchy_t* h) {
+    h->node_meta = (node_meta_t*)((char*)h->meta_arena->base + META_HEADER_SIZE);
+    h->node_meta_capacity = meta_header(h)->capacity;
+}
+
+/* Create node_meta.bin with room for capacity records */
+static mem_error_t create_metadata(hierarchy_t* h, size_t capacity) {
     char path[PATH_MAX];
-    snprintf(path, sizeof(path), "%s/metadata.dat", h->base_dir);
+    snprintf(path, sizeof(path), "%s/%s", h->base_dir, METADATA_FILE);
 
-    FILE* f = fopen(path, "wb");
-    if (!f) {
-        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to open metadata file for write");
-    }
+    MEM_CHECK(arena_create_mmap(&h->meta_arena, path,
+                                META_HEADER_SIZE + capacity * sizeof(node_meta_t),
+                                ARENA_FLAG_RANDOM));
 
-    /* Write header: magic, version, count */
-    size_t count = relations_count(h->relations);
-    uint32_t magic = METADATA_MAGIC;
-    uint32_t version = METADATA_VERSION;
-    uint32_t node_count = (uint32_t)count;
+    node_meta_header_t* hdr = meta_header(h);
+    hdr->magic = METADATA_MAGIC;
+    hdr->version = METADATA_VERSION;
+    hdr->count = 0;
+    hdr->capacity = (uint32_t)capacity;
 
-    if (fwrite(&magic, sizeof(magic), 1, f) != 1 ||
-        fwrite(&version, sizeof(version), 1, f) != 1 ||
-        fwrite(&node_count, sizeof(node_count), 1, f) != 1) {
-        fclose(f);
-        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to write metadata header");
-    }
+    map_meta_records(h);
+    h->meta_dirty_from = SIZE_MAX;
+    h->meta_dirty_to = 0;
+    return MEM_OK;
+}
 
-    /* Write node metadata entries */
-    for (size_t i = 0; i < count && i < h->node_meta_capacity; i++) {
-        if (fwrite(&h->node_meta[i], sizeof(node_meta_t), 1, f) != 1) {
-            fclose(f);
-            MEM_RETURN_ERROR(MEM_ERR_IO, "failed to write node metadata");
-        }
-    }
+/* Mark record id as written since the last sync and the last writeback */
+static inline void mark_meta_dirty(hierarchy_t* h, node_id_t id) {
+    if (id < h->meta_dirty_from) h->meta_dirty_from = id;
+    if (id + 1 > h->meta_dirty_to) h->meta_dirty_to = id + 1;
+    arena_mark_dirty(h->meta_arena, META_HEADER_SIZE + (size_t)id * sizeof(node_meta_t),
+                     sizeof(node_meta_t));
+}
 
-    fclose(f);
+/* Flush the header and the records written since the last sync */
+static mem_error_t sync_metadata(hierarchy_t* h) {
+    /* Stored only on change: a write dirties the page and its mtime */
+    uint32_t count = (uint32_t)relations_count(h->relations);
+    if (meta_header(h)->count != count) meta_header(h)->count = count;
+    MEM_CHECK(arena_sync_range(h->meta_arena, 0, META_HEADER_SIZE));
+
+    if (h->meta_dirty_from < h->meta_dirty_to) {
+        MEM_CHECK(arena_sync_range(h->meta_arena,
+                                   META_HEADER_SIZE + h->meta_dirty_from * sizeof(node_meta_t),
+                                   (h->meta_dirty_to - h->meta_dirty_from) * sizeof(node_meta_t)));
+    }
+    h->meta_dirty_from = SIZE_MAX;
+    h->meta_dirty_to = 0;
     return MEM_OK;
 }
 
-/* Load node metadata from file */
-static mem_error_t load_metadata(hierarchy_t* h) {
+/*
+ * Import a version 1 metadata.dat into a freshly created node_meta.bin,
+ * then remove it. A missing file is fine: the hierarchy had no metadata.
+ */
+static mem_error_t migrate_legacy_metadata(hierarchy_t* h) {
     char path[PATH_MAX];
-    snprintf(path, sizeof(path), "%s/metadata.dat", h->base_dir);
+    snprintf(path, sizeof(path), "%s/%s", h->base_dir, LEGACY_METADATA_FILE);
 
     FILE* f = fopen(path, "rb");
-    if (!f) {
-        /* File doesn't exist - not an error for fresh databases */
-        return MEM_OK;
-    }
+    if (!f) return MEM_OK;
 
     /* Read and validate header */
     uint32_t magic, version, node_count;
@@ -102,25 +163,199 @@ static mem_error_t load_metadata(hierarchy_t* h) {
         MEM_RETURN_ERROR(MEM_ERR_IO, "invalid metadata magic - file corrupted");
     }
 
-    if (version != METADATA_VERSION) {
+    if (version != 1) {
         fclose(f);
         MEM_RETURN_ERROR(MEM_ERR_IO, "unsupported metadata version");
     }
 
-    /* Read node metadata entries */
-    for (size_t i = 0; i < node_count && i < h->node_meta_capacity; i++) {
-        if (fread(&h->node_meta[i], sizeof(node_meta_t), 1, f) != 1) {
-            fclose(f);
-            MEM_RETURN_ERROR(MEM_ERR_IO, "failed to read node metadata");
+    size_t n = node_count < h->node_meta_capacity ? node_count : h->node_meta_capacity;
+    if (fread(h->node_meta, sizeof(node_meta_t), n, f) != n) {
+        fclose(f);
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to read node metadata");
+    }
+    fclose(f);
+
+    meta_header(h)->count = (uint32_t)n;
+    MEM_CHECK(arena_sync(h->meta_arena));
+    unlink(path);
+
+    LOG_INFO("Migrated metadata for %u nodes to %s", node_count, METADATA_FILE);
+    return MEM_OK;
+}
+
+/* Map node_meta.bin, creating it (and migrating metadata.dat) if missing */
+static mem_error_t open_metadata(hierarchy_t* h) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", h->base_dir, METADATA_FILE);
+
+    size_t count = relations_count(h->relations);
+    if (access(path, F_OK) != 0) {
+        MEM_CHECK(create_metadata(h, count > 0 ? count * 2 : 1024));
+        return migrate_legacy_metadata(h);
+    }
+
+    MEM_CHECK(arena_open_mmap(&h->meta_arena, path, ARENA_FLAG_RANDOM));
+
+    node_meta_header_t* hdr = meta_header(h);
+    if (arena_size(h->meta_arena) < META_HEADER_SIZE ||
+        hdr->magic != METADATA_MAGIC || hdr->version != METADATA_VERSION) {
+        MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid %s", METADATA_FILE);
+    }
+
+    /* A crash can keep a grown capacity but not the file size behind it;
+     * records past the file are redone from the WAL */
+    size_t held = (arena_size(h->meta_arena) - META_HEADER_SIZE) / sizeof(node_meta_t);
+    if (hdr->capacity > held) hdr->capacity = (uint32_t)held;
+
+    map_meta_records(h);
+    h->meta_dirty_from = SIZE_MAX;
+    h->meta_dirty_to = 0;
+    LOG_INFO("Mapped metadata for %u nodes", hdr->count);
+    return MEM_OK;
+}
+
+/* Create a store subdirectory if missing */
+static mem_error_t ensure_subdir(const char* path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to create %s", path);
+    }
+    return MEM_OK;
+}
+
+/*
+ * Populate the column store from relations and loaded metadata.
+ * Used when opening a hierarchy written before columns existed.
+ * Parents always have lower IDs than children, so one forward pass
+ * can inherit agent/session ownership.
+ */
+static mem_error_t backfill_columns(hierarchy_t* h) {
+    size_t count = relations_count(h->relations);
+
+    for (node_id_t id = 0; id < count; id++) {
+        hierarchy_level_t level = relations_get_level(h->relations, id);
+        node_id_t parent = relations_get_parent(h->relations, id);
+
+        column_row_t row = {
+            .created_at = id < h->node_meta_capacity ? h->node_meta[id].created_at : 0,
+            .token_count = 0,
+            .level = level,
+            .agent = level == LEVEL_AGENT ? id : columns_get_agent(h->columns, parent),
+            .session = level == LEVEL_SESSION ? id : columns_get_session(h->columns, parent)
+        };
+        MEM_CHECK(columns_append(h->columns, id, &row));
+    }
+
+    LOG_INFO("Backfilled column store for %zu nodes", count);
+    return MEM_OK;
+}
+
+/* ID index file, next to node_meta.bin */
+#define ID_INDEX_FILE "id_index.bin"
+
+/* Candidate check for id index lookups */
+typedef struct {
+    const hierarchy_t* h;
+    hierarchy_level_t level;
+    node_id_t parent;           /* NODE_ID_INVALID matches any parent */
+    const char* str;
+} id_match_t;
+
+static bool id_matches(node_id_t node, void* user_data) {
+    const id_match_t* m = user_data;
+    const hierarchy_t* h = m->h;
+
+    if (node >= h->node_meta_capacity ||
+        relations_get_level(h->relations, node) != m->level) {
+        return false;
+    }
+    if (m->level == LEVEL_AGENT) {
+        return strcmp(h->node_meta[node].agent_id, m->str) == 0;
+    }
+    if (m->parent != NODE_ID_INVALID &&
+        relations_get_parent(h->relations, node) != m->parent) {
+        return false;
+    }
+    return strcmp(h->node_meta[node].session_id, m->str) == 0;
+}
+
+/* Look up a session by id under parent, or under any agent */
+static node_id_t find_session_indexed(const hierarchy_t* h, node_id_t parent,
+                                      const char* session_id) {
+    id_match_t m = { h, LEVEL_SESSION, parent, session_id };
+    return id_index_find(h->ids, id_index_key(ID_KEY_SESSION, parent, session_id),
+                         id_matches, &m);
+}
+
+/*
+ * Add an agent or session node to the id index. A key that already finds
+ * a node is left alone: lookups return the first match, and WAL replay
+ * indexes nodes that may be indexed already.
+ */
+static mem_error_t index_node_ids(hierarchy_t* h, node_id_t id) {
+    if (id >= h->node_meta_capacity) return MEM_OK;
+
+    const node_meta_t* meta = &h->node_meta[id];
+    hierarchy_level_t level = relations_get_level(h->relations, id);
+
+    if (level == LEVEL_AGENT) {
+        id_match_t m = { h, LEVEL_AGENT, NODE_ID_INVALID, meta->agent_id };
+        uint64_t key = id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, meta->agent_id);
+        if (id_index_find(h->ids, key, id_matches, &m) == NODE_ID_INVALID) {
+            MEM_CHECK(id_index_insert(h->ids, key, id));
+        }
+    } else if (level == LEVEL_SESSION) {
+        node_id_t agent = relations_get_parent(h->relations, id);
+
+        /* The agent-less key keeps only the first session with this id,
+         * matching what a scan in node order would return */
+        if (find_session_indexed(h, NODE_ID_INVALID, meta->session_id) == NODE_ID_INVALID) {
+            MEM_CHECK(id_index_insert(h->ids,
+                                      id_index_key(ID_KEY_SESSION, NODE_ID_INVALID,
+                                                   meta->session_id), id));
+        }
+        if (agent != NODE_ID_INVALID &&
+            find_session_indexed(h, agent, meta->session_id) == NODE_ID_INVALID) {
+            MEM_CHECK(id_index_insert(h->ids,
+                                      id_index_key(ID_KEY_SESSION, agent, meta->session_id), id));
         }
     }
+    return MEM_OK;
+}
 
-    fclose(f);
-    LOG_INFO("Loaded metadata for %u nodes", node_count);
+/*
+ * Open the id index, creating it for hierarchies that predate it, and
+ * index any nodes written after its watermark (e.g. before a crash).
+ */
+static mem_error_t open_id_index(hierarchy_t* h) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", h->base_dir, ID_INDEX_FILE);
+
+    size_t count = relations_count(h->relations);
+    mem_error_t err = id_index_open(&h->ids, path);
+    if (err == MEM_OK && id_index_watermark(h->ids) > count) {
+        /* Index is ahead of the relations it describes; start over */
+        id_index_close(h->ids);
+        h->ids = NULL;
+        err = MEM_ERR_INDEX_CORRUPT;
+    }
+    if (err == MEM_ERR_OPEN || err == MEM_ERR_INDEX_CORRUPT) {
+        err = id_index_create(&h->ids, path, count / 4);
+    }
+    MEM_CHECK(err);
+
+    size_t watermark = id_index_watermark(h->ids);
+    for (node_id_t id = (node_id_t)watermark; id < count; id++) {
+        MEM_CHECK(index_node_ids(h, id));
+    }
+    id_index_set_watermark(h->ids, count);
+
+    if (watermark < count) {
+        LOG_INFO("Indexed agent/session ids for %zu nodes", count - watermark);
+    }
     return MEM_OK;
 }
 
-/* Ensure node metadata array has capacity */
+/* Ensure node metadata file has capacity; may move node_meta */
 static mem_error_t ensure_meta_capacity(hierarchy_t* h, size_t needed) {
     if (needed <= h->node_meta_capacity) {
         return MEM_OK;
@@ -130,21 +365,25 @@ static mem_error_t ensure_meta_capacity(hierarchy_t* h, size_t needed) {
     if (new_capacity < needed) new_capacity = needed;
     if (new_capacity < 1024) new_capacity = 1024;
 
-    node_meta_t* new_meta = realloc(h->node_meta, new_capacity * sizeof(node_meta_t));
-    if (!new_meta) {
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to grow node metadata array");
-    }
-
-    /* Zero-initialize new entries */
-    memset(new_meta + h->node_meta_capacity, 0,
-           (new_capacity - h->node_meta_capacity) * sizeof(node_meta_t));
-
-    h->node_meta = new_meta;
-    h->node_meta_capacity = new_capacity;
+    /* New records come from the file extension and read as zero */
+    MEM_CHECK(arena_grow(h->meta_arena, META_HEADER_SIZE + new_capacity * sizeof(node_meta_t)));
+    meta_header(h)->capacity = (uint32_t)new_capacity;
+    map_meta_records(h);
 
     return MEM_OK;
 }
 
+/* A snapshot waiting for the gate must not starve behind steady writes */
+static void init_write_gate(pthread_rwlock_t* gate) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#if defined(__GLIBC__)
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(gate, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
 mem_error_t hierarchy_create(hierarchy_t** h, const char* dir, size_t capacity) {
     MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy ptr is NULL");
     MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
@@ -158,6 +397,9 @@ mem_error_t hierarchy_create(hierarchy_t** h, const char* dir, size_t capacity)
         free(hier);
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
     }
+    pthread_mutex_init(&hier->snapshot_lock, NULL);
+    init_write_gate(&hier->write_gate);
+    pthread_mutex_init(&hier->insert_lock, NULL);
 
     /* Create subdirectories */
     char path[PATH_MAX];
@@ -171,21 +413,25 @@ mem_error_t hierarchy_create(hierarchy_t** h, const char* dir, size_t capacity)
     err = embeddings_create(&hier->embeddings, path, capacity);
     if (err != MEM_OK) goto cleanup;
 
+    snprintf(path, sizeof(path), "%s/columns", dir);
+    err = ensure_subdir(path);
+    if (err != MEM_OK) goto cleanup;
+    err = columns_create(&hier->columns, path, capacity);
+    if (err != MEM_OK) goto cleanup;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, ID_INDEX_FILE);
+    err = id_index_create(&hier->ids, path, capacity / 4);
+    if (err != MEM_OK) goto cleanup;
+
     /* Initialize node metadata */
-    hier->node_meta = calloc(capacity, sizeof(node_meta_t));
-    if (!hier->node_meta) {
-        err = MEM_ERR_NOMEM;
-        goto cleanup;
-    }
-    hier->node_meta_capacity = capacity;
+    err = create_metadata(hier, capacity);
+    if (err != MEM_OK) goto cleanup;
 
-    /* Initialize text content storage */
-    hier->text_content = calloc(capacity, sizeof(text_entry_t));
-    if (!hier->text_content) {
-        err = MEM_ERR_NOMEM;
-        goto cleanup;
-    }
-    hier->text_content_capacity = capacity;
+    snprintf(path, sizeof(path), "%s/" TEXT_DIR, dir);
+    err = ensure_subdir(path);
+    if (err != MEM_OK) goto cleanup;
+    err = text_store_create(&hier->text, path, 0);
+    if (err != MEM_OK) goto cleanup;
 
     *h = hier;
     LOG_INFO("Hierarchy created at %s with capacity %zu", dir, capacity);
@@ -194,8 +440,13 @@ mem_error_t hierarchy_create(hierarchy_t** h, const char* dir, size_t capacity)
 cleanup:
     if (hier->relations) relations_close(hier->relations);
     if (hier->embeddings) embeddings_close(hier->embeddings);
-    free(hier->node_meta);
-    free(hier->text_content);
+    if (hier->columns) columns_close(hier->columns);
+    if (hier->ids) id_index_close(hier->ids);
+    if (hier->text) text_store_close(hier->text);
+    if (hier->meta_arena) arena_destroy(hier->meta_arena);
+    pthread_mutex_destroy(&hier->snapshot_lock);
+    pthread_rwlock_destroy(&hier->write_gate);
+    pthread_mutex_destroy(&hier->insert_lock);
     free(hier->base_dir);
     free(hier);
     return err;
@@ -213,6 +464,9 @@ mem_error_t hierarchy_open(hierarchy_t** h, const char* dir) {
         free(hier);
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
     }
+    pthread_mutex_init(&hier->snapshot_lock, NULL);
+    init_write_gate(&hier->write_gate);
+    pthread_mutex_init(&hier->insert_lock, NULL);
 
     char path[PATH_MAX];
     mem_error_t err;
@@ -225,27 +479,35 @@ mem_error_t hierarchy_open(hierarchy_t** h, const char* dir) {
     err = embeddings_open(&hier->embeddings, path);
     if (err != MEM_OK) goto cleanup;
 
-    /* Initialize node metadata array based on existing node count */
+    /* Map persisted node metadata */
     size_t count = relations_count(hier->relations);
-    size_t capacity = count > 0 ? count * 2 : 1024;
+    err = open_metadata(hier);
+    if (err != MEM_OK) goto cleanup;
 
-    hier->node_meta = calloc(capacity, sizeof(node_meta_t));
-    if (!hier->node_meta) {
-        err = MEM_ERR_NOMEM;
-        goto cleanup;
+    /* Open column store, rebuilding it for hierarchies that predate it */
+    snprintf(path, sizeof(path), "%s/columns", dir);
+    err = columns_open(&hier->columns, path);
+    if (err == MEM_ERR_OPEN) {
+        err = ensure_subdir(path);
+        if (err != MEM_OK) goto cleanup;
+        err = columns_create(&hier->columns, path, hier->relations->capacity);
+        if (err != MEM_OK) goto cleanup;
+        err = backfill_columns(hier);
     }
-    hier->node_meta_capacity = capacity;
+    if (err != MEM_OK) goto cleanup;
 
-    /* Initialize text content storage */
-    hier->text_content = calloc(capacity, sizeof(text_entry_t));
-    if (!hier->text_content) {
-        err = MEM_ERR_NOMEM;
-        goto cleanup;
-    }
-    hier->text_content_capacity = capacity;
+    /* Needs relations and loaded metadata */
+    err = open_id_index(hier);
+    if (err != MEM_OK) goto cleanup;
 
-    /* Load persisted metadata */
-    err = load_metadata(hier);
+    /* Open text log; hierarchies that predate it start with an empty one */
+    snprintf(path, sizeof(path), "%s/" TEXT_DIR, dir);
+    err = text_store_open(&hier->text, path);
+    if (err == MEM_ERR_OPEN) {
+        err = ensure_subdir(path);
+        if (err != MEM_OK) goto cleanup;
+        err = text_store_create(&hier->text, path, 0);
+    }
     if (err != MEM_OK) goto cleanup;
 
     *h = hier;
@@ -255,8 +517,13 @@ mem_error_t hierarchy_open(hierarchy_t** h, const char* dir) {
 cleanup:
     if (hier->relations) relations_close(hier->relations);
     if (hier->embeddings) embeddings_close(hier->embeddings);
-    free(hier->node_meta);
-    free(hier->text_content);
+    if (hier->columns) columns_close(hier->columns);
+    if (hier->ids) id_index_close(hier->ids);
+    if (hier->text) text_store_close(hier->text);
+    if (hier->meta_arena) arena_destroy(hier->meta_arena);
+    pthread_mutex_destroy(&hier->snapshot_lock);
+    pthread_rwlock_destroy(&hier->write_gate);
+    pthread_mutex_destroy(&hier->insert_lock);
     free(hier->base_dir);
     free(hier);
     return err;
@@ -265,20 +532,24 @@ cleanup:
 void hierarchy_close(hierarchy_t* h) {
     if (!h) return;
 
-    hierarchy_sync(h);
+    flusher_destroy(h->flusher);
+
+    /* Stores hold every logged mutation once synced, so a clean close
+     * leaves an empty WAL */
+    if (h->wal_writer) wal_writer_destroy(h->wal_writer);
+    if (hierarchy_sync(h) == MEM_OK && h->wal) wal_truncate(h->wal);
+    if (h->wal) wal_close(h->wal);
 
     if (h->relations) relations_close(h->relations);
     if (h->embeddings) embeddings_close(h->embeddings);
-
-    /* Free text content */
-    if (h->text_content) {
-        for (size_t i = 0; i < h->text_content_capacity; i++) {
-            free(h->text_content[i].text);
-        }
-        free(h->text_content);
-    }
-
-    free(h->node_meta);
+    if (h->columns) columns_close(h->columns);
+    if (h->ids) id_index_close(h->ids);
+    if (h->text) text_store_close(h->text);
+
+    if (h->meta_arena) arena_destroy(h->meta_arena);
+    pthread_mutex_destroy(&h->snapshot_lock);
+    pthread_rwlock_destroy(&h->write_gate);
+    pthread_mutex_destroy(&h->insert_lock);
     free(h->base_dir);
     free(h);
 }
@@ -288,56 +559,108 @@ mem_error_t hierarchy_sync(hierarchy_t* h) {
 
     MEM_CHECK(relations_sync(h->relations));
     MEM_CHECK(embeddings_sync(h->embeddings));
-    MEM_CHECK(save_metadata(h));
+    MEM_CHECK(columns_sync(h->columns));
+    MEM_CHECK(id_index_sync(h->ids));
+    MEM_CHECK(text_store_sync(h->text));
+    MEM_CHECK(sync_metadata(h));
+
+    return MEM_OK;
+}
+
+mem_error_t hierarchy_set_mmap_config(hierarchy_t* h, const hierarchy_mmap_config_t* config) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    MEM_CHECK_ERR(config != NULL, MEM_ERR_INVALID_ARG, "config is NULL");
+
+    uint32_t populate = config->populate ? ARENA_FLAG_POPULATE : 0;
+    MEM_CHECK(relations_advise(h->relations, RELATIONS_ARENA_FLAGS | populate));
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        uint32_t hints = EMBEDDING_ARENA_FLAGS | populate;
+        if (config->lock_levels & (1u << level)) hints |= ARENA_FLAG_LOCK;
+        MEM_CHECK(embeddings_advise(h->embeddings, (hierarchy_level_t)level, hints));
+    }
 
     return MEM_OK;
 }
 
-/* Internal: Create a node at specified level under parent */
-static mem_error_t create_node_internal(hierarchy_t* h,
-                                        node_id_t parent_id,
-                                        hierarchy_level_t level,
-                                        const char* agent_id,
-                                        const char* session_id,
-                                        node_id_t* out_id) {
+/* Queue a WAL record whose payload is head followed by body */
+static mem_error_t log_mutation(hierarchy_t* h, wal_op_type_t op,
+                                const void* head, size_t head_len,
+                                const void* body, size_t body_len) {
+    if (!h->wal_writer) return MEM_OK;
+
+    struct iovec parts[2] = {
+        { (void*)head, head_len },
+        { (void*)body, body_len }
+    };
+    return wal_writer_log(h->wal_writer, op, parts, body_len > 0 ? 2 : 1, NULL);
+}
+
+/* Create a node at specified level under parent, with begin_insert held */
+static mem_error_t insert_node(hierarchy_t* h,
+                               node_id_t parent_id,
+                               hierarchy_level_t level,
+                               const char* agent_id,
+                               const char* session_id,
+                               timestamp_ns_t created_at,
+                               node_id_t* out_id) {
+    /* Callers may pass ids from a parent's record; growing moves them */
+    char agent_buf[MAX_AGENT_ID_LEN];
+    char session_buf[MAX_SESSION_ID_LEN];
+    if (agent_id) {
+        snprintf(agent_buf, sizeof(agent_buf), "%s", agent_id);
+        agent_id = agent_buf;
+    }
+    if (session_id) {
+        snprintf(session_buf, sizeof(session_buf), "%s", session_id);
+        session_id = session_buf;
+    }
+
+    /* Whatever can fail runs before the node is allocated, so a failure
+     * leaves no store holding a node the others lack */
+    node_id_t next = (node_id_t)relations_count(h->relations);
+    if (parent_id != NODE_ID_INVALID && parent_id >= next) {
+        MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "parent %u not found", parent_id);
+    }
+    MEM_CHECK(relations_reserve(h->relations, next));
+    MEM_CHECK(columns_reserve(h->columns, next));
+    MEM_CHECK(ensure_meta_capacity(h, (size_t)next + 1));
+
+    /* Allocate embedding slot */
+    uint32_t emb_idx;
+    MEM_CHECK(embeddings_alloc(h->embeddings, level, &emb_idx));
+
     /* Allocate node in relations store */
     node_id_t id;
     MEM_CHECK(relations_alloc_node(h->relations, &id));
 
-    /* Ensure metadata capacity */
-    MEM_CHECK(ensure_meta_capacity(h, id + 1));
-
     /* Set level */
     MEM_CHECK(relations_set_level(h->relations, id, level));
 
-    /* Set parent relationship */
+    /* Set parent relationship; the tail it links after is logged for redo */
+    node_id_t prev_sibling = NODE_ID_INVALID;
+    uint32_t child_index = 0;
     if (parent_id != NODE_ID_INVALID) {
-        MEM_CHECK(relations_set_parent(h->relations, id, parent_id));
-
-        /* Link as child of parent */
-        node_id_t first_child = relations_get_first_child(h->relations, parent_id);
-        if (first_child == NODE_ID_INVALID) {
-            /* First child */
-            MEM_CHECK(relations_set_first_child(h->relations, parent_id, id));
-        } else {
-            /* Find last sibling and link */
-            node_id_t last = first_child;
-            node_id_t next = relations_get_next_sibling(h->relations, last);
-            while (next != NODE_ID_INVALID) {
-                last = next;
-                next = relations_get_next_sibling(h->relations, last);
-            }
-            MEM_CHECK(relations_set_next_sibling(h->relations, last, id));
-        }
-    }
+        prev_sibling = relations_get_last_child(h->relations, parent_id);
+        child_index = relations_get_child_count(h->relations, parent_id);
 
-    /* Allocate embedding slot */
-    uint32_t emb_idx;
-    MEM_CHECK(embeddings_alloc(h->embeddings, level, &emb_idx));
+        /* Link as last child of parent */
+        MEM_CHECK(relations_append_child(h->relations, parent_id, id));
+    }
 
     /* Store metadata */
     node_meta_t* meta = &h->node_meta[id];
-    meta->created_at = timestamp_now_ns();
+    meta->created_at = created_at ? created_at : timestamp_now_ns();
+
+    /* Append scoring columns; ownership is inherited from the parent */
+    column_row_t row = {
+        .created_at = meta->created_at,
+        .token_count = 0,
+        .level = level,
+        .agent = level == LEVEL_AGENT ? id : columns_get_agent(h->columns, parent_id),
+        .session = level == LEVEL_SESSION ? id : columns_get_session(h->columns, parent_id)
+    };
+    MEM_CHECK(columns_append(h->columns, id, &row));
     meta->embedding_idx = emb_idx;
 
     if (agent_id) {
@@ -349,44 +672,58 @@ static mem_error_t create_node_internal(hierarchy_t* h,
         snprintf(meta->session_id, MAX_SESSION_ID_LEN, "%s", session_id);
         meta->session_id[MAX_SESSION_ID_LEN - 1] = '\0';
     }
+    mark_meta_dirty(h, id);
+
+    MEM_CHECK(index_node_ids(h, id));
+    id_index_set_watermark(h->ids, id + 1);
+
+    /* Logged last: a node in the WAL is complete in the stores */
+    wal_node_data_t rec = {
+        .node_id = id,
+        .level = level,
+        .parent_id = parent_id,
+        .embedding_idx = emb_idx,
+        .created_at = meta->created_at,
+        .prev_sibling = prev_sibling,
+        .child_index = child_index
+    };
+    memcpy(rec.agent_id, meta->agent_id, MAX_AGENT_ID_LEN);
+    memcpy(rec.session_id, meta->session_id, MAX_SESSION_ID_LEN);
+    MEM_CHECK(log_mutation(h, WAL_OP_NODE_INSERT, &rec, sizeof(rec), NULL, 0));
 
     *out_id = id;
     return MEM_OK;
 }
 
+/*
+ * Take the write gate and the insert lock. Checks that a new node is
+ * unique, and reads of the parent record it inherits from, go under it
+ * too: another insert can move node_meta.
+ */
+static void begin_insert(hierarchy_t* h) {
+    pthread_rwlock_rdlock(&h->write_gate);
+    pthread_mutex_lock(&h->insert_lock);
+}
+
+static void end_insert(hierarchy_t* h) {
+    pthread_mutex_unlock(&h->insert_lock);
+    pthread_rwlock_unlock(&h->write_gate);
+}
+
 /* Find existing agent by agent_id string */
 static node_id_t find_agent_by_id(const hierarchy_t* h, const char* agent_id) {
     if (!h || !agent_id) return NODE_ID_INVALID;
 
-    size_t count = relations_count(h->relations);
-    for (node_id_t id = 0; id < count; id++) {
-        hierarchy_level_t level = relations_get_level(h->relations, id);
-        if (level == LEVEL_AGENT && id < h->node_meta_capacity) {
-            if (strcmp(h->node_meta[id].agent_id, agent_id) == 0) {
-                return id;
-            }
-        }
-    }
-    return NODE_ID_INVALID;
+    id_match_t m = { h, LEVEL_AGENT, NODE_ID_INVALID, agent_id };
+    return id_index_find(h->ids, id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, agent_id),
+                         id_matches, &m);
 }
 
 /* Find existing session by session_id string under a specific agent */
 static node_id_t find_session_by_id(const hierarchy_t* h, node_id_t agent_node_id,
                                     const char* session_id) {
-    if (!h || !session_id) return NODE_ID_INVALID;
-
-    /* Iterate children of agent to find matching session */
-    node_id_t child = relations_get_first_child(h->relations, agent_node_id);
-    while (child != NODE_ID_INVALID) {
-        hierarchy_level_t level = relations_get_level(h->relations, child);
-        if (level == LEVEL_SESSION && child < h->node_meta_capacity) {
-            if (strcmp(h->node_meta[child].session_id, session_id) == 0) {
-                return child;
-            }
-        }
-        child = relations_get_next_sibling(h->relations, child);
-    }
-    return NODE_ID_INVALID;
+    if (!h || !session_id || agent_node_id == NODE_ID_INVALID) return NODE_ID_INVALID;
+    return find_session_indexed(h, agent_node_id, session_id);
 }
 
 mem_error_t hierarchy_create_agent(hierarchy_t* h,
@@ -396,15 +733,20 @@ mem_error_t hierarchy_create_agent(hierarchy_t* h,
     MEM_CHECK_ERR(agent_id != NULL, MEM_ERR_INVALID_ARG, "agent_id is NULL");
     MEM_CHECK_ERR(out_id != NULL, MEM_ERR_INVALID_ARG, "out_id is NULL");
 
+    begin_insert(h);
+
     /* Check if agent already exists */
+    mem_error_t err;
     node_id_t existing = find_agent_by_id(h, agent_id);
     if (existing != NODE_ID_INVALID) {
         *out_id = existing;
-        return MEM_ERR_EXISTS;
+        err = MEM_ERR_EXISTS;
+    } else {
+        err = insert_node(h, NODE_ID_INVALID, LEVEL_AGENT, agent_id, NULL, 0, out_id);
     }
 
-    return create_node_internal(h, NODE_ID_INVALID, LEVEL_AGENT,
-                               agent_id, NULL, out_id);
+    end_insert(h);
+    return err;
 }
 
 mem_error_t hierarchy_create_session(hierarchy_t* h,
@@ -415,28 +757,51 @@ mem_error_t hierarchy_create_session(hierarchy_t* h,
     MEM_CHECK_ERR(session_id != NULL, MEM_ERR_INVALID_ARG, "session_id is NULL");
     MEM_CHECK_ERR(out_id != NULL, MEM_ERR_INVALID_ARG, "out_id is NULL");
 
-    /* Verify parent is an agent */
+    begin_insert(h);
+
+    /* Verify parent is an agent, then check if the session already exists under it */
+    mem_error_t err;
+    node_id_t existing = NODE_ID_INVALID;
     hierarchy_level_t parent_level = relations_get_level(h->relations, agent_node_id);
     if (parent_level != LEVEL_AGENT) {
-        MEM_RETURN_ERROR(MEM_ERR_INVALID_LEVEL,
-                        "session parent must be agent, got level %d", parent_level);
+        MEM_SET_ERROR(MEM_ERR_INVALID_LEVEL,
+                      "session parent must be agent, got level %d", parent_level);
+        err = MEM_ERR_INVALID_LEVEL;
+    } else if ((existing = find_session_by_id(h, agent_node_id, session_id)) != NODE_ID_INVALID) {
+        *out_id = existing;
+        err = MEM_ERR_EXISTS;
+    } else {
+        /* Get agent_id from parent for inheritance */
+        const char* agent_id_str = NULL;
+        if (agent_node_id < h->node_meta_capacity) {
+            agent_id_str = h->node_meta[agent_node_id].agent_id;
+        }
+        err = insert_node(h, agent_node_id, LEVEL_SESSION, agent_id_str, session_id, 0, out_id);
     }
 
-    /* Check if session already exists under this agent */
-    node_id_t existing = find_session_by_id(h, agent_node_id, session_id);
-    if (existing != NODE_ID_INVALID) {
-        *out_id = existing;
-        return MEM_ERR_EXISTS;
+    end_insert(h);
+    return err;
+}
+
+/* Create a child of parent_id, with begin_insert held */
+static mem_error_t insert_child(hierarchy_t* h, node_id_t parent_id,
+                                hierarchy_level_t level, node_id_t* out_id) {
+    /* Validate level hierarchy */
+    hierarchy_level_t parent_level = relations_get_level(h->relations, parent_id);
+    if (level >= parent_level) {
+        MEM_RETURN_ERROR(MEM_ERR_INVALID_LEVEL,
+                        "child level %d must be < parent level %d", level, parent_level);
     }
 
-    /* Get agent_id from parent for inheritance */
-    const char* agent_id_str = NULL;
-    if (agent_node_id < h->node_meta_capacity) {
-        agent_id_str = h->node_meta[agent_node_id].agent_id;
+    /* Inherit session info from parent */
+    const char* agent_id = NULL;
+    const char* session_id = NULL;
+    if (parent_id < h->node_meta_capacity) {
+        agent_id = h->node_meta[parent_id].agent_id;
+        session_id = h->node_meta[parent_id].session_id;
     }
 
-    return create_node_internal(h, agent_node_id, LEVEL_SESSION,
-                               agent_id_str, session_id, out_id);
+    return insert_node(h, parent_id, level, agent_id, session_id, 0, out_id);
 }
 
 mem_error_t hierarchy_create_child(hierarchy_t* h,
@@ -448,22 +813,312 @@ mem_error_t hierarchy_create_child(hierarchy_t* h,
     MEM_CHECK_ERR(level < LEVEL_COUNT, MEM_ERR_INVALID_LEVEL, "invalid level");
     MEM_CHECK_ERR(out_id != NULL, MEM_ERR_INVALID_ARG, "out_id is NULL");
 
-    /* Validate level hierarchy */
-    hierarchy_level_t parent_level = relations_get_level(h->relations, parent_id);
-    if (level >= parent_level) {
-        MEM_RETURN_ERROR(MEM_ERR_INVALID_LEVEL,
-                        "child level %d must be < parent level %d", level, parent_level);
+    begin_insert(h);
+    mem_error_t err = insert_child(h, parent_id, level, out_id);
+    end_insert(h);
+    return err;
+}
+
+/*
+ * Write-ahead log
+ *
+ * Mutations are applied to the mmap'd stores first and logged after, so
+ * every logged record is already reflected in memory. Replay is
+ * idempotent redo: a node record rewrites every slot its insert wrote,
+ * text equal to the stored copy is not appended again, and embeddings and
+ * token counts are plain overwrites. After a process crash the stores are
+ * complete and replay rewrites them with the same values; after losing
+ * unsynced pages, which may leave a store's count ahead of rows that
+ * never reached disk, it rebuilds every node the log covers.
+ */
+
+/* Rewrite every slot insert_node wrote for a logged node, write gate held */
+static mem_error_t redo_node(hierarchy_t* h, const wal_node_data_t* rec) {
+    node_id_t id = rec->node_id;
+    hierarchy_level_t level = rec->level;
+    node_id_t parent_id = rec->parent_id;
+
+    MEM_CHECK_ERR(level < LEVEL_COUNT, MEM_ERR_WAL_CORRUPT,
+                  "WAL node %u has level %d", id, level);
+    MEM_CHECK_ERR(parent_id == NODE_ID_INVALID || parent_id < id, MEM_ERR_WAL_CORRUPT,
+                  "WAL node %u has parent %u", id, parent_id);
+
+    size_t count = relations_count(h->relations);
+    if (id > count) {
+        MEM_RETURN_ERROR(MEM_ERR_WAL_CORRUPT, "WAL node %u follows only %zu nodes",
+                         id, count);
     }
+    MEM_CHECK(relations_reserve(h->relations, id));
+    MEM_CHECK(columns_reserve(h->columns, id));
+    MEM_CHECK(ensure_meta_capacity(h, (size_t)id + 1));
 
-    /* Inherit session info from parent */
-    const char* agent_id = NULL;
-    const char* session_id = NULL;
-    if (parent_id < h->node_meta_capacity) {
-        agent_id = h->node_meta[parent_id].agent_id;
-        session_id = h->node_meta[parent_id].session_id;
+    if (id == count) {
+        node_id_t allocated;
+        MEM_CHECK(relations_alloc_node(h->relations, &allocated));
+    }
+
+    /* Slots are handed out in order; a count that never reached disk
+     * would hand this one out again */
+    while (embeddings_count(h->embeddings, level) <= rec->embedding_idx) {
+        uint32_t idx;
+        MEM_CHECK(embeddings_alloc(h->embeddings, level, &idx));
+    }
+
+    MEM_CHECK(relations_set_level(h->relations, id, level));
+    MEM_CHECK(relations_relink_child(h->relations, parent_id, id,
+                                     rec->prev_sibling, rec->child_index));
+
+    node_meta_t* meta = &h->node_meta[id];
+    meta->created_at = rec->created_at;
+    meta->embedding_idx = rec->embedding_idx;
+    memcpy(meta->agent_id, rec->agent_id, MAX_AGENT_ID_LEN);
+    memcpy(meta->session_id, rec->session_id, MAX_SESSION_ID_LEN);
+    meta->agent_id[MAX_AGENT_ID_LEN - 1] = '\0';
+    meta->session_id[MAX_SESSION_ID_LEN - 1] = '\0';
+    mark_meta_dirty(h, id);
+
+    /* Token counts follow in their own records */
+    column_row_t row = {
+        .created_at = rec->created_at,
+        .token_count = 0,
+        .level = level,
+        .agent = level == LEVEL_AGENT ? id : columns_get_agent(h->columns, parent_id),
+        .session = level == LEVEL_SESSION ? id : columns_get_session(h->columns, parent_id)
+    };
+    MEM_CHECK(columns_set_row(h->columns, id, &row));
+
+    MEM_CHECK(index_node_ids(h, id));
+    if (id_index_watermark(h->ids) <= id) id_index_set_watermark(h->ids, id + 1);
+    return MEM_OK;
+}
+
+static mem_error_t replay_node(hierarchy_t* h, const void* data, size_t len) {
+    wal_node_data_t rec = {0};
+    memcpy(&rec, data, len);
+
+    /* Older records lack the link they were appended after; only nodes the
+     * stores do not hold yet can be redone, from the parent's current tail */
+    if (len == WAL_NODE_DATA_V1_SIZE) {
+        if (rec.node_id < relations_count(h->relations)) return MEM_OK;
+        if (rec.parent_id < rec.node_id) {
+            rec.prev_sibling = relations_get_last_child(h->relations, rec.parent_id);
+            rec.child_index = relations_get_child_count(h->relations, rec.parent_id);
+        }
     }
 
-    return create_node_internal(h, parent_id, level, agent_id, session_id, out_id);
+    pthread_rwlock_rdlock(&h->write_gate);
+    mem_error_t err = redo_node(h, &rec);
+    pthread_rwlock_unlock(&h->write_gate);
+    return err;
+}
+
+static mem_error_t replay_record(wal_op_type_t op, const void* data, size_t len,
+                                 void* user_data) {
+    hierarchy_t* h = user_data;
+    size_t count = relations_count(h->relations);
+
+    switch (op) {
+        case WAL_OP_NODE_INSERT:
+            MEM_CHECK_ERR(len == sizeof(wal_node_data_t) || len == WAL_NODE_DATA_V1_SIZE,
+                          MEM_ERR_WAL_CORRUPT, "bad node record length %zu", len);
+            return replay_node(h, data, len);
+
+        case WAL_OP_TEXT_SET: {
+            const wal_text_data_t* rec = data;
+            MEM_CHECK_ERR(len >= sizeof(*rec) && len - sizeof(*rec) == rec->len,
+                          MEM_ERR_WAL_CORRUPT, "bad text record length %zu", len);
+            MEM_CHECK_ERR(rec->node_id < count, MEM_ERR_WAL_CORRUPT,
+                          "WAL text for unknown node %u", rec->node_id);
+
+            const char* text = (const char*)(rec + 1);
+            char* stored = malloc((size_t)rec->len + 1);
+            MEM_CHECK_ALLOC(stored);
+            size_t stored_len = 0;
+            bool same = text_store_get(h->text, rec->node_id, stored, (size_t)rec->len + 1,
+                                       &stored_len) &&
+                        stored_len == rec->len && memcmp(stored, text, rec->len) == 0;
+            free(stored);
+            if (same) return MEM_OK;
+            return text_store_put(h->text, rec->node_id, text, rec->len);
+        }
+
+        case WAL_OP_EMBEDDING_SET: {
+            const wal_embedding_data_t* rec = data;
+            MEM_CHECK_ERR(len == sizeof(*rec), MEM_ERR_WAL_CORRUPT,
+                          "bad embedding record length %zu", len);
+            MEM_CHECK_ERR(rec->node_id < count, MEM_ERR_WAL_CORRUPT,
+                          "WAL embedding for unknown node %u", rec->node_id);
+            return embeddings_set(h->embeddings, rec->level, rec->embedding_idx, rec->values);
+        }
+
+        case WAL_OP_TOKENS_SET: {
+            const wal_tokens_data_t* rec = data;
+            MEM_CHECK_ERR(len == sizeof(*rec), MEM_ERR_WAL_CORRUPT,
+                          "bad token record length %zu", len);
+            return columns_set_token_count(h->columns, rec->node_id, rec->token_count);
+        }
+
+        default:
+            return MEM_OK;
+    }
+}
+
+static mem_error_t sync_for_checkpoint(void* arg) {
+    return hierarchy_sync(arg);
+}
+
+mem_error_t hierarchy_enable_wal(hierarchy_t* h, size_t max_size, const wal_config_t* config) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    MEM_CHECK_ERR(h->wal == NULL, MEM_ERR_EXISTS, "WAL already enabled");
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", h->base_dir, WAL_FILE);
+
+    MEM_CHECK(wal_create(&h->wal, path, max_size ? max_size : HIERARCHY_WAL_SIZE_DEFAULT));
+
+    mem_error_t err = config ? wal_set_config(h->wal, config) : MEM_OK;
+
+    /* Recover what an unclean shutdown left, then start from an empty log.
+     * The writer is not running yet, so replay logs nothing itself. */
+    if (err == MEM_OK && wal_size(h->wal) > 0) {
+        size_t before = relations_count(h->relations);
+        uint64_t start = time_now_ns();
+
+        err = wal_replay(h->wal, replay_record, h);
+        if (err == MEM_OK) err = hierarchy_sync(h);
+        if (err == MEM_OK) err = wal_checkpoint(h->wal);
+        if (err == MEM_OK) err = wal_truncate(h->wal);
+        if (err == MEM_OK) {
+            LOG_INFO("WAL recovery restored %zu nodes in %.1f ms",
+                     relations_count(h->relations) - before,
+                     (double)(time_now_ns() - start) / 1e6);
+        }
+    }
+
+    if (err == MEM_OK) err = wal_prepare_segment(h->wal);
+    if (err == MEM_OK) err = wal_writer_create(&h->wal_writer, h->wal);
+    if (err != MEM_OK) {
+        wal_close(h->wal);
+        h->wal = NULL;
+        return err;
+    }
+
+    LOG_INFO("WAL enabled at %s", path);
+    return MEM_OK;
+}
+
+/* Checkpoint with snapshot_lock held */
+static mem_error_t checkpoint_locked(hierarchy_t* h) {
+    if (!h->wal_writer) return hierarchy_sync(h);
+    return wal_writer_checkpoint(h->wal_writer, sync_for_checkpoint, h);
+}
+
+mem_error_t hierarchy_checkpoint(hierarchy_t* h) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+
+    pthread_mutex_lock(&h->snapshot_lock);
+    mem_error_t err = checkpoint_locked(h);
+    pthread_mutex_unlock(&h->snapshot_lock);
+    return err;
+}
+
+mem_error_t hierarchy_commit(hierarchy_t* h) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    if (!h->wal_writer) return MEM_OK;
+
+    MEM_CHECK(wal_writer_flush(h->wal_writer));
+
+    /* The commit is durable either way; a failed checkpoint, or one put
+     * off while a snapshot or another checkpoint runs, is retried */
+    if (wal_writer_needs_checkpoint(h->wal_writer) &&
+        pthread_mutex_trylock(&h->snapshot_lock) == 0) {
+        mem_error_t err = checkpoint_locked(h);
+        pthread_mutex_unlock(&h->snapshot_lock);
+        if (err != MEM_OK) {
+            LOG_WARN("WAL checkpoint failed: %s", mem_error_str(err));
+        }
+    }
+    return MEM_OK;
+}
+
+mem_error_t hierarchy_enable_flusher(hierarchy_t* h, uint32_t interval_ms) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    MEM_CHECK_ERR(h->flusher == NULL, MEM_ERR_EXISTS, "flusher already enabled");
+
+    MEM_CHECK(flusher_create(&h->flusher, interval_ms));
+    LOG_INFO("Background writeback every %u ms",
+             interval_ms ? interval_ms : FLUSHER_INTERVAL_DEFAULT_MS);
+    return MEM_OK;
+}
+
+/*
+ * Copy the stores while writes go on, then the WAL once it covers every
+ * write made meanwhile. Checkpoints wait on snapshot_lock, so the copied
+ * log still holds everything since the last one and replaying it redoes
+ * whatever a store was copied without (see hierarchy_enable_wal). Text
+ * is copied with its own writes paused: a text store must open before
+ * the log can be replayed into it.
+ */
+static mem_error_t snapshot_copy_wal_cut(hierarchy_t* h, snapshot_t* snap,
+                                         uint64_t* sequence) {
+    mem_error_t err = snapshot_copy_tree(snap, NULL, (const char*[]){ WAL_FILE, TEXT_DIR, NULL });
+
+    if (err == MEM_OK) {
+        text_store_pause_writes(h->text);
+        err = snapshot_copy_tree(snap, (const char*[]){ TEXT_DIR, NULL }, NULL);
+        text_store_resume_writes(h->text);
+    }
+
+    /* Mutations log before releasing the gate, so once it has been held
+     * every change the copies may have caught is in the flushed log */
+    if (err == MEM_OK) {
+        pthread_rwlock_wrlock(&h->write_gate);
+        err = wal_writer_flush(h->wal_writer);
+        *sequence = wal_sequence(h->wal);
+        pthread_rwlock_unlock(&h->write_gate);
+    }
+    if (err == MEM_OK) err = snapshot_copy_tree(snap, (const char*[]){ WAL_FILE, NULL }, NULL);
+    return err;
+}
+
+mem_error_t hierarchy_snapshot(hierarchy_t* h, const char* dest_dir,
+                               const char* base_dir, snapshot_stats_t* stats) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    MEM_CHECK_ERR(dest_dir != NULL, MEM_ERR_INVALID_ARG, "dest_dir is NULL");
+
+    pthread_mutex_lock(&h->snapshot_lock);
+
+    snapshot_t* snap = NULL;
+    mem_error_t err = snapshot_begin(&snap, h->base_dir, dest_dir, base_dir);
+    if (err != MEM_OK) {
+        pthread_mutex_unlock(&h->snapshot_lock);
+        return err;
+    }
+
+    /* The sync gives changed files a new mtime, so the next snapshot
+     * links only unchanged ones */
+    pthread_rwlock_wrlock(&h->write_gate);
+    uint64_t sequence = 0;
+    if (!h->wal_writer) {
+        /* Nothing could repair a store copied mid-write; hold writes off */
+        err = hierarchy_sync(h);
+        if (err == MEM_OK) err = snapshot_copy_tree(snap, NULL, (const char*[]){ WAL_FILE, NULL });
+        pthread_rwlock_unlock(&h->write_gate);
+    } else {
+        err = wal_writer_flush(h->wal_writer);
+        if (err == MEM_OK) err = hierarchy_sync(h);
+        pthread_rwlock_unlock(&h->write_gate);
+        if (err == MEM_OK) err = snapshot_copy_wal_cut(h, snap, &sequence);
+    }
+
+    if (err == MEM_OK) {
+        err = snapshot_commit(snap, sequence, stats);
+    } else {
+        snapshot_abort(snap);
+    }
+
+    pthread_mutex_unlock(&h->snapshot_lock);
+    return err;
 }
 
 mem_error_t hierarchy_create_message(hierarchy_t* h,
@@ -471,14 +1126,23 @@ mem_error_t hierarchy_create_message(hierarchy_t* h,
                                      node_id_t* out_id) {
     MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
 
+    MEM_CHECK_ERR(out_id != NULL, MEM_ERR_INVALID_ARG, "out_id is NULL");
+
+    begin_insert(h);
+
     /* Verify parent is a session */
+    mem_error_t err;
     hierarchy_level_t parent_level = relations_get_level(h->relations, session_id);
     if (parent_level != LEVEL_SESSION) {
-        MEM_RETURN_ERROR(MEM_ERR_INVALID_LEVEL,
-                        "message parent must be session, got level %d", parent_level);
+        MEM_SET_ERROR(MEM_ERR_INVALID_LEVEL,
+                      "message parent must be session, got level %d", parent_level);
+        err = MEM_ERR_INVALID_LEVEL;
+    } else {
+        err = insert_child(h, session_id, LEVEL_MESSAGE, out_id);
     }
 
-    return hierarchy_create_child(h, session_id, LEVEL_MESSAGE, out_id);
+    end_insert(h);
+    return err;
 }
 
 mem_error_t hierarchy_create_block(hierarchy_t* h,
@@ -486,14 +1150,23 @@ mem_error_t hierarchy_create_block(hierarchy_t* h,
                                    node_id_t* out_id) {
     MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
 
+    MEM_CHECK_ERR(out_id != NULL, MEM_ERR_INVALID_ARG, "out_id is NULL");
+
+    begin_insert(h);
+
     /* Verify parent is a message */
+    mem_error_t err;
     hierarchy_level_t parent_level = relations_get_level(h->relations, message_id);
     if (parent_level != LEVEL_MESSAGE) {
-        MEM_RETURN_ERROR(MEM_ERR_INVALID_LEVEL,
-                        "block parent must be message, got level %d", parent_level);
+        MEM_SET_ERROR(MEM_ERR_INVALID_LEVEL,
+                      "block parent must be message, got level %d", parent_level);
+        err = MEM_ERR_INVALID_LEVEL;
+    } else {
+        err = insert_child(h, message_id, LEVEL_BLOCK, out_id);
     }
 
-    return hierarchy_create_child(h, message_id, LEVEL_BLOCK, out_id);
+    end_insert(h);
+    return err;
 }
 
 mem_error_t hierarchy_create_statement(hierarchy_t* h,
@@ -551,6 +1224,11 @@ node_id_t hierarchy_get_first_child(const hierarchy_t* h, node_id_t id) {
     return relations_get_first_child(h->relations, id);
 }
 
+size_t hierarchy_get_child_count(const hierarchy_t* h, node_id_t id) {
+    if (!h) return 0;
+    return relations_get_child_count(h->relations, id);
+}
+
 node_id_t hierarchy_get_next_sibling(const hierarchy_t* h, node_id_t id) {
     if (!h) return NODE_ID_INVALID;
     return relations_get_next_sibling(h->relations, id);
@@ -589,11 +1267,7 @@ size_t hierarchy_count(const hierarchy_t* h) {
     return relations_count(h->relations);
 }
 
-mem_error_t hierarchy_set_embedding(hierarchy_t* h, node_id_t id,
-                                    const float* values) {
-    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
-    MEM_CHECK_ERR(values != NULL, MEM_ERR_INVALID_ARG, "values is NULL");
-
+static mem_error_t set_embedding(hierarchy_t* h, node_id_t id, const float* values) {
     size_t count = relations_count(h->relations);
     if (id >= count) {
         MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "node %u not found", id);
@@ -606,7 +1280,40 @@ mem_error_t hierarchy_set_embedding(hierarchy_t* h, node_id_t id,
     hierarchy_level_t level = relations_get_level(h->relations, id);
     uint32_t emb_idx = h->node_meta[id].embedding_idx;
 
-    return embeddings_set(h->embeddings, level, emb_idx, values);
+    MEM_CHECK(embeddings_set(h->embeddings, level, emb_idx, values));
+
+    if (h->wal_writer) {
+        wal_embedding_data_t rec = {
+            .node_id = id,
+            .level = level,
+            .embedding_idx = emb_idx
+        };
+        memcpy(rec.values, values, sizeof(rec.values));
+        MEM_CHECK(log_mutation(h, WAL_OP_EMBEDDING_SET, &rec, sizeof(rec), NULL, 0));
+    }
+    return MEM_OK;
+}
+
+mem_error_t hierarchy_set_embedding(hierarchy_t* h, node_id_t id,
+                                    const float* values) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+    MEM_CHECK_ERR(values != NULL, MEM_ERR_INVALID_ARG, "values is NULL");
+
+    pthread_rwlock_rdlock(&h->write_gate);
+    mem_error_t err = set_embedding(h, id, values);
+    pthread_rwlock_unlock(&h->write_gate);
+    return err;
+}
+
+mem_error_t hierarchy_set_token_count(hierarchy_t* h, node_id_t id, uint32_t token_count) {
+    MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
+
+    pthread_rwlock_rdlock(&h->write_gate);
+    wal_tokens_data_t rec = { .node_id = id, .token_count = token_count };
+    mem_error_t err = columns_set_token_count(h->columns, id, token_count);
+    if (err == MEM_OK) err = log_mutation(h, WAL_OP_TOKENS_SET, &rec, sizeof(rec), NULL, 0);
+    pthread_rwlock_unlock(&h->write_gate);
+    return err;
 }
 
 const float* hierarchy_get_embedding(const hierarchy_t* h, node_id_t id) {
@@ -651,73 +1358,40 @@ embeddings_store_t* hierarchy_get_embeddings(hierarchy_t* h) {
     return h ? h->embeddings : NULL;
 }
 
-/* Ensure text content array has capacity */
-static mem_error_t ensure_text_capacity(hierarchy_t* h, size_t needed) {
-    if (needed <= h->text_content_capacity) {
-        return MEM_OK;
-    }
-
-    size_t new_capacity = h->text_content_capacity * 2;
-    if (new_capacity < needed) new_capacity = needed;
-    if (new_capacity < 1024) new_capacity = 1024;
-
-    text_entry_t* new_text = realloc(h->text_content, new_capacity * sizeof(text_entry_t));
-    if (!new_text) {
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to grow text content array");
-    }
-
-    /* Zero-initialize new entries */
-    memset(new_text + h->text_content_capacity, 0,
-           (new_capacity - h->text_content_capacity) * sizeof(text_entry_t));
-
-    h->text_content = new_text;
-    h->text_content_capacity = new_capacity;
-
-    return MEM_OK;
+columns_store_t* hierarchy_get_columns(const hierarchy_t* h) {
+    return h ? h->columns : NULL;
 }
 
 mem_error_t hierarchy_set_text(hierarchy_t* h, node_id_t id,
                                const char* text, size_t len) {
     MEM_CHECK_ERR(h != NULL, MEM_ERR_INVALID_ARG, "hierarchy is NULL");
     MEM_CHECK_ERR(text != NULL, MEM_ERR_INVALID_ARG, "text is NULL");
+    MEM_CHECK_ERR(len <= UINT32_MAX, MEM_ERR_INVALID_ARG, "text too long");
 
-    size_t count = relations_count(h->relations);
-    if (id >= count) {
-        MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "node %u not found", id);
+    pthread_rwlock_rdlock(&h->write_gate);
+    mem_error_t err = MEM_OK;
+    if (id >= relations_count(h->relations)) {
+        err = MEM_ERR_NOT_FOUND;
+        MEM_SET_ERROR(err, "node %u not found", id);
     }
+    if (err == MEM_OK) err = text_store_put(h->text, id, text, len);
 
-    /* Ensure capacity */
-    MEM_CHECK(ensure_text_capacity(h, id + 1));
-
-    /* Free old text if present */
-    free(h->text_content[id].text);
-
-    /* Allocate and copy new text */
-    h->text_content[id].text = malloc(len + 1);
-    if (!h->text_content[id].text) {
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate text");
-    }
-
-    memcpy(h->text_content[id].text, text, len);
-    h->text_content[id].text[len] = '\0';
-    h->text_content[id].len = len;
-
-    return MEM_OK;
+    wal_text_data_t rec = { .node_id = id, .len = (uint32_t)len };
+    if (err == MEM_OK) err = log_mutation(h, WAL_OP_TEXT_SET, &rec, sizeof(rec), text, len);
+    pthread_rwlock_unlock(&h->write_gate);
+    return err;
 }
 
-const char* hierarchy_get_text(const hierarchy_t* h, node_id_t id, size_t* len) {
-    if (!h) return NULL;
+bool hierarchy_get_text(const hierarchy_t* h, node_id_t id,
+                        char* buf, size_t size, size_t* len) {
+    if (len) *len = 0;
+    if (size > 0) buf[0] = '\0';
+    if (!h) return false;
 
     size_t count = relations_count(h->relations);
-    if (id >= count) return NULL;
-
-    if (id >= h->text_content_capacity) return NULL;
-
-    if (len) {
-        *len = h->text_content[id].len;
-    }
+    if (id >= count) return false;
 
-    return h->text_content[id].text;
+    return text_store_get(h->text, id, buf, size, len);
 }
 
 size_t hierarchy_iter_sessions(const hierarchy_t* h, session_iter_fn callback, void* user_data) {
@@ -746,3 +1420,13 @@ size_t hierarchy_iter_sessions(const hierarchy_t* h, session_iter_fn callback, v
 
     return session_count;
 }
+
+node_id_t hierarchy_find_agent(const hierarchy_t* h, const char* agent_id) {
+    return find_agent_by_id(h, agent_id);
+}
+
+node_id_t hierarchy_find_session(const hierarchy_t* h, node_id_t agent_node_id,
+                                 const char* session_id) {
+    if (!h || !session_id) return NODE_ID_INVALID;
+    return find_session_indexed(h, agent_node_id, session_id);
+}
@@ -14,6 +14,10 @@
 #include "../../include/error.h"
 #include "../storage/relations.h"
 #include "../storage/embeddings.h"
+#include "../storage/columns.h"
+#include "../storage/wal.h"
+#include "../storage/flusher.h"
+#include "../storage/snapshot.h"
 
 /* Forward declaration */
 typedef struct hierarchy hierarchy_t;
@@ -31,6 +35,15 @@ typedef struct {
     char            session_id[MAX_SESSION_ID_LEN];
 } node_info_t;
 
+/* mmap tuning for the relation and embedding files */
+typedef struct {
+    bool            populate;       /* Fault the files in up front */
+    uint32_t        lock_levels;    /* Embedding levels to mlock, bit (1 << level) */
+} hierarchy_mmap_config_t;
+
+#define HIERARCHY_MMAP_CONFIG_DEFAULT ((hierarchy_mmap_config_t){ \
+    .populate = false, .lock_levels = 0 })
+
 /* Create a new hierarchy manager */
 mem_error_t hierarchy_create(hierarchy_t** h, const char* dir, size_t capacity);
 
@@ -43,6 +56,52 @@ void hierarchy_close(hierarchy_t* h);
 /* Sync to disk */
 mem_error_t hierarchy_sync(hierarchy_t* h);
 
+/* Apply mmap tuning on top of each store's default access hints */
+mem_error_t hierarchy_set_mmap_config(hierarchy_t* h, const hierarchy_mmap_config_t* config);
+
+/* Default WAL size that triggers a checkpoint */
+#define HIERARCHY_WAL_SIZE_DEFAULT (64 * 1024 * 1024)
+
+/*
+ * Log node, text, embedding and token count mutations to the segments
+ * dir/wal.log.N. Records left by an unclean shutdown are replayed first.
+ * Records are written by a group-commit writer; max_size 0 selects
+ * HIERARCHY_WAL_SIZE_DEFAULT and a NULL config WAL_CONFIG_DEFAULT.
+ */
+mem_error_t hierarchy_enable_wal(hierarchy_t* h, size_t max_size, const wal_config_t* config);
+
+/*
+ * Wait until every mutation logged so far is durable in the WAL, and
+ * checkpoint once the WAL has reached max_size. Returns immediately when
+ * the WAL is not enabled.
+ */
+mem_error_t hierarchy_commit(hierarchy_t* h);
+
+/* Sync all stores and empty the WAL */
+mem_error_t hierarchy_checkpoint(hierarchy_t* h);
+
+/*
+ * Start writing back the pages the stores dirty every interval_ms (0
+ * selects FLUSHER_INTERVAL_DEFAULT_MS) from a background thread, so a
+ * sync or close has little left to flush. Stopped by hierarchy_close.
+ */
+mem_error_t hierarchy_enable_flusher(hierarchy_t* h, uint32_t interval_ms);
+
+/*
+ * Copy the data directory to dest_dir (created; must not exist), from
+ * any thread; reads never wait. With the WAL enabled, mutations wait
+ * only while the stores are synced and once more for a WAL flush, and
+ * text writes while the text is copied; the other stores are copied as
+ * they change and the WAL is copied last, so a copy
+ * of the snapshot holds every mutation that returned before this was
+ * called, with none half applied, once hierarchy_enable_wal has replayed
+ * its log. Without the WAL, mutations wait for the whole copy and the
+ * copy opens complete. base_dir, if not NULL, is an earlier snapshot to
+ * link unchanged files from. stats (may be NULL) receives counters.
+ */
+mem_error_t hierarchy_snapshot(hierarchy_t* h, const char* dest_dir,
+                               const char* base_dir, snapshot_stats_t* stats);
+
 /*
  * Node creation functions
  */
@@ -102,6 +161,9 @@ node_id_t hierarchy_get_next_sibling(const hierarchy_t* h, node_id_t id);
 /* Get level of a node */
 hierarchy_level_t hierarchy_get_level(const hierarchy_t* h, node_id_t id);
 
+/* Get number of children of a node (constant time) */
+size_t hierarchy_get_child_count(const hierarchy_t* h, node_id_t id);
+
 /* Get all children of a node */
 size_t hierarchy_get_children(const hierarchy_t* h, node_id_t id,
                               node_id_t* children, size_t max_count);
@@ -128,7 +190,10 @@ size_t hierarchy_count(const hierarchy_t* h);
 mem_error_t hierarchy_set_embedding(hierarchy_t* h, node_id_t id,
                                     const float* values);
 
-/* Get embedding for a node */
+/* Set a node's token count in the scoring columns */
+mem_error_t hierarchy_set_token_count(hierarchy_t* h, node_id_t id, uint32_t token_count);
+
+/* Get embedding for a node (pointer stays valid until the hierarchy is closed) */
 const float* hierarchy_get_embedding(const hierarchy_t* h, node_id_t id);
 
 /* Compute similarity between two nodes */
@@ -142,8 +207,11 @@ float hierarchy_similarity(const hierarchy_t* h, node_id_t id1, node_id_t id2);
 mem_error_t hierarchy_set_text(hierarchy_t* h, node_id_t id,
                                const char* text, size_t len);
 
-/* Get text content for a node (returns pointer to internal storage) */
-const char* hierarchy_get_text(const hierarchy_t* h, node_id_t id, size_t* len);
+/* Copy a node's text into buf, NUL-terminated and truncated to fit in
+ * size bytes, and set *len to its full length. Returns false if the node
+ * has no text; size 0 only reports the length */
+bool hierarchy_get_text(const hierarchy_t* h, node_id_t id,
+                        char* buf, size_t size, size_t* len);
 
 /*
  * Session iteration
@@ -156,11 +224,20 @@ typedef bool (*session_iter_fn)(node_id_t session_id, const char* agent_id,
 /* Iterate all sessions */
 size_t hierarchy_iter_sessions(const hierarchy_t* h, session_iter_fn callback, void* user_data);
 
+/* Find agent node by agent_id string (NODE_ID_INVALID if none) */
+node_id_t hierarchy_find_agent(const hierarchy_t* h, const char* agent_id);
+
+/* Find session node by session_id string, under agent_node_id or under
+ * any agent if NODE_ID_INVALID (NODE_ID_INVALID if none) */
+node_id_t hierarchy_find_session(const hierarchy_t* h, node_id_t agent_node_id,
+                                 const char* session_id);
+
 /*
  * Access underlying stores (for advanced operations)
  */
 
 relations_store_t* hierarchy_get_relations(hierarchy_t* h);
 embeddings_store_t* hierarchy_get_embeddings(hierarchy_t* h);
+columns_store_t* hierarchy_get_columns(const hierarchy_t* h);
 
 #endif /* MEMORY_SERVICE_HIERARCHY_H */
@@ -7,11 +7,13 @@
 
 #include "embedding.h"
 #include "tokenizer.h"
+#include "embedding_cache.h"
 #include "../util/log.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 
 #ifdef HAVE_ONNXRUNTIME
 #include <onnxruntime_c_api.h>
@@ -28,6 +30,7 @@ struct embedding_engine {
     embedding_config_t config;
     bool onnx_available;
     tokenizer_t* tokenizer;
+    embedding_cache_t* cache;   /* Query embedding cache (NULL = disabled) */
 
 #ifdef HAVE_ONNXRUNTIME
     const OrtApi* api;
@@ -64,6 +67,34 @@ static float magnitude_scalar(const float* v, size_t n) {
     return sqrtf(dot_product_scalar(v, v, n));
 }
 
+/* Set up the query embedding cache, reloading persisted entries if present */
+static void cache_attach(embedding_engine_t* e) {
+    if (e->config.cache_mb == 0) return;
+
+    if (embedding_cache_create(&e->cache, e->config.cache_mb * 1024 * 1024) != MEM_OK) {
+        LOG_WARN("Query embedding cache disabled");
+        e->cache = NULL;
+        return;
+    }
+    if (e->config.cache_path && access(e->config.cache_path, F_OK) == 0) {
+        if (embedding_cache_load(e->cache, e->config.cache_path) != MEM_OK) {
+            LOG_WARN("Ignoring unreadable embedding cache %s", e->config.cache_path);
+        }
+    }
+}
+
+/* Persist (if configured) and free the query embedding cache */
+static void cache_detach(embedding_engine_t* e) {
+    if (!e->cache) return;
+
+    if (e->config.cache_path &&
+        embedding_cache_save(e->cache, e->config.cache_path) != MEM_OK) {
+        LOG_WARN("Failed to persist embedding cache to %s", e->config.cache_path);
+    }
+    embedding_cache_destroy(e->cache);
+    e->cache = NULL;
+}
+
 bool embedding_onnx_available(void) {
 #ifdef HAVE_ONNXRUNTIME
     return true;
@@ -135,6 +166,7 @@ mem_error_t embedding_engine_create(embedding_engine_t** engine,
     if (!e->config.model_path) {
         /* No model path - use stub */
         e->onnx_available = false;
+        cache_attach(e);
         *engine = e;
         LOG_WARN("No ONNX model path provided - using stub embeddings");
         return MEM_OK;
@@ -296,6 +328,7 @@ mem_error_t embedding_engine_create(embedding_engine_t** engine,
     }
 
     e->onnx_available = true;
+    cache_attach(e);
     *engine = e;
     LOG_INFO("ONNX embedding engine initialized (provider=%s, model=%s)",
              provider_name, e->config.model_path);
@@ -305,6 +338,7 @@ mem_error_t embedding_engine_create(embedding_engine_t** engine,
 void embedding_engine_destroy(embedding_engine_t* engine) {
     if (!engine) return;
 
+    cache_detach(engine);
     if (engine->tokenizer) {
         tokenizer_destroy(engine->tokenizer);
     }
@@ -582,6 +616,7 @@ mem_error_t embedding_engine_create(embedding_engine_t** engine,
     }
 
     e->onnx_available = false;
+    cache_attach(e);
     *engine = e;
 
     LOG_WARN("ONNX Runtime not available - using stub embeddings");
@@ -590,6 +625,7 @@ mem_error_t embedding_engine_create(embedding_engine_t** engine,
 
 void embedding_engine_destroy(embedding_engine_t* engine) {
     if (!engine) return;
+    cache_detach(engine);
     if (engine->tokenizer) {
         tokenizer_destroy(engine->tokenizer);
     }
@@ -640,6 +676,32 @@ mem_error_t embedding_generate_batch(embedding_engine_t* engine,
 
 /* Common implementations */
 
+mem_error_t embedding_generate_cached(embedding_engine_t* engine,
+                                      const char* text, size_t text_len,
+                                      float* output) {
+    MEM_CHECK_ERR(engine != NULL, MEM_ERR_INVALID_ARG, "engine is NULL");
+    MEM_CHECK_ERR(output != NULL, MEM_ERR_INVALID_ARG, "output is NULL");
+
+    if (embedding_cache_get(engine->cache, text, text_len, output)) {
+        return MEM_OK;
+    }
+
+    MEM_CHECK(embedding_generate(engine, text, text_len, output));
+    embedding_cache_put(engine->cache, text, text_len, output);
+    return MEM_OK;
+}
+
+size_t embedding_count_tokens(const embedding_engine_t* engine,
+                              const char* text, size_t text_len) {
+    if (!engine) return 0;
+    return tokenizer_count(engine->tokenizer, text, text_len);
+}
+
+void embedding_get_cache_stats(const embedding_engine_t* engine,
+                               embedding_cache_stats_t* stats) {
+    embedding_cache_get_stats(engine ? engine->cache : NULL, stats);
+}
+
 void embedding_mean_pool(const float** embeddings, size_t count, float* output) {
     if (!embeddings || count == 0 || !output) return;
 
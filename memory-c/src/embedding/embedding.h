@@ -10,6 +10,7 @@
 
 #include "../../include/types.h"
 #include "../../include/error.h"
+#include "embedding_cache.h"
 
 /* Forward declaration */
 typedef struct embedding_engine embedding_engine_t;
@@ -19,13 +20,17 @@ typedef struct {
     const char* model_path;     /* Path to ONNX model file */
     size_t batch_size;          /* Batch size for inference (default: 32) */
     size_t max_seq_len;         /* Max sequence length (default: 512) */
+    size_t cache_mb;            /* Query embedding cache budget in MB (0 = disabled) */
+    const char* cache_path;     /* File to persist the cache across restarts (optional) */
 } embedding_config_t;
 
 /* Default configuration */
 #define EMBEDDING_CONFIG_DEFAULT { \
     .model_path = NULL, \
     .batch_size = BATCH_SIZE, \
-    .max_seq_len = 512 \
+    .max_seq_len = 512, \
+    .cache_mb = 16, \
+    .cache_path = NULL \
 }
 
 /*
@@ -53,6 +58,22 @@ mem_error_t embedding_generate(embedding_engine_t* engine,
                                const char* text, size_t text_len,
                                float* output);
 
+/*
+ * Generate embedding for query text, served from the query embedding
+ * cache when the same text was embedded before
+ */
+mem_error_t embedding_generate_cached(embedding_engine_t* engine,
+                                      const char* text, size_t text_len,
+                                      float* output);
+
+/* Count model (WordPiece) tokens in text, excluding special tokens */
+size_t embedding_count_tokens(const embedding_engine_t* engine,
+                              const char* text, size_t text_len);
+
+/* Get query embedding cache counters (all zero when disabled) */
+void embedding_get_cache_stats(const embedding_engine_t* engine,
+                               embedding_cache_stats_t* stats);
+
 /*
  * Generate embeddings for batch of texts
  *
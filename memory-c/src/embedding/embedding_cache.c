@@ -0,0 +1,350 @@
+/*
+ * Memory Service - Query Embedding Cache Implementation
+ */
+
+#include "embedding_cache.h"
+#include "../util/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+
+#define NO_ENTRY (-1)
+
+/* Persisted file format: header followed by entries, least recent first */
+#define CACHE_FILE_MAGIC 0x454D4330  /* "EMC0" */
+#define CACHE_FILE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dim;
+    uint32_t count;
+} cache_file_header_t;
+
+typedef struct {
+    uint64_t hash_a;
+    uint64_t hash_b;
+    uint32_t text_len;
+    uint32_t reserved;
+    float    embedding[EMBEDDING_DIM];
+} cache_file_record_t;
+
+typedef struct {
+    uint64_t hash_a;
+    uint64_t hash_b;
+    uint32_t text_len;
+    int32_t  lru_prev;      /* Towards most recently used */
+    int32_t  lru_next;      /* Towards least recently used */
+    int32_t  hash_next;     /* Bucket chain, or free list link */
+    float    embedding[EMBEDDING_DIM];
+} cache_entry_t;
+
+struct embedding_cache {
+    cache_entry_t*  entries;
+    size_t          capacity;
+    size_t          count;
+    int32_t*        buckets;
+    size_t          bucket_mask;
+    int32_t         lru_head;
+    int32_t         lru_tail;
+    int32_t         free_head;
+    pthread_mutex_t lock;
+    uint64_t        hits;
+    uint64_t        misses;
+    uint64_t        evictions;
+};
+
+/* Seeded FNV-1a with a final avalanche; two seeds give independent keys */
+static uint64_t text_hash(const char* text, size_t len, uint64_t seed) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)text[i];
+        h *= 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+#define HASH_SEED_A 0x0ULL
+#define HASH_SEED_B 0x9E3779B97F4A7C15ULL
+
+/* ========== LRU / bucket maintenance (lock held) ========== */
+
+static void lru_unlink(embedding_cache_t* c, int32_t idx) {
+    cache_entry_t* e = &c->entries[idx];
+    if (e->lru_prev != NO_ENTRY) c->entries[e->lru_prev].lru_next = e->lru_next;
+    else c->lru_head = e->lru_next;
+    if (e->lru_next != NO_ENTRY) c->entries[e->lru_next].lru_prev = e->lru_prev;
+    else c->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NO_ENTRY;
+}
+
+static void lru_push_front(embedding_cache_t* c, int32_t idx) {
+    cache_entry_t* e = &c->entries[idx];
+    e->lru_prev = NO_ENTRY;
+    e->lru_next = c->lru_head;
+    if (c->lru_head != NO_ENTRY) c->entries[c->lru_head].lru_prev = idx;
+    c->lru_head = idx;
+    if (c->lru_tail == NO_ENTRY) c->lru_tail = idx;
+}
+
+static int32_t bucket_find(embedding_cache_t* c, uint64_t hash_a, uint64_t hash_b,
+                           uint32_t text_len) {
+    int32_t idx = c->buckets[hash_a & c->bucket_mask];
+    while (idx != NO_ENTRY) {
+        const cache_entry_t* e = &c->entries[idx];
+        if (e->hash_a == hash_a && e->hash_b == hash_b && e->text_len == text_len) {
+            return idx;
+        }
+        idx = e->hash_next;
+    }
+    return NO_ENTRY;
+}
+
+static void bucket_unlink(embedding_cache_t* c, int32_t idx) {
+    int32_t* link = &c->buckets[c->entries[idx].hash_a & c->bucket_mask];
+    while (*link != NO_ENTRY) {
+        if (*link == idx) {
+            *link = c->entries[idx].hash_next;
+            return;
+        }
+        link = &c->entries[*link].hash_next;
+    }
+}
+
+/* Insert or refresh an entry, evicting the least recently used if full */
+static void insert_locked(embedding_cache_t* c, uint64_t hash_a, uint64_t hash_b,
+                          uint32_t text_len, const float* embedding) {
+    int32_t idx = bucket_find(c, hash_a, hash_b, text_len);
+    if (idx != NO_ENTRY) {
+        memcpy(c->entries[idx].embedding, embedding, sizeof(float) * EMBEDDING_DIM);
+        lru_unlink(c, idx);
+        lru_push_front(c, idx);
+        return;
+    }
+
+    if (c->free_head == NO_ENTRY) {
+        idx = c->lru_tail;
+        bucket_unlink(c, idx);
+        lru_unlink(c, idx);
+        c->evictions++;
+    } else {
+        idx = c->free_head;
+        c->free_head = c->entries[idx].hash_next;
+        c->count++;
+    }
+
+    cache_entry_t* e = &c->entries[idx];
+    e->hash_a = hash_a;
+    e->hash_b = hash_b;
+    e->text_len = text_len;
+    memcpy(e->embedding, embedding, sizeof(float) * EMBEDDING_DIM);
+
+    size_t bucket = hash_a & c->bucket_mask;
+    e->hash_next = c->buckets[bucket];
+    c->buckets[bucket] = idx;
+    lru_push_front(c, idx);
+}
+
+/* ========== Public API ========== */
+
+mem_error_t embedding_cache_create(embedding_cache_t** cache, size_t max_bytes) {
+    MEM_CHECK_ERR(cache != NULL, MEM_ERR_INVALID_ARG, "cache is NULL");
+
+    size_t capacity = max_bytes / sizeof(cache_entry_t);
+    MEM_CHECK_ERR(capacity > 0, MEM_ERR_INVALID_ARG,
+                  "cache budget %zu bytes holds no entries", max_bytes);
+    if (capacity > INT32_MAX / 2) capacity = INT32_MAX / 2;
+
+    embedding_cache_t* c = calloc(1, sizeof(embedding_cache_t));
+    MEM_CHECK_ALLOC(c);
+
+    size_t bucket_count = 16;
+    while (bucket_count < capacity * 2) bucket_count <<= 1;
+
+    c->entries = malloc(capacity * sizeof(cache_entry_t));
+    c->buckets = malloc(bucket_count * sizeof(int32_t));
+    if (!c->entries || !c->buckets) {
+        free(c->entries);
+        free(c->buckets);
+        free(c);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate embedding cache");
+    }
+    if (pthread_mutex_init(&c->lock, NULL) != 0) {
+        free(c->entries);
+        free(c->buckets);
+        free(c);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init embedding cache mutex");
+    }
+
+    c->capacity = capacity;
+    c->bucket_mask = bucket_count - 1;
+    for (size_t i = 0; i < bucket_count; i++) {
+        c->buckets[i] = NO_ENTRY;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        c->entries[i].lru_prev = c->entries[i].lru_next = NO_ENTRY;
+        c->entries[i].hash_next = (i + 1 < capacity) ? (int32_t)(i + 1) : NO_ENTRY;
+    }
+    c->free_head = 0;
+    c->lru_head = c->lru_tail = NO_ENTRY;
+
+    *cache = c;
+    return MEM_OK;
+}
+
+void embedding_cache_destroy(embedding_cache_t* cache) {
+    if (!cache) return;
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+bool embedding_cache_get(embedding_cache_t* cache, const char* text, size_t text_len,
+                         float* output) {
+    if (!cache || !text || !output || text_len > UINT32_MAX) return false;
+
+    uint64_t hash_a = text_hash(text, text_len, HASH_SEED_A);
+    uint64_t hash_b = text_hash(text, text_len, HASH_SEED_B);
+
+    pthread_mutex_lock(&cache->lock);
+    int32_t idx = bucket_find(cache, hash_a, hash_b, (uint32_t)text_len);
+    if (idx != NO_ENTRY) {
+        memcpy(output, cache->entries[idx].embedding, sizeof(float) * EMBEDDING_DIM);
+        lru_unlink(cache, idx);
+        lru_push_front(cache, idx);
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return idx != NO_ENTRY;
+}
+
+void embedding_cache_put(embedding_cache_t* cache, const char* text, size_t text_len,
+                         const float* embedding) {
+    if (!cache || !text || !embedding || text_len > UINT32_MAX) return;
+
+    uint64_t hash_a = text_hash(text, text_len, HASH_SEED_A);
+    uint64_t hash_b = text_hash(text, text_len, HASH_SEED_B);
+
+    pthread_mutex_lock(&cache->lock);
+    insert_locked(cache, hash_a, hash_b, (uint32_t)text_len, embedding);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+mem_error_t embedding_cache_save(embedding_cache_t* cache, const char* path) {
+    MEM_CHECK_ERR(cache != NULL, MEM_ERR_INVALID_ARG, "cache is NULL");
+    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to create temp file for %s", path);
+    }
+
+    mem_error_t err = MEM_OK;
+    pthread_mutex_lock(&cache->lock);
+
+    cache_file_header_t hdr = {
+        .magic = CACHE_FILE_MAGIC,
+        .version = CACHE_FILE_VERSION,
+        .dim = EMBEDDING_DIM,
+        .count = (uint32_t)cache->count
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+        err = MEM_ERR_WRITE;
+    }
+
+    /* Least recently used first, so a reload rebuilds the same order */
+    for (int32_t idx = cache->lru_tail; err == MEM_OK && idx != NO_ENTRY;
+         idx = cache->entries[idx].lru_prev) {
+        const cache_entry_t* e = &cache->entries[idx];
+        cache_file_record_t rec = {
+            .hash_a = e->hash_a,
+            .hash_b = e->hash_b,
+            .text_len = e->text_len
+        };
+        memcpy(rec.embedding, e->embedding, sizeof(rec.embedding));
+        if (fwrite(&rec, sizeof(rec), 1, f) != 1) {
+            err = MEM_ERR_WRITE;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    if (fclose(f) != 0 && err == MEM_OK) {
+        err = MEM_ERR_WRITE;
+    }
+    if (err == MEM_OK && rename(tmp_path, path) != 0) {
+        err = MEM_ERR_IO;
+    }
+    if (err != MEM_OK) {
+        remove(tmp_path);
+        MEM_RETURN_ERROR(err, "failed to write embedding cache %s", path);
+    }
+
+    LOG_DEBUG("Embedding cache saved: %u entries", hdr.count);
+    return MEM_OK;
+}
+
+mem_error_t embedding_cache_load(embedding_cache_t* cache, const char* path) {
+    MEM_CHECK_ERR(cache != NULL, MEM_ERR_INVALID_ARG, "cache is NULL");
+    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open %s", path);
+    }
+
+    cache_file_header_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        hdr.magic != CACHE_FILE_MAGIC || hdr.version != CACHE_FILE_VERSION ||
+        hdr.dim != EMBEDDING_DIM) {
+        fclose(f);
+        MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid embedding cache file %s", path);
+    }
+
+    /* A truncated file keeps whatever complete records it has */
+    size_t loaded = 0;
+    cache_file_record_t rec;
+
+    pthread_mutex_lock(&cache->lock);
+    uint64_t evictions = cache->evictions;
+    while (loaded < hdr.count && fread(&rec, sizeof(rec), 1, f) == 1) {
+        insert_locked(cache, rec.hash_a, rec.hash_b, rec.text_len, rec.embedding);
+        loaded++;
+    }
+    cache->evictions = evictions;
+    pthread_mutex_unlock(&cache->lock);
+
+    fclose(f);
+    LOG_INFO("Embedding cache loaded: %zu of %u entries", loaded, hdr.count);
+    return MEM_OK;
+}
+
+void embedding_cache_get_stats(embedding_cache_t* cache, embedding_cache_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) return;
+
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->count;
+    stats->capacity = cache->capacity;
+    pthread_mutex_unlock(&cache->lock);
+}
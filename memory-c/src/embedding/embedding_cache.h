@@ -0,0 +1,51 @@
+/*
+ * Memory Service - Query Embedding Cache
+ *
+ * Bounded LRU map from query text to its embedding, so repeated query
+ * text skips model inference. Text is keyed by two independent 64-bit
+ * hashes plus its length; entries are fixed-size, so the byte budget
+ * translates directly into an entry count. Safe for concurrent use.
+ */
+
+#ifndef MEMORY_SERVICE_EMBEDDING_CACHE_H
+#define MEMORY_SERVICE_EMBEDDING_CACHE_H
+
+#include "../../include/types.h"
+#include "../../include/error.h"
+
+/* Forward declaration */
+typedef struct embedding_cache embedding_cache_t;
+
+/* Cache counters */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t   entries;       /* Current entry count */
+    size_t   capacity;      /* Max entries within the byte budget */
+} embedding_cache_stats_t;
+
+/* Create cache using at most max_bytes for entries */
+mem_error_t embedding_cache_create(embedding_cache_t** cache, size_t max_bytes);
+
+/* Destroy cache */
+void embedding_cache_destroy(embedding_cache_t* cache);
+
+/* Copy cached embedding for text to output (EMBEDDING_DIM floats). Returns true on hit */
+bool embedding_cache_get(embedding_cache_t* cache, const char* text, size_t text_len,
+                         float* output);
+
+/* Insert or refresh embedding for text */
+void embedding_cache_put(embedding_cache_t* cache, const char* text, size_t text_len,
+                         const float* embedding);
+
+/* Write entries to path (atomically, via rename) */
+mem_error_t embedding_cache_save(embedding_cache_t* cache, const char* path);
+
+/* Load entries from path; most recently used entries win if over capacity */
+mem_error_t embedding_cache_load(embedding_cache_t* cache, const char* path);
+
+/* Get counters */
+void embedding_cache_get_stats(embedding_cache_t* cache, embedding_cache_stats_t* stats);
+
+#endif /* MEMORY_SERVICE_EMBEDDING_CACHE_H */
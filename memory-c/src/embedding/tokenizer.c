@@ -206,45 +206,62 @@ void tokenizer_destroy(tokenizer_t* tok) {
     free(tok);
 }
 
-/* Basic word tokenization (split on whitespace and punctuation) */
-static size_t basic_tokenize(const char* text, size_t text_len,
-                             char tokens[][MAX_TOKEN_LEN], size_t max_tokens) {
-    size_t token_count = 0;
-    size_t i = 0;
+/*
+ * Next basic token at *pos: a single punctuation character or a run of
+ * word characters, lowercased into word. Returns its length (0 at end
+ * of text); words too long for the buffer are not copied.
+ */
+static size_t next_word(const char* text, size_t text_len, size_t* pos,
+                        char word[MAX_TOKEN_LEN]) {
+    size_t i = *pos;
 
-    while (i < text_len && token_count < max_tokens) {
-        /* Skip whitespace */
-        while (i < text_len && isspace((unsigned char)text[i])) {
-            i++;
-        }
+    /* Skip whitespace */
+    while (i < text_len && isspace((unsigned char)text[i])) {
+        i++;
+    }
 
-        if (i >= text_len) break;
+    if (i >= text_len) {
+        *pos = i;
+        return 0;
+    }
 
-        /* Check for punctuation (single character token) */
-        if (ispunct((unsigned char)text[i])) {
-            tokens[token_count][0] = text[i];
-            tokens[token_count][1] = '\0';
-            token_count++;
-            i++;
-            continue;
-        }
+    /* Check for punctuation (single character token) */
+    if (ispunct((unsigned char)text[i])) {
+        word[0] = text[i];
+        word[1] = '\0';
+        *pos = i + 1;
+        return 1;
+    }
 
-        /* Collect word characters */
-        size_t start = i;
-        while (i < text_len && !isspace((unsigned char)text[i]) &&
-               !ispunct((unsigned char)text[i])) {
-            i++;
-        }
+    /* Collect word characters */
+    size_t start = i;
+    while (i < text_len && !isspace((unsigned char)text[i]) &&
+           !ispunct((unsigned char)text[i])) {
+        i++;
+    }
+    *pos = i;
 
-        size_t word_len = i - start;
-        if (word_len > 0 && word_len < MAX_TOKEN_LEN - 1) {
-            /* Convert to lowercase */
-            for (size_t j = 0; j < word_len; j++) {
-                tokens[token_count][j] = tolower((unsigned char)text[start + j]);
-            }
-            tokens[token_count][word_len] = '\0';
-            token_count++;
+    size_t word_len = i - start;
+    if (word_len < MAX_TOKEN_LEN - 1) {
+        /* Convert to lowercase */
+        for (size_t j = 0; j < word_len; j++) {
+            word[j] = tolower((unsigned char)text[start + j]);
         }
+        word[word_len] = '\0';
+    }
+    return word_len;
+}
+
+/* Basic word tokenization (split on whitespace and punctuation) */
+static size_t basic_tokenize(const char* text, size_t text_len,
+                             char tokens[][MAX_TOKEN_LEN], size_t max_tokens) {
+    size_t token_count = 0;
+    size_t i = 0;
+
+    while (token_count < max_tokens) {
+        size_t word_len = next_word(text, text_len, &i, tokens[token_count]);
+        if (word_len == 0) break;
+        if (word_len < MAX_TOKEN_LEN - 1) token_count++;
     }
 
     return token_count;
@@ -367,6 +384,29 @@ mem_error_t tokenizer_encode(tokenizer_t* tok,
     return MEM_OK;
 }
 
+size_t tokenizer_count(const tokenizer_t* tok, const char* text, size_t text_len) {
+    if (!tok || !text) return 0;
+    if (!tok->has_vocab) return text_len;  /* Character-level, as in encode */
+
+    size_t count = 0;
+    size_t pos = 0;
+    char word[MAX_TOKEN_LEN];
+    int32_t subword_ids[MAX_TOKEN_LEN];
+
+    for (;;) {
+        size_t word_len = next_word(text, text_len, &pos, word);
+        if (word_len == 0) break;
+
+        /* Over-long words map to a single [UNK], as in BERT */
+        if (word_len >= MAX_TOKEN_LEN - 1) {
+            count++;
+            continue;
+        }
+        count += wordpiece_tokenize(tok, word, subword_ids, MAX_TOKEN_LEN);
+    }
+    return count;
+}
+
 mem_error_t tokenizer_encode_batch(tokenizer_t* tok,
                                    const char** texts,
                                    const size_t* lengths,
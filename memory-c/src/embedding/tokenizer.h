@@ -76,6 +76,14 @@ mem_error_t tokenizer_encode(tokenizer_t* tokenizer,
                              size_t max_length,
                              tokenizer_output_t* output);
 
+/*
+ * Count WordPiece tokens in text
+ *
+ * Same tokenization as tokenizer_encode, but without special tokens,
+ * padding or truncation, so the result is the text's full token cost.
+ */
+size_t tokenizer_count(const tokenizer_t* tokenizer, const char* text, size_t text_len);
+
 /*
  * Tokenize batch of texts
  *
@@ -26,6 +26,9 @@
 #include "search/search.h"
 #include "api/api.h"
 
+/* How often the main loop applies the search retention window */
+#define RETENTION_INTERVAL_MS 60000
+
 /* Global shutdown flag */
 static volatile sig_atomic_t g_shutdown = 0;
 
@@ -44,9 +47,19 @@ static void print_usage(const char* prog) {
     printf("Options:\n");
     printf("  -d, --data-dir DIR       Data directory (default: ./data)\n");
     printf("  -p, --port PORT          HTTP port (default: 8080)\n");
-    printf("  -c, --capacity NUM       Max nodes capacity (default: 10000)\n");
+    printf("  -c, --capacity NUM       Initial node capacity (default: 10000)\n");
     printf("  -m, --model PATH         ONNX model path (optional)\n");
     printf("  -l, --log-format FORMAT  Log format: text or json (default: text)\n");
+    printf("  -f, --search-fanout NUM  Parallel per-level search tasks (default: 0, serial)\n");
+    printf("  -e, --embed-cache-mb NUM Query embedding cache size in MB (default: 16, 0 = off)\n");
+    printf("  -P, --mmap-populate      Fault relation and embedding files in at startup\n");
+    printf("  -L, --mlock-levels LIST  Lock embedding levels in RAM, e.g. agent,session\n");
+    printf("  -W, --no-wal             Do not log writes to the write-ahead log\n");
+    printf("  -S, --wal-sync MODE      WAL durability: fdatasync, dsync or direct (default: fdatasync)\n");
+    printf("  -U, --io-uring           Submit WAL writes through io_uring where available\n");
+    printf("  -F, --flush-interval MS  Background writeback interval (default: 1000, 0 = off)\n");
+    printf("  -B, --snapshot-dir DIR   Enable memory.snapshot, writing snapshots under DIR\n");
+    printf("  -R, --retention-days NUM Keep statements, blocks and messages searchable NUM days (default: 0, forever)\n");
     printf("  -v, --verbose            Verbose logging\n");
     printf("  -h, --help               Show this help\n");
     printf("\nEndpoints:\n");
@@ -58,6 +71,31 @@ static void print_usage(const char* prog) {
     printf("  memory.query             Search memories\n");
     printf("  memory.get_context       Get context for session\n");
     printf("  memory.list_sessions     List all sessions\n");
+    printf("  memory.snapshot          Copy the data directory while serving (admin)\n");
+}
+
+/* Parse comma-separated level names into a (1 << level) mask; -1 if invalid */
+static int64_t parse_level_mask(const char* list) {
+    static const char* names[LEVEL_COUNT] = {
+        [LEVEL_STATEMENT] = "statement", [LEVEL_BLOCK] = "block",
+        [LEVEL_MESSAGE] = "message", [LEVEL_SESSION] = "session",
+        [LEVEL_AGENT] = "agent"
+    };
+
+    int64_t mask = 0;
+    const char* p = list;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        int level = -1;
+        for (int i = 0; i < LEVEL_COUNT; i++) {
+            if (strlen(names[i]) == len && strncmp(p, names[i], len) == 0) level = i;
+        }
+        if (level < 0) return -1;
+        mask |= (int64_t)1 << level;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return mask;
 }
 
 /* Ensure directory exists */
@@ -84,6 +122,14 @@ int main(int argc, char** argv) {
     const char* model_path = NULL;
     int verbose = 0;
     log_format_t log_format = LOG_FORMAT_TEXT;
+    size_t search_fanout = 0;
+    size_t embed_cache_mb = 16;
+    hierarchy_mmap_config_t mmap_cfg = HIERARCHY_MMAP_CONFIG_DEFAULT;
+    bool use_wal = true;
+    wal_config_t wal_cfg = WAL_CONFIG_DEFAULT;
+    uint32_t flush_interval_ms = FLUSHER_INTERVAL_DEFAULT_MS;
+    const char* snapshot_dir = NULL;
+    uint64_t retention_days = 0;
 
     /* Parse command line options */
     static struct option long_options[] = {
@@ -92,13 +138,23 @@ int main(int argc, char** argv) {
         {"capacity",   required_argument, 0, 'c'},
         {"model",      required_argument, 0, 'm'},
         {"log-format", required_argument, 0, 'l'},
+        {"search-fanout", required_argument, 0, 'f'},
+        {"embed-cache-mb", required_argument, 0, 'e'},
+        {"mmap-populate", no_argument,   0, 'P'},
+        {"mlock-levels", required_argument, 0, 'L'},
+        {"no-wal",     no_argument,       0, 'W'},
+        {"wal-sync",   required_argument, 0, 'S'},
+        {"io-uring",   no_argument,       0, 'U'},
+        {"flush-interval", required_argument, 0, 'F'},
+        {"snapshot-dir", required_argument, 0, 'B'},
+        {"retention-days", required_argument, 0, 'R'},
         {"verbose",    no_argument,       0, 'v'},
         {"help",       no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "d:p:c:m:l:vh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:p:c:m:l:f:e:PL:WS:UF:B:R:vh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'd':
                 data_dir = optarg;
@@ -122,6 +178,51 @@ int main(int argc, char** argv) {
                     return 1;
                 }
                 break;
+            case 'f':
+                search_fanout = (size_t)atol(optarg);
+                break;
+            case 'e':
+                embed_cache_mb = (size_t)atol(optarg);
+                break;
+            case 'P':
+                mmap_cfg.populate = true;
+                break;
+            case 'L': {
+                int64_t mask = parse_level_mask(optarg);
+                if (mask < 0) {
+                    fprintf(stderr, "Invalid level list: %s\n", optarg);
+                    return 1;
+                }
+                mmap_cfg.lock_levels = (uint32_t)mask;
+                break;
+            }
+            case 'W':
+                use_wal = false;
+                break;
+            case 'S':
+                if (strcmp(optarg, "fdatasync") == 0) {
+                    wal_cfg.io_mode = WAL_IO_BUFFERED;
+                } else if (strcmp(optarg, "dsync") == 0) {
+                    wal_cfg.io_mode = WAL_IO_DSYNC;
+                } else if (strcmp(optarg, "direct") == 0) {
+                    wal_cfg.io_mode = WAL_IO_DIRECT;
+                } else {
+                    fprintf(stderr, "Invalid WAL sync mode: %s (use 'fdatasync', 'dsync' or 'direct')\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'U':
+                wal_cfg.backend = AIO_BACKEND_IO_URING;
+                break;
+            case 'F':
+                flush_interval_ms = (uint32_t)atol(optarg);
+                break;
+            case 'B':
+                snapshot_dir = optarg;
+                break;
+            case 'R':
+                retention_days = (uint64_t)atoll(optarg);
+                break;
             case 'v':
                 verbose = 1;
                 break;
@@ -161,6 +262,11 @@ int main(int argc, char** argv) {
     }
     LOG_INFO("Data directory: %s", data_dir);
 
+    if (snapshot_dir && ensure_dir(snapshot_dir) != 0) {
+        LOG_ERROR("Failed to create snapshot directory: %s", snapshot_dir);
+        return 1;
+    }
+
     /* Initialize components */
     mem_error_t err = MEM_OK;
     hierarchy_t* hierarchy = NULL;
@@ -179,10 +285,35 @@ int main(int argc, char** argv) {
             goto cleanup;
         }
     }
+    if (mmap_cfg.populate || mmap_cfg.lock_levels) {
+        err = hierarchy_set_mmap_config(hierarchy, &mmap_cfg);
+        if (err != MEM_OK) {
+            LOG_ERROR("Failed to apply mmap settings: %d", err);
+            goto cleanup;
+        }
+    }
+    if (use_wal) {
+        err = hierarchy_enable_wal(hierarchy, 0, &wal_cfg);
+        if (err != MEM_OK) {
+            LOG_ERROR("Failed to open write-ahead log: %d", err);
+            goto cleanup;
+        }
+    }
+    if (flush_interval_ms > 0) {
+        err = hierarchy_enable_flusher(hierarchy, flush_interval_ms);
+        if (err != MEM_OK) {
+            LOG_ERROR("Failed to start background flusher: %d", err);
+            goto cleanup;
+        }
+    }
 
     /* 2. Initialize embedding engine */
     embedding_config_t emb_cfg = EMBEDDING_CONFIG_DEFAULT;
     emb_cfg.model_path = model_path;
+    emb_cfg.cache_mb = embed_cache_mb;
+    char embed_cache_path[512];
+    snprintf(embed_cache_path, sizeof(embed_cache_path), "%s/embedding_cache.bin", data_dir);
+    emb_cfg.cache_path = embed_cache_path;
     err = embedding_engine_create(&embedding_engine, &emb_cfg);
     if (err != MEM_OK) {
         LOG_ERROR("Failed to create embedding engine: %d", err);
@@ -191,6 +322,8 @@ int main(int argc, char** argv) {
 
     /* 3. Initialize search engine */
     search_config_t search_cfg = SEARCH_CONFIG_DEFAULT;
+    search_cfg.parallel_fanout = search_fanout;
+    search_cfg.retention_ns = retention_days * 86400ULL * 1000000000ULL;
     err = search_engine_create(&search, hierarchy, &search_cfg);
     if (err != MEM_OK) {
         LOG_ERROR("Failed to create search engine: %d", err);
@@ -200,6 +333,7 @@ int main(int argc, char** argv) {
     /* 4. Start API server */
     api_config_t api_cfg = API_CONFIG_DEFAULT;
     api_cfg.port = port;
+    api_cfg.snapshot_dir = snapshot_dir;
     err = api_server_create(&api, hierarchy, search, embedding_engine, &api_cfg);
     if (err != MEM_OK) {
         LOG_ERROR("Failed to create API server: %d", err);
@@ -216,10 +350,15 @@ int main(int argc, char** argv) {
         LOG_INFO("Service running in embedded mode (API available via api_process_rpc)");
     }
 
-    LOG_INFO("Memory Service ready (capacity: %zu nodes)", capacity);
+    LOG_INFO("Memory Service ready (initial capacity: %zu nodes)", capacity);
 
-    /* Main loop */
+    /* Main loop; drops expired index segments every RETENTION_INTERVAL_MS */
+    uint64_t next_expiry = 0;
     while (!g_shutdown) {
+        if (search_cfg.retention_ns > 0 && time_now_ms() >= next_expiry) {
+            search_engine_expire(search, timestamp_now_ns(), NULL);
+            next_expiry = time_now_ms() + RETENTION_INTERVAL_MS;
+        }
         sleep_ms(100);
     }
 
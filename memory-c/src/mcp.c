@@ -106,7 +106,9 @@ static const char* MCP_TOOLS_JSON =
       "\"properties\": {"
         "\"query\": {\"type\": \"string\", \"description\": \"Search query text\"},"
         "\"level\": {\"type\": \"string\", \"enum\": [\"session\", \"message\", \"block\", \"statement\"], \"description\": \"Filter to specific level\"},"
-        "\"max_results\": {\"type\": \"integer\", \"description\": \"Maximum results (default 10, max 100)\"}"
+        "\"max_results\": {\"type\": \"integer\", \"description\": \"Maximum results (default 10, max 100)\"},"
+        "\"agent_id\": {\"type\": \"string\", \"description\": \"Only search this agent's memory\"},"
+        "\"session_id\": {\"type\": \"string\", \"description\": \"Only search this session\"}"
       "},"
       "\"required\": [\"query\"]"
     "}"
@@ -527,10 +529,18 @@ int main(int argc, char** argv) {
             goto cleanup;
         }
     }
+    err = hierarchy_enable_wal(hierarchy, 0, NULL);
+    if (err != MEM_OK) {
+        fprintf(stderr, "Failed to open write-ahead log: %d\n", err);
+        goto cleanup;
+    }
 
     /* 2. Initialize embedding engine */
     embedding_config_t emb_cfg = EMBEDDING_CONFIG_DEFAULT;
     emb_cfg.model_path = model_path;
+    char embed_cache_path[512];
+    snprintf(embed_cache_path, sizeof(embed_cache_path), "%s/embedding_cache.bin", data_dir);
+    emb_cfg.cache_path = embed_cache_path;
     err = embedding_engine_create(&embedding_engine, &emb_cfg);
     if (err != MEM_OK) {
         fprintf(stderr, "Failed to create embedding engine: %d\n", err);
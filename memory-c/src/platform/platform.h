@@ -14,6 +14,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <sys/types.h>
 
 /* Platform detection */
 #if defined(__linux__)
@@ -60,6 +61,50 @@
  */
 void* platform_mremap(void* old_addr, size_t old_size, size_t new_size, int fd);
 
+/* Start writeback of bytes [offset, offset + len) of a shared file mapping
+ * without waiting for it to finish. Pages already being written are
+ * waited for first, so every page dirty at the call is queued.
+ * On Linux, uses sync_file_range(). On macOS, uses msync(MS_ASYNC).
+ *
+ * Parameters:
+ *   base      - Mapped address of the file
+ *   fd        - File descriptor of the mapping
+ *   offset    - Page-aligned file offset
+ *   len       - Bytes to write back
+ *
+ * Returns:
+ *   0 on success, -1 with errno set on error
+ */
+int platform_writeback(void* base, int fd, size_t offset, size_t len);
+
+/*
+ * File copy operations
+ */
+
+/* Create dst_path as a copy-on-write clone of an open file, sharing its
+ * blocks instead of copying them.
+ * On Linux, uses the FICLONE ioctl (btrfs, XFS, bcachefs). On macOS,
+ * uses fclonefileat() (APFS).
+ *
+ * Parameters:
+ *   src_fd    - File descriptor of the source, open for reading
+ *   dst_path  - Path of the clone; must not exist
+ *
+ * Returns:
+ *   0 on success, -1 with errno set (and dst_path absent) when the
+ *   filesystem cannot clone or on error
+ */
+int platform_clone_file(int src_fd, const char* dst_path);
+
+/* Copy len bytes at offset from one file to the same offset in another
+ * inside the kernel.
+ * On Linux, uses copy_file_range(). Not available on macOS (ENOSYS).
+ *
+ * Returns:
+ *   Bytes copied (may be short; 0 at end of file), -1 with errno set
+ */
+ssize_t platform_copy_range(int in_fd, int out_fd, size_t offset, size_t len);
+
 /*
  * ONNX Runtime execution provider
  */
@@ -5,7 +5,10 @@
 #include "platform.h"
 
 #include <sys/mman.h>
+#include <sys/clonefile.h>
+#include <fcntl.h>
 #include <string.h>
+#include <errno.h>
 
 /*
  * Memory remapping on macOS (no mremap, use munmap + mmap)
@@ -46,6 +49,30 @@ void* platform_mremap(void* old_addr, size_t old_size, size_t new_size, int fd)
     return new_addr;
 }
 
+/*
+ * Writeback on macOS: no sync_file_range, so schedule through the mapping
+ */
+int platform_writeback(void* base, int fd, size_t offset, size_t len) {
+    (void)fd;
+    return msync((char*)base + offset, len, MS_ASYNC);
+}
+
+/*
+ * Clone on APFS; other filesystems fail with ENOTSUP
+ */
+int platform_clone_file(int src_fd, const char* dst_path) {
+    return fclonefileat(src_fd, AT_FDCWD, dst_path, 0);
+}
+
+ssize_t platform_copy_range(int in_fd, int out_fd, size_t offset, size_t len) {
+    (void)in_fd;
+    (void)out_fd;
+    (void)offset;
+    (void)len;
+    errno = ENOSYS;  /* No copy_file_range; callers copy through a buffer */
+    return -1;
+}
+
 /*
  * ONNX Runtime provider - CoreML on Apple Silicon
  */
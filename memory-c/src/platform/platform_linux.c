@@ -5,7 +5,12 @@
 #include "platform.h"
 
 #include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <fcntl.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 /*
  * Memory remapping using Linux mremap()
@@ -15,6 +20,38 @@ void* platform_mremap(void* old_addr, size_t old_size, size_t new_size, int fd)
     return mremap(old_addr, old_size, new_size, MREMAP_MAYMOVE);
 }
 
+/*
+ * Writeback through the file: the mapping may move while this runs
+ */
+int platform_writeback(void* base, int fd, size_t offset, size_t len) {
+    (void)base;  /* Not needed on Linux - works on the file's page cache */
+    return sync_file_range(fd, (off_t)offset, (off_t)len,
+                           SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE);
+}
+
+/*
+ * Reflink through FICLONE; the clone needs an open destination file
+ */
+int platform_clone_file(int src_fd, const char* dst_path) {
+    int fd = open(dst_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) return -1;
+
+    if (ioctl(fd, FICLONE, src_fd) < 0) {
+        int saved = errno;
+        close(fd);
+        unlink(dst_path);
+        errno = saved;
+        return -1;
+    }
+    return close(fd);
+}
+
+ssize_t platform_copy_range(int in_fd, int out_fd, size_t offset, size_t len) {
+    off_t in_off = (off_t)offset;
+    off_t out_off = (off_t)offset;
+    return copy_file_range(in_fd, &in_off, out_fd, &out_off, len, 0);
+}
+
 /*
  * ONNX Runtime provider - CPU on Linux (CUDA would need separate build)
  */
@@ -59,8 +59,13 @@ struct hnsw_index {
     size_t entry_point;
     int max_layer;
 
-    /* ID to index mapping */
-    node_id_t* id_to_idx;     /* Sparse array: id_to_idx[id] = node index */
+    /*
+     * ID to index mapping over the window [id_base, id_base + id_map_size),
+     * so an index holding a narrow ID range (e.g. one time segment) only
+     * pays for that range
+     */
+    node_id_t* id_to_idx;     /* id_to_idx[id - id_base] = node index */
+    node_id_t id_base;
     size_t id_map_size;
 
     /* Random state for layer selection */
@@ -70,6 +75,55 @@ struct hnsw_index {
     float level_mult;
 };
 
+/* ========== ID Map ========== */
+
+/* Map slot for id, or NULL if id lies outside the window */
+static inline node_id_t* id_slot(const hnsw_index_t* index, node_id_t id) {
+    if (id < index->id_base || (size_t)(id - index->id_base) >= index->id_map_size) {
+        return NULL;
+    }
+    return &index->id_to_idx[id - index->id_base];
+}
+
+/* Grow the window to cover id, at least doubling it in either direction */
+static mem_error_t id_map_reserve(hnsw_index_t* index, node_id_t id) {
+    if (id_slot(index, id)) return MEM_OK;
+
+    size_t size = index->id_map_size;
+    node_id_t base = size ? index->id_base : id;
+    node_id_t new_base = base;
+    size_t new_size;
+
+    if (id < base) {
+        size_t grow = (size_t)(base - id) > size ? (size_t)(base - id) : size;
+        new_base = grow < base ? (node_id_t)(base - grow) : 0;
+        new_size = size + (base - new_base);
+    } else {
+        new_size = (size_t)(id - base) + 1;
+        if (new_size < size * 2) new_size = size * 2;
+        if (new_size < 64) new_size = 64;
+    }
+
+    node_id_t* new_map = realloc(index->id_to_idx, new_size * sizeof(node_id_t));
+    if (!new_map) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand ID map");
+    }
+
+    /* Growing down shifts the existing slots up */
+    size_t shift = base - new_base;
+    if (shift > 0) {
+        memmove(new_map + shift, new_map, size * sizeof(node_id_t));
+    }
+    for (size_t i = 0; i < new_size; i++) {
+        if (i < shift || i >= shift + size) new_map[i] = NODE_ID_INVALID;
+    }
+
+    index->id_to_idx = new_map;
+    index->id_base = new_base;
+    index->id_map_size = new_size;
+    return MEM_OK;
+}
+
 /* ========== Priority Queue Implementation ========== */
 
 static bool pq_init(pq_t* pq, size_t capacity) {
@@ -275,6 +329,67 @@ static void search_layer(hnsw_index_t* idx, const float* query, size_t entry,
     free(visited);
 }
 
+/* Add node to accepted, a max-heap (negated distances) of the ef best filter hits */
+static void filtered_accept(hnsw_index_t* idx, size_t node_idx, float dist, size_t ef,
+                            hnsw_filter_fn filter, void* filter_ctx, pq_t* accepted) {
+    hnsw_node_t* node = &idx->nodes[node_idx];
+    if (node->deleted || !filter(node->id, filter_ctx)) return;
+    pq_push(accepted, node_idx, -dist);
+    if (accepted->size > ef) pq_pop(accepted);
+}
+
+/*
+ * Filtered search of layer 0. Only nodes passing the filter count toward
+ * the ef results; rejected and deleted ones are traversed but not kept.
+ * Until ef nodes pass, every neighbor reached is explored, so a selective
+ * filter costs distance computations rather than recall.
+ */
+static void search_layer_filtered(hnsw_index_t* idx, const float* query, size_t entry,
+                                  size_t ef, hnsw_filter_fn filter, void* filter_ctx,
+                                  pq_t* accepted) {
+    if (entry >= idx->node_count) return;
+
+    size_t visited_size = (idx->node_count + 63) / 64;
+    uint64_t* visited = calloc(visited_size ? visited_size : 1, sizeof(uint64_t));
+    if (!visited) return;
+
+    pq_t candidates;
+    if (!pq_init(&candidates, ef * 2)) {
+        free(visited);
+        return;
+    }
+
+    visited[entry / 64] |= (1ULL << (entry % 64));
+    float entry_dist = compute_distance(query, idx->nodes[entry].vector);
+    pq_push(&candidates, entry, entry_dist);
+    filtered_accept(idx, entry, entry_dist, ef, filter, filter_ctx, accepted);
+
+    while (!pq_empty(&candidates)) {
+        pq_elem_t curr = pq_pop(&candidates);
+        bool full = accepted->size >= ef;
+        if (full && curr.distance > -accepted->data[0].distance) break;
+
+        hnsw_node_t* node = &idx->nodes[curr.node_idx];
+        if (!node->neighbors || !node->neighbor_counts || !node->neighbors[0]) continue;
+
+        for (size_t i = 0; i < node->neighbor_counts[0]; i++) {
+            size_t neighbor_idx = node->neighbors[0][i];
+            if (neighbor_idx >= idx->node_count) continue;
+            if (visited[neighbor_idx / 64] & (1ULL << (neighbor_idx % 64))) continue;
+            visited[neighbor_idx / 64] |= (1ULL << (neighbor_idx % 64));
+
+            float dist = compute_distance(query, idx->nodes[neighbor_idx].vector);
+            if (accepted->size < ef || dist < -accepted->data[0].distance) {
+                pq_push(&candidates, neighbor_idx, dist);
+                filtered_accept(idx, neighbor_idx, dist, ef, filter, filter_ctx, accepted);
+            }
+        }
+    }
+
+    pq_destroy(&candidates);
+    free(visited);
+}
+
 /* Select M best neighbors from candidates */
 static void select_neighbors(hnsw_index_t* idx, size_t node_idx, pq_t* candidates,
                             int layer, size_t M, node_id_t* out, size_t* out_count) {
@@ -368,8 +483,8 @@ mem_error_t hnsw_create(hnsw_index_t** index, const hnsw_config_t* config) {
         idx->config = (hnsw_config_t)HNSW_CONFIG_DEFAULT;
     }
 
-    /* Allocate nodes array */
-    idx->node_capacity = 1024;
+    /* Allocate nodes array; small, since many indexes may hold few nodes */
+    idx->node_capacity = 64;
     idx->nodes = calloc(idx->node_capacity, sizeof(hnsw_node_t));
     if (!idx->nodes) {
         free(idx);
@@ -380,17 +495,10 @@ mem_error_t hnsw_create(hnsw_index_t** index, const hnsw_config_t* config) {
     idx->entry_point = 0;
     idx->max_layer = -1;
 
-    /* ID mapping */
-    idx->id_map_size = idx->config.max_elements;
-    idx->id_to_idx = malloc(idx->id_map_size * sizeof(node_id_t));
-    if (!idx->id_to_idx) {
-        free(idx->nodes);
-        free(idx);
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate ID map");
-    }
-    for (size_t i = 0; i < idx->id_map_size; i++) {
-        idx->id_to_idx[i] = NODE_ID_INVALID;
-    }
+    /* ID map starts empty and grows around the IDs added */
+    idx->id_to_idx = NULL;
+    idx->id_base = 0;
+    idx->id_map_size = 0;
 
     /* Random state */
     idx->rand_state = 12345;  /* Fixed seed for reproducibility */
@@ -426,16 +534,23 @@ mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector) {
     MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
     MEM_CHECK_ERR(vector != NULL, MEM_ERR_INVALID_ARG, "vector is NULL");
 
+    /* Check if ID already exists; a removed one is revived in its old slot */
+    node_id_t* slot = id_slot(index, id);
+    if (slot && *slot != NODE_ID_INVALID) {
+        hnsw_node_t* existing = &index->nodes[*slot];
+        if (!existing->deleted) {
+            MEM_RETURN_ERROR(MEM_ERR_EXISTS, "ID %u already in index", id);
+        }
+        memcpy(existing->vector, vector, EMBEDDING_DIM * sizeof(float));
+        existing->deleted = false;
+        return MEM_OK;
+    }
+
     /* Check capacity */
     if (index->node_count >= index->config.max_elements) {
         MEM_RETURN_ERROR(MEM_ERR_FULL, "HNSW index is full");
     }
 
-    /* Check if ID already exists */
-    if (id < index->id_map_size && index->id_to_idx[id] != NODE_ID_INVALID) {
-        MEM_RETURN_ERROR(MEM_ERR_EXISTS, "ID %u already in index", id);
-    }
-
     /* Expand nodes array if needed */
     if (index->node_count >= index->node_capacity) {
         size_t new_cap = index->node_capacity * 2;
@@ -450,21 +565,7 @@ mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector) {
     }
 
     /* Expand ID map if needed */
-    if (id >= index->id_map_size) {
-        size_t new_size = id + 1;
-        if (new_size < index->id_map_size * 2) {
-            new_size = index->id_map_size * 2;
-        }
-        node_id_t* new_map = realloc(index->id_to_idx, new_size * sizeof(node_id_t));
-        if (!new_map) {
-            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand ID map");
-        }
-        for (size_t i = index->id_map_size; i < new_size; i++) {
-            new_map[i] = NODE_ID_INVALID;
-        }
-        index->id_to_idx = new_map;
-        index->id_map_size = new_size;
-    }
+    MEM_CHECK(id_map_reserve(index, id));
 
     /* Assign layer */
     int node_layer = random_layer(index);
@@ -511,7 +612,7 @@ mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector) {
     }
 
     /* Update ID mapping */
-    index->id_to_idx[id] = (node_id_t)node_idx;
+    *id_slot(index, id) = (node_id_t)node_idx;
 
     /* If first node, set as entry point */
     if (index->node_count == 1) {
@@ -586,8 +687,11 @@ mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector) {
     return MEM_OK;
 }
 
-mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
-                        size_t k, hnsw_result_t* results, size_t* result_count) {
+/* Shared search path: greedy descent, then ef-wide search at layer 0 */
+static mem_error_t search_internal(const hnsw_index_t* index, const float* query,
+                                   size_t k, size_t ef,
+                                   hnsw_filter_fn filter, void* filter_ctx,
+                                   hnsw_result_t* results, size_t* result_count) {
     MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
     MEM_CHECK_ERR(query != NULL, MEM_ERR_INVALID_ARG, "query is NULL");
     MEM_CHECK_ERR(results != NULL, MEM_ERR_INVALID_ARG, "results is NULL");
@@ -599,6 +703,9 @@ mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
         return MEM_OK;
     }
 
+    /* k results need at least k candidates */
+    if (ef < k) ef = k;
+
     /* Cast away const for internal operations (search doesn't modify) */
     hnsw_index_t* idx = (hnsw_index_t*)index;
 
@@ -630,13 +737,32 @@ mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
         }
     }
 
-    /* Search layer 0 with ef_search candidates */
+    if (filter) {
+        pq_t accepted;
+        if (!pq_init(&accepted, ef + 1)) {
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate search results");
+        }
+        search_layer_filtered(idx, query, curr_entry, ef, filter, filter_ctx, &accepted);
+
+        /* The max-heap yields the worst hit first; keep the best k */
+        while (accepted.size > k) pq_pop(&accepted);
+        *result_count = accepted.size;
+        for (size_t i = accepted.size; i > 0; i--) {
+            pq_elem_t hit = pq_pop(&accepted);
+            results[i - 1].id = idx->nodes[hit.node_idx].id;
+            results[i - 1].distance = -hit.distance;
+        }
+        pq_destroy(&accepted);
+        return MEM_OK;
+    }
+
+    /* Search layer 0 with ef candidates */
     pq_t candidates;
-    if (!pq_init(&candidates, idx->config.ef_search)) {
+    if (!pq_init(&candidates, ef)) {
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate search candidates");
     }
 
-    search_layer(idx, query, curr_entry, 0, idx->config.ef_search, &candidates);
+    search_layer(idx, query, curr_entry, 0, ef, &candidates);
 
     /* Extract k best results */
     pq_elem_t* sorted = malloc(candidates.size * sizeof(pq_elem_t));
@@ -666,6 +792,29 @@ mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
     return MEM_OK;
 }
 
+mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
+                        size_t k, hnsw_result_t* results, size_t* result_count) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    return search_internal(index, query, k, index->config.ef_search,
+                           NULL, NULL, results, result_count);
+}
+
+mem_error_t hnsw_search_filtered(const hnsw_index_t* index, const float* query,
+                                 size_t k, size_t ef,
+                                 hnsw_filter_fn filter, void* filter_ctx,
+                                 hnsw_result_t* results, size_t* result_count) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    MEM_CHECK_ERR(filter != NULL, MEM_ERR_INVALID_ARG, "filter is NULL");
+    if (ef < index->config.ef_search) ef = index->config.ef_search;
+    return search_internal(index, query, k, ef, filter, filter_ctx,
+                           results, result_count);
+}
+
+const float* hnsw_get_vector(const hnsw_index_t* index, node_id_t id) {
+    if (!hnsw_contains(index, id)) return NULL;
+    return index->nodes[*id_slot(index, id)].vector;
+}
+
 size_t hnsw_size(const hnsw_index_t* index) {
     if (!index) return 0;
 
@@ -678,24 +827,34 @@ size_t hnsw_size(const hnsw_index_t* index) {
     return count;
 }
 
+size_t hnsw_slot_count(const hnsw_index_t* index) {
+    return index ? index->node_count : 0;
+}
+
+bool hnsw_slot(const hnsw_index_t* index, size_t slot, node_id_t* id, const float** vector) {
+    if (!index || slot >= index->node_count || index->nodes[slot].deleted) return false;
+    if (id) *id = index->nodes[slot].id;
+    if (vector) *vector = index->nodes[slot].vector;
+    return true;
+}
+
 bool hnsw_contains(const hnsw_index_t* index, node_id_t id) {
     if (!index) return false;
-    if (id >= index->id_map_size) return false;
-    if (index->id_to_idx[id] == NODE_ID_INVALID) return false;
+    const node_id_t* slot = id_slot(index, id);
+    if (!slot || *slot == NODE_ID_INVALID) return false;
 
-    size_t idx = index->id_to_idx[id];
-    return !index->nodes[idx].deleted;
+    return !index->nodes[*slot].deleted;
 }
 
 mem_error_t hnsw_remove(hnsw_index_t* index, node_id_t id) {
     MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
 
-    if (id >= index->id_map_size || index->id_to_idx[id] == NODE_ID_INVALID) {
+    const node_id_t* slot = id_slot(index, id);
+    if (!slot || *slot == NODE_ID_INVALID) {
         MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "ID %u not in index", id);
     }
 
-    size_t idx = index->id_to_idx[id];
-    index->nodes[idx].deleted = true;
+    index->nodes[*slot].deleted = true;
 
     /* Note: We don't actually remove the node or update the graph structure.
      * This is a soft delete that marks the node as deleted but keeps it
@@ -49,16 +49,21 @@ void hnsw_destroy(hnsw_index_t* index);
 /*
  * Add a vector to the index
  *
+ * Adding a removed id revives it in place: the vector is replaced and
+ * the element keeps its slot and graph links.
+ *
  * @param index   The HNSW index
  * @param id      Unique identifier for this vector
  * @param vector  The embedding vector (EMBEDDING_DIM floats)
- * @return MEM_OK on success
+ * @return MEM_OK on success, MEM_ERR_EXISTS if id is already present
  */
 mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector);
 
 /*
  * Search for nearest neighbors
  *
+ * Explores max(k, ef_search) candidates, so k is never capped by ef_search.
+ *
  * @param index       The HNSW index
  * @param query       Query vector (EMBEDDING_DIM floats)
  * @param k           Number of nearest neighbors to find
@@ -69,11 +74,47 @@ mem_error_t hnsw_add(hnsw_index_t* index, node_id_t id, const float* vector);
 mem_error_t hnsw_search(const hnsw_index_t* index, const float* query,
                         size_t k, hnsw_result_t* results, size_t* result_count);
 
+/* Predicate for filtered search: return true to keep id */
+typedef bool (*hnsw_filter_fn)(node_id_t id, void* ctx);
+
+/*
+ * Search for nearest neighbors accepted by filter
+ *
+ * Only accepted elements fill the ef candidates (at least the configured
+ * ef_search, and at least k); rejected ones are traversed but not counted, so the search
+ * widens until ef elements pass the filter or none are left to reach. A
+ * selective filter costs more distance computations instead of recall.
+ */
+mem_error_t hnsw_search_filtered(const hnsw_index_t* index, const float* query,
+                                 size_t k, size_t ef,
+                                 hnsw_filter_fn filter, void* filter_ctx,
+                                 hnsw_result_t* results, size_t* result_count);
+
+/*
+ * Get the stored vector for an element (NULL if absent or deleted)
+ */
+const float* hnsw_get_vector(const hnsw_index_t* index, node_id_t id);
+
 /*
  * Get number of elements in the index
  */
 size_t hnsw_size(const hnsw_index_t* index);
 
+/*
+ * Get number of element slots, removed elements included. Slots are
+ * numbered in insertion order and never move; max_elements caps them.
+ */
+size_t hnsw_slot_count(const hnsw_index_t* index);
+
+/*
+ * Read an element slot
+ *
+ * @return true if the slot holds a live element; id and vector (either
+ *         may be NULL) are then set
+ */
+bool hnsw_slot(const hnsw_index_t* index, size_t slot, node_id_t* id,
+               const float** vector);
+
 /*
  * Check if index contains an element
  */
@@ -333,6 +333,59 @@ mem_error_t inverted_index_remove(inverted_index_t* index, node_id_t doc_id) {
     return MEM_OK;
 }
 
+static int compare_doc_ids(const void* a, const void* b) {
+    node_id_t ia = *(const node_id_t*)a;
+    node_id_t ib = *(const node_id_t*)b;
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+static inline bool doc_in(const node_id_t* sorted, size_t count, node_id_t doc_id) {
+    return bsearch(&doc_id, sorted, count, sizeof(node_id_t), compare_doc_ids) != NULL;
+}
+
+mem_error_t inverted_index_remove_batch(inverted_index_t* index,
+                                        const node_id_t* doc_ids, size_t count) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    MEM_CHECK_ERR(doc_ids != NULL || count == 0, MEM_ERR_INVALID_ARG, "doc_ids is NULL");
+    if (count == 0) return MEM_OK;
+
+    node_id_t* sorted = malloc(count * sizeof(node_id_t));
+    if (!sorted) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate removal set");
+    }
+    memcpy(sorted, doc_ids, count * sizeof(node_id_t));
+    qsort(sorted, count, sizeof(node_id_t), compare_doc_ids);
+
+    /* Mark documents as deleted */
+    size_t active_docs = 0;
+    for (size_t i = 0; i < index->doc_count; i++) {
+        doc_info_t* doc = &index->docs[i];
+        if (!doc->deleted && doc_in(sorted, count, doc->doc_id)) {
+            doc->deleted = true;
+            index->total_tokens -= doc->token_count;
+        }
+        if (!doc->deleted) active_docs++;
+    }
+    index->avg_doc_len = active_docs > 0 ?
+        (float)index->total_tokens / (float)active_docs : 0.0f;
+
+    /* Compact every posting list once */
+    for (size_t i = 0; i < index->bucket_count; i++) {
+        for (token_entry_t* entry = index->buckets[i]; entry; entry = entry->next) {
+            size_t kept = 0;
+            for (size_t j = 0; j < entry->posting_count; j++) {
+                if (!doc_in(sorted, count, entry->postings[j].doc_id)) {
+                    entry->postings[kept++] = entry->postings[j];
+                }
+            }
+            entry->posting_count = kept;
+        }
+    }
+
+    free(sorted);
+    return MEM_OK;
+}
+
 mem_error_t inverted_index_search(const inverted_index_t* index,
                                   const char** tokens, size_t token_count,
                                   size_t k, inverted_result_t* results,
@@ -469,10 +522,12 @@ mem_error_t inverted_index_search(const inverted_index_t* index,
     return MEM_OK;
 }
 
-mem_error_t inverted_index_search_any(const inverted_index_t* index,
-                                      const char** tokens, size_t token_count,
-                                      size_t k, inverted_result_t* results,
-                                      size_t* result_count) {
+/* OR query; documents rejected by filter (if any) are never scored */
+static mem_error_t search_any_internal(const inverted_index_t* index,
+                                       const char** tokens, size_t token_count,
+                                       size_t k, inverted_filter_fn filter,
+                                       void* filter_ctx, inverted_result_t* results,
+                                       size_t* result_count) {
     MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
     MEM_CHECK_ERR(results != NULL, MEM_ERR_INVALID_ARG, "results is NULL");
     MEM_CHECK_ERR(result_count != NULL, MEM_ERR_INVALID_ARG, "result_count is NULL");
@@ -511,6 +566,7 @@ mem_error_t inverted_index_search_any(const inverted_index_t* index,
         /* For each posting */
         for (size_t p = 0; p < entry->posting_count; p++) {
             node_id_t doc_id = entry->postings[p].doc_id;
+            if (filter && !filter(doc_id, filter_ctx)) continue;
 
             /* Find or add document score entry */
             size_t score_idx = SIZE_MAX;
@@ -572,6 +628,25 @@ mem_error_t inverted_index_search_any(const inverted_index_t* index,
     return MEM_OK;
 }
 
+mem_error_t inverted_index_search_any(const inverted_index_t* index,
+                                      const char** tokens, size_t token_count,
+                                      size_t k, inverted_result_t* results,
+                                      size_t* result_count) {
+    return search_any_internal(index, tokens, token_count, k, NULL, NULL,
+                               results, result_count);
+}
+
+mem_error_t inverted_index_search_any_filtered(const inverted_index_t* index,
+                                               const char** tokens, size_t token_count,
+                                               size_t k, inverted_filter_fn filter,
+                                               void* filter_ctx,
+                                               inverted_result_t* results,
+                                               size_t* result_count) {
+    MEM_CHECK_ERR(filter != NULL, MEM_ERR_INVALID_ARG, "filter is NULL");
+    return search_any_internal(index, tokens, token_count, k, filter, filter_ctx,
+                               results, result_count);
+}
+
 size_t inverted_index_doc_count(const inverted_index_t* index) {
     if (!index) return 0;
 
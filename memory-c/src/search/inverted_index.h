@@ -69,6 +69,13 @@ mem_error_t inverted_index_add(inverted_index_t* index, node_id_t doc_id,
  */
 mem_error_t inverted_index_remove(inverted_index_t* index, node_id_t doc_id);
 
+/*
+ * Remove many documents in one pass over the posting lists. IDs not in
+ * the index are ignored.
+ */
+mem_error_t inverted_index_remove_batch(inverted_index_t* index,
+                                        const node_id_t* doc_ids, size_t count);
+
 /*
  * Search for documents matching all tokens (AND query)
  *
@@ -93,6 +100,21 @@ mem_error_t inverted_index_search_any(const inverted_index_t* index,
                                       size_t k, inverted_result_t* results,
                                       size_t* result_count);
 
+/* Predicate for filtered search: return true to keep doc_id */
+typedef bool (*inverted_filter_fn)(node_id_t doc_id, void* ctx);
+
+/*
+ * Search for documents matching any token (OR query), restricted to
+ * documents accepted by filter. Rejected postings are skipped before
+ * scoring, so k results come from the filtered set.
+ */
+mem_error_t inverted_index_search_any_filtered(const inverted_index_t* index,
+                                               const char** tokens, size_t token_count,
+                                               size_t k, inverted_filter_fn filter,
+                                               void* filter_ctx,
+                                               inverted_result_t* results,
+                                               size_t* result_count);
+
 /*
  * Get number of documents in the index
  */
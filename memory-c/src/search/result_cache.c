@@ -0,0 +1,360 @@
+/*
+ * Memory Service - Query Result Cache Implementation
+ */
+
+#include "result_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#define NO_ENTRY (-1)
+
+typedef struct {
+    uint64_t            hash;
+    char*               text;           /* Normalized query text */
+    size_t              text_len;
+    hierarchy_level_t   min_level;
+    hierarchy_level_t   max_level;
+    size_t              k;
+    search_mode_t       mode;
+    hierarchy_level_t   coarse_level;
+    size_t              coarse_top_n;
+    bool                has_filter;
+    search_filter_t     filter;
+    uint64_t            generations[LEVEL_COUNT];
+    search_match_t*     results;
+    size_t              result_count;
+    int32_t             lru_prev;       /* Towards most recently used */
+    int32_t             lru_next;       /* Towards least recently used */
+    int32_t             hash_next;      /* Bucket chain, or free list link */
+} cache_entry_t;
+
+struct result_cache {
+    cache_entry_t*  entries;
+    size_t          capacity;
+    int32_t*        buckets;
+    size_t          bucket_mask;
+    int32_t         lru_head;
+    int32_t         lru_tail;
+    int32_t         free_head;
+    pthread_mutex_t lock;
+    result_cache_stats_t stats;
+};
+
+/*
+ * Normalization: ASCII lowercase, whitespace runs collapsed to one space,
+ * leading and trailing whitespace dropped. Streamed so lookups never
+ * allocate.
+ */
+typedef struct {
+    const char* p;
+    const char* end;
+    bool        started;
+} norm_cursor_t;
+
+static int norm_next(norm_cursor_t* c) {
+    bool space = false;
+    while (c->p < c->end && isspace((unsigned char)*c->p)) {
+        c->p++;
+        space = true;
+    }
+    if (c->p >= c->end) return -1;
+    if (space && c->started) return ' ';
+
+    c->started = true;
+    return tolower((unsigned char)*c->p++);
+}
+
+static uint64_t fnv1a(uint64_t h, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        h ^= (v >> (i * 8)) & 0xFF;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static uint64_t query_hash(const search_cache_query_t* q) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    norm_cursor_t c = { q->text, q->text + q->text_len, false };
+    int ch;
+    while ((ch = norm_next(&c)) >= 0) {
+        h = fnv1a(h, (uint64_t)ch, 1);
+    }
+    h = fnv1a(h, (uint64_t)q->min_level, 1);
+    h = fnv1a(h, (uint64_t)q->max_level, 1);
+    h = fnv1a(h, (uint64_t)q->mode, 1);
+    h = fnv1a(h, (uint64_t)q->coarse_level, 1);
+    h = fnv1a(h, (uint64_t)q->coarse_top_n, sizeof(uint64_t));
+    if (q->filter) {
+        h = fnv1a(h, (uint64_t)q->filter->agent, sizeof(node_id_t));
+        h = fnv1a(h, (uint64_t)q->filter->session, sizeof(node_id_t));
+        h = fnv1a(h, q->filter->after_time, sizeof(uint64_t));
+        h = fnv1a(h, q->filter->before_time, sizeof(uint64_t));
+    }
+    return fnv1a(h, (uint64_t)q->k, sizeof(uint64_t));
+}
+
+static bool filter_matches(const cache_entry_t* e, const search_filter_t* f) {
+    if (!f) return !e->has_filter;
+    return e->has_filter && e->filter.agent == f->agent &&
+           e->filter.session == f->session &&
+           e->filter.after_time == f->after_time &&
+           e->filter.before_time == f->before_time;
+}
+
+static bool entry_matches(const cache_entry_t* e, uint64_t hash,
+                          const search_cache_query_t* q) {
+    if (e->hash != hash || e->min_level != q->min_level ||
+        e->max_level != q->max_level || e->k != q->k || e->mode != q->mode ||
+        e->coarse_level != q->coarse_level || e->coarse_top_n != q->coarse_top_n ||
+        !filter_matches(e, q->filter)) {
+        return false;
+    }
+
+    norm_cursor_t c = { q->text, q->text + q->text_len, false };
+    size_t i = 0;
+    int ch;
+    while ((ch = norm_next(&c)) >= 0) {
+        if (i >= e->text_len || e->text[i] != (char)ch) return false;
+        i++;
+    }
+    return i == e->text_len;
+}
+
+static bool entry_is_current(const cache_entry_t* e, const uint64_t* generations) {
+    /* Coarse-to-fine results also depend on the coarse level */
+    int top = (int)e->max_level;
+    if (e->mode == SEARCH_MODE_COARSE_TO_FINE &&
+        (int)search_coarse_level(e->coarse_level) > top) {
+        top = (int)search_coarse_level(e->coarse_level);
+    }
+
+    for (int level = e->min_level; level <= top && level < LEVEL_COUNT; level++) {
+        if (e->generations[level] != generations[level]) return false;
+    }
+    return true;
+}
+
+/* ========== LRU / bucket maintenance (lock held) ========== */
+
+static void lru_unlink(result_cache_t* cache, int32_t idx) {
+    cache_entry_t* e = &cache->entries[idx];
+    if (e->lru_prev != NO_ENTRY) cache->entries[e->lru_prev].lru_next = e->lru_next;
+    else cache->lru_head = e->lru_next;
+    if (e->lru_next != NO_ENTRY) cache->entries[e->lru_next].lru_prev = e->lru_prev;
+    else cache->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NO_ENTRY;
+}
+
+static void lru_push_front(result_cache_t* cache, int32_t idx) {
+    cache_entry_t* e = &cache->entries[idx];
+    e->lru_prev = NO_ENTRY;
+    e->lru_next = cache->lru_head;
+    if (cache->lru_head != NO_ENTRY) cache->entries[cache->lru_head].lru_prev = idx;
+    cache->lru_head = idx;
+    if (cache->lru_tail == NO_ENTRY) cache->lru_tail = idx;
+}
+
+static int32_t bucket_find(result_cache_t* cache, uint64_t hash,
+                           const search_cache_query_t* q) {
+    int32_t idx = cache->buckets[hash & cache->bucket_mask];
+    while (idx != NO_ENTRY) {
+        if (entry_matches(&cache->entries[idx], hash, q)) return idx;
+        idx = cache->entries[idx].hash_next;
+    }
+    return NO_ENTRY;
+}
+
+static void bucket_unlink(result_cache_t* cache, int32_t idx) {
+    int32_t* link = &cache->buckets[cache->entries[idx].hash & cache->bucket_mask];
+    while (*link != NO_ENTRY) {
+        if (*link == idx) {
+            *link = cache->entries[idx].hash_next;
+            return;
+        }
+        link = &cache->entries[*link].hash_next;
+    }
+}
+
+/* Unlink entry everywhere, release its buffers and put it on the free list */
+static void entry_release(result_cache_t* cache, int32_t idx) {
+    cache_entry_t* e = &cache->entries[idx];
+    bucket_unlink(cache, idx);
+    lru_unlink(cache, idx);
+    free(e->text);
+    free(e->results);
+    e->text = NULL;
+    e->results = NULL;
+    e->hash_next = cache->free_head;
+    cache->free_head = idx;
+}
+
+/* ========== Public API ========== */
+
+mem_error_t result_cache_create(result_cache_t** cache, size_t capacity) {
+    MEM_CHECK_ERR(cache != NULL, MEM_ERR_INVALID_ARG, "cache is NULL");
+    MEM_CHECK_ERR(capacity > 0 && capacity < INT32_MAX, MEM_ERR_INVALID_ARG,
+                  "invalid cache capacity %zu", capacity);
+
+    result_cache_t* c = calloc(1, sizeof(result_cache_t));
+    MEM_CHECK_ALLOC(c);
+
+    size_t bucket_count = 16;
+    while (bucket_count < capacity * 2) bucket_count <<= 1;
+
+    c->entries = calloc(capacity, sizeof(cache_entry_t));
+    c->buckets = malloc(bucket_count * sizeof(int32_t));
+    if (!c->entries || !c->buckets) {
+        free(c->entries);
+        free(c->buckets);
+        free(c);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate result cache");
+    }
+    if (pthread_mutex_init(&c->lock, NULL) != 0) {
+        free(c->entries);
+        free(c->buckets);
+        free(c);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init result cache mutex");
+    }
+
+    c->capacity = capacity;
+    c->bucket_mask = bucket_count - 1;
+    for (size_t i = 0; i < bucket_count; i++) {
+        c->buckets[i] = NO_ENTRY;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        c->entries[i].lru_prev = c->entries[i].lru_next = NO_ENTRY;
+        c->entries[i].hash_next = (i + 1 < capacity) ? (int32_t)(i + 1) : NO_ENTRY;
+    }
+    c->free_head = 0;
+    c->lru_head = c->lru_tail = NO_ENTRY;
+
+    *cache = c;
+    return MEM_OK;
+}
+
+void result_cache_destroy(result_cache_t* cache) {
+    if (!cache) return;
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        free(cache->entries[i].text);
+        free(cache->entries[i].results);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+bool result_cache_get(result_cache_t* cache, const search_cache_query_t* query,
+                      search_match_t* results, size_t max_results,
+                      size_t* result_count) {
+    if (!cache || !query || !query->text || !results || !result_count) return false;
+
+    uint64_t hash = query_hash(query);
+    bool hit = false;
+
+    pthread_mutex_lock(&cache->lock);
+
+    int32_t idx = bucket_find(cache, hash, query);
+    if (idx != NO_ENTRY && !entry_is_current(&cache->entries[idx], query->generations)) {
+        entry_release(cache, idx);
+        idx = NO_ENTRY;
+    }
+
+    if (idx != NO_ENTRY) {
+        cache_entry_t* e = &cache->entries[idx];
+        size_t n = e->result_count < max_results ? e->result_count : max_results;
+        memcpy(results, e->results, n * sizeof(search_match_t));
+        *result_count = n;
+
+        lru_unlink(cache, idx);
+        lru_push_front(cache, idx);
+        cache->stats.hits++;
+        hit = true;
+    } else {
+        cache->stats.misses++;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    return hit;
+}
+
+mem_error_t result_cache_put(result_cache_t* cache, const search_cache_query_t* query,
+                             const search_match_t* results, size_t result_count) {
+    MEM_CHECK_ERR(cache != NULL, MEM_ERR_INVALID_ARG, "cache is NULL");
+    MEM_CHECK_ERR(query != NULL && query->text != NULL, MEM_ERR_INVALID_ARG, "query is NULL");
+    MEM_CHECK_ERR(results != NULL || result_count == 0, MEM_ERR_INVALID_ARG, "results is NULL");
+
+    /* Build the owned copies before taking the lock */
+    char* text = malloc(query->text_len + 1);
+    search_match_t* copy = malloc((result_count ? result_count : 1) * sizeof(search_match_t));
+    if (!text || !copy) {
+        free(text);
+        free(copy);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate cache entry");
+    }
+
+    norm_cursor_t c = { query->text, query->text + query->text_len, false };
+    size_t text_len = 0;
+    int ch;
+    while ((ch = norm_next(&c)) >= 0) {
+        text[text_len++] = (char)ch;
+    }
+    text[text_len] = '\0';
+    if (result_count > 0) {
+        memcpy(copy, results, result_count * sizeof(search_match_t));
+    }
+
+    uint64_t hash = query_hash(query);
+
+    pthread_mutex_lock(&cache->lock);
+
+    int32_t idx = bucket_find(cache, hash, query);
+    if (idx != NO_ENTRY) {
+        entry_release(cache, idx);
+    }
+    if (cache->free_head == NO_ENTRY) {
+        entry_release(cache, cache->lru_tail);
+        cache->stats.evictions++;
+    }
+
+    idx = cache->free_head;
+    cache_entry_t* e = &cache->entries[idx];
+    cache->free_head = e->hash_next;
+
+    e->hash = hash;
+    e->text = text;
+    e->text_len = text_len;
+    e->min_level = query->min_level;
+    e->max_level = query->max_level;
+    e->k = query->k;
+    e->mode = query->mode;
+    e->coarse_level = query->coarse_level;
+    e->coarse_top_n = query->coarse_top_n;
+    e->has_filter = query->filter != NULL;
+    if (query->filter) e->filter = *query->filter;
+    memcpy(e->generations, query->generations, sizeof(e->generations));
+    e->results = copy;
+    e->result_count = result_count;
+
+    size_t bucket = hash & cache->bucket_mask;
+    e->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = idx;
+    lru_push_front(cache, idx);
+
+    pthread_mutex_unlock(&cache->lock);
+    return MEM_OK;
+}
+
+void result_cache_get_stats(result_cache_t* cache, result_cache_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) return;
+
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
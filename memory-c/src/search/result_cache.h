@@ -0,0 +1,48 @@
+/*
+ * Memory Service - Query Result Cache
+ *
+ * LRU cache of ranked search results keyed by a normalized query
+ * fingerprint (query text, level range, k, search mode and filter). Each
+ * entry remembers the index generation of every level it covers; an
+ * entry is only served while none of those levels has been modified
+ * since it was stored.
+ */
+
+#ifndef MEMORY_SERVICE_RESULT_CACHE_H
+#define MEMORY_SERVICE_RESULT_CACHE_H
+
+#include "search.h"
+
+/* Forward declaration */
+typedef struct result_cache result_cache_t;
+
+/* Cache counters */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;     /* Entries dropped to make room */
+} result_cache_stats_t;
+
+/* Create cache holding up to capacity queries */
+mem_error_t result_cache_create(result_cache_t** cache, size_t capacity);
+
+/* Destroy cache */
+void result_cache_destroy(result_cache_t* cache);
+
+/*
+ * Look up query. On a hit copies at most max_results matches to results
+ * and returns true. Entries whose levels have moved past query->generations
+ * are dropped and reported as misses.
+ */
+bool result_cache_get(result_cache_t* cache, const search_cache_query_t* query,
+                      search_match_t* results, size_t max_results,
+                      size_t* result_count);
+
+/* Store results for query, tagged with query->generations */
+mem_error_t result_cache_put(result_cache_t* cache, const search_cache_query_t* query,
+                             const search_match_t* results, size_t result_count);
+
+/* Get counters */
+void result_cache_get_stats(result_cache_t* cache, result_cache_stats_t* stats);
+
+#endif /* MEMORY_SERVICE_RESULT_CACHE_H */
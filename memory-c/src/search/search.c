@@ -3,113 +3,1618 @@
  *
  * Combines semantic and exact match search with ranking:
  * final_score = 0.6 * relevance + 0.3 * recency + 0.1 * level_boost
+ *
+ * Per-node scoring inputs (created_at, level) come from the hierarchy's
+ * column store, so recency survives restarts and the final scoring pass
+ * runs over contiguous arrays in SIMD batches.
  */
 
 #include "search.h"
+#include "result_cache.h"
 #include "../util/log.h"
 #include "../util/time.h"
+#include "../util/threadpool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* Recency half-life: 1 hour */
+#define RECENCY_HALF_LIFE_NS (3600ULL * 1000000000ULL)
+
+/* Most concurrent chunks one query's segment searches are split into */
+#define MAX_SEARCH_FANOUT 16
+
+/* Buffered vectors (or merging segment slots) the merge thread adds per graph write lock */
+#define MERGE_BATCH 32
+
+/* A time segment of one level's HNSW index */
+typedef struct {
+    timestamp_ns_t start;       /* Holds created_at in [start, end): whole spans */
+    timestamp_ns_t end;
+    timestamp_ns_t min_time;    /* created_at range of nodes added (never shrinks) */
+    timestamp_ns_t max_time;
+    hnsw_index_t* hnsw;
+} index_segment_t;
+
+/*
+ * A level's segments, sorted by start, with disjoint ranges. Unsegmented
+ * levels have one, covering all time
+ */
+typedef struct {
+    index_segment_t* segments;
+    size_t count;
+    size_t capacity;
+} level_index_t;
+
+/*
+ * Segment merge in progress: source's slots are copied into target in
+ * batches, and writes to source are forwarded to target meanwhile. Both
+ * stay searchable, and source keeps its time range, until the copy ends.
+ */
+typedef struct {
+    hierarchy_level_t level;
+    hnsw_index_t* source;       /* NULL = no merge */
+    hnsw_index_t* target;
+    size_t copied;              /* Source slots handled */
+} segment_merge_t;
+
+/* Time index entry */
+typedef struct {
+    timestamp_ns_t time;
+    node_id_t id;
+} time_entry_t;
+
+/*
+ * Fresh-write buffer: ring of recently indexed vectors that are not in
+ * HNSW yet. Queries scan it exactly; the merge thread drains it.
+ */
+typedef struct {
+    node_id_t* ids;             /* NODE_ID_INVALID = removed before merge */
+    hierarchy_level_t* levels;
+    timestamp_ns_t* times;
+    float* vectors;             /* capacity * EMBEDDING_DIM */
+    size_t head;
+    size_t count;
+    size_t capacity;
+} fresh_buffer_t;
+
+/* Indexed nodes sorted by (created_at, node_id) */
+typedef struct {
+    time_entry_t* entries;
+    size_t count;
+    size_t capacity;
+} time_index_t;
+
+/* Search engine structure */
+struct search_engine {
+    search_config_t config;
+    hierarchy_t* hierarchy;
+
+    /* HNSW indices per level, split into time segments */
+    level_index_t levels[LEVEL_COUNT];
+    segment_merge_t merge;
+    _Atomic uint64_t segment_merges;
+
+    /*
+     * Searches hold graph_lock shared; merges, removals and direct adds
+     * hold it exclusive, so a merge moves vectors from the buffer into
+     * the graph atomically with respect to queries. It also guards the
+     * indexed flags and the time index, which searches read.
+     */
+    pthread_rwlock_t graph_lock;
+
+    /* Fresh-write buffer, drained by the merge thread (if running) */
+    fresh_buffer_t fresh;
+    pthread_mutex_t fresh_lock;
+    pthread_cond_t fresh_ready;     /* Entries added, merge pending, or stopping */
+    pthread_cond_t fresh_drained;   /* Buffer emptied, or merges done */
+    bool merge_pending;             /* A level is over segment_limit */
+    pthread_t merger;
+    bool merger_running;
+    bool stopping;
+    _Atomic uint64_t fresh_merged;
+    _Atomic uint64_t fresh_overflows;
+
+    /* Single inverted index */
+    inverted_index_t* inverted;
+
+    /* indexed[node_id] != 0 if the node is searchable */
+    uint8_t* indexed;
+    size_t indexed_size;
+    size_t indexed_count;
+
+    /* Intra-query parallelism (NULL pool = always serial) */
+    thread_pool_t* pool;
+    _Atomic size_t inflight;
+    _Atomic uint64_t parallel_searches;
+    _Atomic uint64_t serial_fallbacks;
+
+    /* Indexed nodes by created_at, for time-range filters */
+    time_index_t times;
+
+    /* Coarse-to-fine and filter planner counters */
+    _Atomic uint64_t coarse_searches;
+    _Atomic uint64_t coarse_scans;
+    _Atomic uint64_t filter_scans;
+    _Atomic uint64_t filter_graph_searches;
+    _Atomic uint64_t segments_pruned;
+
+    /* Query result cache (NULL = disabled), invalidated per level */
+    result_cache_t* cache;
+    _Atomic uint64_t generation[LEVEL_COUNT];
+};
+
+/* ========== Helper Functions ========== */
+
+static inline bool is_indexed(const search_engine_t* engine, node_id_t node_id) {
+    return node_id < engine->indexed_size && engine->indexed[node_id];
+}
+
+static mem_error_t ensure_indexed_capacity(search_engine_t* engine, node_id_t node_id) {
+    if (node_id < engine->indexed_size) return MEM_OK;
+
+    size_t new_size = engine->indexed_size * 2;
+    if (new_size <= node_id) new_size = (size_t)node_id + 1024;
+
+    uint8_t* new_flags = realloc(engine->indexed, new_size);
+    if (!new_flags) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand indexed flags");
+    }
+    memset(new_flags + engine->indexed_size, 0, new_size - engine->indexed_size);
+
+    engine->indexed = new_flags;
+    engine->indexed_size = new_size;
+    return MEM_OK;
+}
+
+/* ========== Time Segments ========== */
+
+/* Statement, block and message indexes are split by created_at */
+static inline bool level_segmented(const search_engine_t* engine, hierarchy_level_t level) {
+    return engine->config.segment_span_ns > 0 && level <= LEVEL_MESSAGE;
+}
+
+static inline timestamp_ns_t segment_start(const search_engine_t* engine,
+                                           hierarchy_level_t level, timestamp_ns_t time) {
+    if (!level_segmented(engine, level)) return 0;
+    return time - time % engine->config.segment_span_ns;
+}
+
+/* Exclusive end of the span-wide segment at start */
+static inline timestamp_ns_t segment_end(const search_engine_t* engine,
+                                         hierarchy_level_t level, timestamp_ns_t start) {
+    uint64_t span = engine->config.segment_span_ns;
+    if (!level_segmented(engine, level) || start > UINT64_MAX - span) return UINT64_MAX;
+    return start + span;
+}
+
+/* Segment boundary at or before cutoff: drop_before frees segments below it */
+static inline timestamp_ns_t drop_boundary(const search_engine_t* engine,
+                                           timestamp_ns_t cutoff) {
+    uint64_t span = engine->config.segment_span_ns;
+    return span ? cutoff - cutoff % span : 0;
+}
+
+/* Retention cutoff at now, or 0 if nothing has expired */
+static inline timestamp_ns_t retention_cutoff(const search_engine_t* engine,
+                                              timestamp_ns_t now) {
+    uint64_t retention = engine->config.retention_ns;
+    return retention && now > retention ? now - retention : 0;
+}
+
+/* Most vectors one segment's HNSW index holds */
+static size_t segment_capacity(void) {
+    hnsw_config_t config = HNSW_CONFIG_DEFAULT;
+    return config.max_elements;
+}
+
+/* Position of the first segment starting at or after start */
+static size_t segment_lower(const level_index_t* li, timestamp_ns_t start) {
+    size_t lo = 0, hi = li->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (li->segments[mid].start < start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Position of the segment using hnsw, or li->count */
+static size_t segment_position(const level_index_t* li, const hnsw_index_t* hnsw) {
+    size_t pos = 0;
+    while (pos < li->count && li->segments[pos].hnsw != hnsw) pos++;
+    return pos;
+}
+
+/* Segment whose time range holds time at level, or NULL */
+static index_segment_t* find_segment(const search_engine_t* engine,
+                                     hierarchy_level_t level, timestamp_ns_t time) {
+    if (level >= LEVEL_COUNT) return NULL;
+    const level_index_t* li = &engine->levels[level];
+    size_t pos = segment_lower(li, time);
+    if (pos < li->count && li->segments[pos].start == time) {
+        return &li->segments[pos];
+    }
+    if (pos == 0) return NULL;
+
+    /* Otherwise only the last segment starting before time can hold it */
+    index_segment_t* segment = &li->segments[pos - 1];
+    return time < segment->end || segment->end == UINT64_MAX ? segment : NULL;
+}
+
+/* Insert an empty segment covering [start, end), which no segment overlaps */
+static mem_error_t segment_create(level_index_t* li, timestamp_ns_t start,
+                                  timestamp_ns_t end, index_segment_t** segment) {
+    if (li->count >= li->capacity) {
+        size_t new_capacity = li->capacity ? li->capacity * 2 : 8;
+        index_segment_t* segments = realloc(li->segments,
+                                            new_capacity * sizeof(index_segment_t));
+        if (!segments) {
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand segment list");
+        }
+        li->segments = segments;
+        li->capacity = new_capacity;
+    }
+
+    hnsw_config_t hnsw_config = HNSW_CONFIG_DEFAULT;
+    hnsw_index_t* hnsw = NULL;
+    MEM_CHECK(hnsw_create(&hnsw, &hnsw_config));
+
+    size_t pos = segment_lower(li, start);
+    memmove(&li->segments[pos + 1], &li->segments[pos],
+            (li->count - pos) * sizeof(index_segment_t));
+    li->segments[pos] = (index_segment_t){
+        .start = start,
+        .end = end,
+        .min_time = UINT64_MAX,
+        .max_time = 0,
+        .hnsw = hnsw
+    };
+    li->count++;
+    if (segment) *segment = &li->segments[pos];
+    return MEM_OK;
+}
+
+/* Segment for a node of level created at time, created span-wide if missing */
+static mem_error_t get_segment(search_engine_t* engine, hierarchy_level_t level,
+                               timestamp_ns_t time, index_segment_t** segment,
+                               bool* created) {
+    *segment = find_segment(engine, level, time);
+    *created = *segment == NULL;
+    if (*segment) return MEM_OK;
+
+    timestamp_ns_t start = segment_start(engine, level, time);
+    return segment_create(&engine->levels[level], start,
+                          segment_end(engine, level, start), segment);
+}
+
+/*
+ * Adjacent pair (i, i + 1) with the fewest combined vectors that still
+ * fits one index, or SIZE_MAX. The newest entry takes most writes, so
+ * pairs with it are a last resort.
+ */
+static size_t merge_candidate(const size_t* sizes, size_t count) {
+    if (count < 2) return SIZE_MAX;
+
+    size_t capacity = segment_capacity();
+    size_t best = SIZE_MAX, best_size = SIZE_MAX;
+    for (size_t pairs = count - 2; pairs < count && best == SIZE_MAX; pairs++) {
+        for (size_t i = 0; i < pairs; i++) {
+            size_t size = sizes[i] + sizes[i + 1];
+            if (size <= capacity && size < best_size) {
+                best = i;
+                best_size = size;
+            }
+        }
+    }
+    return best;
+}
+
+/* Stop the merge, taking the source's copies back out of the target */
+static void merge_abandon(search_engine_t* engine) {
+    segment_merge_t* merge = &engine->merge;
+    size_t slots = hnsw_slot_count(merge->source);
+    for (size_t i = 0; i < slots; i++) {
+        node_id_t id;
+        if (hnsw_slot(merge->source, i, &id, NULL)) hnsw_remove(merge->target, id);
+    }
+    memset(merge, 0, sizeof(*merge));
+}
+
+/* Copy a source vector into the merge target; a full target ends the merge */
+static void merge_copy(search_engine_t* engine, node_id_t id, const float* vector) {
+    mem_error_t err = hnsw_add(engine->merge.target, id, vector);
+    if (err != MEM_OK && err != MEM_ERR_EXISTS) {
+        LOG_WARN("Abandoning segment merge: %s", mem_error_str(err));
+        merge_abandon(engine);
+    }
+}
+
+/*
+ * Start merging two adjacent segments of a level over segment_limit;
+ * the smaller is copied into the larger. True while a merge is in
+ * progress. Caller holds graph_lock exclusive.
+ */
+static bool merge_start(search_engine_t* engine) {
+    size_t limit = engine->config.segment_limit;
+    if (engine->merge.source) return true;
+    if (limit == 0) return false;
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        level_index_t* li = &engine->levels[level];
+        if (!level_segmented(engine, (hierarchy_level_t)level) || li->count <= limit) continue;
+
+        size_t* sizes = malloc(li->count * sizeof(size_t));
+        if (!sizes) return false;
+        for (size_t i = 0; i < li->count; i++) {
+            sizes[i] = hnsw_slot_count(li->segments[i].hnsw);
+        }
+        size_t pair = merge_candidate(sizes, li->count);
+        bool left_smaller = pair != SIZE_MAX && sizes[pair] <= sizes[pair + 1];
+        free(sizes);
+        if (pair == SIZE_MAX) continue;
+
+        size_t source = left_smaller ? pair : pair + 1;
+        size_t target = left_smaller ? pair + 1 : pair;
+        engine->merge = (segment_merge_t){
+            .level = (hierarchy_level_t)level,
+            .source = li->segments[source].hnsw,
+            .target = li->segments[target].hnsw,
+            .copied = 0
+        };
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Copy up to budget source slots into the merge target. Once every slot
+ * is copied the target takes over the source's time range and the
+ * source is freed. Caller holds graph_lock exclusive.
+ */
+static void merge_step(search_engine_t* engine, size_t budget) {
+    segment_merge_t* merge = &engine->merge;
+    for (; merge->source && budget > 0 && merge->copied < hnsw_slot_count(merge->source);
+         budget--) {
+        node_id_t id;
+        const float* vector;
+        if (hnsw_slot(merge->source, merge->copied++, &id, &vector)) {
+            merge_copy(engine, id, vector);
+        }
+    }
+    if (!merge->source || merge->copied < hnsw_slot_count(merge->source)) return;
+
+    level_index_t* li = &engine->levels[merge->level];
+    size_t pos = segment_position(li, merge->source);
+    index_segment_t* source = &li->segments[pos];
+    index_segment_t* target = &li->segments[segment_position(li, merge->target)];
+    if (source->start < target->start) target->start = source->start;
+    if (source->end > target->end) target->end = source->end;
+    if (source->min_time < target->min_time) target->min_time = source->min_time;
+    if (source->max_time > target->max_time) target->max_time = source->max_time;
+
+    hnsw_destroy(source->hnsw);
+    memmove(&li->segments[pos], &li->segments[pos + 1],
+            (li->count - pos - 1) * sizeof(index_segment_t));
+    li->count--;
+    memset(merge, 0, sizeof(*merge));
+    atomic_fetch_add(&engine->segment_merges, 1);
+}
+
+/*
+ * A level gained a segment: merge it back down to segment_limit, on the
+ * merge thread if one is running. Caller holds graph_lock exclusive.
+ */
+static void segments_grew(search_engine_t* engine, hierarchy_level_t level) {
+    size_t limit = engine->config.segment_limit;
+    if (limit == 0 || engine->levels[level].count <= limit) return;
+
+    if (engine->merger_running) {
+        pthread_mutex_lock(&engine->fresh_lock);
+        engine->merge_pending = true;
+        pthread_cond_signal(&engine->fresh_ready);
+        pthread_mutex_unlock(&engine->fresh_lock);
+        return;
+    }
+    while (merge_start(engine)) merge_step(engine, SIZE_MAX);
+}
+
+/* Add a node's vector to the segment for its created_at */
+static mem_error_t segment_add(search_engine_t* engine, hierarchy_level_t level,
+                               timestamp_ns_t time, node_id_t node_id,
+                               const float* embedding) {
+    index_segment_t* segment = NULL;
+    bool created = false;
+    MEM_CHECK(get_segment(engine, level, time, &segment, &created));
+    mem_error_t err = hnsw_add(segment->hnsw, node_id, embedding);
+
+    if (err == MEM_OK) {
+        if (time < segment->min_time) segment->min_time = time;
+        if (time > segment->max_time) segment->max_time = time;
+
+        /* A segment being merged away forwards its writes to the target */
+        if (segment->hnsw == engine->merge.source) merge_copy(engine, node_id, embedding);
+    }
+    if (created) segments_grew(engine, level);
+    return err;
+}
+
+/* Remove a node's vector from its segment (and from a merge target's copy) */
+static void segment_remove(search_engine_t* engine, index_segment_t* segment,
+                           node_id_t node_id) {
+    hnsw_remove(segment->hnsw, node_id);
+    if (segment->hnsw == engine->merge.source) hnsw_remove(engine->merge.target, node_id);
+}
+
+/* Stored vector of an indexed node, or NULL */
+static const float* segment_vector(const search_engine_t* engine, node_id_t node_id) {
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    const index_segment_t* segment = find_segment(engine, columns_get_level(columns, node_id),
+                                                  columns_get_created_at(columns, node_id));
+    return segment ? hnsw_get_vector(segment->hnsw, node_id) : NULL;
+}
+
+/* True if the segment may hold nodes passing the filter's time bounds */
+static inline bool segment_overlaps(const index_segment_t* segment,
+                                    const search_filter_t* filter) {
+    if (!filter) return true;
+    if (filter->after_time && segment->max_time < filter->after_time) return false;
+    if (filter->before_time && segment->min_time >= filter->before_time) return false;
+    return true;
+}
+
+static void level_index_free(level_index_t* li) {
+    for (size_t i = 0; i < li->count; i++) {
+        hnsw_destroy(li->segments[i].hnsw);
+    }
+    free(li->segments);
+    memset(li, 0, sizeof(*li));
+}
+
+/* ========== Fresh-Write Buffer ========== */
+
+static inline size_t fresh_slot(const fresh_buffer_t* fb, size_t i) {
+    return (fb->head + i) % fb->capacity;
+}
+
+static void fresh_free(fresh_buffer_t* fb) {
+    free(fb->ids);
+    free(fb->levels);
+    free(fb->times);
+    free(fb->vectors);
+    memset(fb, 0, sizeof(*fb));
+}
+
+static mem_error_t fresh_init(fresh_buffer_t* fb, size_t capacity) {
+    memset(fb, 0, sizeof(*fb));
+    fb->ids = malloc(capacity * sizeof(node_id_t));
+    fb->levels = malloc(capacity * sizeof(hierarchy_level_t));
+    fb->times = malloc(capacity * sizeof(timestamp_ns_t));
+    fb->vectors = malloc(capacity * EMBEDDING_DIM * sizeof(float));
+    if (!fb->ids || !fb->levels || !fb->times || !fb->vectors) {
+        fresh_free(fb);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate fresh buffer");
+    }
+    fb->capacity = capacity;
+    return MEM_OK;
+}
+
+/* Append a vector; false if the buffer is full. Caller holds fresh_lock */
+static bool fresh_push(fresh_buffer_t* fb, node_id_t id, hierarchy_level_t level,
+                       timestamp_ns_t time, const float* vector) {
+    if (fb->count >= fb->capacity) return false;
+
+    size_t slot = fresh_slot(fb, fb->count);
+    fb->ids[slot] = id;
+    fb->levels[slot] = level;
+    fb->times[slot] = time;
+    memcpy(fb->vectors + slot * EMBEDDING_DIM, vector, EMBEDDING_DIM * sizeof(float));
+    fb->count++;
+    return true;
+}
+
+/* Slot of the newest buffered entry for id, or SIZE_MAX. Caller holds fresh_lock */
+static size_t fresh_find(const fresh_buffer_t* fb, node_id_t id) {
+    for (size_t i = fb->count; i > 0; i--) {
+        size_t slot = fresh_slot(fb, i - 1);
+        if (fb->ids[slot] == id) return slot;
+    }
+    return SIZE_MAX;
+}
+
+/*
+ * Move up to MERGE_BATCH buffered vectors into their segments. Appends
+ * only write past count and every other writer holds graph_lock, so the
+ * batch is stable while we hold it exclusive.
+ */
+static void merge_batch(search_engine_t* engine) {
+    fresh_buffer_t* fb = &engine->fresh;
+
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    pthread_mutex_lock(&engine->fresh_lock);
+    size_t n = fb->count < MERGE_BATCH ? fb->count : MERGE_BATCH;
+    pthread_mutex_unlock(&engine->fresh_lock);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = fresh_slot(fb, i);
+        if (fb->ids[slot] == NODE_ID_INVALID) continue;
+
+        mem_error_t err = segment_add(engine, fb->levels[slot], fb->times[slot],
+                                      fb->ids[slot], fb->vectors + slot * EMBEDDING_DIM);
+        if (err != MEM_OK && err != MEM_ERR_EXISTS) {
+            LOG_WARN("Failed to merge node %u into HNSW: %s", fb->ids[slot],
+                     mem_error_str(err));
+        }
+    }
+
+    pthread_mutex_lock(&engine->fresh_lock);
+    fb->head = fresh_slot(fb, n);
+    fb->count -= n;
+    if (fb->count == 0) pthread_cond_broadcast(&engine->fresh_drained);
+    pthread_mutex_unlock(&engine->fresh_lock);
+    pthread_rwlock_unlock(&engine->graph_lock);
+
+    atomic_fetch_add(&engine->fresh_merged, n);
+}
+
+/*
+ * Copy up to MERGE_BATCH slots of the segment merge in progress, starting
+ * one if a level is over its limit. Clears merge_pending when none is.
+ */
+static void merge_segments(search_engine_t* engine) {
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    if (merge_start(engine)) {
+        merge_step(engine, MERGE_BATCH);
+    } else {
+        pthread_mutex_lock(&engine->fresh_lock);
+        engine->merge_pending = false;
+        pthread_cond_broadcast(&engine->fresh_drained);
+        pthread_mutex_unlock(&engine->fresh_lock);
+    }
+    pthread_rwlock_unlock(&engine->graph_lock);
+}
+
+/*
+ * Merge thread: drain the buffer, then merge segments, until stopped;
+ * then drain what is left of the buffer
+ */
+static void* merge_main(void* arg) {
+    search_engine_t* engine = arg;
+
+    pthread_mutex_lock(&engine->fresh_lock);
+    for (;;) {
+        while (engine->fresh.count == 0 && !engine->merge_pending && !engine->stopping) {
+            pthread_cond_wait(&engine->fresh_ready, &engine->fresh_lock);
+        }
+        if (engine->fresh.count == 0 && engine->stopping) break;
+
+        bool drain = engine->fresh.count > 0;
+        pthread_mutex_unlock(&engine->fresh_lock);
+        if (drain) {
+            merge_batch(engine);
+        } else {
+            merge_segments(engine);
+        }
+        pthread_mutex_lock(&engine->fresh_lock);
+    }
+    pthread_mutex_unlock(&engine->fresh_lock);
+    return NULL;
+}
+
+/* Level boost: higher levels get slight boost */
+static float level_boost(hierarchy_level_t level) {
+    switch (level) {
+        case LEVEL_SESSION:   return 1.0f;
+        case LEVEL_MESSAGE:   return 0.9f;
+        case LEVEL_BLOCK:     return 0.8f;
+        case LEVEL_STATEMENT: return 0.7f;
+        default:              return 0.5f;
+    }
+}
+
+/*
+ * Recency exponent: -age / half_life, so recency = 2^exponent.
+ * Timestamps at or after now decay by nothing.
+ */
+static inline float recency_exponent(timestamp_ns_t timestamp, timestamp_ns_t now) {
+    if (timestamp >= now) return 0.0f;
+    double half_lives = (double)(now - timestamp) / (double)RECENCY_HALF_LIFE_NS;
+    return half_lives > 126.0 ? -126.0f : (float)-half_lives;
+}
+
+/* Convert distance to similarity score */
+static float distance_to_score(float distance) {
+    return 1.0f - distance;
+}
+
+/* Inner product of two n-float vectors (cosine for normalized input) */
+static float dot_product(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float dot = 0.0f;
+
+#if defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t end = n & ~(size_t)7; i < end; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                               _mm256_loadu_ps(b + i)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    for (int j = 0; j < 8; j++) {
+        dot += lanes[j];
+    }
+#endif
+
+    for (; i < n; i++) {
+        dot += a[i] * b[i];
+    }
+    return dot;
+}
+
+/*
+ * Candidate set: structure-of-arrays candidate scores plus an
+ * open-addressed table mapping node_id -> row, so merging a hit is
+ * O(1) expected and the scoring pass streams over flat float arrays.
+ */
+typedef struct {
+    node_id_t* ids;
+    float* semantic;
+    float* exact;
+    float* decay;             /* Recency exponent (see recency_exponent) */
+    float* boost;             /* Level boost */
+    float* score;
+    size_t count;
+    size_t capacity;
+    uint32_t* slots;          /* Row index, or UINT32_MAX if empty */
+    size_t mask;              /* Table size - 1 (power of two) */
+} candidate_set_t;
+
+static void candidate_set_free(candidate_set_t* set) {
+    free(set->ids);
+    free(set->semantic);
+    free(set->exact);
+    free(set->decay);
+    free(set->boost);
+    free(set->score);
+    free(set->slots);
+}
+
+static mem_error_t candidate_set_init(candidate_set_t* set, size_t capacity) {
+    memset(set, 0, sizeof(*set));
+
+    /* Keep load factor at or below 0.5 */
+    size_t table_size = 16;
+    while (table_size < capacity * 2) {
+        table_size <<= 1;
+    }
+
+    set->ids = malloc(capacity * sizeof(node_id_t));
+    set->semantic = malloc(capacity * sizeof(float));
+    set->exact = malloc(capacity * sizeof(float));
+    set->decay = malloc(capacity * sizeof(float));
+    set->boost = malloc(capacity * sizeof(float));
+    set->score = malloc(capacity * sizeof(float));
+    set->slots = malloc(table_size * sizeof(uint32_t));
+    if (!set->ids || !set->semantic || !set->exact || !set->decay ||
+        !set->boost || !set->score || !set->slots) {
+        candidate_set_free(set);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate candidates");
+    }
+    memset(set->slots, 0xFF, table_size * sizeof(uint32_t));
+
+    set->capacity = capacity;
+    set->mask = table_size - 1;
+    return MEM_OK;
+}
+
+static inline size_t candidate_hash(node_id_t id, size_t mask) {
+    /* Fibonacci hashing spreads sequential node IDs across the table */
+    return (size_t)(((uint64_t)id * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/* Add a hit, or merge it into the existing row (keeping max scores) */
+static void candidate_set_add(candidate_set_t* set, node_id_t id,
+                              float semantic, float exact) {
+    size_t pos = candidate_hash(id, set->mask);
+
+    for (;;) {
+        uint32_t row = set->slots[pos];
+        if (row == UINT32_MAX) {
+            if (set->count >= set->capacity) return;
+            row = (uint32_t)set->count++;
+            set->slots[pos] = row;
+            set->ids[row] = id;
+            set->semantic[row] = semantic;
+            set->exact[row] = exact;
+            return;
+        }
+
+        if (set->ids[row] == id) {
+            if (semantic > set->semantic[row]) set->semantic[row] = semantic;
+            if (exact > set->exact[row]) set->exact[row] = exact;
+            return;
+        }
+
+        pos = (pos + 1) & set->mask;
+    }
+}
+
+/* ========== Scoring ========== */
+
+typedef struct {
+    float relevance_semantic;   /* relevance_weight * semantic_weight */
+    float relevance_exact;      /* relevance_weight * exact_weight / max_exact */
+    float recency;
+    float level;
+} score_weights_t;
+
+#if defined(__AVX2__)
+/* 2^x for x in [-126, 0], degree-5 polynomial on the fractional part */
+static inline __m256 exp2_ps(__m256 x) {
+    __m256 xi = _mm256_floor_ps(x);
+    __m256 f = _mm256_sub_ps(x, xi);
+
+    __m256 p = _mm256_set1_ps(1.3333558e-3f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(9.6181291e-3f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(5.5504109e-2f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(2.4022651e-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(6.9314718e-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+
+    __m256i e = _mm256_add_epi32(_mm256_cvttps_epi32(xi), _mm256_set1_epi32(127));
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+}
+#endif
+
+/* score = w_s*semantic + w_e*exact + w_r*2^decay + w_l*boost */
+static void score_batch(const score_weights_t* w, const float* semantic,
+                        const float* exact, const float* decay,
+                        const float* boost, float* score, size_t n) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256 ws = _mm256_set1_ps(w->relevance_semantic);
+    __m256 we = _mm256_set1_ps(w->relevance_exact);
+    __m256 wr = _mm256_set1_ps(w->recency);
+    __m256 wl = _mm256_set1_ps(w->level);
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 acc = _mm256_mul_ps(ws, _mm256_loadu_ps(semantic + i));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(we, _mm256_loadu_ps(exact + i)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(wr, exp2_ps(_mm256_loadu_ps(decay + i))));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(wl, _mm256_loadu_ps(boost + i)));
+        _mm256_storeu_ps(score + i, acc);
+    }
+#endif
+
+    for (; i < n; i++) {
+        score[i] = w->relevance_semantic * semantic[i] +
+                   w->relevance_exact * exact[i] +
+                   w->recency * exp2f(decay[i]) +
+                   w->level * boost[i];
+    }
+}
+
+/* Gather column inputs for every candidate, then score in batches */
+static void score_candidates(const search_config_t* config,
+                             const columns_store_t* columns,
+                             candidate_set_t* set, timestamp_ns_t now) {
+    const timestamp_ns_t* created_at = columns_created_at(columns);
+    const uint8_t* levels = columns_level(columns);
+
+    float max_exact = 0.0f;
+    for (size_t i = 0; i < set->count; i++) {
+        node_id_t id = set->ids[i];
+        set->decay[i] = recency_exponent(created_at[id], now);
+        set->boost[i] = level_boost((hierarchy_level_t)levels[id]);
+        if (set->exact[i] > max_exact) max_exact = set->exact[i];
+    }
+
+    /* Exact scores are normalized to [0, 1] across the candidate set */
+    if (max_exact > 0) {
+        float inv = 1.0f / max_exact;
+        for (size_t i = 0; i < set->count; i++) {
+            set->exact[i] *= inv;
+        }
+    }
+
+    score_weights_t w = {
+        .relevance_semantic = config->relevance_weight * config->semantic_weight,
+        .relevance_exact = config->relevance_weight * config->exact_weight,
+        .recency = config->recency_weight,
+        .level = config->level_weight
+    };
+    score_batch(&w, set->semantic, set->exact, set->decay, set->boost,
+                set->score, set->count);
+}
+
+/* ========== Top-k Selection ========== */
+
+/* Ranking order: higher score first, ties broken by lower node_id */
+static inline bool row_ranks_before(const candidate_set_t* set, uint32_t a, uint32_t b) {
+    if (set->score[a] != set->score[b]) return set->score[a] > set->score[b];
+    return set->ids[a] < set->ids[b];
+}
+
+static int compare_results(const void* a, const void* b) {
+    const search_match_t* ra = a;
+    const search_match_t* rb = b;
+    if (ra->score != rb->score) return ra->score > rb->score ? -1 : 1;
+    if (ra->node_id != rb->node_id) return ra->node_id < rb->node_id ? -1 : 1;
+    return 0;
+}
+
+/* Restore min-heap property (worst-ranked row at the root) */
+static void heap_sift_down(const candidate_set_t* set, uint32_t* heap,
+                           size_t count, size_t i) {
+    for (;;) {
+        size_t worst = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+
+        if (left < count && row_ranks_before(set, heap[worst], heap[left])) worst = left;
+        if (right < count && row_ranks_before(set, heap[worst], heap[right])) worst = right;
+        if (worst == i) return;
+
+        uint32_t tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+/*
+ * Select the k best candidates into out[] in ranked order.
+ * Uses a bounded min-heap of row indices (O(n log k)), then sorts
+ * only the k survivors.
+ */
+static mem_error_t select_top_k(const candidate_set_t* set,
+                                const columns_store_t* columns,
+                                size_t k, search_match_t* out,
+                                size_t* out_count) {
+    *out_count = 0;
+    if (k > set->count) k = set->count;
+    if (k == 0) return MEM_OK;
+
+    uint32_t* heap = malloc(k * sizeof(uint32_t));
+    if (!heap) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate top-k heap");
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        heap[i] = (uint32_t)i;
+    }
+    for (size_t i = k / 2; i-- > 0;) {
+        heap_sift_down(set, heap, k, i);
+    }
+    for (size_t i = k; i < set->count; i++) {
+        if (row_ranks_before(set, (uint32_t)i, heap[0])) {
+            heap[0] = (uint32_t)i;
+            heap_sift_down(set, heap, k, 0);
+        }
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        uint32_t row = heap[i];
+        node_id_t id = set->ids[row];
+        out[i] = (search_match_t){
+            .node_id = id,
+            .level = columns_get_level(columns, id),
+            .score = set->score[row],
+            .semantic_score = set->semantic[row],
+            .exact_score = set->exact[row],
+            .timestamp = columns_get_created_at(columns, id)
+        };
+    }
+    free(heap);
+
+    qsort(out, k, sizeof(search_match_t), compare_results);
+    *out_count = k;
+    return MEM_OK;
+}
+
+/* ========== Level Fan-out ========== */
+
+/*
+ * Restrictions pushed into the search legs: the query filter and, in
+ * coarse-to-fine mode, the coarse roots that nodes below the coarse
+ * level must descend from.
+ */
+typedef struct {
+    const search_engine_t* engine;
+    const search_filter_t* filter;  /* NULL = unfiltered */
+    hierarchy_level_t min_level;    /* Requested level range */
+    hierarchy_level_t max_level;
+    hierarchy_level_t coarse_level;
+    node_id_t* roots;               /* Top coarse hits */
+    size_t root_count;              /* 0 = no coarse restriction */
+    size_t root_capacity;
+} search_scope_t;
+
+static inline bool scope_restricts(const search_scope_t* scope) {
+    return scope->filter != NULL || scope->root_count > 0;
+}
+
+static bool scope_accepts(node_id_t id, void* ctx);
+
+static int compare_hits(const void* a, const void* b) {
+    const hnsw_result_t* ha = a;
+    const hnsw_result_t* hb = b;
+    if (ha->distance != hb->distance) return ha->distance < hb->distance ? -1 : 1;
+    if (ha->id != hb->id) return ha->id < hb->id ? -1 : 1;
+    return 0;
+}
+
+/* One per-segment HNSW search */
+typedef struct {
+    const hnsw_index_t* index;
+    const float* query;
+    size_t k;
+    hnsw_filter_fn filter;      /* NULL = unfiltered */
+    void* filter_ctx;
+    size_t ef;                  /* Filtered searches only */
+    hnsw_result_t* results;
+    size_t count;
+    mem_error_t err;
+} level_search_t;
+
+/* A worker's share of segment searches: tasks[first], tasks[first + stride], ... */
+typedef struct {
+    level_search_t* tasks;
+    size_t first;
+    size_t stride;
+    size_t count;
+} level_chunk_t;
+
+static void run_level_chunk(void* arg) {
+    level_chunk_t* chunk = arg;
+    for (size_t i = chunk->first; i < chunk->count; i += chunk->stride) {
+        level_search_t* t = &chunk->tasks[i];
+        if (t->filter) {
+            t->err = hnsw_search_filtered(t->index, t->query, t->k, t->ef,
+                                          t->filter, t->filter_ctx,
+                                          t->results, &t->count);
+        } else {
+            t->err = hnsw_search(t->index, t->query, t->k, t->results, &t->count);
+        }
+    }
+}
+
+/*
+ * Decide whether this query may fan out. Each parallel query borrows up
+ * to (fanout - 1) workers; once concurrent queries would oversubscribe
+ * the pool, queries run serially so throughput is not lost to queueing.
+ */
+static size_t effective_fanout(search_engine_t* engine, size_t task_count,
+                               size_t inflight) {
+    size_t fanout = engine->config.parallel_fanout;
+    size_t workers = thread_pool_size(engine->pool);
+    if (!engine->pool || fanout <= 1 || task_count <= 1) return 1;
+    if (fanout > task_count) fanout = task_count;
+    if (fanout > workers + 1) fanout = workers + 1;
+    if (fanout > MAX_SEARCH_FANOUT) fanout = MAX_SEARCH_FANOUT;
+
+    if (inflight * (fanout - 1) > workers) {
+        atomic_fetch_add(&engine->serial_fallbacks, 1);
+        return 1;
+    }
+    return fanout;
+}
+
+/* Run all segment searches, fanning out over the pool when allowed */
+static void run_level_searches(search_engine_t* engine, level_search_t* tasks,
+                               size_t task_count, size_t inflight) {
+    size_t fanout = effective_fanout(engine, task_count, inflight);
+    task_group_t group;
+
+    if (fanout > 1 && task_group_init(&group) != MEM_OK) {
+        fanout = 1;
+    }
+
+    if (fanout <= 1) {
+        level_chunk_t all = { tasks, 0, 1, task_count };
+        run_level_chunk(&all);
+        return;
+    }
+
+    level_chunk_t chunks[MAX_SEARCH_FANOUT];
+    for (size_t c = 0; c < fanout; c++) {
+        chunks[c] = (level_chunk_t){ tasks, c, fanout, task_count };
+    }
+
+    /* Chunk 0 always runs on the calling thread; a full queue runs inline too */
+    for (size_t c = 1; c < fanout; c++) {
+        if (thread_pool_try_submit(engine->pool, &group, run_level_chunk,
+                                   &chunks[c]) != MEM_OK) {
+            run_level_chunk(&chunks[c]);
+        }
+    }
+    run_level_chunk(&chunks[0]);
+
+    task_group_wait(&group);
+    task_group_destroy(&group);
+    atomic_fetch_add(&engine->parallel_searches, 1);
+}
+
+/* A buffered vector's hit, tagged with its level */
+typedef struct {
+    hnsw_result_t hit;
+    hierarchy_level_t level;
+} fresh_hit_t;
+
+static int compare_fresh_hits(const void* a, const void* b) {
+    return compare_hits(&((const fresh_hit_t*)a)->hit, &((const fresh_hit_t*)b)->hit);
+}
+
+/*
+ * Exact scan of buffered vectors at levels [lo, hi] accepted by the
+ * scope. Level lo + l gets its best max_candidates hits, best first, at
+ * hits + l * max_candidates, with the count in counts[l].
+ */
+static mem_error_t fresh_scan(search_engine_t* engine, const float* query,
+                              hierarchy_level_t lo, hierarchy_level_t hi,
+                              search_scope_t* scope, hnsw_result_t* hits,
+                              size_t* counts) {
+    size_t max_candidates = engine->config.max_candidates;
+    memset(counts, 0, ((size_t)(hi - lo) + 1) * sizeof(size_t));
+    if (!engine->merger_running) return MEM_OK;
+
+    bool filtered = scope_restricts(scope);
+    const fresh_buffer_t* fb = &engine->fresh;
+
+    pthread_mutex_lock(&engine->fresh_lock);
+    fresh_hit_t* all = fb->count ? malloc(fb->count * sizeof(fresh_hit_t)) : NULL;
+    if (fb->count && !all) {
+        pthread_mutex_unlock(&engine->fresh_lock);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate fresh scan results");
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < fb->count; i++) {
+        size_t slot = fresh_slot(fb, i);
+        node_id_t id = fb->ids[slot];
+        hierarchy_level_t level = fb->levels[slot];
+        if (id == NODE_ID_INVALID || level < lo || level > hi) continue;
+        if (filtered && !scope_accepts(id, scope)) continue;
+
+        const float* vector = fb->vectors + slot * EMBEDDING_DIM;
+        all[n].hit.id = id;
+        all[n].hit.distance = 1.0f - dot_product(query, vector, EMBEDDING_DIM);
+        all[n].level = level;
+        n++;
+    }
+    pthread_mutex_unlock(&engine->fresh_lock);
+
+    if (n > 1) qsort(all, n, sizeof(fresh_hit_t), compare_fresh_hits);
+    for (size_t i = 0; i < n; i++) {
+        size_t l = (size_t)(all[i].level - lo);
+        if (counts[l] < max_candidates) {
+            hits[l * max_candidates + counts[l]++] = all[i].hit;
+        }
+    }
+
+    free(all);
+    return MEM_OK;
+}
+
+/*
+ * Semantic search of levels [lo, hi] into set, at most max_candidates
+ * hits in total. Each level searches every segment overlapping the
+ * filter's time bounds, plus the fresh buffer, and keeps the best
+ * max_candidates of their union. Hits above keep_max are searched but
+ * not kept. When the scope restricts, each segment runs a filtered HNSW
+ * search; with collect_roots, the first hits at the coarse level become
+ * its roots. Caller holds graph_lock shared.
+ */
+static mem_error_t semantic_levels(search_engine_t* engine, const float* query,
+                                   hierarchy_level_t lo, hierarchy_level_t hi,
+                                   hierarchy_level_t keep_max, size_t inflight,
+                                   search_scope_t* scope, bool collect_roots,
+                                   candidate_set_t* set) {
+    size_t max_candidates = engine->config.max_candidates;
+    size_t level_count = (size_t)(hi - lo) + 1;
+    if (level_count > LEVEL_COUNT) level_count = LEVEL_COUNT;
+
+    size_t segment_count = 0, max_sources = 0;
+    for (size_t l = 0; l < level_count; l++) {
+        size_t count = engine->levels[lo + l].count;
+        segment_count += count;
+        if (count > max_sources) max_sources = count;
+    }
+    max_sources++;  /* The fresh buffer */
+
+    /* Per segment results, the fresh buffer's per level, and a merge area */
+    level_search_t* tasks = malloc((segment_count ? segment_count : 1) * sizeof(level_search_t));
+    hnsw_result_t* hnsw_results = malloc((segment_count + level_count + max_sources) *
+                                         max_candidates * sizeof(hnsw_result_t));
+    if (!tasks || !hnsw_results) {
+        free(tasks);
+        free(hnsw_results);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate hnsw results");
+    }
+    hnsw_result_t* fresh_hits = hnsw_results + segment_count * max_candidates;
+    hnsw_result_t* hits = fresh_hits + level_count * max_candidates;
+    size_t fresh_counts[LEVEL_COUNT];
+
+    /* Tasks are grouped by level: level l owns tasks [first[l], first[l + 1]) */
+    bool filtered = scope_restricts(scope);
+    size_t first[LEVEL_COUNT + 1];
+    size_t task_count = 0;
+    uint64_t pruned = 0;
+    for (size_t l = 0; l < level_count; l++) {
+        const level_index_t* li = &engine->levels[lo + l];
+        first[l] = task_count;
+        for (size_t i = 0; i < li->count; i++) {
+            if (!segment_overlaps(&li->segments[i], scope->filter)) {
+                pruned++;
+                continue;
+            }
+            tasks[task_count] = (level_search_t){
+                .index = li->segments[i].hnsw,
+                .query = query,
+                .k = max_candidates,
+                .filter = filtered ? scope_accepts : NULL,
+                .filter_ctx = scope,
+                .ef = max_candidates,
+                .results = hnsw_results + task_count * max_candidates,
+                .count = 0,
+                .err = MEM_OK
+            };
+            task_count++;
+        }
+    }
+    first[level_count] = task_count;
+    if (pruned) atomic_fetch_add(&engine->segments_pruned, pruned);
+
+    run_level_searches(engine, tasks, task_count, inflight);
+
+    mem_error_t err = fresh_scan(engine, query, lo, (hierarchy_level_t)(lo + level_count - 1),
+                                 scope, fresh_hits, fresh_counts);
+    if (err != MEM_OK) {
+        free(tasks);
+        free(hnsw_results);
+        return err;
+    }
+
+    /* Merge in level order so results match serial execution */
+    size_t semantic_count = 0;
+    for (size_t l = 0; l < level_count; l++) {
+        hierarchy_level_t level = (hierarchy_level_t)(lo + l);
+
+        /* Gather the level's segment and buffer hits, best first */
+        size_t hit_count = 0, sources = 0;
+        for (size_t t = first[l]; t < first[l + 1]; t++) {
+            if (tasks[t].err != MEM_OK || tasks[t].count == 0) continue;
+            memcpy(hits + hit_count, tasks[t].results, tasks[t].count * sizeof(hnsw_result_t));
+            hit_count += tasks[t].count;
+            sources++;
+        }
+        if (fresh_counts[l] > 0) {
+            memcpy(hits + hit_count, fresh_hits + l * max_candidates,
+                   fresh_counts[l] * sizeof(hnsw_result_t));
+            hit_count += fresh_counts[l];
+            sources++;
+        }
+        if (sources > 1) {
+            qsort(hits, hit_count, sizeof(hnsw_result_t), compare_hits);
+
+            /* A segment being merged shares its copied vectors with the target */
+            size_t unique = 0;
+            for (size_t i = 0; i < hit_count; i++) {
+                if (unique == 0 || hits[unique - 1].id != hits[i].id) hits[unique++] = hits[i];
+            }
+            hit_count = unique;
+            if (hit_count > max_candidates) hit_count = max_candidates;
+        }
+
+        for (size_t i = 0; i < hit_count; i++) {
+            const hnsw_result_t* hit = &hits[i];
+            if (!is_indexed(engine, hit->id)) continue;
+
+            if (collect_roots && level == scope->coarse_level &&
+                scope->root_count < scope->root_capacity) {
+                scope->roots[scope->root_count++] = hit->id;
+            }
+            if (level > keep_max || semantic_count >= max_candidates) continue;
+
+            candidate_set_add(set, hit->id, distance_to_score(hit->distance), 0.0f);
+            semantic_count++;
+        }
+    }
+
+    free(tasks);
+    free(hnsw_results);
+    return MEM_OK;
+}
+
+/* ========== Time Index ========== */
+
+static int compare_time_entries(const void* a, const void* b) {
+    const time_entry_t* ta = a;
+    const time_entry_t* tb = b;
+    if (ta->time != tb->time) return ta->time < tb->time ? -1 : 1;
+    if (ta->id != tb->id) return ta->id < tb->id ? -1 : 1;
+    return 0;
+}
+
+/* First position whose entry is not before (time, id) */
+static size_t time_index_lower(const time_index_t* ti, timestamp_ns_t time, node_id_t id) {
+    size_t lo = 0, hi = ti->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const time_entry_t* e = &ti->entries[mid];
+        if (e->time < time || (e->time == time && e->id < id)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Insert entry; ingest order is roughly time order, so this is mostly an append */
+static mem_error_t time_index_insert(time_index_t* ti, timestamp_ns_t time, node_id_t id) {
+    if (ti->count >= ti->capacity) {
+        size_t new_capacity = ti->capacity ? ti->capacity * 2 : 1024;
+        time_entry_t* entries = realloc(ti->entries, new_capacity * sizeof(time_entry_t));
+        if (!entries) {
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand time index");
+        }
+        ti->entries = entries;
+        ti->capacity = new_capacity;
+    }
+
+    size_t pos = time_index_lower(ti, time, id);
+    memmove(&ti->entries[pos + 1], &ti->entries[pos],
+            (ti->count - pos) * sizeof(time_entry_t));
+    ti->entries[pos] = (time_entry_t){ time, id };
+    ti->count++;
+    return MEM_OK;
+}
+
+static void time_index_remove(time_index_t* ti, timestamp_ns_t time, node_id_t id) {
+    size_t pos = time_index_lower(ti, time, id);
+    if (pos >= ti->count || ti->entries[pos].id != id || ti->entries[pos].time != time) {
+        return;
+    }
+    memmove(&ti->entries[pos], &ti->entries[pos + 1],
+            (ti->count - pos - 1) * sizeof(time_entry_t));
+    ti->count--;
+}
+
+/* Entries [*first, *last) with after <= time < before (0 = unbounded) */
+static void time_index_range(const time_index_t* ti, timestamp_ns_t after,
+                             timestamp_ns_t before, size_t* first, size_t* last) {
+    *first = after ? time_index_lower(ti, after, 0) : 0;
+    *last = before ? time_index_lower(ti, before, 0) : ti->count;
+    if (*last < *first) *last = *first;
+}
+
+/* ========== Scoped Search ========== */
+
+/* Agent, session and time predicates, read straight from the columns */
+static bool filter_accepts(const search_scope_t* scope, node_id_t id) {
+    const search_filter_t* f = scope->filter;
+    if (!f) return true;
+
+    const columns_store_t* columns = hierarchy_get_columns(scope->engine->hierarchy);
+    if (f->agent != NODE_ID_INVALID && columns_get_agent(columns, id) != f->agent) {
+        return false;
+    }
+    if (f->session != NODE_ID_INVALID && columns_get_session(columns, id) != f->session) {
+        return false;
+    }
+    if (f->after_time || f->before_time) {
+        timestamp_ns_t created_at = columns_get_created_at(columns, id);
+        if (created_at < f->after_time) return false;
+        if (f->before_time && created_at >= f->before_time) return false;
+    }
+    return true;
+}
+
+/* True if id lies in the subtree of one of the coarse roots */
+static bool in_coarse_subtree(const search_scope_t* scope, node_id_t id) {
+    const columns_store_t* columns = hierarchy_get_columns(scope->engine->hierarchy);
+
+    while (id != NODE_ID_INVALID && columns_get_level(columns, id) < scope->coarse_level) {
+        id = hierarchy_get_parent(scope->engine->hierarchy, id);
+    }
+    for (size_t i = 0; i < scope->root_count; i++) {
+        if (scope->roots[i] == id) return true;
+    }
+    return false;
+}
+
+/* Filter callback for HNSW: the query filter, plus the coarse roots below the coarse level */
+static bool scope_accepts(node_id_t id, void* ctx) {
+    const search_scope_t* scope = ctx;
+    if (!filter_accepts(scope, id)) return false;
+    if (scope->root_count == 0) return true;
+
+    const columns_store_t* columns = hierarchy_get_columns(scope->engine->hierarchy);
+    return columns_get_level(columns, id) >= scope->coarse_level ||
+           in_coarse_subtree(scope, id);
+}
 
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
+/* Filter callback for the inverted index: scope_accepts within the level range */
+static bool exact_accepts(node_id_t id, void* ctx) {
+    const search_scope_t* scope = ctx;
+    if (!is_indexed(scope->engine, id)) return false;
 
-/* Node metadata for scoring */
-typedef struct {
-    node_id_t node_id;
-    uint64_t timestamp;
-    hierarchy_level_t level;
-    size_t token_count;
-} node_meta_t;
+    hierarchy_level_t level = columns_get_level(hierarchy_get_columns(scope->engine->hierarchy), id);
+    return level >= scope->min_level && level <= scope->max_level && scope_accepts(id, ctx);
+}
 
-/* Search engine structure */
-struct search_engine {
-    search_config_t config;
-    hierarchy_t* hierarchy;
+/*
+ * Append indexed nodes at levels [lo, hi] below root to ids. Walks
+ * first_child/next_sibling links without descending under lo. Returns
+ * false once more than limit nodes are found.
+ */
+static bool collect_subtree(const search_engine_t* engine, node_id_t root,
+                            hierarchy_level_t lo, hierarchy_level_t hi,
+                            node_id_t* ids, size_t limit, size_t* count) {
+    const hierarchy_t* h = engine->hierarchy;
+    const columns_store_t* columns = hierarchy_get_columns(h);
+
+    node_id_t node = hierarchy_get_first_child(h, root);
+    while (node != NODE_ID_INVALID) {
+        hierarchy_level_t level = columns_get_level(columns, node);
+        if (level >= lo && level <= hi && is_indexed(engine, node)) {
+            if (*count >= limit) return false;
+            ids[(*count)++] = node;
+        }
+
+        node_id_t next = level > lo ? hierarchy_get_first_child(h, node) : NODE_ID_INVALID;
+        while (next == NODE_ID_INVALID && node != root && node != NODE_ID_INVALID) {
+            next = hierarchy_get_next_sibling(h, node);
+            if (next == NODE_ID_INVALID) node = hierarchy_get_parent(h, node);
+        }
+        node = next;
+    }
+    return true;
+}
 
-    /* HNSW indices per level */
-    hnsw_index_t* hnsw[LEVEL_COUNT];
+/* Drop ids rejected by the scope, keeping order */
+static size_t compact_scoped(const search_scope_t* scope, node_id_t* ids, size_t count) {
+    if (!scope_restricts(scope)) return count;
 
-    /* Single inverted index */
-    inverted_index_t* inverted;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (scope_accepts(ids[i], (void*)scope)) ids[kept++] = ids[i];
+    }
+    return kept;
+}
 
-    /* Node metadata for scoring */
-    node_meta_t* metas;
-    size_t meta_count;
-    size_t meta_capacity;
+/*
+ * Enumerate the filtered subset at levels [lo, hi] into ids, from
+ * whichever source fits in limit: the created_at range of the time
+ * index, or the session (else agent) subtree. Returns false if neither
+ * does, in which case the caller searches the graph instead.
+ */
+static bool collect_filtered(const search_engine_t* engine, const search_scope_t* scope,
+                             hierarchy_level_t lo, hierarchy_level_t hi,
+                             node_id_t* ids, size_t limit, size_t* count) {
+    const search_filter_t* f = scope->filter;
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    *count = 0;
+
+    if (f->after_time || f->before_time) {
+        size_t first, last;
+        time_index_range(&engine->times, f->after_time, f->before_time, &first, &last);
+        if (last - first <= limit) {
+            for (size_t i = first; i < last; i++) {
+                node_id_t id = engine->times.entries[i].id;
+                hierarchy_level_t level = columns_get_level(columns, id);
+                if (level >= lo && level <= hi && is_indexed(engine, id)) {
+                    ids[(*count)++] = id;
+                }
+            }
+            *count = compact_scoped(scope, ids, *count);
+            return true;
+        }
+    }
 
-    /* ID to meta index mapping */
-    size_t* id_to_meta;
-    size_t id_map_size;
-};
+    node_id_t root = f->session != NODE_ID_INVALID ? f->session : f->agent;
+    if (root == NODE_ID_INVALID || root >= columns_count(columns)) return false;
 
-/* ========== Helper Functions ========== */
+    hierarchy_level_t root_level = columns_get_level(columns, root);
+    if (root_level >= lo && root_level <= hi && is_indexed(engine, root)) {
+        if (limit == 0) return false;
+        ids[(*count)++] = root;
+    }
+    if (!collect_subtree(engine, root, lo, hi, ids, limit, count)) return false;
 
-static size_t find_meta_index(search_engine_t* engine, node_id_t node_id) {
-    if (node_id >= engine->id_map_size) return SIZE_MAX;
-    return engine->id_to_meta[node_id];
+    *count = compact_scoped(scope, ids, *count);
+    return true;
 }
 
-static node_meta_t* get_meta(search_engine_t* engine, node_id_t node_id) {
-    size_t idx = find_meta_index(engine, node_id);
-    if (idx == SIZE_MAX) return NULL;
-    return &engine->metas[idx];
+static int compare_node_ids(const void* a, const void* b) {
+    node_id_t ia = *(const node_id_t*)a;
+    node_id_t ib = *(const node_id_t*)b;
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
 }
 
-/* Level boost: higher levels get slight boost */
-static float level_boost(hierarchy_level_t level) {
-    switch (level) {
-        case LEVEL_SESSION:   return 1.0f;
-        case LEVEL_MESSAGE:   return 0.9f;
-        case LEVEL_BLOCK:     return 0.8f;
-        case LEVEL_STATEMENT: return 0.7f;
-        default:              return 0.5f;
+/*
+ * Score ids exactly against their stored vectors and add the budget
+ * best. Vectors not merged into a segment yet come from the fresh buffer.
+ */
+static mem_error_t scan_nodes(search_engine_t* engine, const float* query,
+                              const node_id_t* ids, size_t count,
+                              candidate_set_t* set, size_t budget) {
+    if (count == 0) return MEM_OK;
+
+    hnsw_result_t* hits = malloc(count * sizeof(hnsw_result_t));
+    node_id_t* missing = malloc(count * sizeof(node_id_t));
+    if (!hits || !missing) {
+        free(hits);
+        free(missing);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate scan results");
+    }
+
+    size_t hit_count = 0, missing_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        const float* vector = segment_vector(engine, ids[i]);
+        if (!vector) {
+            missing[missing_count++] = ids[i];
+            continue;
+        }
+
+        hits[hit_count].id = ids[i];
+        hits[hit_count].distance = 1.0f - dot_product(query, vector, EMBEDDING_DIM);
+        hit_count++;
+    }
+
+    if (missing_count > 0 && engine->merger_running) {
+        qsort(missing, missing_count, sizeof(node_id_t), compare_node_ids);
+
+        const fresh_buffer_t* fb = &engine->fresh;
+        pthread_mutex_lock(&engine->fresh_lock);
+        for (size_t i = 0; i < fb->count && hit_count < count; i++) {
+            size_t slot = fresh_slot(fb, i);
+            if (fb->ids[slot] == NODE_ID_INVALID ||
+                !bsearch(&fb->ids[slot], missing, missing_count, sizeof(node_id_t),
+                         compare_node_ids)) {
+                continue;
+            }
+            hits[hit_count].id = fb->ids[slot];
+            hits[hit_count].distance = 1.0f - dot_product(query, fb->vectors + slot * EMBEDDING_DIM,
+                                                          EMBEDDING_DIM);
+            hit_count++;
+        }
+        pthread_mutex_unlock(&engine->fresh_lock);
+    }
+    free(missing);
+
+    qsort(hits, hit_count, sizeof(hnsw_result_t), compare_hits);
+    for (size_t i = 0; i < hit_count && i < budget; i++) {
+        candidate_set_add(set, hits[i].id, distance_to_score(hits[i].distance), 0.0f);
     }
+
+    free(hits);
+    return MEM_OK;
 }
 
-/* Recency score: exponential decay over time */
-static float recency_score(uint64_t timestamp, uint64_t now) {
-    if (timestamp >= now) return 1.0f;
+/*
+ * Filtered semantic search of levels [lo, hi]. The planner scans the
+ * filtered subset exactly when it has at most filter_scan_limit nodes,
+ * and otherwise runs filtered HNSW on each level.
+ */
+static mem_error_t search_filtered(search_engine_t* engine, search_scope_t* scope,
+                                   const float* query, hierarchy_level_t lo,
+                                   hierarchy_level_t hi, size_t inflight,
+                                   candidate_set_t* set) {
+    size_t limit = engine->config.filter_scan_limit;
+    node_id_t* ids = malloc((limit ? limit : 1) * sizeof(node_id_t));
+    if (!ids) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate filter subset");
+    }
+
+    mem_error_t err;
+    size_t count = 0;
+    if (collect_filtered(engine, scope, lo, hi, ids, limit, &count)) {
+        err = scan_nodes(engine, query, ids, count, set, engine->config.max_candidates);
+        atomic_fetch_add(&engine->filter_scans, 1);
+    } else {
+        err = semantic_levels(engine, query, lo, hi, hi, inflight, scope, false, set);
+        atomic_fetch_add(&engine->filter_graph_searches, 1);
+    }
 
-    /* Decay constant: half-life of 1 hour */
-    const float half_life_ms = 3600000.0f;
-    float age_ms = (float)(now - timestamp);
-    return expf(-0.693f * age_ms / half_life_ms);
+    free(ids);
+    return err;
 }
 
-/* Convert distance to similarity score */
-static float distance_to_score(float distance) {
-    return 1.0f - distance;
+/*
+ * Add semantic hits from levels [lo, hi] under the coarse roots.
+ * Subtrees totalling at most coarse_scan_limit nodes are scored exactly;
+ * larger ones use HNSW restricted to the scope.
+ */
+static mem_error_t search_subtrees(search_engine_t* engine, search_scope_t* scope,
+                                   const float* query, hierarchy_level_t lo,
+                                   hierarchy_level_t hi, size_t inflight,
+                                   candidate_set_t* set) {
+    size_t limit = engine->config.coarse_scan_limit;
+    node_id_t* ids = malloc((limit ? limit : 1) * sizeof(node_id_t));
+    if (!ids) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate subtree buffer");
+    }
+
+    size_t count = 0;
+    bool fits = limit > 0;
+    for (size_t r = 0; fits && r < scope->root_count; r++) {
+        fits = collect_subtree(engine, scope->roots[r], lo, hi, ids, limit, &count);
+    }
+
+    mem_error_t err;
+    if (fits) {
+        count = compact_scoped(scope, ids, count);
+        err = scan_nodes(engine, query, ids, count, set, engine->config.max_candidates);
+        atomic_fetch_add(&engine->coarse_scans, 1);
+    } else {
+        err = semantic_levels(engine, query, lo, hi, hi, inflight, scope, false, set);
+    }
+
+    free(ids);
+    return err;
 }
 
-/* Merge and deduplicate results */
-static void merge_results(search_match_t* dst, size_t* dst_count, size_t dst_capacity,
-                          search_match_t* src, size_t src_count) {
-    for (size_t i = 0; i < src_count && *dst_count < dst_capacity; i++) {
-        bool found = false;
-        for (size_t j = 0; j < *dst_count; j++) {
-            if (dst[j].node_id == src[i].node_id) {
-                if (src[i].semantic_score > dst[j].semantic_score) {
-                    dst[j].semantic_score = src[i].semantic_score;
-                }
-                if (src[i].exact_score > dst[j].exact_score) {
-                    dst[j].exact_score = src[i].exact_score;
-                }
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            dst[(*dst_count)++] = src[i];
+/*
+ * Create the segments a rebuild of level fills: a span-wide one per span
+ * holding nodes, with adjacent spans combined as segment_limit merges
+ * would have left them. Reads the sorted time index.
+ */
+static mem_error_t plan_segments(search_engine_t* engine, hierarchy_level_t level) {
+    if (!level_segmented(engine, level)) return MEM_OK;
+
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    const time_index_t* ti = &engine->times;
+    size_t* sizes = malloc((ti->count ? ti->count : 1) * sizeof(size_t));
+    timestamp_ns_t* starts = malloc((ti->count ? ti->count : 1) * sizeof(timestamp_ns_t));
+    timestamp_ns_t* ends = malloc((ti->count ? ti->count : 1) * sizeof(timestamp_ns_t));
+    if (!sizes || !starts || !ends) {
+        free(sizes);
+        free(starts);
+        free(ends);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate segment plan");
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < ti->count; i++) {
+        if (columns_get_level(columns, ti->entries[i].id) != level) continue;
+        timestamp_ns_t start = segment_start(engine, level, ti->entries[i].time);
+        if (count > 0 && starts[count - 1] == start) {
+            sizes[count - 1]++;
+            continue;
         }
+        starts[count] = start;
+        ends[count] = segment_end(engine, level, start);
+        sizes[count++] = 1;
     }
-}
 
-static int compare_results(const void* a, const void* b) {
-    const search_match_t* ra = a;
-    const search_match_t* rb = b;
-    if (rb->score > ra->score) return 1;
-    if (rb->score < ra->score) return -1;
-    return 0;
+    size_t limit = engine->config.segment_limit;
+    while (limit > 0 && count > limit) {
+        size_t pair = merge_candidate(sizes, count);
+        if (pair == SIZE_MAX) break;
+        ends[pair] = ends[pair + 1];
+        sizes[pair] += sizes[pair + 1];
+        size_t tail = count - pair - 2;
+        memmove(&starts[pair + 1], &starts[pair + 2], tail * sizeof(timestamp_ns_t));
+        memmove(&ends[pair + 1], &ends[pair + 2], tail * sizeof(timestamp_ns_t));
+        memmove(&sizes[pair + 1], &sizes[pair + 2], tail * sizeof(size_t));
+        count--;
+    }
+
+    mem_error_t err = MEM_OK;
+    for (size_t i = 0; i < count && err == MEM_OK; i++) {
+        err = segment_create(&engine->levels[level], starts[i], ends[i], NULL);
+    }
+    free(sizes);
+    free(starts);
+    free(ends);
+    return err;
 }
 
 /* ========== Public API ========== */
@@ -133,112 +1638,136 @@ mem_error_t search_engine_create(search_engine_t** engine,
 
     eng->hierarchy = hierarchy;
 
-    /* Create HNSW index for each level */
-    hnsw_config_t hnsw_config = HNSW_CONFIG_DEFAULT;
-    for (int level = 0; level < LEVEL_COUNT; level++) {
-        mem_error_t err = hnsw_create(&eng->hnsw[level], &hnsw_config);
-        if (err != MEM_OK) {
-            for (int i = 0; i < level; i++) {
-                hnsw_destroy(eng->hnsw[i]);
-            }
-            free(eng);
-            return err;
-        }
-    }
+    /* HNSW segments are created on first insert */
 
     /* Create inverted index */
     inverted_index_config_t inv_config = INVERTED_INDEX_CONFIG_DEFAULT;
     mem_error_t err = inverted_index_create(&eng->inverted, &inv_config);
     if (err != MEM_OK) {
-        for (int i = 0; i < LEVEL_COUNT; i++) {
-            hnsw_destroy(eng->hnsw[i]);
-        }
         free(eng);
         return err;
     }
 
-    /* Initialize metadata storage */
-    eng->meta_capacity = 1024;
-    eng->metas = calloc(eng->meta_capacity, sizeof(node_meta_t));
-    if (!eng->metas) {
+    /* Initialize indexed flags */
+    eng->indexed_size = 1024;
+    eng->indexed = calloc(eng->indexed_size, sizeof(uint8_t));
+    if (!eng->indexed) {
         inverted_index_destroy(eng->inverted);
-        for (int i = 0; i < LEVEL_COUNT; i++) {
-            hnsw_destroy(eng->hnsw[i]);
-        }
         free(eng);
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate metas");
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate indexed flags");
     }
 
-    eng->id_map_size = 1024;
-    eng->id_to_meta = malloc(eng->id_map_size * sizeof(size_t));
-    if (!eng->id_to_meta) {
-        free(eng->metas);
-        inverted_index_destroy(eng->inverted);
-        for (int i = 0; i < LEVEL_COUNT; i++) {
-            hnsw_destroy(eng->hnsw[i]);
+    /* Prefer the merge thread over a steady stream of readers */
+    pthread_rwlockattr_t rwattr;
+    pthread_rwlockattr_init(&rwattr);
+    pthread_rwlockattr_setkind_np(&rwattr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&eng->graph_lock, &rwattr);
+    pthread_rwlockattr_destroy(&rwattr);
+    pthread_mutex_init(&eng->fresh_lock, NULL);
+    pthread_cond_init(&eng->fresh_ready, NULL);
+    pthread_cond_init(&eng->fresh_drained, NULL);
+
+    /* Fresh-write buffer and its merge thread */
+    if (eng->config.fresh_buffer_capacity > 0) {
+        err = fresh_init(&eng->fresh, eng->config.fresh_buffer_capacity);
+        if (err == MEM_OK && pthread_create(&eng->merger, NULL, merge_main, eng) != 0) {
+            fresh_free(&eng->fresh);
+            err = MEM_ERR_THREAD;
+            MEM_SET_ERROR(err, "failed to start merge thread");
+        }
+        if (err != MEM_OK) {
+            LOG_WARN("Fresh-write buffer disabled: %s", mem_error_str(err));
+        } else {
+            eng->merger_running = true;
         }
-        free(eng);
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate id map");
     }
-    for (size_t i = 0; i < eng->id_map_size; i++) {
-        eng->id_to_meta[i] = SIZE_MAX;
+
+    /* Worker pool for intra-query fan-out */
+    if (eng->config.parallel_fanout > 1) {
+        err = thread_pool_create(&eng->pool, eng->config.parallel_threads, 0);
+        if (err != MEM_OK) {
+            LOG_WARN("Parallel search disabled: %s", mem_error_str(err));
+            eng->pool = NULL;
+        }
     }
 
-    LOG_INFO("Search engine created");
-    *engine = eng;
+    if (eng->config.result_cache_entries > 0) {
+        err = result_cache_create(&eng->cache, eng->config.result_cache_entries);
+        if (err != MEM_OK) {
+            LOG_WARN("Result cache disabled: %s", mem_error_str(err));
+            eng->cache = NULL;
+        }
+    }
 
-    /* Rebuild index from existing hierarchy data */
+    /* Sized for the rebuild below; new nodes grow it on insert */
     size_t node_count = hierarchy_count(hierarchy);
     if (node_count > 0) {
-        LOG_INFO("Rebuilding search index from %zu existing nodes...", node_count);
-        size_t indexed = 0;
-        uint64_t now = timestamp_now_ns();
+        eng->times.entries = malloc(node_count * sizeof(time_entry_t));
+        if (!eng->times.entries) {
+            search_engine_destroy(eng);
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate time index");
+        }
+        eng->times.capacity = node_count;
+    }
 
-        for (node_id_t id = 0; id < node_count; id++) {
-            const float* embedding = hierarchy_get_embedding(hierarchy, id);
-            if (embedding) {
-                hierarchy_level_t level = hierarchy_get_level(hierarchy, id);
+    LOG_INFO("Search engine created (fan-out %zu, %zu workers, %zu cached queries, "
+             "%zu buffered vectors)",
+             eng->pool ? eng->config.parallel_fanout : (size_t)1,
+             thread_pool_size(eng->pool),
+             eng->cache ? eng->config.result_cache_entries : (size_t)0,
+             eng->fresh.capacity);
+    *engine = eng;
 
-                /* Index in HNSW */
-                if (level < LEVEL_COUNT) {
-                    hnsw_add(eng->hnsw[level], id, embedding);
-                }
+    /* Rebuild index from existing hierarchy data; scoring columns are persistent */
+    const columns_store_t* columns = hierarchy_get_columns(hierarchy);
+    if (node_count > 0) {
+        LOG_INFO("Rebuilding search index from %zu existing nodes...", node_count);
+        size_t indexed = 0, expired = 0;
 
-                /* Store metadata */
-                if (eng->meta_count >= eng->meta_capacity) {
-                    size_t new_cap = eng->meta_capacity * 2;
-                    node_meta_t* new_metas = realloc(eng->metas, new_cap * sizeof(node_meta_t));
-                    if (new_metas) {
-                        eng->metas = new_metas;
-                        eng->meta_capacity = new_cap;
-                    }
-                }
+        /* Nodes a retention pass would drop are not re-indexed */
+        timestamp_ns_t horizon = drop_boundary(eng, retention_cutoff(eng, timestamp_now_ns()));
 
-                if (id >= eng->id_map_size) {
-                    size_t new_size = id + 1024;
-                    size_t* new_map = realloc(eng->id_to_meta, new_size * sizeof(size_t));
-                    if (new_map) {
-                        for (size_t i = eng->id_map_size; i < new_size; i++) {
-                            new_map[i] = SIZE_MAX;
-                        }
-                        eng->id_to_meta = new_map;
-                        eng->id_map_size = new_size;
-                    }
-                }
+        /* Flag and time-index every node first, so segments can be planned */
+        pthread_rwlock_wrlock(&eng->graph_lock);
+        for (node_id_t id = 0; id < node_count; id++) {
+            if (!hierarchy_get_embedding(hierarchy, id)) continue;
 
-                size_t meta_idx = eng->meta_count++;
-                eng->metas[meta_idx] = (node_meta_t){
-                    .node_id = id,
-                    .timestamp = now,
-                    .level = level,
-                    .token_count = 0
-                };
-                eng->id_to_meta[id] = meta_idx;
+            hierarchy_level_t level = columns_get_level(columns, id);
+            if (level >= LEVEL_COUNT) continue;
+            if (ensure_indexed_capacity(eng, id) != MEM_OK) break;
+
+            timestamp_ns_t created_at = columns_get_created_at(columns, id);
+            if (level_segmented(eng, level) && created_at < horizon) {
+                expired++;
+                continue;
+            }
+            eng->indexed[id] = 1;
+            eng->indexed_count++;
+            eng->times.entries[eng->times.count++] = (time_entry_t){ created_at, id };
+        }
+        qsort(eng->times.entries, eng->times.count, sizeof(time_entry_t),
+              compare_time_entries);
 
-                indexed++;
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            if (plan_segments(eng, (hierarchy_level_t)level) != MEM_OK) {
+                LOG_WARN("Failed to plan level %d segments; they merge after the rebuild",
+                         level);
             }
         }
-        LOG_INFO("Search index rebuilt: %zu nodes indexed", indexed);
+        for (size_t i = 0; i < eng->times.count; i++) {
+            node_id_t id = eng->times.entries[i].id;
+            segment_add(eng, columns_get_level(columns, id), eng->times.entries[i].time,
+                        id, hierarchy_get_embedding(hierarchy, id));
+        }
+        indexed = eng->times.count;
+        pthread_rwlock_unlock(&eng->graph_lock);
+
+        size_t segments = 0;
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            segments += eng->levels[level].count;
+        }
+        LOG_INFO("Search index rebuilt: %zu nodes indexed in %zu segments "
+                 "(%zu past retention)", indexed, segments, expired);
     }
 
     return MEM_OK;
@@ -247,85 +1776,286 @@ mem_error_t search_engine_create(search_engine_t** engine,
 void search_engine_destroy(search_engine_t* engine) {
     if (!engine) return;
 
+    /* The merge thread drains the buffer before exiting */
+    if (engine->merger_running) {
+        pthread_mutex_lock(&engine->fresh_lock);
+        engine->stopping = true;
+        pthread_cond_signal(&engine->fresh_ready);
+        pthread_mutex_unlock(&engine->fresh_lock);
+        pthread_join(engine->merger, NULL);
+    }
+    fresh_free(&engine->fresh);
+    pthread_cond_destroy(&engine->fresh_drained);
+    pthread_cond_destroy(&engine->fresh_ready);
+    pthread_mutex_destroy(&engine->fresh_lock);
+    pthread_rwlock_destroy(&engine->graph_lock);
+
+    thread_pool_destroy(engine->pool);
+    result_cache_destroy(engine->cache);
     for (int i = 0; i < LEVEL_COUNT; i++) {
-        hnsw_destroy(engine->hnsw[i]);
+        level_index_free(&engine->levels[i]);
     }
     inverted_index_destroy(engine->inverted);
-    free(engine->metas);
-    free(engine->id_to_meta);
+    free(engine->times.entries);
+    free(engine->indexed);
     free(engine);
 }
 
+/*
+ * Add a vector to its segment directly: buffering is off, the buffer is
+ * full, or the node is being re-indexed
+ */
+static mem_error_t index_vector(search_engine_t* engine, node_id_t node_id,
+                                hierarchy_level_t level, timestamp_ns_t old_time,
+                                timestamp_ns_t new_time, const float* embedding) {
+    mem_error_t err;
+    pthread_rwlock_wrlock(&engine->graph_lock);
+
+    /* Still buffered: keep its vector, but merge it into the segment for the new time */
+    size_t slot = SIZE_MAX;
+    if (engine->merger_running && engine->indexed[node_id]) {
+        pthread_mutex_lock(&engine->fresh_lock);
+        slot = fresh_find(&engine->fresh, node_id);
+        if (slot != SIZE_MAX) engine->fresh.times[slot] = new_time;
+        pthread_mutex_unlock(&engine->fresh_lock);
+    }
+
+    if (slot != SIZE_MAX) {
+        err = MEM_ERR_EXISTS;
+        MEM_SET_ERROR(err, "ID %u already in index", node_id);
+    } else {
+        /* A re-index that moves created_at across segments moves the vector too */
+        index_segment_t* old_segment = engine->indexed[node_id]
+                                     ? find_segment(engine, level, old_time) : NULL;
+        if (old_segment && old_segment != find_segment(engine, level, new_time)) {
+            segment_remove(engine, old_segment, node_id);
+        }
+        err = segment_add(engine, level, new_time, node_id, embedding);
+    }
+
+    pthread_rwlock_unlock(&engine->graph_lock);
+    return err;
+}
+
 mem_error_t search_engine_index(search_engine_t* engine, node_id_t node_id,
                                 const float* embedding, const char** tokens,
                                 size_t token_count, uint64_t timestamp) {
     MEM_CHECK_ERR(engine != NULL, MEM_ERR_INVALID_ARG, "engine is NULL");
     MEM_CHECK_ERR(embedding != NULL, MEM_ERR_INVALID_ARG, "embedding is NULL");
 
-    hierarchy_level_t level = hierarchy_get_level(engine->hierarchy, node_id);
+    columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    if (node_id >= columns_count(columns)) {
+        MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "node %u not in hierarchy", node_id);
+    }
+
+    hierarchy_level_t level = columns_get_level(columns, node_id);
+    timestamp_ns_t old_time = columns_get_created_at(columns, node_id);
 
-    /* Expand meta array if needed */
-    if (engine->meta_count >= engine->meta_capacity) {
-        size_t new_cap = engine->meta_capacity * 2;
-        node_meta_t* new_metas = realloc(engine->metas, new_cap * sizeof(node_meta_t));
-        if (!new_metas) {
-            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand metas");
-        }
-        engine->metas = new_metas;
-        engine->meta_capacity = new_cap;
+    /* Record scoring inputs in the persistent columns */
+    if (timestamp != 0) {
+        MEM_CHECK(columns_set_created_at(columns, node_id, timestamp));
     }
 
-    /* Expand ID map if needed */
-    if (node_id >= engine->id_map_size) {
-        size_t new_size = node_id + 1;
-        if (new_size < engine->id_map_size * 2) {
-            new_size = engine->id_map_size * 2;
-        }
-        size_t* new_map = realloc(engine->id_to_meta, new_size * sizeof(size_t));
-        if (!new_map) {
-            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to expand id map");
-        }
-        for (size_t i = engine->id_map_size; i < new_size; i++) {
-            new_map[i] = SIZE_MAX;
+    timestamp_ns_t new_time = columns_get_created_at(columns, node_id);
+
+    /* Searches read the flags and the time index, so they change only exclusively */
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    mem_error_t err = ensure_indexed_capacity(engine, node_id);
+    bool was_indexed = err == MEM_OK && engine->indexed[node_id];
+    pthread_rwlock_unlock(&engine->graph_lock);
+    if (err != MEM_OK) return err;
+
+    /* New nodes land in the fresh buffer; the merge thread adds them to HNSW */
+    bool buffered = false;
+    if (engine->merger_running && !was_indexed) {
+        pthread_mutex_lock(&engine->fresh_lock);
+        buffered = fresh_push(&engine->fresh, node_id, level, new_time, embedding);
+        if (buffered && engine->fresh.count == 1) {
+            pthread_cond_signal(&engine->fresh_ready);
         }
-        engine->id_to_meta = new_map;
-        engine->id_map_size = new_size;
+        pthread_mutex_unlock(&engine->fresh_lock);
+        if (!buffered) atomic_fetch_add(&engine->fresh_overflows, 1);
     }
 
-    /* Store metadata */
-    size_t meta_idx = engine->meta_count++;
-    engine->metas[meta_idx].node_id = node_id;
-    engine->metas[meta_idx].timestamp = timestamp;
-    engine->metas[meta_idx].level = level;
-    engine->metas[meta_idx].token_count = token_count;
-    engine->id_to_meta[node_id] = meta_idx;
-
-    /* Add to HNSW for this level */
-    MEM_CHECK(hnsw_add(engine->hnsw[level], node_id, embedding));
+    err = buffered ? MEM_OK
+                   : index_vector(engine, node_id, level, old_time, new_time, embedding);
 
     /* Add to inverted index */
-    if (tokens && token_count > 0) {
-        MEM_CHECK(inverted_index_add(engine->inverted, node_id, tokens, token_count));
+    if (err == MEM_OK && tokens && token_count > 0) {
+        err = inverted_index_add(engine->inverted, node_id, tokens, token_count);
     }
 
-    return MEM_OK;
+    /* Keep the time index in step with created_at, which may change on re-index */
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    if (engine->indexed[node_id]) {
+        if (new_time != old_time) {
+            time_index_remove(&engine->times, old_time, node_id);
+            mem_error_t time_err = time_index_insert(&engine->times, new_time, node_id);
+            if (err == MEM_OK) err = time_err;
+        }
+    } else if (err == MEM_OK) {
+        err = time_index_insert(&engine->times, new_time, node_id);
+    }
+
+    if (err == MEM_OK && !engine->indexed[node_id]) {
+        engine->indexed[node_id] = 1;
+        engine->indexed_count++;
+    }
+    pthread_rwlock_unlock(&engine->graph_lock);
+
+    /* Even a failed add may have touched the level, so always invalidate */
+    atomic_fetch_add(&engine->generation[level], 1);
+    return err;
 }
 
 mem_error_t search_engine_remove(search_engine_t* engine, node_id_t node_id) {
     MEM_CHECK_ERR(engine != NULL, MEM_ERR_INVALID_ARG, "engine is NULL");
 
-    node_meta_t* meta = get_meta(engine, node_id);
-    if (!meta) {
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    if (!is_indexed(engine, node_id)) {
+        pthread_rwlock_unlock(&engine->graph_lock);
         MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "node %u not in index", node_id);
     }
 
-    hnsw_remove(engine->hnsw[meta->level], node_id);
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    hierarchy_level_t level = columns_get_level(columns, node_id);
+    timestamp_ns_t created_at = columns_get_created_at(columns, node_id);
+
+    size_t slot = SIZE_MAX;
+    if (engine->merger_running) {
+        pthread_mutex_lock(&engine->fresh_lock);
+        slot = fresh_find(&engine->fresh, node_id);
+        if (slot != SIZE_MAX) engine->fresh.ids[slot] = NODE_ID_INVALID;
+        pthread_mutex_unlock(&engine->fresh_lock);
+    }
+    if (slot == SIZE_MAX) {
+        index_segment_t* segment = find_segment(engine, level, created_at);
+        if (segment) segment_remove(engine, segment, node_id);
+    }
+    time_index_remove(&engine->times, created_at, node_id);
+    engine->indexed[node_id] = 0;
+    engine->indexed_count--;
+    pthread_rwlock_unlock(&engine->graph_lock);
+
     inverted_index_remove(engine->inverted, node_id);
-    engine->id_to_meta[node_id] = SIZE_MAX;
+    atomic_fetch_add(&engine->generation[level], 1);
 
     return MEM_OK;
 }
 
+mem_error_t search_engine_drop_before(search_engine_t* engine, timestamp_ns_t cutoff,
+                                      size_t* dropped) {
+    MEM_CHECK_ERR(engine != NULL, MEM_ERR_INVALID_ARG, "engine is NULL");
+
+    if (dropped) *dropped = 0;
+    if (engine->config.segment_span_ns == 0) return MEM_OK;
+
+    /* Segments ending at or before the span boundary hold only nodes older than cutoff */
+    timestamp_ns_t boundary = drop_boundary(engine, cutoff);
+
+    /* Segments, flags and time index go together, so searches never see half a drop */
+    pthread_rwlock_wrlock(&engine->graph_lock);
+    size_t last = time_index_lower(&engine->times, boundary, 0);
+    node_id_t* ids = malloc((last ? last : 1) * sizeof(node_id_t));
+    if (!ids) {
+        pthread_rwlock_unlock(&engine->graph_lock);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dropped node list");
+    }
+
+    /*
+     * Merged segments may straddle the boundary and are kept whole, so
+     * each level drops the nodes before its own horizon: the start of its
+     * first kept segment, or the boundary
+     */
+    timestamp_ns_t horizon[LEVEL_COUNT] = {0};
+    size_t segments = 0;
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        if (!level_segmented(engine, (hierarchy_level_t)level)) continue;
+
+        level_index_t* li = &engine->levels[level];
+        size_t n = 0;
+        while (n < li->count && li->segments[n].end <= boundary) n++;
+        horizon[level] = n < li->count && li->segments[n].start < boundary
+                       ? li->segments[n].start : boundary;
+
+        /* A merge into a dropped target is moot; one from a dropped source is undone */
+        segment_merge_t* merge = &engine->merge;
+        if (merge->source && merge->level == (hierarchy_level_t)level) {
+            if (segment_position(li, merge->target) < n) {
+                memset(merge, 0, sizeof(*merge));
+            } else if (segment_position(li, merge->source) < n) {
+                merge_abandon(engine);
+            }
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            hnsw_destroy(li->segments[i].hnsw);
+        }
+        memmove(&li->segments[0], &li->segments[n], (li->count - n) * sizeof(index_segment_t));
+        li->count -= n;
+        segments += n;
+    }
+
+    /* Buffered vectors of dropped nodes must not be merged into new old segments */
+    if (engine->merger_running) {
+        fresh_buffer_t* fb = &engine->fresh;
+        pthread_mutex_lock(&engine->fresh_lock);
+        for (size_t i = 0; i < fb->count; i++) {
+            size_t slot = fresh_slot(fb, i);
+            if (fb->times[slot] < horizon[fb->levels[slot]]) {
+                fb->ids[slot] = NODE_ID_INVALID;
+            }
+        }
+        pthread_mutex_unlock(&engine->fresh_lock);
+    }
+
+    /* Their nodes are the time index entries before the horizon at those levels */
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
+    size_t count = 0, kept = 0;
+    for (size_t i = 0; i < last; i++) {
+        time_entry_t entry = engine->times.entries[i];
+        if (entry.time < horizon[columns_get_level(columns, entry.id)]) {
+            ids[count++] = entry.id;
+            engine->indexed[entry.id] = 0;
+            engine->indexed_count--;
+        } else {
+            engine->times.entries[kept++] = entry;
+        }
+    }
+    memmove(&engine->times.entries[kept], &engine->times.entries[last],
+            (engine->times.count - last) * sizeof(time_entry_t));
+    engine->times.count -= count;
+    pthread_rwlock_unlock(&engine->graph_lock);
+
+    mem_error_t err = inverted_index_remove_batch(engine->inverted, ids, count);
+    free(ids);
+
+    if (segments > 0 || count > 0) {
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            if (level_segmented(engine, (hierarchy_level_t)level)) {
+                atomic_fetch_add(&engine->generation[level], 1);
+            }
+        }
+        LOG_INFO("Dropped %zu index segments (%zu nodes) before %llu",
+                 segments, count, (unsigned long long)boundary);
+    }
+
+    if (dropped) *dropped = count;
+    return err;
+}
+
+mem_error_t search_engine_expire(search_engine_t* engine, timestamp_ns_t now,
+                                 size_t* dropped) {
+    MEM_CHECK_ERR(engine != NULL, MEM_ERR_INVALID_ARG, "engine is NULL");
+
+    timestamp_ns_t cutoff = retention_cutoff(engine, now);
+    if (cutoff == 0) {
+        if (dropped) *dropped = 0;
+        return MEM_OK;
+    }
+    return search_engine_drop_before(engine, cutoff, dropped);
+}
+
 mem_error_t search_engine_search(search_engine_t* engine,
                                  const search_query_t* query,
                                  search_match_t* results,
@@ -337,107 +2067,128 @@ mem_error_t search_engine_search(search_engine_t* engine,
 
     *result_count = 0;
 
+    const columns_store_t* columns = hierarchy_get_columns(engine->hierarchy);
     size_t max_candidates = engine->config.max_candidates;
-    search_match_t* candidates = calloc(max_candidates * 2, sizeof(search_match_t));
-    if (!candidates) {
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate candidates");
+
+    /* Coarse-to-fine: levels below the coarse level only match its top subtrees */
+    hierarchy_level_t coarse = search_coarse_level(query->coarse_level);
+    bool coarse_mode = query->mode == SEARCH_MODE_COARSE_TO_FINE && query->embedding &&
+                       coarse < LEVEL_COUNT && coarse > query->min_level &&
+                       query->min_level <= query->max_level;
+    search_scope_t scope = {
+        .engine = engine,
+        .filter = query->filter,
+        .min_level = query->min_level,
+        .max_level = query->max_level,
+        .coarse_level = coarse
+    };
+    if (coarse_mode) {
+        scope.root_capacity = query->coarse_top_n ? query->coarse_top_n
+                                                  : engine->config.coarse_top_n;
+        scope.roots = malloc((scope.root_capacity ? scope.root_capacity : 1) *
+                             sizeof(node_id_t));
+        if (!scope.roots) {
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate coarse roots");
+        }
+    }
+
+    /* Coarse mode keeps a separate budget of fine-level hits */
+    candidate_set_t candidates;
+    mem_error_t err = candidate_set_init(&candidates,
+                                         max_candidates * (coarse_mode ? 3 : 2));
+    if (err != MEM_OK) {
+        free(scope.roots);
+        return err;
     }
-    size_t candidate_count = 0;
 
-    uint64_t now = time_now_ms();
+    inverted_result_t* inv_results = NULL;
+
+    size_t inflight = atomic_fetch_add(&engine->inflight, 1) + 1;
+    pthread_rwlock_rdlock(&engine->graph_lock);
 
     /* Semantic search across requested levels */
-    if (query->embedding) {
-        for (hierarchy_level_t level = query->min_level; level <= query->max_level; level++) {
-            hnsw_result_t hnsw_results[100];
-            size_t hnsw_count = 0;
-
-            mem_error_t err = hnsw_search(engine->hnsw[level], query->embedding,
-                                          max_candidates, hnsw_results, &hnsw_count);
-            if (err != MEM_OK) continue;
-
-            for (size_t i = 0; i < hnsw_count && candidate_count < max_candidates; i++) {
-                node_meta_t* meta = get_meta(engine, hnsw_results[i].id);
-                if (!meta) continue;
-
-                search_match_t r = {
-                    .node_id = hnsw_results[i].id,
-                    .level = meta->level,
-                    .semantic_score = distance_to_score(hnsw_results[i].distance),
-                    .exact_score = 0.0f,
-                    .timestamp = meta->timestamp,
-                    .score = 0.0f
-                };
-
-                merge_results(candidates, &candidate_count, max_candidates * 2, &r, 1);
-            }
+    if (coarse_mode) {
+        /* The coarse level is searched even when above max_level */
+        hierarchy_level_t hi = query->max_level > coarse ? query->max_level : coarse;
+        hierarchy_level_t fine_hi = query->max_level < coarse ? query->max_level
+                                                              : (hierarchy_level_t)(coarse - 1);
+
+        err = semantic_levels(engine, query->embedding, coarse, hi, query->max_level,
+                              inflight, &scope, true, &candidates);
+        if (err != MEM_OK) goto cleanup;
+
+        if (scope.root_count > 0) {
+            atomic_fetch_add(&engine->coarse_searches, 1);
+            err = search_subtrees(engine, &scope, query->embedding, query->min_level,
+                                  fine_hi, inflight, &candidates);
+        } else if (scope.filter) {
+            /* Nothing matched at the coarse level: fall back to flat */
+            err = search_filtered(engine, &scope, query->embedding, query->min_level,
+                                  fine_hi, inflight, &candidates);
+        } else {
+            err = semantic_levels(engine, query->embedding, query->min_level, fine_hi,
+                                  fine_hi, inflight, &scope, false, &candidates);
+        }
+        if (err != MEM_OK) goto cleanup;
+    } else if (query->embedding && query->min_level <= query->max_level) {
+        if (scope.filter) {
+            err = search_filtered(engine, &scope, query->embedding, query->min_level,
+                                  query->max_level, inflight, &candidates);
+        } else {
+            err = semantic_levels(engine, query->embedding, query->min_level,
+                                  query->max_level, query->max_level, inflight,
+                                  &scope, false, &candidates);
         }
+        if (err != MEM_OK) goto cleanup;
     }
 
-    /* Exact match search */
+    /* Exact match search; restricted queries filter postings before ranking */
     if (query->tokens && query->token_count > 0) {
-        inverted_result_t inv_results[100];
-        size_t inv_count = 0;
+        inv_results = malloc(max_candidates * sizeof(inverted_result_t));
+        if (!inv_results) {
+            err = MEM_ERR_NOMEM;
+            MEM_SET_ERROR(err, "failed to allocate inverted results");
+            goto cleanup;
+        }
 
-        mem_error_t err = inverted_index_search_any(engine->inverted,
-                                                     query->tokens, query->token_count,
-                                                     max_candidates, inv_results, &inv_count);
-        if (err == MEM_OK) {
+        size_t inv_count = 0;
+        mem_error_t inv_err;
+        if (scope_restricts(&scope)) {
+            inv_err = inverted_index_search_any_filtered(engine->inverted,
+                                                         query->tokens, query->token_count,
+                                                         max_candidates, exact_accepts,
+                                                         &scope, inv_results, &inv_count);
+        } else {
+            inv_err = inverted_index_search_any(engine->inverted,
+                                                query->tokens, query->token_count,
+                                                max_candidates, inv_results, &inv_count);
+        }
+        if (inv_err == MEM_OK) {
             for (size_t i = 0; i < inv_count; i++) {
-                node_meta_t* meta = get_meta(engine, inv_results[i].doc_id);
-                if (!meta) continue;
+                node_id_t id = inv_results[i].doc_id;
+                if (!is_indexed(engine, id)) continue;
 
-                if (meta->level < query->min_level || meta->level > query->max_level) {
+                hierarchy_level_t level = columns_get_level(columns, id);
+                if (level < query->min_level || level > query->max_level) {
                     continue;
                 }
 
-                search_match_t r = {
-                    .node_id = inv_results[i].doc_id,
-                    .level = meta->level,
-                    .semantic_score = 0.0f,
-                    .exact_score = inv_results[i].score,
-                    .timestamp = meta->timestamp,
-                    .score = 0.0f
-                };
-
-                merge_results(candidates, &candidate_count, max_candidates * 2, &r, 1);
+                candidate_set_add(&candidates, id, 0.0f, inv_results[i].score);
             }
         }
     }
 
-    /* Normalize exact scores */
-    float max_exact = 0.0f;
-    for (size_t i = 0; i < candidate_count; i++) {
-        if (candidates[i].exact_score > max_exact) {
-            max_exact = candidates[i].exact_score;
-        }
-    }
-    if (max_exact > 0) {
-        for (size_t i = 0; i < candidate_count; i++) {
-            candidates[i].exact_score /= max_exact;
-        }
-    }
-
-    /* Compute final scores: 0.6 * relevance + 0.3 * recency + 0.1 * level_boost */
-    for (size_t i = 0; i < candidate_count; i++) {
-        float relevance = engine->config.semantic_weight * candidates[i].semantic_score +
-                          engine->config.exact_weight * candidates[i].exact_score;
-        float recency = recency_score(candidates[i].timestamp, now);
-        float level = level_boost(candidates[i].level);
-
-        candidates[i].score = engine->config.relevance_weight * relevance +
-                              engine->config.recency_weight * recency +
-                              engine->config.level_weight * level;
-    }
-
-    qsort(candidates, candidate_count, sizeof(search_match_t), compare_results);
-
-    size_t copy_count = candidate_count < query->k ? candidate_count : query->k;
-    memcpy(results, candidates, copy_count * sizeof(search_match_t));
-    *result_count = copy_count;
-
-    free(candidates);
-    return MEM_OK;
+    /* Final ranking: 0.6 * relevance + 0.3 * recency + 0.1 * level_boost */
+    score_candidates(&engine->config, columns, &candidates, timestamp_now_ns());
+    err = select_top_k(&candidates, columns, query->k, results, result_count);
+
+cleanup:
+    pthread_rwlock_unlock(&engine->graph_lock);
+    atomic_fetch_sub(&engine->inflight, 1);
+    free(inv_results);
+    free(scope.roots);
+    candidate_set_free(&candidates);
+    return err;
 }
 
 mem_error_t search_engine_semantic(search_engine_t* engine,
@@ -482,9 +2233,125 @@ mem_error_t search_engine_exact(search_engine_t* engine,
     return search_engine_search(engine, &query, results, result_count);
 }
 
+void search_engine_flush(search_engine_t* engine) {
+    if (!engine || !engine->merger_running) return;
+
+    pthread_mutex_lock(&engine->fresh_lock);
+    while (engine->fresh.count > 0 || engine->merge_pending) {
+        pthread_cond_wait(&engine->fresh_drained, &engine->fresh_lock);
+    }
+    pthread_mutex_unlock(&engine->fresh_lock);
+}
+
 size_t search_engine_node_count(const search_engine_t* engine) {
     if (!engine) return 0;
-    return engine->meta_count;
+    pthread_rwlock_t* lock = (pthread_rwlock_t*)&engine->graph_lock;
+    pthread_rwlock_rdlock(lock);
+    size_t count = engine->indexed_count;
+    pthread_rwlock_unlock(lock);
+    return count;
+}
+
+void search_engine_get_stats(const search_engine_t* engine, search_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!engine) return;
+
+    stats->parallel_searches = atomic_load(&engine->parallel_searches);
+    stats->serial_fallbacks = atomic_load(&engine->serial_fallbacks);
+    stats->coarse_searches = atomic_load(&engine->coarse_searches);
+    stats->coarse_scans = atomic_load(&engine->coarse_scans);
+    stats->filter_scans = atomic_load(&engine->filter_scans);
+    stats->filter_graph_searches = atomic_load(&engine->filter_graph_searches);
+    stats->segments_pruned = atomic_load(&engine->segments_pruned);
+    stats->segment_merges = atomic_load(&engine->segment_merges);
+    stats->fresh_merged = atomic_load(&engine->fresh_merged);
+    stats->fresh_overflows = atomic_load(&engine->fresh_overflows);
+    if (engine->merger_running) {
+        pthread_mutex_t* lock = (pthread_mutex_t*)&engine->fresh_lock;
+        pthread_mutex_lock(lock);
+        stats->fresh_vectors = engine->fresh.count;
+        pthread_mutex_unlock(lock);
+    }
+    pthread_rwlock_t* graph_lock = (pthread_rwlock_t*)&engine->graph_lock;
+    pthread_rwlock_rdlock(graph_lock);
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        stats->segments += engine->levels[level].count;
+    }
+    pthread_rwlock_unlock(graph_lock);
+
+    result_cache_stats_t cache_stats;
+    result_cache_get_stats(engine->cache, &cache_stats);
+    stats->cache_hits = cache_stats.hits;
+    stats->cache_misses = cache_stats.misses;
+    stats->cache_evictions = cache_stats.evictions;
+}
+
+bool search_engine_cache_lookup(search_engine_t* engine,
+                                search_cache_query_t* query,
+                                search_match_t* results,
+                                size_t* result_count) {
+    if (!engine || !query) return false;
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        query->generations[level] = atomic_load(&engine->generation[level]);
+    }
+    return result_cache_get(engine->cache, query, results, query->k, result_count);
+}
+
+void search_engine_cache_store(search_engine_t* engine,
+                               const search_cache_query_t* query,
+                               const search_match_t* results,
+                               size_t result_count) {
+    if (!engine || !engine->cache || !query) return;
+
+    if (result_cache_put(engine->cache, query, results, result_count) != MEM_OK) {
+        LOG_WARN("Failed to cache search results");
+    }
+}
+
+/* ========== Token Budget ========== */
+
+/* Fallback cost for nodes whose token count was never recorded */
+static size_t estimated_tokens(hierarchy_level_t level) {
+    switch (level) {
+        case LEVEL_STATEMENT: return 50;
+        case LEVEL_BLOCK:     return 200;
+        case LEVEL_MESSAGE:   return 500;
+        case LEVEL_SESSION:   return 1000;
+        default:              return 100;
+    }
+}
+
+/* Budget item: one result with its cost and value */
+typedef struct {
+    size_t index;             /* Position in results */
+    size_t cost;
+    float value;
+} budget_item_t;
+
+static int compare_density(const void* a, const void* b) {
+    const budget_item_t* ia = a;
+    const budget_item_t* ib = b;
+    /* value/cost descending, compared by cross-multiplying */
+    double da = (double)ia->value * (double)ib->cost;
+    double db = (double)ib->value * (double)ia->cost;
+    if (da != db) return da > db ? -1 : 1;
+    return ia->index < ib->index ? -1 : (ia->index > ib->index ? 1 : 0);
+}
+
+/* True if ancestor is a proper ancestor of node */
+static bool is_ancestor(const hierarchy_t* h, node_id_t ancestor, node_id_t node) {
+    size_t count = hierarchy_count(h);
+    if (ancestor >= count || node >= count || ancestor == node) return false;
+
+    hierarchy_level_t level = hierarchy_get_level(h, ancestor);
+    node_id_t cur = hierarchy_get_parent(h, node);
+    while (cur != NODE_ID_INVALID && cur < count && hierarchy_get_level(h, cur) <= level) {
+        if (cur == ancestor) return true;
+        cur = hierarchy_get_parent(h, cur);
+    }
+    return false;
 }
 
 mem_error_t search_apply_budget(hierarchy_t* hierarchy,
@@ -494,26 +2361,98 @@ mem_error_t search_apply_budget(hierarchy_t* hierarchy,
     MEM_CHECK_ERR(results != NULL, MEM_ERR_INVALID_ARG, "results is NULL");
     MEM_CHECK_ERR(final_count != NULL, MEM_ERR_INVALID_ARG, "final_count is NULL");
 
-    size_t total_tokens = 0;
     *final_count = 0;
+    if (count == 0) return MEM_OK;
+
+    budget_item_t* items = malloc(count * sizeof(budget_item_t));
+    bool* chosen = calloc(count, sizeof(bool));
+    search_match_t* ordered = malloc(count * sizeof(search_match_t));
+    if (!items || !chosen || !ordered) {
+        free(items);
+        free(chosen);
+        free(ordered);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate budget state");
+    }
 
+    /* Cost from the ingest-time token count column, value from the score */
+    const columns_store_t* columns = hierarchy_get_columns(hierarchy);
     for (size_t i = 0; i < count; i++) {
-        size_t est_tokens;
-        switch (results[i].level) {
-            case LEVEL_STATEMENT: est_tokens = 50;   break;
-            case LEVEL_BLOCK:     est_tokens = 200;  break;
-            case LEVEL_MESSAGE:   est_tokens = 500;  break;
-            case LEVEL_SESSION:   est_tokens = 1000; break;
-            default:              est_tokens = 100;  break;
+        size_t tokens = columns_get_token_count(columns, results[i].node_id);
+        float score = results[i].score;
+        items[i] = (budget_item_t){
+            .index = i,
+            .cost = tokens ? tokens : estimated_tokens(results[i].level),
+            .value = (isnan(score) || score <= 0.0f) ? 1e-6f : score
+        };
+    }
+    qsort(items, count, sizeof(budget_item_t), compare_density);
+
+    /*
+     * Greedy by value density. A node covered by a chosen ancestor adds
+     * nothing; choosing a parent releases the budget of its chosen
+     * descendants, so one parent can replace many children.
+     */
+    size_t used = 0;
+    float total_value = 0.0f;
+    for (size_t n = 0; n < count; n++) {
+        const budget_item_t* item = &items[n];
+        node_id_t id = results[item->index].node_id;
+
+        bool covered = false;
+        size_t released = 0;
+        float released_value = 0.0f;
+        for (size_t m = 0; m < n && !covered; m++) {
+            if (!chosen[items[m].index]) continue;
+            node_id_t other = results[items[m].index].node_id;
+            if (is_ancestor(hierarchy, other, id)) {
+                covered = true;
+            } else if (is_ancestor(hierarchy, id, other)) {
+                released += items[m].cost;
+                released_value += items[m].value;
+            }
+        }
+        if (covered || used - released + item->cost > budget) continue;
+
+        for (size_t m = 0; m < n && released > 0; m++) {
+            if (chosen[items[m].index] &&
+                is_ancestor(hierarchy, id, results[items[m].index].node_id)) {
+                chosen[items[m].index] = false;
+            }
         }
+        chosen[item->index] = true;
+        used = used - released + item->cost;
+        /* A parent keeps its descendants' content, so it is worth at least them */
+        total_value += (item->value > released_value ? item->value : released_value) -
+                       released_value;
+    }
 
-        if (total_tokens + est_tokens > budget) {
-            break;
+    /* Greedy can lose to one large item; keep the better of the two */
+    size_t best = count;
+    for (size_t n = 0; n < count; n++) {
+        if (items[n].cost <= budget && items[n].value > total_value &&
+            (best == count || items[n].value > items[best].value)) {
+            best = n;
         }
+    }
+    if (best < count) {
+        memset(chosen, 0, count * sizeof(bool));
+        chosen[items[best].index] = true;
+    }
 
-        total_tokens += est_tokens;
-        (*final_count)++;
+    /* Kept results first, in their original rank order */
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (chosen[i]) ordered[kept++] = results[i];
+    }
+    size_t rest = kept;
+    for (size_t i = 0; i < count; i++) {
+        if (!chosen[i]) ordered[rest++] = results[i];
     }
+    memcpy(results, ordered, count * sizeof(search_match_t));
+    *final_count = kept;
 
+    free(items);
+    free(chosen);
+    free(ordered);
     return MEM_OK;
 }
@@ -26,6 +26,16 @@ typedef struct {
     float level_weight;       /* Weight for hierarchy level (default: 0.1) */
     size_t max_candidates;    /* Max candidates per search type (default: 100) */
     size_t token_budget;      /* Max tokens in response (default: 4096) */
+    size_t parallel_fanout;   /* Concurrent level searches per query (0/1 = serial) */
+    size_t parallel_threads;  /* Shared worker threads (0 = online CPUs - 1) */
+    size_t result_cache_entries; /* Cached query results (0 = disabled) */
+    size_t coarse_top_n;      /* Coarse hits expanded in coarse-to-fine mode (default: 8) */
+    size_t coarse_scan_limit; /* Max subtree nodes scanned exactly before using HNSW (default: 4096) */
+    size_t filter_scan_limit; /* Max filtered nodes scanned exactly before using HNSW (default: 4096) */
+    uint64_t segment_span_ns; /* Time segment width for statement/block/message indexes (default: 1 day, 0 = one segment) */
+    size_t segment_limit;     /* Max segments per level; adjacent ones merge past it (default: 8, 0 = unbounded) */
+    uint64_t retention_ns;    /* Keep statement/block/message nodes indexed this long (default: 0 = forever) */
+    size_t fresh_buffer_capacity; /* New vectors buffered ahead of HNSW (default: 4096, 0 = add synchronously) */
 } search_config_t;
 
 /* Default configuration */
@@ -36,7 +46,51 @@ typedef struct {
     .relevance_weight = 0.6f, \
     .level_weight = 0.1f, \
     .max_candidates = 100, \
-    .token_budget = 4096 \
+    .token_budget = 4096, \
+    .parallel_fanout = 0, \
+    .parallel_threads = 0, \
+    .result_cache_entries = 256, \
+    .coarse_top_n = 8, \
+    .coarse_scan_limit = 4096, \
+    .filter_scan_limit = 4096, \
+    .segment_span_ns = 86400ULL * 1000000000ULL, \
+    .segment_limit = 8, \
+    .retention_ns = 0, \
+    .fresh_buffer_capacity = 4096 \
+}
+
+/* Search mode */
+typedef enum {
+    SEARCH_MODE_FLAT = 0,         /* Search every requested level independently */
+    SEARCH_MODE_COARSE_TO_FINE    /* Search coarse level, then only its top subtrees */
+} search_mode_t;
+
+/*
+ * Effective coarse level. LEVEL_STATEMENT, the zero value, selects
+ * LEVEL_MESSAGE: the deepest level ingest always embeds above blocks.
+ */
+static inline hierarchy_level_t search_coarse_level(hierarchy_level_t coarse_level) {
+    return coarse_level == LEVEL_STATEMENT ? LEVEL_MESSAGE : coarse_level;
+}
+
+/*
+ * Result filter, applied inside the semantic and exact legs. Agent and
+ * session are node IDs (NODE_ID_INVALID = any); times are created_at
+ * bounds in ns (0 = unbounded), after inclusive and before exclusive.
+ */
+typedef struct {
+    node_id_t agent;
+    node_id_t session;
+    timestamp_ns_t after_time;
+    timestamp_ns_t before_time;
+} search_filter_t;
+
+/* Filter that accepts every node */
+#define SEARCH_FILTER_NONE { \
+    .agent = NODE_ID_INVALID, \
+    .session = NODE_ID_INVALID, \
+    .after_time = 0, \
+    .before_time = 0 \
 }
 
 /* Internal search result (different from API search_match_t) */
@@ -49,6 +103,25 @@ typedef struct {
     uint64_t timestamp;       /* For recency calculation */
 } search_match_t;
 
+/* Search engine counters */
+typedef struct {
+    uint64_t parallel_searches;   /* Queries that fanned out across workers */
+    uint64_t serial_fallbacks;    /* Parallel-eligible queries run serially under load */
+    uint64_t cache_hits;          /* Result cache hits */
+    uint64_t cache_misses;        /* Result cache misses (including stale entries) */
+    uint64_t cache_evictions;     /* Result cache LRU evictions */
+    uint64_t coarse_searches;     /* Coarse-to-fine queries */
+    uint64_t coarse_scans;        /* Coarse-to-fine queries answered by exact subtree scan */
+    uint64_t filter_scans;        /* Filtered queries answered by exact scan of the subset */
+    uint64_t filter_graph_searches; /* Filtered queries answered by filtered HNSW */
+    uint64_t segments;            /* Live HNSW time segments across all levels */
+    uint64_t segments_pruned;     /* Segment searches skipped by a time filter */
+    uint64_t segment_merges;      /* Segments merged into a neighbour by segment_limit */
+    uint64_t fresh_vectors;       /* Vectors waiting in the fresh-write buffer */
+    uint64_t fresh_merged;        /* Buffered vectors merged into HNSW */
+    uint64_t fresh_overflows;     /* Adds done synchronously because the buffer was full */
+} search_stats_t;
+
 /* Search query */
 typedef struct {
     const float* embedding;   /* Query embedding (EMBEDDING_DIM floats) */
@@ -57,8 +130,30 @@ typedef struct {
     size_t k;                 /* Max results to return */
     hierarchy_level_t min_level;  /* Minimum hierarchy level to search */
     hierarchy_level_t max_level;  /* Maximum hierarchy level to search */
+    search_mode_t mode;           /* Flat (default) or coarse-to-fine */
+    hierarchy_level_t coarse_level; /* Coarse-to-fine: level searched first (STATEMENT = message) */
+    size_t coarse_top_n;          /* Coarse-to-fine: subtrees to expand (0 = config default) */
+    const search_filter_t* filter;  /* Agent/session/time filter (NULL = none) */
 } search_query_t;
 
+/*
+ * Result cache key. The fingerprint is the normalized query text plus the
+ * level range, k, search mode and filter; generations is filled in by
+ * search_engine_cache_lookup.
+ */
+typedef struct {
+    const char* text;         /* Raw query text */
+    size_t text_len;
+    hierarchy_level_t min_level;
+    hierarchy_level_t max_level;
+    size_t k;
+    search_mode_t mode;
+    hierarchy_level_t coarse_level;
+    size_t coarse_top_n;
+    const search_filter_t* filter;      /* NULL = none */
+    uint64_t generations[LEVEL_COUNT];  /* Index generation per level */
+} search_cache_query_t;
+
 /*
  * Create a search engine
  */
@@ -74,6 +169,10 @@ void search_engine_destroy(search_engine_t* engine);
 /*
  * Index a node (add to HNSW and inverted index)
  *
+ * New vectors go to the fresh-write buffer, which queries scan exactly,
+ * and a background thread merges them into HNSW. They are searchable as
+ * soon as this returns.
+ *
  * @param engine    Search engine
  * @param node_id   Node to index
  * @param embedding Embedding vector
@@ -90,6 +189,38 @@ mem_error_t search_engine_index(search_engine_t* engine, node_id_t node_id,
  */
 mem_error_t search_engine_remove(search_engine_t* engine, node_id_t node_id);
 
+/*
+ * Drop index segments that end at or before cutoff
+ *
+ * Statement, block and message nodes created before cutoff (rounded
+ * down to a segment boundary) leave the index a whole segment at a
+ * time: the segment's HNSW graph is freed instead of tombstoning each
+ * node. A merged segment reaching past the boundary is kept until it
+ * expires entirely. Sessions and agents stay indexed; hierarchy storage
+ * is untouched.
+ *
+ * @param engine  Search engine
+ * @param cutoff  Retention cutoff (created_at, ns)
+ * @param dropped Output: number of nodes removed from the index (may be NULL)
+ */
+mem_error_t search_engine_drop_before(search_engine_t* engine, timestamp_ns_t cutoff,
+                                      size_t* dropped);
+
+/*
+ * Apply the configured retention window
+ *
+ * Drops what search_engine_drop_before(now - retention_ns) would; a no-op
+ * when retention_ns or segment_span_ns is 0. The cutoff is not stored:
+ * an engine created with a retention window skips nodes older than it
+ * while rebuilding, so expired nodes stay out of the index after a restart.
+ *
+ * @param engine  Search engine
+ * @param now     Current time (ns)
+ * @param dropped Output: number of nodes removed from the index (may be NULL)
+ */
+mem_error_t search_engine_expire(search_engine_t* engine, timestamp_ns_t now,
+                                 size_t* dropped);
+
 /*
  * Perform unified search
  *
@@ -103,6 +234,26 @@ mem_error_t search_engine_search(search_engine_t* engine,
                                  search_match_t* results,
                                  size_t* result_count);
 
+/*
+ * Look up cached results for a query
+ *
+ * Snapshots the current index generations into query->generations, so
+ * a following search_engine_cache_store is invalidated by any index or
+ * remove that races with the search. Returns true on a hit.
+ */
+bool search_engine_cache_lookup(search_engine_t* engine,
+                                search_cache_query_t* query,
+                                search_match_t* results,
+                                size_t* result_count);
+
+/*
+ * Cache results for a query previously passed to search_engine_cache_lookup
+ */
+void search_engine_cache_store(search_engine_t* engine,
+                               const search_cache_query_t* query,
+                               const search_match_t* results,
+                               size_t result_count);
+
 /*
  * Perform semantic-only search
  */
@@ -119,16 +270,33 @@ mem_error_t search_engine_exact(search_engine_t* engine,
                                 size_t k, search_match_t* results,
                                 size_t* result_count);
 
+/*
+ * Wait until the merge thread has moved every buffered vector into HNSW
+ * and brought every level back within segment_limit
+ */
+void search_engine_flush(search_engine_t* engine);
+
 /*
  * Get search engine statistics
  */
 size_t search_engine_node_count(const search_engine_t* engine);
 
+/*
+ * Get search engine counters
+ */
+void search_engine_get_stats(const search_engine_t* engine, search_stats_t* stats);
+
 /*
  * Apply token budget constraint to results
  *
- * @param hierarchy   Hierarchy for text length lookup
- * @param results     Results to filter
+ * Picks a high-value set of results (by score) whose token counts fit
+ * the budget: greedy by score per token, where a chosen parent covers
+ * and replaces its descendants. Costs come from the token count column
+ * recorded at ingest, with a per-level estimate for nodes without one.
+ * Results are reordered so the kept ones come first, in rank order.
+ *
+ * @param hierarchy   Hierarchy for token counts and ancestry
+ * @param results     Results to filter (reordered in place)
  * @param count       Number of results
  * @param budget      Token budget
  * @param final_count Output: number of results within budget
@@ -0,0 +1,529 @@
+/*
+ * Memory Service - Asynchronous File I/O Implementation
+ *
+ * The io_uring backend talks to the kernel through the raw system calls
+ * and the shared rings, so no library is needed. Only the submitter
+ * writes the submission ring (under the lock) and only the completion
+ * thread reads the completion ring. At most cq_entries operations are in
+ * flight, so completions can never overflow their ring.
+ */
+
+#include "aio.h"
+#include "../util/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define AIO_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef AIO_HAVE_IO_URING
+/* One submitted operation of a request */
+typedef struct aio_op {
+    struct aio_request* req;
+    size_t              len;        /* Bytes a write must complete */
+    bool                is_sync;
+} aio_op_t;
+
+/* A write (or sync) and its linked operations */
+typedef struct aio_request {
+    aio_t*          aio;
+    int             fd;
+    struct iovec*   iov;            /* Copy, for the blocking redo */
+    int             iovcnt;
+    off_t           offset;
+    size_t          len;
+    bool            datasync;
+    aio_done_fn     done;
+    void*           arg;
+    unsigned        pending;        /* Operations not yet completed */
+    bool            failed;         /* An operation failed or came up short */
+    aio_op_t        ops[];
+} aio_request_t;
+#endif
+
+struct aio {
+    aio_backend_t   backend;
+    pthread_mutex_t lock;
+    pthread_cond_t  idle;           /* Operations completed */
+    aio_stats_t     stats;
+
+#ifdef AIO_HAVE_IO_URING
+    int             ring_fd;
+    pthread_t       thread;
+    unsigned        inflight;       /* Operations submitted, not yet reaped */
+
+    void*           sq_ptr;
+    size_t          sq_len;
+    void*           cq_ptr;
+    size_t          cq_len;
+    struct io_uring_sqe* sqes;
+    size_t          sqes_len;
+
+    unsigned*       sq_head;
+    unsigned*       sq_tail;
+    unsigned*       sq_mask;
+    unsigned*       sq_array;
+    unsigned        sq_entries;
+
+    unsigned*       cq_head;
+    unsigned*       cq_tail;
+    unsigned*       cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned        cq_entries;
+#endif
+};
+
+/* Write all of iov at offset, resuming after short writes */
+static mem_error_t write_all(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+    size_t skip = 0;    /* Bytes of iov[0] already written */
+
+    while (iovcnt > 0) {
+        if (iov->iov_len == skip) {
+            iov++;
+            iovcnt--;
+            skip = 0;
+            continue;
+        }
+
+        ssize_t n = skip > 0
+            ? pwrite(fd, (const char*)iov->iov_base + skip, iov->iov_len - skip, offset)
+            : pwritev(fd, iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            MEM_RETURN_ERROR(MEM_ERR_WRITE, "write failed: %s", n < 0 ? strerror(errno) : "no progress");
+        }
+        offset += n;
+
+        size_t left = (size_t)n + skip;
+        skip = 0;
+        while (iovcnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        skip = left;
+    }
+    return MEM_OK;
+}
+
+/* The request done with blocking calls */
+static mem_error_t run_blocking(int fd, const struct iovec* iov, int iovcnt,
+                                off_t offset, bool datasync) {
+    MEM_CHECK(write_all(fd, iov, iovcnt, offset));
+    if (datasync && fdatasync(fd) < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_SYNC, "fdatasync failed: %s", strerror(errno));
+    }
+    return MEM_OK;
+}
+
+static size_t iov_bytes(const struct iovec* iov, int iovcnt) {
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) len += iov[i].iov_len;
+    return len;
+}
+
+static void count_request(aio_t* a, size_t bytes, bool fallback) {
+    pthread_mutex_lock(&a->lock);
+    a->stats.requests++;
+    a->stats.bytes += bytes;
+    if (fallback) a->stats.fallbacks++;
+    pthread_mutex_unlock(&a->lock);
+}
+
+static mem_error_t submit_blocking(aio_t* a, int fd, const struct iovec* iov, int iovcnt,
+                                   off_t offset, bool datasync, aio_done_fn done, void* arg,
+                                   bool fallback) {
+    mem_error_t err = run_blocking(fd, iov, iovcnt, offset, datasync);
+    count_request(a, iov_bytes(iov, iovcnt), fallback);
+    done(arg, err);
+    return MEM_OK;
+}
+
+#ifdef AIO_HAVE_IO_URING
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static mem_error_t uring_setup(aio_t* a, unsigned depth) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    int fd = (int)syscall(__NR_io_uring_setup, depth, &p);
+    if (fd < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "io_uring_setup failed: %s", strerror(errno));
+    }
+    a->ring_fd = fd;
+
+    a->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    a->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        if (a->cq_len > a->sq_len) a->sq_len = a->cq_len;
+        a->cq_len = a->sq_len;
+    }
+
+    a->sq_ptr = mmap(NULL, a->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    if (a->sq_ptr == MAP_FAILED) {
+        a->sq_ptr = NULL;
+        MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to map io_uring submission ring");
+    }
+    if (single) {
+        a->cq_ptr = a->sq_ptr;
+    } else {
+        a->cq_ptr = mmap(NULL, a->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+        if (a->cq_ptr == MAP_FAILED) {
+            a->cq_ptr = NULL;
+            MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to map io_uring completion ring");
+        }
+    }
+
+    a->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    a->sqes = mmap(NULL, a->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   fd, IORING_OFF_SQES);
+    if (a->sqes == MAP_FAILED) {
+        a->sqes = NULL;
+        MEM_RETURN_ERROR(MEM_ERR_MMAP, "failed to map io_uring submission entries");
+    }
+
+    char* sq = a->sq_ptr;
+    a->sq_head = (unsigned*)(sq + p.sq_off.head);
+    a->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    a->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    a->sq_array = (unsigned*)(sq + p.sq_off.array);
+    a->sq_entries = p.sq_entries;
+
+    char* cq = a->cq_ptr;
+    a->cq_head = (unsigned*)(cq + p.cq_off.head);
+    a->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    a->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    a->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    a->cq_entries = p.cq_entries;
+
+    return MEM_OK;
+}
+
+static void uring_teardown(aio_t* a) {
+    if (a->sqes) munmap(a->sqes, a->sqes_len);
+    if (a->cq_ptr && a->cq_ptr != a->sq_ptr) munmap(a->cq_ptr, a->cq_len);
+    if (a->sq_ptr) munmap(a->sq_ptr, a->sq_len);
+    if (a->ring_fd >= 0) close(a->ring_fd);
+    a->sqes = NULL;
+    a->cq_ptr = a->sq_ptr = NULL;
+    a->ring_fd = -1;
+}
+
+/* Claim the next submission entry; caller holds the lock and checked space */
+static struct io_uring_sqe* next_sqe(aio_t* a, unsigned* tail) {
+    unsigned idx = *tail & *a->sq_mask;
+    struct io_uring_sqe* sqe = &a->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    a->sq_array[idx] = idx;
+    (*tail)++;
+    return sqe;
+}
+
+/*
+ * Publish entries up to tail and have the kernel take them. Returns false
+ * if it took none of them, in which case they are withdrawn.
+ */
+static bool uring_publish(aio_t* a, unsigned start, unsigned tail) {
+    __atomic_store_n(a->sq_tail, tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        unsigned head = __atomic_load_n(a->sq_head, __ATOMIC_ACQUIRE);
+        if (head == tail) return true;
+
+        int r = uring_enter(a->ring_fd, tail - head, 0, 0);
+        if (r >= 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+
+        head = __atomic_load_n(a->sq_head, __ATOMIC_ACQUIRE);
+        if (head == start) {
+            __atomic_store_n(a->sq_tail, start, __ATOMIC_RELEASE);
+            LOG_WARN("io_uring_enter failed: %s", strerror(errno));
+            return false;
+        }
+        /* Part went in; the rest is picked up by the next enter */
+        return true;
+    }
+}
+
+/* Returns MEM_ERR_FULL when the request should run with blocking calls */
+static mem_error_t uring_submit(aio_t* a, int fd, const struct iovec* iov, int iovcnt,
+                                off_t offset, bool datasync, aio_done_fn done, void* arg) {
+    unsigned writes = (unsigned)((iovcnt + IOV_MAX - 1) / IOV_MAX);
+    unsigned n = writes + (datasync ? 1 : 0);
+    if (n == 0 || n > a->sq_entries || n > a->cq_entries) return MEM_ERR_FULL;
+
+    aio_request_t* r = malloc(sizeof(aio_request_t) + n * sizeof(aio_op_t) +
+                              (size_t)iovcnt * sizeof(struct iovec));
+    MEM_CHECK_ALLOC(r);
+    r->aio = a;
+    r->fd = fd;
+    r->iov = (struct iovec*)&r->ops[n];
+    r->iovcnt = iovcnt;
+    r->offset = offset;
+    r->datasync = datasync;
+    r->done = done;
+    r->arg = arg;
+    r->pending = n;
+    r->failed = false;
+    if (iovcnt > 0) memcpy(r->iov, iov, (size_t)iovcnt * sizeof(struct iovec));
+    r->len = iov_bytes(r->iov, iovcnt);
+
+    pthread_mutex_lock(&a->lock);
+    while (a->inflight + n > a->cq_entries) {
+        pthread_cond_wait(&a->idle, &a->lock);
+    }
+
+    unsigned start = *a->sq_tail;
+    if (start - __atomic_load_n(a->sq_head, __ATOMIC_ACQUIRE) + n > a->sq_entries) {
+        pthread_mutex_unlock(&a->lock);
+        free(r);
+        return MEM_ERR_FULL;
+    }
+
+    unsigned tail = start;
+    off_t pos = offset;
+    for (unsigned w = 0; w < writes; w++) {
+        int first = (int)w * IOV_MAX;
+        int count = iovcnt - first < IOV_MAX ? iovcnt - first : IOV_MAX;
+        size_t len = iov_bytes(&r->iov[first], count);
+
+        r->ops[w] = (aio_op_t){ r, len, false };
+        struct io_uring_sqe* sqe = next_sqe(a, &tail);
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)&r->iov[first];
+        sqe->len = (uint32_t)count;
+        sqe->off = (uint64_t)pos;
+        sqe->user_data = (uint64_t)(uintptr_t)&r->ops[w];
+        if (w + 1 < n) sqe->flags = IOSQE_IO_LINK;
+        pos += (off_t)len;
+    }
+    if (datasync) {
+        r->ops[writes] = (aio_op_t){ r, 0, true };
+        struct io_uring_sqe* sqe = next_sqe(a, &tail);
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = (uint64_t)(uintptr_t)&r->ops[writes];
+    }
+
+    a->inflight += n;
+    bool taken = uring_publish(a, start, tail);
+    if (!taken) a->inflight -= n;
+    pthread_mutex_unlock(&a->lock);
+
+    if (!taken) {
+        free(r);
+        return MEM_ERR_FULL;
+    }
+    return MEM_OK;
+}
+
+/* All operations of r completed: redo it if needed and report */
+static void finish_request(aio_request_t* r) {
+    mem_error_t err = MEM_OK;
+    if (r->failed) {
+        err = run_blocking(r->fd, r->iov, r->iovcnt, r->offset, r->datasync);
+    }
+    count_request(r->aio, r->len, r->failed);
+    r->done(r->arg, err);
+    free(r);
+}
+
+static void* completion_main(void* arg) {
+    aio_t* a = arg;
+
+    for (;;) {
+        unsigned head = *a->cq_head;
+        unsigned tail = __atomic_load_n(a->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (uring_enter(a->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                LOG_ERROR("io_uring wait failed: %s", strerror(errno));
+                usleep(1000);
+            }
+            continue;
+        }
+
+        /* Requests are published under the lock; taking it orders their
+         * fields before this thread's reads in terms race checkers see */
+        pthread_mutex_lock(&a->lock);
+        pthread_mutex_unlock(&a->lock);
+
+        bool stop = false;
+        unsigned reaped = 0;
+        for (; head != tail; head++, reaped++) {
+            const struct io_uring_cqe* cqe = &a->cqes[head & *a->cq_mask];
+            aio_op_t* op = (aio_op_t*)(uintptr_t)cqe->user_data;
+            if (!op) {
+                stop = true;
+                continue;
+            }
+
+            aio_request_t* r = op->req;
+            if (cqe->res < 0 || (!op->is_sync && (size_t)cqe->res != op->len)) {
+                r->failed = true;
+            }
+            if (--r->pending == 0) finish_request(r);
+        }
+        __atomic_store_n(a->cq_head, head, __ATOMIC_RELEASE);
+
+        pthread_mutex_lock(&a->lock);
+        a->inflight -= reaped;
+        pthread_cond_broadcast(&a->idle);
+        pthread_mutex_unlock(&a->lock);
+
+        if (stop) return NULL;
+    }
+}
+
+/*
+ * Wait for everything in flight, then stop the completion thread. Returns
+ * false if the stop could not be submitted; the thread then keeps the
+ * rings and they must not be unmapped.
+ */
+static bool uring_stop(aio_t* a) {
+    pthread_mutex_lock(&a->lock);
+    while (a->inflight > 0) {
+        pthread_cond_wait(&a->idle, &a->lock);
+    }
+
+    unsigned start = *a->sq_tail;
+    unsigned tail = start;
+    struct io_uring_sqe* sqe = next_sqe(a, &tail);
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = 0;
+    a->inflight = 1;
+    bool taken = uring_publish(a, start, tail);
+    pthread_mutex_unlock(&a->lock);
+
+    if (!taken) {
+        LOG_ERROR("failed to stop io_uring completion thread");
+        pthread_detach(a->thread);
+        return false;
+    }
+    pthread_join(a->thread, NULL);
+    return true;
+}
+
+#endif /* AIO_HAVE_IO_URING */
+
+mem_error_t aio_create(aio_t** aio, aio_backend_t backend, unsigned depth) {
+    MEM_CHECK_ERR(aio != NULL, MEM_ERR_INVALID_ARG, "aio pointer is NULL");
+    MEM_CHECK_ERR(backend <= AIO_BACKEND_IO_URING, MEM_ERR_INVALID_ARG,
+                  "unknown backend %d", (int)backend);
+
+    aio_t* a = calloc(1, sizeof(aio_t));
+    MEM_CHECK_ALLOC(a);
+    a->backend = AIO_BACKEND_BLOCKING;
+
+    if (pthread_mutex_init(&a->lock, NULL) != 0) {
+        free(a);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init aio mutex");
+    }
+    if (pthread_cond_init(&a->idle, NULL) != 0) {
+        pthread_mutex_destroy(&a->lock);
+        free(a);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init aio condition");
+    }
+
+#ifdef AIO_HAVE_IO_URING
+    a->ring_fd = -1;
+    if (backend == AIO_BACKEND_IO_URING) {
+        mem_error_t err = uring_setup(a, depth ? depth : AIO_DEPTH_DEFAULT);
+        if (err == MEM_OK && pthread_create(&a->thread, NULL, completion_main, a) != 0) {
+            err = MEM_ERR_THREAD;
+        }
+        if (err == MEM_OK) {
+            a->backend = AIO_BACKEND_IO_URING;
+            LOG_DEBUG("io_uring ready: %u submission, %u completion entries",
+                      a->sq_entries, a->cq_entries);
+        } else {
+            uring_teardown(a);
+            LOG_WARN("io_uring unavailable, using blocking I/O");
+        }
+    }
+#else
+    (void)depth;
+    if (backend == AIO_BACKEND_IO_URING) {
+        LOG_WARN("io_uring not supported on this platform, using blocking I/O");
+    }
+#endif
+
+    *aio = a;
+    return MEM_OK;
+}
+
+void aio_destroy(aio_t* aio) {
+    if (!aio) return;
+
+#ifdef AIO_HAVE_IO_URING
+    if (aio->backend == AIO_BACKEND_IO_URING && !uring_stop(aio)) return;
+    uring_teardown(aio);
+#endif
+
+    pthread_cond_destroy(&aio->idle);
+    pthread_mutex_destroy(&aio->lock);
+    free(aio);
+}
+
+aio_backend_t aio_get_backend(const aio_t* aio) {
+    return aio ? aio->backend : AIO_BACKEND_BLOCKING;
+}
+
+const char* aio_backend_name(aio_backend_t backend) {
+    switch (backend) {
+        case AIO_BACKEND_IO_URING: return "io_uring";
+        default:                   return "blocking";
+    }
+}
+
+mem_error_t aio_write(aio_t* aio, int fd, const struct iovec* iov, int iovcnt,
+                      off_t offset, bool datasync, aio_done_fn done, void* arg) {
+    MEM_CHECK_ERR(aio != NULL, MEM_ERR_INVALID_ARG, "aio is NULL");
+    MEM_CHECK_ERR(iov != NULL || iovcnt == 0, MEM_ERR_INVALID_ARG, "iov is NULL");
+    MEM_CHECK_ERR(iovcnt >= 0, MEM_ERR_INVALID_ARG, "negative iovcnt");
+    MEM_CHECK_ERR(done != NULL, MEM_ERR_INVALID_ARG, "done is NULL");
+
+#ifdef AIO_HAVE_IO_URING
+    if (aio->backend == AIO_BACKEND_IO_URING) {
+        mem_error_t err = uring_submit(aio, fd, iov, iovcnt, offset, datasync, done, arg);
+        if (err != MEM_ERR_FULL) return err;
+        return submit_blocking(aio, fd, iov, iovcnt, offset, datasync, done, arg, true);
+    }
+#endif
+
+    return submit_blocking(aio, fd, iov, iovcnt, offset, datasync, done, arg, false);
+}
+
+mem_error_t aio_fsync(aio_t* aio, int fd, aio_done_fn done, void* arg) {
+    return aio_write(aio, fd, NULL, 0, 0, true, done, arg);
+}
+
+void aio_get_stats(aio_t* aio, aio_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!aio) return;
+
+    pthread_mutex_lock(&aio->lock);
+    *stats = aio->stats;
+    pthread_mutex_unlock(&aio->lock);
+}
@@ -0,0 +1,80 @@
+/*
+ * Memory Service - Asynchronous File I/O
+ *
+ * Submits positioned writes, optionally followed by a linked fdatasync,
+ * and reports each request's outcome to a callback. The io_uring backend
+ * (Linux) hands requests to the kernel and runs callbacks on a single
+ * completion thread, so the submitter never waits for the disk and many
+ * requests can be in flight at once. The blocking backend performs the
+ * same calls inline and runs the callback before returning; it is used
+ * where io_uring is unavailable or refused, and by choice.
+ *
+ * A request whose writes come up short or fail is redone with blocking
+ * calls on the completion thread before its callback runs, so callers
+ * see one result per request either way.
+ */
+
+#ifndef MEMORY_SERVICE_AIO_H
+#define MEMORY_SERVICE_AIO_H
+
+#include "../../include/error.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Forward declaration */
+typedef struct aio aio_t;
+
+/* I/O backends */
+typedef enum {
+    AIO_BACKEND_BLOCKING = 0,       /* pwritev + fdatasync on the caller */
+    AIO_BACKEND_IO_URING            /* io_uring with a completion thread */
+} aio_backend_t;
+
+/* Default queue depth for io_uring */
+#define AIO_DEPTH_DEFAULT 64
+
+/* Completion callback: err is MEM_OK once the request is done (and synced) */
+typedef void (*aio_done_fn)(void* arg, mem_error_t err);
+
+/* Counters */
+typedef struct {
+    uint64_t    requests;           /* Requests completed */
+    uint64_t    bytes;              /* Bytes written */
+    uint64_t    fallbacks;          /* Requests redone or run with blocking calls */
+} aio_stats_t;
+
+/*
+ * Create an I/O context. Asking for io_uring on a system that lacks or
+ * refuses it gives a blocking context; check aio_get_backend. depth 0
+ * selects AIO_DEPTH_DEFAULT.
+ */
+mem_error_t aio_create(aio_t** aio, aio_backend_t backend, unsigned depth);
+
+/* Wait for every submitted request to complete, then free */
+void aio_destroy(aio_t* aio);
+
+/* Backend in use */
+aio_backend_t aio_get_backend(const aio_t* aio);
+
+/* Backend name for logs and options */
+const char* aio_backend_name(aio_backend_t backend);
+
+/*
+ * Write iov at offset in fd, then fdatasync it if datasync is set. fd and
+ * the memory iov describes must stay valid until done runs; the iov array
+ * itself may be reused once this returns. On MEM_OK, done runs exactly
+ * once, possibly before this returns; on error it does not run.
+ */
+mem_error_t aio_write(aio_t* aio, int fd, const struct iovec* iov, int iovcnt,
+                      off_t offset, bool datasync, aio_done_fn done, void* arg);
+
+/* fdatasync fd; done runs as for aio_write */
+mem_error_t aio_fsync(aio_t* aio, int fd, aio_done_fn done, void* arg);
+
+/* Get counters */
+void aio_get_stats(aio_t* aio, aio_stats_t* stats);
+
+#endif /* MEMORY_SERVICE_AIO_H */
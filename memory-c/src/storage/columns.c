@@ -0,0 +1,399 @@
+/*
+ * Memory Service - Node Columns Storage Implementation
+ */
+
+#include "columns.h"
+#include "../util/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+
+/* File names */
+#define CREATED_AT_FILE "created_at.bin"
+#define TOKEN_COUNT_FILE "token_count.bin"
+#define LEVEL_FILE "level.bin"
+#define AGENT_FILE "agent.bin"
+#define SESSION_FILE "session.bin"
+
+/* Header at start of each file */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t capacity;
+} columns_header_t;
+
+#define COLUMNS_MAGIC 0x434F4C30  /* "COL0" */
+#define COLUMNS_VERSION 1
+#define HEADER_SIZE sizeof(columns_header_t)
+
+/* Scoring loops stream whole columns */
+#define COLUMNS_ARENA_FLAGS ARENA_FLAG_SEQUENTIAL
+
+/* Open or create arena for one column */
+static mem_error_t open_column_arena(arena_t** arena, const char* dir,
+                                     const char* filename, size_t capacity,
+                                     size_t element_size, uint8_t fill, bool create) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, filename);
+
+    if (create) {
+        MEM_CHECK(arena_create_mmap(arena, path, HEADER_SIZE + capacity * element_size,
+                                    COLUMNS_ARENA_FLAGS));
+
+        columns_header_t* hdr = arena_alloc(*arena, HEADER_SIZE);
+        MEM_CHECK_ALLOC(hdr);
+
+        hdr->magic = COLUMNS_MAGIC;
+        hdr->version = COLUMNS_VERSION;
+        hdr->count = 0;
+        hdr->capacity = (uint32_t)capacity;
+
+        void* data = arena_alloc(*arena, capacity * element_size);
+        MEM_CHECK_ALLOC(data);
+        memset(data, fill, capacity * element_size);
+    } else {
+        MEM_CHECK(arena_open_mmap(arena, path, COLUMNS_ARENA_FLAGS));
+
+        columns_header_t* hdr = arena_get_ptr(*arena, 0);
+        if (!hdr || hdr->magic != COLUMNS_MAGIC || hdr->version != COLUMNS_VERSION) {
+            arena_destroy(*arena);
+            *arena = NULL;
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid column file %s", filename);
+        }
+    }
+
+    /* Room for every node id, so growth never moves the mapping under readers */
+    mem_error_t err = arena_reserve(*arena, HEADER_SIZE + (size_t)NODE_ID_INVALID * element_size);
+    if (err != MEM_OK) {
+        arena_destroy(*arena);
+        *arena = NULL;
+        return err;
+    }
+    return MEM_OK;
+}
+
+static void close_arenas(columns_store_t* s) {
+    if (s->created_at_arena) arena_destroy(s->created_at_arena);
+    if (s->token_count_arena) arena_destroy(s->token_count_arena);
+    if (s->level_arena) arena_destroy(s->level_arena);
+    if (s->agent_arena) arena_destroy(s->agent_arena);
+    if (s->session_arena) arena_destroy(s->session_arena);
+}
+
+static mem_error_t open_all(columns_store_t* s, const char* dir,
+                            size_t capacity, bool create) {
+    /* 0xFF fill makes node_id columns start as NODE_ID_INVALID */
+    MEM_CHECK(open_column_arena(&s->created_at_arena, dir, CREATED_AT_FILE,
+                                capacity, sizeof(timestamp_ns_t), 0, create));
+    MEM_CHECK(open_column_arena(&s->token_count_arena, dir, TOKEN_COUNT_FILE,
+                                capacity, sizeof(uint32_t), 0, create));
+    MEM_CHECK(open_column_arena(&s->level_arena, dir, LEVEL_FILE,
+                                capacity, sizeof(uint8_t), 0, create));
+    MEM_CHECK(open_column_arena(&s->agent_arena, dir, AGENT_FILE,
+                                capacity, sizeof(node_id_t), 0xFF, create));
+    MEM_CHECK(open_column_arena(&s->session_arena, dir, SESSION_FILE,
+                                capacity, sizeof(node_id_t), 0xFF, create));
+    return MEM_OK;
+}
+
+mem_error_t columns_create(columns_store_t** store, const char* dir,
+                           size_t initial_capacity) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
+    MEM_CHECK_ERR(initial_capacity > 0, MEM_ERR_INVALID_ARG, "capacity must be > 0");
+
+    columns_store_t* s = calloc(1, sizeof(columns_store_t));
+    MEM_CHECK_ALLOC(s);
+
+    s->base_dir = strdup(dir);
+    if (!s->base_dir) {
+        free(s);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
+    }
+
+    mem_error_t err = open_all(s, dir, initial_capacity, true);
+    if (err != MEM_OK) {
+        close_arenas(s);
+        free(s->base_dir);
+        free(s);
+        return err;
+    }
+
+    s->count = 0;
+    s->capacity = initial_capacity;
+
+    *store = s;
+    LOG_INFO("Column store created at %s with capacity %zu", dir, initial_capacity);
+    return MEM_OK;
+}
+
+/* Rows a column file holds */
+static size_t file_capacity(const arena_t* arena, size_t element_size) {
+    size_t size = arena_size(arena);
+    return size > HEADER_SIZE ? (size - HEADER_SIZE) / element_size : 0;
+}
+
+/*
+ * After a crash the created_at header may count rows another file never
+ * got; use only what every file holds and leave the rest to WAL replay.
+ */
+static void clamp_to_files(columns_store_t* s) {
+    const struct { const arena_t* arena; size_t element_size; } files[] = {
+        { s->created_at_arena, sizeof(timestamp_ns_t) },
+        { s->token_count_arena, sizeof(uint32_t) },
+        { s->level_arena, sizeof(uint8_t) },
+        { s->agent_arena, sizeof(node_id_t) },
+        { s->session_arena, sizeof(node_id_t) },
+    };
+
+    size_t capacity = s->capacity;
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        size_t held = file_capacity(files[i].arena, files[i].element_size);
+        if (held < capacity) capacity = held;
+    }
+    if (capacity == s->capacity && s->count <= capacity) return;
+
+    LOG_WARN("Column header claims %zu of %zu rows, files hold %zu",
+             s->count, s->capacity, capacity);
+    s->capacity = capacity;
+    if (s->count > capacity) s->count = capacity;
+
+    columns_header_t* hdr = arena_get_ptr(s->created_at_arena, 0);
+    hdr->count = (uint32_t)s->count;
+    hdr->capacity = (uint32_t)s->capacity;
+    arena_mark_dirty(s->created_at_arena, 0, HEADER_SIZE);
+}
+
+mem_error_t columns_open(columns_store_t** store, const char* dir) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
+
+    columns_store_t* s = calloc(1, sizeof(columns_store_t));
+    MEM_CHECK_ALLOC(s);
+
+    s->base_dir = strdup(dir);
+    if (!s->base_dir) {
+        free(s);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
+    }
+
+    mem_error_t err = open_all(s, dir, 0, false);
+    if (err != MEM_OK) {
+        close_arenas(s);
+        free(s->base_dir);
+        free(s);
+        return err;
+    }
+
+    /* Count and capacity live in the created_at header */
+    columns_header_t* hdr = arena_get_ptr(s->created_at_arena, 0);
+    s->count = hdr->count;
+    s->capacity = hdr->capacity;
+    clamp_to_files(s);
+
+    *store = s;
+    LOG_INFO("Column store opened at %s with %zu rows", dir, s->count);
+    return MEM_OK;
+}
+
+/* Helper to get pointer to the first element of a column */
+static inline void* column_data(const arena_t* arena) {
+    return arena ? (char*)arena->base + HEADER_SIZE : NULL;
+}
+
+/* Record a written row for background writeback */
+static inline void mark_row(arena_t* arena, node_id_t node_id, size_t element_size) {
+    arena_mark_dirty(arena, HEADER_SIZE + node_id * element_size, element_size);
+}
+
+/* Extend one column file to capacity, filling the new rows */
+static mem_error_t grow_column_arena(arena_t* arena, size_t old_capacity,
+                                     size_t capacity, size_t element_size, uint8_t fill) {
+    /* A crash during an earlier grow may have left this file larger already */
+    size_t file_size = HEADER_SIZE + capacity * element_size;
+    if (arena_size(arena) < file_size) {
+        MEM_CHECK(arena_grow(arena, file_size));
+    }
+
+    memset((char*)column_data(arena) + old_capacity * element_size, fill,
+           (capacity - old_capacity) * element_size);
+
+    columns_header_t* hdr = arena_get_ptr(arena, 0);
+    hdr->capacity = (uint32_t)capacity;
+    arena_mark_dirty(arena, 0, HEADER_SIZE);
+    arena_mark_dirty(arena, HEADER_SIZE + old_capacity * element_size,
+                     (capacity - old_capacity) * element_size);
+    return MEM_OK;
+}
+
+/* Double capacity; created_at holds the authoritative header, so it goes last */
+static mem_error_t grow_columns(columns_store_t* store) {
+    size_t old_capacity = store->capacity;
+    size_t capacity = old_capacity * 2;
+    if (capacity > NODE_ID_INVALID) capacity = NODE_ID_INVALID;
+    if (capacity <= old_capacity) {
+        MEM_RETURN_ERROR(MEM_ERR_FULL, "column store at maximum capacity");
+    }
+
+    MEM_CHECK(grow_column_arena(store->token_count_arena, old_capacity, capacity,
+                                sizeof(uint32_t), 0));
+    MEM_CHECK(grow_column_arena(store->level_arena, old_capacity, capacity,
+                                sizeof(uint8_t), 0));
+    MEM_CHECK(grow_column_arena(store->agent_arena, old_capacity, capacity,
+                                sizeof(node_id_t), 0xFF));
+    MEM_CHECK(grow_column_arena(store->session_arena, old_capacity, capacity,
+                                sizeof(node_id_t), 0xFF));
+    MEM_CHECK(grow_column_arena(store->created_at_arena, old_capacity, capacity,
+                                sizeof(timestamp_ns_t), 0));
+
+    store->capacity = capacity;
+    LOG_DEBUG("Column store grown to capacity %zu", capacity);
+    return MEM_OK;
+}
+
+mem_error_t columns_reserve(columns_store_t* store, node_id_t node_id) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+
+    while (node_id >= store->capacity) {
+        MEM_CHECK(grow_columns(store));
+    }
+    return MEM_OK;
+}
+
+/* Store every column of an allocated row */
+static void write_row(columns_store_t* store, node_id_t node_id, const column_row_t* row) {
+    ((timestamp_ns_t*)column_data(store->created_at_arena))[node_id] = row->created_at;
+    ((uint32_t*)column_data(store->token_count_arena))[node_id] = row->token_count;
+    ((uint8_t*)column_data(store->level_arena))[node_id] = (uint8_t)row->level;
+    ((node_id_t*)column_data(store->agent_arena))[node_id] = row->agent;
+    ((node_id_t*)column_data(store->session_arena))[node_id] = row->session;
+    mark_row(store->created_at_arena, node_id, sizeof(timestamp_ns_t));
+    mark_row(store->token_count_arena, node_id, sizeof(uint32_t));
+    mark_row(store->level_arena, node_id, sizeof(uint8_t));
+    mark_row(store->agent_arena, node_id, sizeof(node_id_t));
+    mark_row(store->session_arena, node_id, sizeof(node_id_t));
+}
+
+mem_error_t columns_append(columns_store_t* store, node_id_t node_id,
+                           const column_row_t* row) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(row != NULL, MEM_ERR_INVALID_ARG, "row is NULL");
+    MEM_CHECK_ERR(node_id == store->count, MEM_ERR_INVALID_ARG,
+                  "column append out of order: %u != %zu", node_id, store->count);
+
+    MEM_CHECK(columns_reserve(store, node_id));
+    write_row(store, node_id, row);
+
+    store->count++;
+
+    columns_header_t* hdr = arena_get_ptr(store->created_at_arena, 0);
+    if (hdr) hdr->count = (uint32_t)store->count;
+    arena_mark_dirty(store->created_at_arena, 0, HEADER_SIZE);
+
+    return MEM_OK;
+}
+
+mem_error_t columns_set_row(columns_store_t* store, node_id_t node_id,
+                            const column_row_t* row) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(row != NULL, MEM_ERR_INVALID_ARG, "row is NULL");
+    if (node_id == store->count) return columns_append(store, node_id, row);
+    MEM_CHECK_ERR(node_id < store->count, MEM_ERR_NOT_FOUND, "node not found");
+
+    write_row(store, node_id, row);
+    return MEM_OK;
+}
+
+mem_error_t columns_set_created_at(columns_store_t* store, node_id_t node_id,
+                                   timestamp_ns_t created_at) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(node_id < store->count, MEM_ERR_NOT_FOUND, "node not found");
+
+    ((timestamp_ns_t*)column_data(store->created_at_arena))[node_id] = created_at;
+    mark_row(store->created_at_arena, node_id, sizeof(timestamp_ns_t));
+    return MEM_OK;
+}
+
+mem_error_t columns_set_token_count(columns_store_t* store, node_id_t node_id,
+                                    uint32_t token_count) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(node_id < store->count, MEM_ERR_NOT_FOUND, "node not found");
+
+    ((uint32_t*)column_data(store->token_count_arena))[node_id] = token_count;
+    mark_row(store->token_count_arena, node_id, sizeof(uint32_t));
+    return MEM_OK;
+}
+
+timestamp_ns_t columns_get_created_at(const columns_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return 0;
+    return columns_created_at(store)[node_id];
+}
+
+uint32_t columns_get_token_count(const columns_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return 0;
+    return columns_token_count(store)[node_id];
+}
+
+hierarchy_level_t columns_get_level(const columns_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return LEVEL_STATEMENT;
+    return (hierarchy_level_t)columns_level(store)[node_id];
+}
+
+node_id_t columns_get_agent(const columns_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return NODE_ID_INVALID;
+    return columns_agent(store)[node_id];
+}
+
+node_id_t columns_get_session(const columns_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return NODE_ID_INVALID;
+    return columns_session(store)[node_id];
+}
+
+const timestamp_ns_t* columns_created_at(const columns_store_t* store) {
+    return store ? column_data(store->created_at_arena) : NULL;
+}
+
+const uint32_t* columns_token_count(const columns_store_t* store) {
+    return store ? column_data(store->token_count_arena) : NULL;
+}
+
+const uint8_t* columns_level(const columns_store_t* store) {
+    return store ? column_data(store->level_arena) : NULL;
+}
+
+const node_id_t* columns_agent(const columns_store_t* store) {
+    return store ? column_data(store->agent_arena) : NULL;
+}
+
+const node_id_t* columns_session(const columns_store_t* store) {
+    return store ? column_data(store->session_arena) : NULL;
+}
+
+size_t columns_count(const columns_store_t* store) {
+    return store ? store->count : 0;
+}
+
+mem_error_t columns_sync(columns_store_t* store) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+
+    MEM_CHECK(arena_sync(store->created_at_arena));
+    MEM_CHECK(arena_sync(store->token_count_arena));
+    MEM_CHECK(arena_sync(store->level_arena));
+    MEM_CHECK(arena_sync(store->agent_arena));
+    MEM_CHECK(arena_sync(store->session_arena));
+
+    return MEM_OK;
+}
+
+void columns_close(columns_store_t* store) {
+    if (!store) return;
+
+    columns_sync(store);
+    close_arenas(store);
+
+    free(store->base_dir);
+    free(store);
+}
@@ -0,0 +1,98 @@
+/*
+ * Memory Service - Node Columns Storage
+ *
+ * mmap'd structure-of-arrays storage for per-node scoring attributes:
+ * - created_at[node_id] = creation timestamp (ns since epoch)
+ * - token_count[node_id] = token count of the node's content
+ * - level[node_id] = hierarchy level
+ * - agent[node_id] = node_id of the owning agent
+ * - session[node_id] = node_id of the owning session
+ *
+ * Each attribute lives in its own file so scoring loops stream through
+ * contiguous arrays instead of striding over per-node records. Files
+ * double in capacity when a row is appended past the end, within address
+ * space reserved for every node id, so the mappings never move.
+ */
+
+#ifndef MEMORY_SERVICE_COLUMNS_H
+#define MEMORY_SERVICE_COLUMNS_H
+
+#include "../core/arena.h"
+#include "../../include/types.h"
+#include "../../include/error.h"
+
+/* Column store */
+typedef struct {
+    arena_t*        created_at_arena;   /* created_at[id] = timestamp_ns */
+    arena_t*        token_count_arena;  /* token_count[id] = tokens */
+    arena_t*        level_arena;        /* level[id] = hierarchy_level */
+    arena_t*        agent_arena;        /* agent[id] = agent node_id */
+    arena_t*        session_arena;      /* session[id] = session node_id */
+    char*           base_dir;
+    size_t          count;              /* Number of rows */
+    size_t          capacity;           /* Max rows before grow */
+} columns_store_t;
+
+/* One row of column values */
+typedef struct {
+    timestamp_ns_t      created_at;
+    uint32_t            token_count;
+    hierarchy_level_t   level;
+    node_id_t           agent;          /* NODE_ID_INVALID if none */
+    node_id_t           session;        /* NODE_ID_INVALID if none */
+} column_row_t;
+
+/* Create column store */
+mem_error_t columns_create(columns_store_t** store, const char* dir,
+                           size_t initial_capacity);
+
+/* Open existing column store */
+mem_error_t columns_open(columns_store_t** store, const char* dir);
+
+/* Grow so the row for node_id can be appended without failing */
+mem_error_t columns_reserve(columns_store_t* store, node_id_t node_id);
+
+/* Append the row for node_id (must equal the current row count) */
+mem_error_t columns_append(columns_store_t* store, node_id_t node_id,
+                           const column_row_t* row);
+
+/* Overwrite the row for node_id, appending it if it is the next row */
+mem_error_t columns_set_row(columns_store_t* store, node_id_t node_id,
+                            const column_row_t* row);
+
+/* Set creation timestamp */
+mem_error_t columns_set_created_at(columns_store_t* store, node_id_t node_id,
+                                   timestamp_ns_t created_at);
+
+/* Set token count */
+mem_error_t columns_set_token_count(columns_store_t* store, node_id_t node_id,
+                                    uint32_t token_count);
+
+/* Get single values (0 / LEVEL_STATEMENT / NODE_ID_INVALID if out of range) */
+timestamp_ns_t columns_get_created_at(const columns_store_t* store, node_id_t node_id);
+uint32_t columns_get_token_count(const columns_store_t* store, node_id_t node_id);
+hierarchy_level_t columns_get_level(const columns_store_t* store, node_id_t node_id);
+node_id_t columns_get_agent(const columns_store_t* store, node_id_t node_id);
+node_id_t columns_get_session(const columns_store_t* store, node_id_t node_id);
+
+/*
+ * Raw column access for batch processing. Arrays are indexed by node_id
+ * and valid for columns_count() entries until the store is closed; growth
+ * does not move them.
+ */
+const timestamp_ns_t* columns_created_at(const columns_store_t* store);
+const uint32_t* columns_token_count(const columns_store_t* store);
+const uint8_t* columns_level(const columns_store_t* store);
+const node_id_t* columns_agent(const columns_store_t* store);
+const node_id_t* columns_session(const columns_store_t* store);
+
+/* Get row count */
+size_t columns_count(const columns_store_t* store);
+
+/* Sync to disk */
+mem_error_t columns_sync(columns_store_t* store);
+
+/* Close store */
+void columns_close(columns_store_t* store);
+
+#endif /* MEMORY_SERVICE_COLUMNS_H */
@@ -11,8 +11,9 @@
 #include <stdio.h>
 #include <limits.h>
 
-/* File name format */
+/* File name formats: first segment (with header), later segments */
 #define LEVEL_FILE_FMT "%s/level_%d.bin"
+#define SEGMENT_FILE_FMT "%s/level_%d.%zu.bin"
 
 /* Header stored at beginning of each level file */
 typedef struct {
@@ -20,22 +21,44 @@ typedef struct {
     uint32_t version;
     uint32_t dim;
     uint32_t count;
-    uint32_t capacity;
-    uint32_t reserved[3];
+    uint32_t capacity;          /* Vectors in this file (segment 0) */
+    uint32_t segment_vectors;   /* Vectors per later segment (v2) */
+    uint32_t segment_count;     /* Segment files in use, including this one (v2) */
+    uint32_t reserved;
 } embedding_file_header_t;
 
 #define EMBEDDING_MAGIC 0x454D4230  /* "EMB0" */
-#define EMBEDDING_VERSION 1
+#define EMBEDDING_VERSION 2         /* 2: adds segment files */
 #define HEADER_SIZE sizeof(embedding_file_header_t)
+#define EMBEDDING_BYTES (EMBEDDING_DIM * sizeof(float))
+
+/* Smallest first segment or segment for any level */
+#define LEVEL_MIN_CAPACITY 64
+
+/*
+ * Capacity per level as a right shift of the statement-level figure:
+ * each level up holds far fewer nodes than the one below it.
+ */
+static const unsigned level_capacity_shift[LEVEL_COUNT] = {
+    [LEVEL_STATEMENT] = 0,
+    [LEVEL_BLOCK] = 2,
+    [LEVEL_MESSAGE] = 4,
+    [LEVEL_SESSION] = 6,
+    [LEVEL_AGENT] = 10,
+};
+
+static size_t level_capacity(size_t capacity, hierarchy_level_t level) {
+    capacity >>= level_capacity_shift[level];
+    return capacity < LEVEL_MIN_CAPACITY ? LEVEL_MIN_CAPACITY : capacity;
+}
 
 /* Calculate file size for capacity - returns 0 on overflow */
 static size_t calc_file_size(size_t capacity) {
     /* Check for integer overflow before multiplication */
-    size_t embedding_bytes = EMBEDDING_DIM * sizeof(float);
-    if (capacity > (SIZE_MAX - HEADER_SIZE) / embedding_bytes) {
+    if (capacity > (SIZE_MAX - HEADER_SIZE) / EMBEDDING_BYTES) {
         return 0;  /* Overflow would occur */
     }
-    return HEADER_SIZE + capacity * embedding_bytes;
+    return HEADER_SIZE + capacity * EMBEDDING_BYTES;
 }
 
 /* Get level file path */
@@ -43,21 +66,84 @@ static void get_level_path(char* buf, size_t buflen, const char* dir, int level)
     snprintf(buf, buflen, LEVEL_FILE_FMT, dir, level);
 }
 
+static inline embedding_file_header_t* level_header(const embedding_level_t* lev) {
+    return arena_get_ptr(lev->segments[0], 0);
+}
+
+/* Translate an index to its vector: segment 0 first, then fixed-size segments */
+static inline float* slot_ptr(const embedding_level_t* lev, uint32_t idx) {
+    if (idx < lev->first_capacity) {
+        return arena_get_ptr(lev->segments[0], HEADER_SIZE + (size_t)idx * EMBEDDING_BYTES);
+    }
+
+    size_t rel = idx - lev->first_capacity;
+    size_t seg = 1 + rel / lev->segment_vectors;
+    if (seg >= lev->segment_count) return NULL;
+    return arena_get_ptr(lev->segments[seg], (rel % lev->segment_vectors) * EMBEDDING_BYTES);
+}
+
+/* Record a written vector for background writeback */
+static void mark_slot(const embedding_level_t* lev, uint32_t idx) {
+    if (idx < lev->first_capacity) {
+        arena_mark_dirty(lev->segments[0], HEADER_SIZE + (size_t)idx * EMBEDDING_BYTES,
+                         EMBEDDING_BYTES);
+        return;
+    }
+
+    size_t rel = idx - lev->first_capacity;
+    arena_mark_dirty(lev->segments[1 + rel / lev->segment_vectors],
+                     (rel % lev->segment_vectors) * EMBEDDING_BYTES, EMBEDDING_BYTES);
+}
+
+/* Map segment seg (>= 1) of a level, creating its file if asked */
+static mem_error_t map_segment(embedding_level_t* lev, const char* dir, size_t seg,
+                               bool create) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), SEGMENT_FILE_FMT, dir, (int)lev->level, seg);
+
+    size_t size = lev->segment_vectors * EMBEDDING_BYTES;
+    if (create) {
+        MEM_CHECK(arena_create_mmap(&lev->segments[seg], path, size, lev->hints));
+    } else {
+        MEM_CHECK(arena_open_mmap(&lev->segments[seg], path, lev->hints));
+        if (arena_size(lev->segments[seg]) < size) {
+            arena_destroy(lev->segments[seg]);
+            lev->segments[seg] = NULL;
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "embedding segment level_%d.%zu.bin is truncated",
+                             (int)lev->level, seg);
+        }
+    }
+    return MEM_OK;
+}
+
+/* Unmap all segments of a level */
+static void close_level(embedding_level_t* lev) {
+    for (size_t i = 0; i < EMBEDDING_MAX_SEGMENTS; i++) {
+        if (lev->segments[i]) {
+            arena_sync(lev->segments[i]);
+            arena_destroy(lev->segments[i]);
+            lev->segments[i] = NULL;
+        }
+    }
+}
+
 /* Initialize single level */
 static mem_error_t init_level(embedding_level_t* lev, const char* dir,
                               hierarchy_level_t level, size_t capacity, bool create) {
     char path[PATH_MAX];
     get_level_path(path, sizeof(path), dir, level);
+    lev->level = level;
+    lev->hints = EMBEDDING_ARENA_FLAGS;
 
     if (create) {
         size_t file_size = calc_file_size(capacity);
         if (file_size == 0) {
             MEM_RETURN_ERROR(MEM_ERR_OVERFLOW, "capacity %zu would cause integer overflow", capacity);
         }
-        MEM_CHECK(arena_create_mmap(&lev->arena, path, file_size, 0));
+        MEM_CHECK(arena_create_mmap(&lev->segments[0], path, file_size, lev->hints));
 
         /* Write header */
-        embedding_file_header_t* hdr = arena_alloc(lev->arena, HEADER_SIZE);
+        embedding_file_header_t* hdr = arena_alloc(lev->segments[0], HEADER_SIZE);
         MEM_CHECK_ALLOC(hdr);
 
         hdr->magic = EMBEDDING_MAGIC;
@@ -65,33 +151,93 @@ static mem_error_t init_level(embedding_level_t* lev, const char* dir,
         hdr->dim = EMBEDDING_DIM;
         hdr->count = 0;
         hdr->capacity = (uint32_t)capacity;
-
-        lev->count = 0;
-        lev->capacity = capacity;
+        hdr->segment_vectors = (uint32_t)level_capacity(EMBEDDING_SEGMENT_VECTORS, level);
+        hdr->segment_count = 1;
     } else {
-        MEM_CHECK(arena_open_mmap(&lev->arena, path, 0));
+        MEM_CHECK(arena_open_mmap(&lev->segments[0], path, lev->hints));
 
         /* Validate header */
-        embedding_file_header_t* hdr = arena_get_ptr(lev->arena, 0);
-        if (!hdr || hdr->magic != EMBEDDING_MAGIC) {
-            arena_destroy(lev->arena);
-            lev->arena = NULL;
+        embedding_file_header_t* hdr = level_header(lev);
+        if (!hdr || hdr->magic != EMBEDDING_MAGIC || hdr->version > EMBEDDING_VERSION) {
             MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid embedding file level_%d.bin", level);
         }
 
         if (hdr->dim != EMBEDDING_DIM) {
-            arena_destroy(lev->arena);
-            lev->arena = NULL;
             MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT,
                            "dimension mismatch: expected %d, got %d",
                            EMBEDDING_DIM, hdr->dim);
         }
 
-        lev->count = hdr->count;
-        lev->capacity = hdr->capacity;
+        if (calc_file_size(hdr->capacity) > arena_size(lev->segments[0])) {
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "embedding file level_%d.bin is truncated", level);
+        }
+
+        /* Version 1 files are a single segment; later segments start now */
+        if (hdr->version < 2) {
+            hdr->segment_vectors = (uint32_t)level_capacity(EMBEDDING_SEGMENT_VECTORS, level);
+            hdr->segment_count = 1;
+            hdr->version = EMBEDDING_VERSION;
+        }
+
+        if (hdr->segment_vectors == 0 || hdr->segment_count == 0 ||
+            hdr->segment_count > EMBEDDING_MAX_SEGMENTS) {
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid segments in level_%d.bin", level);
+        }
     }
 
-    lev->level = level;
+    embedding_file_header_t* hdr = level_header(lev);
+    lev->first_capacity = hdr->capacity;
+    lev->segment_vectors = hdr->segment_vectors;
+    lev->segment_count = 1;
+    lev->capacity = lev->first_capacity;
+
+    /*
+     * The header can reach disk (or a snapshot) before a segment file it
+     * counts. Use the segments that are whole; the WAL redoes the vectors
+     * past them and allocating again recreates the files.
+     */
+    for (size_t seg = 1; seg < hdr->segment_count; seg++) {
+        if (map_segment(lev, dir, seg, false) != MEM_OK) {
+            LOG_WARN("level_%d.bin counts %u segments, only %zu are whole",
+                     level, hdr->segment_count, seg);
+            hdr->segment_count = (uint32_t)seg;
+            arena_mark_dirty(lev->segments[0], 0, HEADER_SIZE);
+            break;
+        }
+        lev->segment_count++;
+        lev->capacity += lev->segment_vectors;
+    }
+
+    lev->count = hdr->count;
+    if (lev->count > lev->capacity) {
+        LOG_WARN("level_%d.bin counts %zu vectors, segments hold %zu",
+                 level, lev->count, lev->capacity);
+        lev->count = lev->capacity;
+        hdr->count = (uint32_t)lev->capacity;
+        arena_mark_dirty(lev->segments[0], 0, HEADER_SIZE);
+    }
+    return MEM_OK;
+}
+
+/*
+ * Map one more segment. The file is created before the header counts it,
+ * so a crash in between leaves only an unused file that is reused later.
+ */
+static mem_error_t add_segment(embedding_level_t* lev, const char* dir) {
+    size_t seg = lev->segment_count;
+    if (seg >= EMBEDDING_MAX_SEGMENTS || lev->capacity + lev->segment_vectors > UINT32_MAX) {
+        MEM_RETURN_ERROR(MEM_ERR_FULL, "embedding level %d at maximum capacity %zu",
+                         lev->level, lev->capacity);
+    }
+
+    MEM_CHECK(map_segment(lev, dir, seg, true));
+    lev->segment_count++;
+    lev->capacity += lev->segment_vectors;
+    level_header(lev)->segment_count = (uint32_t)lev->segment_count;
+    arena_mark_dirty(lev->segments[0], 0, HEADER_SIZE);
+
+    LOG_DEBUG("Embedding level %d mapped segment %zu (capacity %zu)",
+              lev->level, seg, lev->capacity);
     return MEM_OK;
 }
 
@@ -110,16 +256,15 @@ mem_error_t embeddings_create(embeddings_store_t** store, const char* dir,
         MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
     }
 
-    /* Initialize each level */
+    /* Initialize each level, sized to its expected share of nodes */
     for (int i = 0; i < LEVEL_COUNT; i++) {
         mem_error_t err = init_level(&s->levels[i], dir, (hierarchy_level_t)i,
-                                     initial_capacity, true);
+                                     level_capacity(initial_capacity, (hierarchy_level_t)i),
+                                     true);
         if (err != MEM_OK) {
             /* Cleanup already initialized levels */
-            for (int j = 0; j < i; j++) {
-                if (s->levels[j].arena) {
-                    arena_destroy(s->levels[j].arena);
-                }
+            for (int j = 0; j <= i; j++) {
+                close_level(&s->levels[j]);
             }
             free(s->base_dir);
             free(s);
@@ -128,7 +273,7 @@ mem_error_t embeddings_create(embeddings_store_t** store, const char* dir,
     }
 
     *store = s;
-    LOG_INFO("Embeddings store created at %s with capacity %zu per level",
+    LOG_INFO("Embeddings store created at %s with statement capacity %zu",
              dir, initial_capacity);
     return MEM_OK;
 }
@@ -150,10 +295,8 @@ mem_error_t embeddings_open(embeddings_store_t** store, const char* dir) {
     for (int i = 0; i < LEVEL_COUNT; i++) {
         mem_error_t err = init_level(&s->levels[i], dir, (hierarchy_level_t)i, 0, false);
         if (err != MEM_OK) {
-            for (int j = 0; j < i; j++) {
-                if (s->levels[j].arena) {
-                    arena_destroy(s->levels[j].arena);
-                }
+            for (int j = 0; j <= i; j++) {
+                close_level(&s->levels[j]);
             }
             free(s->base_dir);
             free(s);
@@ -175,18 +318,15 @@ mem_error_t embeddings_alloc(embeddings_store_t* store, hierarchy_level_t level,
     embedding_level_t* lev = &store->levels[level];
 
     if (lev->count >= lev->capacity) {
-        /* TODO: Grow the arena */
-        MEM_RETURN_ERROR(MEM_ERR_FULL, "embedding level %d at capacity", level);
+        MEM_CHECK(add_segment(lev, store->base_dir));
     }
 
     *idx = (uint32_t)lev->count;
     lev->count++;
 
     /* Update header count */
-    embedding_file_header_t* hdr = arena_get_ptr(lev->arena, 0);
-    if (hdr) {
-        hdr->count = (uint32_t)lev->count;
-    }
+    level_header(lev)->count = (uint32_t)lev->count;
+    arena_mark_dirty(lev->segments[0], 0, HEADER_SIZE);
 
     return MEM_OK;
 }
@@ -203,15 +343,13 @@ mem_error_t embeddings_set(embeddings_store_t* store, hierarchy_level_t level,
         MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "embedding index %u not allocated", idx);
     }
 
-    /* Calculate offset */
-    size_t offset = HEADER_SIZE + idx * EMBEDDING_DIM * sizeof(float);
-    float* dest = arena_get_ptr(lev->arena, offset);
-
+    float* dest = slot_ptr(lev, idx);
     if (!dest) {
         MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get embedding pointer");
     }
 
-    memcpy(dest, values, EMBEDDING_DIM * sizeof(float));
+    memcpy(dest, values, EMBEDDING_BYTES);
+    mark_slot(lev, idx);
     return MEM_OK;
 }
 
@@ -222,8 +360,7 @@ const float* embeddings_get(const embeddings_store_t* store,
     const embedding_level_t* lev = &store->levels[level];
     if (idx >= lev->count) return NULL;
 
-    size_t offset = HEADER_SIZE + idx * EMBEDDING_DIM * sizeof(float);
-    return arena_get_ptr(lev->arena, offset);
+    return slot_ptr(lev, idx);
 }
 
 mem_error_t embeddings_copy(const embeddings_store_t* store,
@@ -294,12 +431,26 @@ size_t embeddings_count(const embeddings_store_t* store, hierarchy_level_t level
     return store->levels[level].count;
 }
 
+mem_error_t embeddings_advise(embeddings_store_t* store, hierarchy_level_t level,
+                              uint32_t hints) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(level < LEVEL_COUNT, MEM_ERR_INVALID_LEVEL, "invalid level");
+
+    embedding_level_t* lev = &store->levels[level];
+    for (size_t seg = 0; seg < lev->segment_count; seg++) {
+        MEM_CHECK(arena_advise(lev->segments[seg], hints));
+    }
+    lev->hints = hints;
+    return MEM_OK;
+}
+
 mem_error_t embeddings_sync(embeddings_store_t* store) {
     MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
 
     for (int i = 0; i < LEVEL_COUNT; i++) {
-        if (store->levels[i].arena) {
-            MEM_CHECK(arena_sync(store->levels[i].arena));
+        const embedding_level_t* lev = &store->levels[i];
+        for (size_t seg = 0; seg < lev->segment_count; seg++) {
+            MEM_CHECK(arena_sync(lev->segments[seg]));
         }
     }
 
@@ -310,10 +461,7 @@ void embeddings_close(embeddings_store_t* store) {
     if (!store) return;
 
     for (int i = 0; i < LEVEL_COUNT; i++) {
-        if (store->levels[i].arena) {
-            arena_sync(store->levels[i].arena);
-            arena_destroy(store->levels[i].arena);
-        }
+        close_level(&store->levels[i]);
     }
 
     free(store->base_dir);
@@ -2,7 +2,16 @@
  * Memory Service - Embeddings Storage
  *
  * mmap'd storage for embedding vectors at each hierarchy level.
- * Each level has its own file with contiguous float32 arrays.
+ * Each level is a chain of fixed-size segment files of contiguous float32
+ * arrays:
+ * - level_N.bin holds the header and the first segment
+ * - level_N.S.bin (S >= 1) each hold segment_vectors more vectors
+ *
+ * The first segment is sized to the level's expected share of nodes
+ * (higher levels hold far fewer); later segments are sized per level too.
+ * A full level maps one more segment. Segments are mapped once and never
+ * remapped, so pointers from embeddings_get stay valid until the store is
+ * closed while ingest keeps appending.
  */
 
 #ifndef MEMORY_SERVICE_EMBEDDINGS_H
@@ -12,11 +21,24 @@
 #include "../../include/types.h"
 #include "../../include/error.h"
 
+/* Vectors per segment after the first, at the statement level */
+#define EMBEDDING_SEGMENT_VECTORS 65536
+
+/* Most segment files one level can span */
+#define EMBEDDING_MAX_SEGMENTS 1024
+
+/* Default mmap hints: HNSW and similarity lookups hit vectors in no useful order */
+#define EMBEDDING_ARENA_FLAGS (ARENA_FLAG_RANDOM | ARENA_FLAG_HUGEPAGE)
+
 /* Embedding storage for one level */
 typedef struct {
-    arena_t*        arena;          /* mmap'd arena */
+    arena_t*        segments[EMBEDDING_MAX_SEGMENTS]; /* [0] is level_N.bin */
+    size_t          segment_count;  /* Mapped segments */
+    size_t          first_capacity; /* Vectors in segment 0 */
+    size_t          segment_vectors;/* Vectors in each later segment */
     size_t          count;          /* Number of embeddings */
-    size_t          capacity;       /* Max embeddings before grow */
+    size_t          capacity;       /* Vectors across mapped segments */
+    uint32_t        hints;          /* ARENA_FLAG_* hints for every segment */
     hierarchy_level_t level;
 } embedding_level_t;
 
@@ -26,7 +48,7 @@ typedef struct {
     char*           base_dir;
 } embeddings_store_t;
 
-/* Create embeddings store */
+/* Create embeddings store; initial_capacity sizes the statement level */
 mem_error_t embeddings_create(embeddings_store_t** store, const char* dir,
                               size_t initial_capacity);
 
@@ -41,7 +63,7 @@ mem_error_t embeddings_alloc(embeddings_store_t* store, hierarchy_level_t level,
 mem_error_t embeddings_set(embeddings_store_t* store, hierarchy_level_t level,
                            uint32_t idx, const float* values);
 
-/* Get embedding values (returns pointer to mmap'd data) */
+/* Get embedding values (returns pointer to mmap'd data, valid until close) */
 const float* embeddings_get(const embeddings_store_t* store,
                             hierarchy_level_t level, uint32_t idx);
 
@@ -63,6 +85,13 @@ float embeddings_similarity_vec(const embeddings_store_t* store,
 /* Get count for level */
 size_t embeddings_count(const embeddings_store_t* store, hierarchy_level_t level);
 
+/*
+ * Replace the mmap access hints (ARENA_FLAG_*) of a level, including
+ * segments mapped later. Levels start with EMBEDDING_ARENA_FLAGS.
+ */
+mem_error_t embeddings_advise(embeddings_store_t* store, hierarchy_level_t level,
+                              uint32_t hints);
+
 /* Sync to disk */
 mem_error_t embeddings_sync(embeddings_store_t* store);
 
@@ -0,0 +1,159 @@
+/*
+ * Memory Service - Background Flusher Implementation
+ */
+
+#include "flusher.h"
+#include "../core/arena.h"
+#include "../util/log.h"
+#include "../util/time.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+
+struct flusher {
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;       /* Flush requested or shutdown (monotonic clock) */
+    pthread_cond_t      done;       /* A pass finished */
+    uint32_t            interval_ms;
+    uint64_t            requested;  /* Passes asked for by flusher_flush */
+    uint64_t            served;     /* Requests covered by a finished pass */
+    mem_error_t         last_err;   /* Result of the last pass */
+    bool                shutdown;
+    flusher_stats_t     stats;
+};
+
+/* Absolute CLOCK_MONOTONIC time interval_ms from now */
+static struct timespec deadline_after(uint32_t interval_ms) {
+    uint64_t ns = time_now_ns() + (uint64_t)interval_ms * 1000000ULL;
+    return (struct timespec){
+        .tv_sec = (time_t)(ns / 1000000000ULL),
+        .tv_nsec = (long)(ns % 1000000000ULL)
+    };
+}
+
+static void* flusher_main(void* arg) {
+    flusher_t* f = arg;
+
+    pthread_mutex_lock(&f->lock);
+    while (!f->shutdown) {
+        /* Sleep out the interval unless a pass is asked for sooner */
+        struct timespec deadline = deadline_after(f->interval_ms);
+        while (!f->shutdown && f->served == f->requested) {
+            if (pthread_cond_timedwait(&f->wake, &f->lock, &deadline) == ETIMEDOUT) break;
+        }
+        if (f->shutdown) break;
+
+        uint64_t target = f->requested;
+        pthread_mutex_unlock(&f->lock);
+
+        size_t ranges = 0;
+        size_t bytes = 0;
+        uint64_t start = time_now_ns();
+        mem_error_t err = arena_writeback_all(&ranges, &bytes);
+        uint64_t elapsed = time_now_ns() - start;
+
+        pthread_mutex_lock(&f->lock);
+        if (err != MEM_OK && f->last_err == MEM_OK) {
+            LOG_WARN("Background writeback failed: %s", mem_error_str(err));
+        }
+        f->stats.passes++;
+        f->stats.ranges += ranges;
+        f->stats.bytes += bytes;
+        f->stats.writeback_ns += elapsed;
+        if (err != MEM_OK) f->stats.errors++;
+        f->last_err = err;
+        f->served = target;
+        pthread_cond_broadcast(&f->done);
+    }
+    pthread_mutex_unlock(&f->lock);
+    return NULL;
+}
+
+mem_error_t flusher_create(flusher_t** flusher, uint32_t interval_ms) {
+    MEM_CHECK_ERR(flusher != NULL, MEM_ERR_INVALID_ARG, "flusher is NULL");
+
+    flusher_t* f = calloc(1, sizeof(flusher_t));
+    MEM_CHECK_ALLOC(f);
+    f->interval_ms = interval_ms ? interval_ms : FLUSHER_INTERVAL_DEFAULT_MS;
+
+    if (pthread_mutex_init(&f->lock, NULL) != 0) {
+        free(f);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init flusher mutex");
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int rc = pthread_cond_init(&f->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc != 0) {
+        pthread_mutex_destroy(&f->lock);
+        free(f);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init flusher condition");
+    }
+    if (pthread_cond_init(&f->done, NULL) != 0) {
+        pthread_cond_destroy(&f->wake);
+        pthread_mutex_destroy(&f->lock);
+        free(f);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init flusher condition");
+    }
+    if (pthread_create(&f->thread, NULL, flusher_main, f) != 0) {
+        pthread_cond_destroy(&f->done);
+        pthread_cond_destroy(&f->wake);
+        pthread_mutex_destroy(&f->lock);
+        free(f);
+        MEM_RETURN_ERROR(MEM_ERR_THREAD, "failed to start flusher");
+    }
+
+    LOG_DEBUG("Background flusher running every %u ms", f->interval_ms);
+    *flusher = f;
+    return MEM_OK;
+}
+
+void flusher_destroy(flusher_t* flusher) {
+    if (!flusher) return;
+
+    pthread_mutex_lock(&flusher->lock);
+    flusher->shutdown = true;
+    pthread_cond_signal(&flusher->wake);
+    pthread_mutex_unlock(&flusher->lock);
+
+    pthread_join(flusher->thread, NULL);
+
+    LOG_DEBUG("Flusher: %lu bytes in %lu passes",
+              (unsigned long)flusher->stats.bytes, (unsigned long)flusher->stats.passes);
+
+    pthread_cond_destroy(&flusher->done);
+    pthread_cond_destroy(&flusher->wake);
+    pthread_mutex_destroy(&flusher->lock);
+    free(flusher);
+}
+
+mem_error_t flusher_flush(flusher_t* flusher) {
+    MEM_CHECK_ERR(flusher != NULL, MEM_ERR_INVALID_ARG, "flusher is NULL");
+
+    pthread_mutex_lock(&flusher->lock);
+    uint64_t ticket = ++flusher->requested;
+    pthread_cond_signal(&flusher->wake);
+    while (flusher->served < ticket && !flusher->shutdown) {
+        pthread_cond_wait(&flusher->done, &flusher->lock);
+    }
+    mem_error_t err = flusher->served < ticket ? MEM_ERR_IO : flusher->last_err;
+    pthread_mutex_unlock(&flusher->lock);
+
+    if (err != MEM_OK) {
+        MEM_RETURN_ERROR(err, "background writeback failed");
+    }
+    return MEM_OK;
+}
+
+void flusher_get_stats(flusher_t* flusher, flusher_stats_t* stats) {
+    if (!flusher || !stats) return;
+
+    pthread_mutex_lock(&flusher->lock);
+    *stats = flusher->stats;
+    pthread_mutex_unlock(&flusher->lock);
+}
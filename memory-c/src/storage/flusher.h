@@ -0,0 +1,56 @@
+/*
+ * Memory Service - Background Flusher
+ *
+ * A thread that, every interval, starts writeback of the pages written
+ * since its last pass in each mapped store file (relations, embeddings,
+ * columns, node metadata, text). Stores mark the bytes they write, so a
+ * pass touches only those ranges and an idle store costs nothing. Pages
+ * reach disk steadily instead of all at once in the msync of a sync or
+ * close, which then has little left to do.
+ *
+ * Writeback is not a durability point: acknowledged writes are durable
+ * through the WAL, and a checkpoint still syncs the stores.
+ *
+ * Nor does it follow any order. The kernel writes dirty pages back on its
+ * own schedule as well, so ordering these passes would not order what
+ * reaches disk: a count header can land before the rows it counts, or a
+ * grown header before the file size behind it. Recovery does not depend
+ * on it either. Opening a store uses only the slots every one of its files
+ * holds, and WAL replay rewrites everything each logged mutation wrote, so
+ * any mix of pages written since the last checkpoint recovers.
+ */
+
+#ifndef MEMORY_SERVICE_FLUSHER_H
+#define MEMORY_SERVICE_FLUSHER_H
+
+#include "../../include/error.h"
+#include <stdint.h>
+
+/* Default time between passes */
+#define FLUSHER_INTERVAL_DEFAULT_MS 1000
+
+/* Forward declaration */
+typedef struct flusher flusher_t;
+
+/* Writeback counters */
+typedef struct {
+    uint64_t    passes;             /* Completed passes */
+    uint64_t    ranges;             /* Dirty ranges written back */
+    uint64_t    bytes;              /* Bytes written back, whole pages */
+    uint64_t    errors;             /* Passes that hit a writeback error */
+    uint64_t    writeback_ns;       /* Total time spent in passes */
+} flusher_stats_t;
+
+/* Start a flusher running a pass every interval_ms (0 selects the default) */
+mem_error_t flusher_create(flusher_t** flusher, uint32_t interval_ms);
+
+/* Stop the flusher thread and free it */
+void flusher_destroy(flusher_t* flusher);
+
+/* Run a pass now and wait for it */
+mem_error_t flusher_flush(flusher_t* flusher);
+
+/* Get counters */
+void flusher_get_stats(flusher_t* flusher, flusher_stats_t* stats);
+
+#endif /* MEMORY_SERVICE_FLUSHER_H */
@@ -0,0 +1,267 @@
+/*
+ * Memory Service - Agent/Session ID Index Implementation
+ */
+
+#include "id_index.h"
+#include "../util/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+
+/* File header */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t watermark;
+    uint32_t reserved;
+} id_index_header_t;
+
+/* One table slot; node == NODE_ID_INVALID marks it empty */
+typedef struct {
+    uint64_t    key;
+    node_id_t   node;
+    uint32_t    reserved;
+} id_slot_t;
+
+#define ID_INDEX_MAGIC 0x49445830  /* "IDX0" */
+#define ID_INDEX_VERSION 1
+#define HEADER_SIZE sizeof(id_index_header_t)
+#define MIN_CAPACITY 64
+
+static inline id_index_header_t* get_header(const id_index_t* index) {
+    return (id_index_header_t*)index->arena->base;
+}
+
+static inline id_slot_t* get_slots(const id_index_t* index) {
+    return (id_slot_t*)((char*)index->arena->base + HEADER_SIZE);
+}
+
+static size_t round_capacity(size_t capacity) {
+    size_t n = MIN_CAPACITY;
+    while (n < capacity) n <<= 1;
+    return n;
+}
+
+/* Map a new empty table file of capacity slots */
+static mem_error_t create_table(arena_t** arena, const char* path, size_t capacity) {
+    MEM_CHECK(arena_create_mmap(arena, path, HEADER_SIZE + capacity * sizeof(id_slot_t), 0));
+
+    id_index_header_t* hdr = (id_index_header_t*)(*arena)->base;
+    hdr->magic = ID_INDEX_MAGIC;
+    hdr->version = ID_INDEX_VERSION;
+    hdr->count = 0;
+    hdr->capacity = (uint32_t)capacity;
+    hdr->watermark = 0;
+    hdr->reserved = 0;
+
+    /* 0xFF fill makes every slot's node NODE_ID_INVALID */
+    memset((char*)(*arena)->base + HEADER_SIZE, 0xFF, capacity * sizeof(id_slot_t));
+    return MEM_OK;
+}
+
+/* Store key in the first free slot of its probe chain; returns the slot */
+static size_t place(id_slot_t* slots, size_t capacity, uint64_t key, node_id_t node) {
+    size_t mask = capacity - 1;
+    size_t i = (size_t)key & mask;
+    while (slots[i].node != NODE_ID_INVALID) {
+        i = (i + 1) & mask;
+    }
+    slots[i].key = key;
+    slots[i].node = node;
+    slots[i].reserved = 0;
+    return i;
+}
+
+/* Rehash into a table twice the size, swapped in by rename */
+static mem_error_t grow(id_index_t* index) {
+    size_t new_capacity = index->capacity * 2;
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index->path);
+
+    arena_t* arena = NULL;
+    MEM_CHECK(create_table(&arena, tmp_path, new_capacity));
+
+    id_slot_t* old_slots = get_slots(index);
+    id_slot_t* new_slots = (id_slot_t*)((char*)arena->base + HEADER_SIZE);
+
+    /* Walk from the start of a probe chain so equal keys keep their order */
+    size_t start = 0;
+    while (start < index->capacity && old_slots[start].node != NODE_ID_INVALID) {
+        start++;
+    }
+    for (size_t n = 0; n < index->capacity; n++) {
+        id_slot_t* s = &old_slots[(start + n) & (index->capacity - 1)];
+        if (s->node != NODE_ID_INVALID) {
+            place(new_slots, new_capacity, s->key, s->node);
+        }
+    }
+
+    id_index_header_t* hdr = (id_index_header_t*)arena->base;
+    hdr->count = (uint32_t)index->count;
+    hdr->watermark = get_header(index)->watermark;
+
+    mem_error_t err = arena_sync(arena);
+    if (err == MEM_OK && rename(tmp_path, index->path) != 0) {
+        err = MEM_ERR_IO;
+        MEM_SET_ERROR(err, "failed to replace %s", index->path);
+    }
+    if (err != MEM_OK) {
+        arena_destroy(arena);
+        remove(tmp_path);
+        return err;
+    }
+
+    arena_destroy(index->arena);
+    index->arena = arena;
+    index->capacity = new_capacity;
+    return MEM_OK;
+}
+
+mem_error_t id_index_create(id_index_t** index, const char* path, size_t initial_capacity) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
+
+    id_index_t* idx = calloc(1, sizeof(id_index_t));
+    MEM_CHECK_ALLOC(idx);
+
+    idx->path = strdup(path);
+    if (!idx->path) {
+        free(idx);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate index path");
+    }
+
+    idx->capacity = round_capacity(initial_capacity);
+    mem_error_t err = create_table(&idx->arena, path, idx->capacity);
+    if (err != MEM_OK) {
+        free(idx->path);
+        free(idx);
+        return err;
+    }
+
+    *index = idx;
+    return MEM_OK;
+}
+
+mem_error_t id_index_open(id_index_t** index, const char* path) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
+
+    id_index_t* idx = calloc(1, sizeof(id_index_t));
+    MEM_CHECK_ALLOC(idx);
+
+    idx->path = strdup(path);
+    if (!idx->path) {
+        free(idx);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate index path");
+    }
+
+    mem_error_t err = arena_open_mmap(&idx->arena, path, 0);
+    if (err != MEM_OK) {
+        free(idx->path);
+        free(idx);
+        return err;
+    }
+
+    /* Validate header and that the file holds every slot it claims */
+    id_index_header_t* hdr = get_header(idx);
+    if (idx->arena->size < HEADER_SIZE ||
+        hdr->magic != ID_INDEX_MAGIC || hdr->version != ID_INDEX_VERSION ||
+        hdr->capacity < MIN_CAPACITY || (hdr->capacity & (hdr->capacity - 1)) != 0 ||
+        idx->arena->size < HEADER_SIZE + (size_t)hdr->capacity * sizeof(id_slot_t) ||
+        hdr->count >= hdr->capacity) {
+        arena_destroy(idx->arena);
+        free(idx->path);
+        free(idx);
+        MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid id index file %s", path);
+    }
+
+    idx->count = hdr->count;
+    idx->capacity = hdr->capacity;
+
+    *index = idx;
+    LOG_INFO("ID index opened at %s with %zu entries", path, idx->count);
+    return MEM_OK;
+}
+
+uint64_t id_index_key(id_key_kind_t kind, node_id_t scope, const char* str) {
+    /* FNV-1a over kind, scope and string, then a final avalanche so the
+     * low bits used for slot selection depend on every input byte */
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = (h ^ (uint64_t)kind) * 0x100000001b3ULL;
+    for (size_t i = 0; i < sizeof(scope); i++) {
+        h = (h ^ ((scope >> (i * 8)) & 0xFF)) * 0x100000001b3ULL;
+    }
+    for (const unsigned char* p = (const unsigned char*)str; p && *p; p++) {
+        h = (h ^ *p) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+mem_error_t id_index_insert(id_index_t* index, uint64_t key, node_id_t node) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    MEM_CHECK_ERR(node != NODE_ID_INVALID, MEM_ERR_INVALID_ARG, "invalid node id");
+
+    /* Keep load under 70% */
+    if ((index->count + 1) * 10 > index->capacity * 7) {
+        MEM_CHECK(grow(index));
+    }
+
+    size_t slot = place(get_slots(index), index->capacity, key, node);
+    index->count++;
+    get_header(index)->count = (uint32_t)index->count;
+    arena_mark_dirty(index->arena, 0, HEADER_SIZE);
+    arena_mark_dirty(index->arena, HEADER_SIZE + slot * sizeof(id_slot_t), sizeof(id_slot_t));
+    return MEM_OK;
+}
+
+node_id_t id_index_find(const id_index_t* index, uint64_t key,
+                        id_index_match_fn match, void* user_data) {
+    if (!index) return NODE_ID_INVALID;
+
+    const id_slot_t* slots = get_slots(index);
+    size_t mask = index->capacity - 1;
+    size_t i = (size_t)key & mask;
+
+    while (slots[i].node != NODE_ID_INVALID) {
+        if (slots[i].key == key && (!match || match(slots[i].node, user_data))) {
+            return slots[i].node;
+        }
+        i = (i + 1) & mask;
+    }
+    return NODE_ID_INVALID;
+}
+
+size_t id_index_watermark(const id_index_t* index) {
+    return index ? get_header(index)->watermark : 0;
+}
+
+void id_index_set_watermark(id_index_t* index, size_t watermark) {
+    if (!index) return;
+    get_header(index)->watermark = (uint32_t)watermark;
+    arena_mark_dirty(index->arena, 0, HEADER_SIZE);
+}
+
+size_t id_index_count(const id_index_t* index) {
+    return index ? index->count : 0;
+}
+
+mem_error_t id_index_sync(id_index_t* index) {
+    MEM_CHECK_ERR(index != NULL, MEM_ERR_INVALID_ARG, "index is NULL");
+    return arena_sync(index->arena);
+}
+
+void id_index_close(id_index_t* index) {
+    if (!index) return;
+
+    if (index->arena) arena_destroy(index->arena);
+    free(index->path);
+    free(index);
+}
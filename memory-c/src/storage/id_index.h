@@ -0,0 +1,74 @@
+/*
+ * Memory Service - Agent/Session ID Index
+ *
+ * Persistent hash index from external string ids to node ids:
+ * - agent_id -> agent node
+ * - (agent node, session_id) -> session node
+ * - session_id -> first session node with that id, under any agent
+ *
+ * A single mmap'd file holds an open-addressing table (linear probing)
+ * of 64-bit key hashes and node ids. Strings are not stored; callers
+ * confirm each candidate against the node's own metadata through a match
+ * callback, so hash collisions cost an extra probe, never a wrong answer.
+ * The table doubles when it passes 70% load.
+ *
+ * The header also records a watermark: every node below it has been
+ * offered to the index, so on open only newer nodes need indexing.
+ */
+
+#ifndef MEMORY_SERVICE_ID_INDEX_H
+#define MEMORY_SERVICE_ID_INDEX_H
+
+#include "../core/arena.h"
+#include "../../include/types.h"
+#include "../../include/error.h"
+
+/* Key namespaces */
+typedef enum {
+    ID_KEY_AGENT = 1,           /* scope: NODE_ID_INVALID, str: agent_id */
+    ID_KEY_SESSION = 2,         /* scope: agent node or NODE_ID_INVALID, str: session_id */
+} id_key_kind_t;
+
+/* ID index */
+typedef struct {
+    arena_t*        arena;
+    char*           path;
+    size_t          count;              /* Occupied slots */
+    size_t          capacity;           /* Slot count (power of two) */
+} id_index_t;
+
+/* Confirm that node really carries the key being looked up */
+typedef bool (*id_index_match_fn)(node_id_t node, void* user_data);
+
+/* Create empty index file at path */
+mem_error_t id_index_create(id_index_t** index, const char* path, size_t initial_capacity);
+
+/* Open existing index file (MEM_ERR_OPEN if missing) */
+mem_error_t id_index_open(id_index_t** index, const char* path);
+
+/* Hash a key */
+uint64_t id_index_key(id_key_kind_t kind, node_id_t scope, const char* str);
+
+/* Add key -> node (duplicates are kept; lookups return the first match) */
+mem_error_t id_index_insert(id_index_t* index, uint64_t key, node_id_t node);
+
+/* Find the first node for key accepted by match (NODE_ID_INVALID if none) */
+node_id_t id_index_find(const id_index_t* index, uint64_t key,
+                        id_index_match_fn match, void* user_data);
+
+/* Number of nodes already offered to the index */
+size_t id_index_watermark(const id_index_t* index);
+
+/* Record that all nodes below watermark have been offered */
+void id_index_set_watermark(id_index_t* index, size_t watermark);
+
+/* Get entry count */
+size_t id_index_count(const id_index_t* index);
+
+/* Sync to disk */
+mem_error_t id_index_sync(id_index_t* index);
+
+/* Close index */
+void id_index_close(id_index_t* index);
+
+#endif /* MEMORY_SERVICE_ID_INDEX_H */
@@ -15,6 +15,8 @@
 #define FIRST_CHILD_FILE "first_child.bin"
 #define NEXT_SIBLING_FILE "next_sibling.bin"
 #define LEVEL_FILE "level.bin"
+#define LAST_CHILD_FILE "last_child.bin"
+#define CHILD_COUNT_FILE "child_count.bin"
 
 /* Header at start of each file */
 typedef struct {
@@ -25,7 +27,7 @@ typedef struct {
 } relations_header_t;
 
 #define RELATIONS_MAGIC 0x52454C30  /* "REL0" */
-#define RELATIONS_VERSION 1
+#define RELATIONS_VERSION 2         /* 2: adds last_child and child_count */
 #define HEADER_SIZE sizeof(relations_header_t)
 
 /* Calculate file size */
@@ -33,16 +35,21 @@ static size_t calc_file_size(size_t capacity, size_t element_size) {
     return HEADER_SIZE + capacity * element_size;
 }
 
-/* Open or create arena for relation type */
+/*
+ * Open or create arena for relation type. New arrays are filled with
+ * fill_byte: 0xFF gives NODE_ID_INVALID for node_id arrays, 0 for counters
+ * and levels.
+ */
 static mem_error_t open_relation_arena(arena_t** arena, const char* dir,
                                        const char* filename, size_t capacity,
-                                       size_t element_size, bool create) {
+                                       size_t element_size, uint8_t fill_byte,
+                                       bool create) {
     char path[PATH_MAX];
     snprintf(path, sizeof(path), "%s/%s", dir, filename);
 
     if (create) {
         size_t file_size = calc_file_size(capacity, element_size);
-        MEM_CHECK(arena_create_mmap(arena, path, file_size, 0));
+        MEM_CHECK(arena_create_mmap(arena, path, file_size, RELATIONS_ARENA_FLAGS));
 
         /* Write header */
         relations_header_t* hdr = arena_alloc(*arena, HEADER_SIZE);
@@ -53,22 +60,12 @@ static mem_error_t open_relation_arena(arena_t** arena, const char* dir,
         hdr->count = 0;
         hdr->capacity = (uint32_t)capacity;
 
-        /* Initialize data to invalid */
+        /* Initialize data */
         void* data = arena_alloc(*arena, capacity * element_size);
         MEM_CHECK_ALLOC(data);
-
-        if (element_size == sizeof(node_id_t)) {
-            /* Initialize node_id arrays to NODE_ID_INVALID */
-            node_id_t* arr = (node_id_t*)data;
-            for (size_t i = 0; i < capacity; i++) {
-                arr[i] = NODE_ID_INVALID;
-            }
-        } else {
-            /* Initialize level array to 0 */
-            memset(data, 0, capacity * element_size);
-        }
+        memset(data, fill_byte, capacity * element_size);
     } else {
-        MEM_CHECK(arena_open_mmap(arena, path, 0));
+        MEM_CHECK(arena_open_mmap(arena, path, RELATIONS_ARENA_FLAGS));
 
         /* Validate header */
         relations_header_t* hdr = arena_get_ptr(*arena, 0);
@@ -79,6 +76,74 @@ static mem_error_t open_relation_arena(arena_t** arena, const char* dir,
         }
     }
 
+    /* Room for every node id, so growth never moves the mapping under readers */
+    mem_error_t err = arena_reserve(*arena, calc_file_size(NODE_ID_INVALID, element_size));
+    if (err != MEM_OK) {
+        arena_destroy(*arena);
+        *arena = NULL;
+        return err;
+    }
+    return MEM_OK;
+}
+
+/* Helper to get pointer into relation array */
+static inline node_id_t* get_node_ptr(arena_t* arena, node_id_t id) {
+    size_t offset = HEADER_SIZE + id * sizeof(node_id_t);
+    return arena_get_ptr(arena, offset);
+}
+
+static inline uint8_t* get_level_ptr(arena_t* arena, node_id_t id) {
+    size_t offset = HEADER_SIZE + id * sizeof(uint8_t);
+    return arena_get_ptr(arena, offset);
+}
+
+static inline uint32_t* get_count_ptr(arena_t* arena, node_id_t id) {
+    size_t offset = HEADER_SIZE + id * sizeof(uint32_t);
+    return arena_get_ptr(arena, offset);
+}
+
+/* Record a written slot for background writeback */
+static inline void mark_slot(arena_t* arena, node_id_t id, size_t element_size) {
+    arena_mark_dirty(arena, HEADER_SIZE + id * element_size, element_size);
+}
+
+/*
+ * Upgrade an older store in place: build last_child and child_count by
+ * walking every sibling chain once, then stamp the current version into
+ * each file header.
+ */
+static mem_error_t upgrade_relations(relations_store_t* s, const char* dir,
+                                     uint32_t from_version) {
+    MEM_CHECK(open_relation_arena(&s->last_child_arena, dir, LAST_CHILD_FILE,
+                                  s->capacity, sizeof(node_id_t), 0xFF, true));
+    MEM_CHECK(open_relation_arena(&s->child_count_arena, dir, CHILD_COUNT_FILE,
+                                  s->capacity, sizeof(uint32_t), 0, true));
+
+    for (node_id_t id = 0; id < s->count; id++) {
+        node_id_t last = NODE_ID_INVALID;
+        uint32_t children = 0;
+        node_id_t child = *get_node_ptr(s->first_child_arena, id);
+        while (child != NODE_ID_INVALID) {
+            last = child;
+            children++;
+            child = *get_node_ptr(s->next_sibling_arena, child);
+        }
+        *get_node_ptr(s->last_child_arena, id) = last;
+        *get_count_ptr(s->child_count_arena, id) = children;
+    }
+
+    arena_t* arenas[] = {
+        s->parent_arena, s->first_child_arena, s->next_sibling_arena,
+        s->last_child_arena, s->child_count_arena, s->level_arena
+    };
+    for (size_t i = 0; i < sizeof(arenas) / sizeof(arenas[0]); i++) {
+        relations_header_t* hdr = arena_get_ptr(arenas[i], 0);
+        hdr->version = RELATIONS_VERSION;
+        MEM_CHECK(arena_sync(arenas[i]));
+    }
+
+    LOG_INFO("Relations store at %s upgraded from version %u to %u",
+             dir, from_version, RELATIONS_VERSION);
     return MEM_OK;
 }
 
@@ -101,19 +166,27 @@ mem_error_t relations_create(relations_store_t** store, const char* dir,
     mem_error_t err;
 
     err = open_relation_arena(&s->parent_arena, dir, PARENT_FILE,
-                              initial_capacity, sizeof(node_id_t), true);
+                              initial_capacity, sizeof(node_id_t), 0xFF, true);
     if (err != MEM_OK) goto cleanup;
 
     err = open_relation_arena(&s->first_child_arena, dir, FIRST_CHILD_FILE,
-                              initial_capacity, sizeof(node_id_t), true);
+                              initial_capacity, sizeof(node_id_t), 0xFF, true);
     if (err != MEM_OK) goto cleanup;
 
     err = open_relation_arena(&s->next_sibling_arena, dir, NEXT_SIBLING_FILE,
-                              initial_capacity, sizeof(node_id_t), true);
+                              initial_capacity, sizeof(node_id_t), 0xFF, true);
+    if (err != MEM_OK) goto cleanup;
+
+    err = open_relation_arena(&s->last_child_arena, dir, LAST_CHILD_FILE,
+                              initial_capacity, sizeof(node_id_t), 0xFF, true);
+    if (err != MEM_OK) goto cleanup;
+
+    err = open_relation_arena(&s->child_count_arena, dir, CHILD_COUNT_FILE,
+                              initial_capacity, sizeof(uint32_t), 0, true);
     if (err != MEM_OK) goto cleanup;
 
     err = open_relation_arena(&s->level_arena, dir, LEVEL_FILE,
-                              initial_capacity, sizeof(uint8_t), true);
+                              initial_capacity, sizeof(uint8_t), 0, true);
     if (err != MEM_OK) goto cleanup;
 
     s->count = 0;
@@ -127,12 +200,53 @@ cleanup:
     if (s->parent_arena) arena_destroy(s->parent_arena);
     if (s->first_child_arena) arena_destroy(s->first_child_arena);
     if (s->next_sibling_arena) arena_destroy(s->next_sibling_arena);
+    if (s->last_child_arena) arena_destroy(s->last_child_arena);
+    if (s->child_count_arena) arena_destroy(s->child_count_arena);
     if (s->level_arena) arena_destroy(s->level_arena);
     free(s->base_dir);
     free(s);
     return err;
 }
 
+/* Slots a relation file holds */
+static size_t file_capacity(const arena_t* arena, size_t element_size) {
+    size_t size = arena_size(arena);
+    return size > HEADER_SIZE ? (size - HEADER_SIZE) / element_size : 0;
+}
+
+/*
+ * Header pages, data pages and file sizes reach disk in no set order, so
+ * after a crash the parent header may describe slots another file never
+ * got. Use only what every file holds; the WAL redoes the nodes past it.
+ */
+static void clamp_to_files(relations_store_t* s) {
+    const struct { const arena_t* arena; size_t element_size; } files[] = {
+        { s->parent_arena, sizeof(node_id_t) },
+        { s->first_child_arena, sizeof(node_id_t) },
+        { s->next_sibling_arena, sizeof(node_id_t) },
+        { s->last_child_arena, sizeof(node_id_t) },
+        { s->child_count_arena, sizeof(uint32_t) },
+        { s->level_arena, sizeof(uint8_t) },
+    };
+
+    size_t capacity = s->capacity;
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        size_t held = file_capacity(files[i].arena, files[i].element_size);
+        if (held < capacity) capacity = held;
+    }
+    if (capacity == s->capacity && s->count <= capacity) return;
+
+    LOG_WARN("Relations header claims %zu of %zu nodes, files hold %zu",
+             s->count, s->capacity, capacity);
+    s->capacity = capacity;
+    if (s->count > capacity) s->count = capacity;
+
+    relations_header_t* hdr = arena_get_ptr(s->parent_arena, 0);
+    hdr->count = (uint32_t)s->count;
+    hdr->capacity = (uint32_t)s->capacity;
+    arena_mark_dirty(s->parent_arena, 0, HEADER_SIZE);
+}
+
 mem_error_t relations_open(relations_store_t** store, const char* dir) {
     MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
     MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
@@ -148,16 +262,16 @@ mem_error_t relations_open(relations_store_t** store, const char* dir) {
 
     mem_error_t err;
 
-    err = open_relation_arena(&s->parent_arena, dir, PARENT_FILE, 0, sizeof(node_id_t), false);
+    err = open_relation_arena(&s->parent_arena, dir, PARENT_FILE, 0, sizeof(node_id_t), 0xFF, false);
     if (err != MEM_OK) goto cleanup;
 
-    err = open_relation_arena(&s->first_child_arena, dir, FIRST_CHILD_FILE, 0, sizeof(node_id_t), false);
+    err = open_relation_arena(&s->first_child_arena, dir, FIRST_CHILD_FILE, 0, sizeof(node_id_t), 0xFF, false);
     if (err != MEM_OK) goto cleanup;
 
-    err = open_relation_arena(&s->next_sibling_arena, dir, NEXT_SIBLING_FILE, 0, sizeof(node_id_t), false);
+    err = open_relation_arena(&s->next_sibling_arena, dir, NEXT_SIBLING_FILE, 0, sizeof(node_id_t), 0xFF, false);
     if (err != MEM_OK) goto cleanup;
 
-    err = open_relation_arena(&s->level_arena, dir, LEVEL_FILE, 0, sizeof(uint8_t), false);
+    err = open_relation_arena(&s->level_arena, dir, LEVEL_FILE, 0, sizeof(uint8_t), 0, false);
     if (err != MEM_OK) goto cleanup;
 
     /* Read count and capacity from parent file header */
@@ -165,6 +279,26 @@ mem_error_t relations_open(relations_store_t** store, const char* dir) {
     s->count = hdr->count;
     s->capacity = hdr->capacity;
 
+    if (hdr->version > RELATIONS_VERSION) {
+        err = MEM_ERR_INDEX_CORRUPT;
+        MEM_SET_ERROR(err, "unsupported relations version %u", hdr->version);
+        goto cleanup;
+    }
+
+    if (hdr->version < RELATIONS_VERSION) {
+        err = upgrade_relations(s, dir, hdr->version);
+        if (err != MEM_OK) goto cleanup;
+    } else {
+        err = open_relation_arena(&s->last_child_arena, dir, LAST_CHILD_FILE, 0,
+                                  sizeof(node_id_t), 0xFF, false);
+        if (err != MEM_OK) goto cleanup;
+
+        err = open_relation_arena(&s->child_count_arena, dir, CHILD_COUNT_FILE, 0,
+                                  sizeof(uint32_t), 0, false);
+        if (err != MEM_OK) goto cleanup;
+    }
+    clamp_to_files(s);
+
     *store = s;
     LOG_INFO("Relations store opened at %s with %zu nodes", dir, s->count);
     return MEM_OK;
@@ -173,19 +307,80 @@ cleanup:
     if (s->parent_arena) arena_destroy(s->parent_arena);
     if (s->first_child_arena) arena_destroy(s->first_child_arena);
     if (s->next_sibling_arena) arena_destroy(s->next_sibling_arena);
+    if (s->last_child_arena) arena_destroy(s->last_child_arena);
+    if (s->child_count_arena) arena_destroy(s->child_count_arena);
     if (s->level_arena) arena_destroy(s->level_arena);
     free(s->base_dir);
     free(s);
     return err;
 }
 
+/* Extend one relation file to capacity, filling the new slots */
+static mem_error_t grow_relation_arena(arena_t* arena, size_t old_capacity,
+                                       size_t capacity, size_t element_size,
+                                       uint8_t fill_byte) {
+    /* A crash during an earlier grow may have left this file larger already */
+    size_t file_size = calc_file_size(capacity, element_size);
+    if (arena_size(arena) < file_size) {
+        MEM_CHECK(arena_grow(arena, file_size));
+    }
+
+    uint8_t* data = arena_get_ptr(arena, calc_file_size(old_capacity, element_size));
+    memset(data, fill_byte, (capacity - old_capacity) * element_size);
+
+    relations_header_t* hdr = arena_get_ptr(arena, 0);
+    hdr->capacity = (uint32_t)capacity;
+    arena_mark_dirty(arena, 0, HEADER_SIZE);
+    arena_mark_dirty(arena, calc_file_size(old_capacity, element_size),
+                     (capacity - old_capacity) * element_size);
+    return MEM_OK;
+}
+
+/*
+ * Double capacity across all relation files. The parent file's header is
+ * the one read back on open, so it is grown last: a crash part way leaves
+ * it at the old capacity, which every other file still covers.
+ */
+static mem_error_t grow_relations(relations_store_t* store) {
+    size_t old_capacity = store->capacity;
+    size_t capacity = old_capacity * 2;
+    if (capacity > NODE_ID_INVALID) capacity = NODE_ID_INVALID;
+    if (capacity <= old_capacity) {
+        MEM_RETURN_ERROR(MEM_ERR_FULL, "relations store at maximum capacity");
+    }
+
+    MEM_CHECK(grow_relation_arena(store->first_child_arena, old_capacity, capacity,
+                                  sizeof(node_id_t), 0xFF));
+    MEM_CHECK(grow_relation_arena(store->next_sibling_arena, old_capacity, capacity,
+                                  sizeof(node_id_t), 0xFF));
+    MEM_CHECK(grow_relation_arena(store->last_child_arena, old_capacity, capacity,
+                                  sizeof(node_id_t), 0xFF));
+    MEM_CHECK(grow_relation_arena(store->child_count_arena, old_capacity, capacity,
+                                  sizeof(uint32_t), 0));
+    MEM_CHECK(grow_relation_arena(store->level_arena, old_capacity, capacity,
+                                  sizeof(uint8_t), 0));
+    MEM_CHECK(grow_relation_arena(store->parent_arena, old_capacity, capacity,
+                                  sizeof(node_id_t), 0xFF));
+
+    store->capacity = capacity;
+    LOG_DEBUG("Relations store grown to capacity %zu", capacity);
+    return MEM_OK;
+}
+
+mem_error_t relations_reserve(relations_store_t* store, node_id_t node_id) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+
+    while (node_id >= store->capacity) {
+        MEM_CHECK(grow_relations(store));
+    }
+    return MEM_OK;
+}
+
 mem_error_t relations_alloc_node(relations_store_t* store, node_id_t* id) {
     MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
     MEM_CHECK_ERR(id != NULL, MEM_ERR_INVALID_ARG, "id is NULL");
 
-    if (store->count >= store->capacity) {
-        MEM_RETURN_ERROR(MEM_ERR_FULL, "relations store at capacity");
-    }
+    MEM_CHECK(relations_reserve(store, (node_id_t)store->count));
 
     *id = (node_id_t)store->count;
     store->count++;
@@ -193,21 +388,11 @@ mem_error_t relations_alloc_node(relations_store_t* store, node_id_t* id) {
     /* Update header count in all files */
     relations_header_t* hdr = arena_get_ptr(store->parent_arena, 0);
     if (hdr) hdr->count = (uint32_t)store->count;
+    arena_mark_dirty(store->parent_arena, 0, HEADER_SIZE);
 
     return MEM_OK;
 }
 
-/* Helper to get pointer into relation array */
-static inline node_id_t* get_node_ptr(arena_t* arena, node_id_t id) {
-    size_t offset = HEADER_SIZE + id * sizeof(node_id_t);
-    return arena_get_ptr(arena, offset);
-}
-
-static inline uint8_t* get_level_ptr(arena_t* arena, node_id_t id) {
-    size_t offset = HEADER_SIZE + id * sizeof(uint8_t);
-    return arena_get_ptr(arena, offset);
-}
-
 mem_error_t relations_set_parent(relations_store_t* store, node_id_t node_id,
                                  node_id_t parent_id) {
     MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
@@ -217,6 +402,7 @@ mem_error_t relations_set_parent(relations_store_t* store, node_id_t node_id,
     if (!ptr) MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get parent pointer");
 
     *ptr = parent_id;
+    mark_slot(store->parent_arena, node_id, sizeof(node_id_t));
     return MEM_OK;
 }
 
@@ -229,6 +415,7 @@ mem_error_t relations_set_first_child(relations_store_t* store, node_id_t node_i
     if (!ptr) MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get first_child pointer");
 
     *ptr = child_id;
+    mark_slot(store->first_child_arena, node_id, sizeof(node_id_t));
     return MEM_OK;
 }
 
@@ -241,6 +428,80 @@ mem_error_t relations_set_next_sibling(relations_store_t* store, node_id_t node_
     if (!ptr) MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get next_sibling pointer");
 
     *ptr = sibling_id;
+    mark_slot(store->next_sibling_arena, node_id, sizeof(node_id_t));
+    return MEM_OK;
+}
+
+mem_error_t relations_append_child(relations_store_t* store, node_id_t parent_id,
+                                   node_id_t child_id) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(parent_id < store->count, MEM_ERR_NOT_FOUND, "parent not found");
+    MEM_CHECK_ERR(child_id < store->count, MEM_ERR_NOT_FOUND, "child not found");
+
+    node_id_t* last_ptr = get_node_ptr(store->last_child_arena, parent_id);
+    uint32_t* count_ptr = get_count_ptr(store->child_count_arena, parent_id);
+    if (!last_ptr || !count_ptr) {
+        MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get last_child pointer");
+    }
+
+    MEM_CHECK(relations_set_parent(store, child_id, parent_id));
+
+    node_id_t last = *last_ptr;
+    if (last == NODE_ID_INVALID) {
+        /* Chains linked by hand through set_first_child/set_next_sibling
+         * carry no last_child; find the tail once and track it from here */
+        last = relations_get_first_child(store, parent_id);
+        if (last != NODE_ID_INVALID) {
+            node_id_t next = relations_get_next_sibling(store, last);
+            while (next != NODE_ID_INVALID) {
+                last = next;
+                next = relations_get_next_sibling(store, last);
+            }
+        }
+    }
+
+    if (last == NODE_ID_INVALID) {
+        MEM_CHECK(relations_set_first_child(store, parent_id, child_id));
+    } else {
+        MEM_CHECK(relations_set_next_sibling(store, last, child_id));
+    }
+
+    *last_ptr = child_id;
+    (*count_ptr)++;
+    mark_slot(store->last_child_arena, parent_id, sizeof(node_id_t));
+    mark_slot(store->child_count_arena, parent_id, sizeof(uint32_t));
+    return MEM_OK;
+}
+
+mem_error_t relations_relink_child(relations_store_t* store, node_id_t parent_id,
+                                   node_id_t child_id, node_id_t prev_id,
+                                   uint32_t index) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(child_id < store->count, MEM_ERR_NOT_FOUND, "child not found");
+    MEM_CHECK_ERR(parent_id == NODE_ID_INVALID || parent_id < child_id,
+                  MEM_ERR_INVALID_ARG, "parent %u not before child %u", parent_id, child_id);
+    MEM_CHECK_ERR(prev_id == NODE_ID_INVALID || prev_id < child_id,
+                  MEM_ERR_INVALID_ARG, "sibling %u not before child %u", prev_id, child_id);
+
+    /* The child is new at this point, so it has no siblings or children yet */
+    MEM_CHECK(relations_set_parent(store, child_id, parent_id));
+    MEM_CHECK(relations_set_first_child(store, child_id, NODE_ID_INVALID));
+    MEM_CHECK(relations_set_next_sibling(store, child_id, NODE_ID_INVALID));
+    *get_node_ptr(store->last_child_arena, child_id) = NODE_ID_INVALID;
+    *get_count_ptr(store->child_count_arena, child_id) = 0;
+    mark_slot(store->last_child_arena, child_id, sizeof(node_id_t));
+    mark_slot(store->child_count_arena, child_id, sizeof(uint32_t));
+    if (parent_id == NODE_ID_INVALID) return MEM_OK;
+
+    if (prev_id == NODE_ID_INVALID) {
+        MEM_CHECK(relations_set_first_child(store, parent_id, child_id));
+    } else {
+        MEM_CHECK(relations_set_next_sibling(store, prev_id, child_id));
+    }
+    *get_node_ptr(store->last_child_arena, parent_id) = child_id;
+    *get_count_ptr(store->child_count_arena, parent_id) = index + 1;
+    mark_slot(store->last_child_arena, parent_id, sizeof(node_id_t));
+    mark_slot(store->child_count_arena, parent_id, sizeof(uint32_t));
     return MEM_OK;
 }
 
@@ -254,6 +515,7 @@ mem_error_t relations_set_level(relations_store_t* store, node_id_t node_id,
     if (!ptr) MEM_RETURN_ERROR(MEM_ERR_INDEX, "failed to get level pointer");
 
     *ptr = (uint8_t)level;
+    mark_slot(store->level_arena, node_id, sizeof(uint8_t));
     return MEM_OK;
 }
 
@@ -278,6 +540,20 @@ node_id_t relations_get_next_sibling(const relations_store_t* store, node_id_t n
     return ptr ? *ptr : NODE_ID_INVALID;
 }
 
+node_id_t relations_get_last_child(const relations_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return NODE_ID_INVALID;
+
+    node_id_t* ptr = get_node_ptr(store->last_child_arena, node_id);
+    return ptr ? *ptr : NODE_ID_INVALID;
+}
+
+uint32_t relations_get_child_count(const relations_store_t* store, node_id_t node_id) {
+    if (!store || node_id >= store->count) return 0;
+
+    uint32_t* ptr = get_count_ptr(store->child_count_arena, node_id);
+    return ptr ? *ptr : 0;
+}
+
 hierarchy_level_t relations_get_level(const relations_store_t* store, node_id_t node_id) {
     if (!store || node_id >= store->count) return LEVEL_STATEMENT;
 
@@ -355,12 +631,27 @@ size_t relations_count(const relations_store_t* store) {
     return store ? store->count : 0;
 }
 
+mem_error_t relations_advise(relations_store_t* store, uint32_t hints) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+
+    MEM_CHECK(arena_advise(store->parent_arena, hints));
+    MEM_CHECK(arena_advise(store->first_child_arena, hints));
+    MEM_CHECK(arena_advise(store->next_sibling_arena, hints));
+    MEM_CHECK(arena_advise(store->last_child_arena, hints));
+    MEM_CHECK(arena_advise(store->child_count_arena, hints));
+    MEM_CHECK(arena_advise(store->level_arena, hints));
+
+    return MEM_OK;
+}
+
 mem_error_t relations_sync(relations_store_t* store) {
     MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
 
     MEM_CHECK(arena_sync(store->parent_arena));
     MEM_CHECK(arena_sync(store->first_child_arena));
     MEM_CHECK(arena_sync(store->next_sibling_arena));
+    MEM_CHECK(arena_sync(store->last_child_arena));
+    MEM_CHECK(arena_sync(store->child_count_arena));
     MEM_CHECK(arena_sync(store->level_arena));
 
     return MEM_OK;
@@ -374,6 +665,8 @@ void relations_close(relations_store_t* store) {
     if (store->parent_arena) arena_destroy(store->parent_arena);
     if (store->first_child_arena) arena_destroy(store->first_child_arena);
     if (store->next_sibling_arena) arena_destroy(store->next_sibling_arena);
+    if (store->last_child_arena) arena_destroy(store->last_child_arena);
+    if (store->child_count_arena) arena_destroy(store->child_count_arena);
     if (store->level_arena) arena_destroy(store->level_arena);
 
     free(store->base_dir);
@@ -5,7 +5,17 @@
  * - parent[node_id] = parent_id
  * - first_child[node_id] = child_id
  * - next_sibling[node_id] = sibling_id
+ * - last_child[node_id] = child_id
+ * - child_count[node_id] = number of children
  * - level[node_id] = hierarchy_level
+ *
+ * last_child and child_count were added in format version 2 so children
+ * can be appended in constant time; version 1 stores are upgraded on open.
+ *
+ * Files start at the initial capacity and double whenever a node is
+ * allocated past it. Each is mapped into address space reserved up front
+ * for every node id, so growth extends a mapping in place and readers on
+ * other threads never see it move.
  */
 
 #ifndef MEMORY_SERVICE_RELATIONS_H
@@ -15,11 +25,16 @@
 #include "../../include/types.h"
 #include "../../include/error.h"
 
+/* Default mmap hints: lookups jump between unrelated node ids */
+#define RELATIONS_ARENA_FLAGS ARENA_FLAG_RANDOM
+
 /* Relations store */
 typedef struct {
     arena_t*        parent_arena;       /* parent[id] = parent_id */
     arena_t*        first_child_arena;  /* first_child[id] = child_id */
     arena_t*        next_sibling_arena; /* next_sibling[id] = sibling_id */
+    arena_t*        last_child_arena;   /* last_child[id] = child_id */
+    arena_t*        child_count_arena;  /* child_count[id] = children */
     arena_t*        level_arena;        /* level[id] = hierarchy_level */
     char*           base_dir;
     size_t          count;              /* Number of nodes */
@@ -33,6 +48,9 @@ mem_error_t relations_create(relations_store_t** store, const char* dir,
 /* Open existing relations store */
 mem_error_t relations_open(relations_store_t** store, const char* dir);
 
+/* Grow so node_id can be allocated without failing */
+mem_error_t relations_reserve(relations_store_t* store, node_id_t node_id);
+
 /* Allocate new node slot, returns node_id */
 mem_error_t relations_alloc_node(relations_store_t* store, node_id_t* id);
 
@@ -48,6 +66,23 @@ mem_error_t relations_set_first_child(relations_store_t* store, node_id_t node_i
 mem_error_t relations_set_next_sibling(relations_store_t* store, node_id_t node_id,
                                        node_id_t sibling_id);
 
+/*
+ * Append child as the last child of parent_id: sets the child's parent,
+ * links it after the current last child and bumps the child count.
+ */
+mem_error_t relations_append_child(relations_store_t* store, node_id_t parent_id,
+                                   node_id_t child_id);
+
+/*
+ * Rewrite every slot appending child_id after prev_id (NODE_ID_INVALID if
+ * first) as the index-th child of parent_id writes, and reset the child's
+ * own links. Used to redo a logged append whatever part of it reached
+ * disk; parent_id NODE_ID_INVALID only resets the child.
+ */
+mem_error_t relations_relink_child(relations_store_t* store, node_id_t parent_id,
+                                   node_id_t child_id, node_id_t prev_id,
+                                   uint32_t index);
+
 /* Set node level */
 mem_error_t relations_set_level(relations_store_t* store, node_id_t node_id,
                                 hierarchy_level_t level);
@@ -61,6 +96,12 @@ node_id_t relations_get_first_child(const relations_store_t* store, node_id_t no
 /* Get next sibling */
 node_id_t relations_get_next_sibling(const relations_store_t* store, node_id_t node_id);
 
+/* Get last child */
+node_id_t relations_get_last_child(const relations_store_t* store, node_id_t node_id);
+
+/* Get number of children appended via relations_append_child */
+uint32_t relations_get_child_count(const relations_store_t* store, node_id_t node_id);
+
 /* Get level */
 hierarchy_level_t relations_get_level(const relations_store_t* store, node_id_t node_id);
 
@@ -82,6 +123,9 @@ size_t relations_count_descendants(const relations_store_t* store, node_id_t nod
 /* Get node count */
 size_t relations_count(const relations_store_t* store);
 
+/* Replace the mmap access hints (ARENA_FLAG_*) of every relation file */
+mem_error_t relations_advise(relations_store_t* store, uint32_t hints);
+
 /* Sync to disk */
 mem_error_t relations_sync(relations_store_t* store);
 
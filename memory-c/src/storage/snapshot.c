@@ -0,0 +1,498 @@
+/*
+ * Memory Service - Data Directory Snapshot Implementation
+ */
+
+#include "snapshot.h"
+#include "../platform/platform.h"
+#include "../util/log.h"
+#include "../util/time.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+
+/* Buffer for copies the kernel cannot do itself */
+#define COPY_BUF_SIZE (1024 * 1024)
+
+/* One file in a snapshot */
+typedef struct {
+    char*       name;               /* Path relative to the snapshot root */
+    uint64_t    size;
+    uint64_t    mtime_ns;           /* Source mtime when copied */
+} snapshot_file_t;
+
+typedef struct {
+    snapshot_file_t* files;
+    size_t      count;
+    size_t      capacity;
+} file_list_t;
+
+struct snapshot {
+    char*       src;
+    char*       dest;
+    char*       base;               /* NULL without a base */
+    uint64_t    started_ns;         /* Wall clock, comparable with mtimes */
+    uint64_t    start;              /* Monotonic, for elapsed time */
+
+    file_list_t files;              /* Copied so far */
+    file_list_t base_files;         /* From the base manifest */
+    uint64_t    base_started_ns;
+
+    char**      dirs;               /* Subdirectories created, for fsync */
+    size_t      dir_count;
+
+    uint8_t*    buf;                /* COPY_BUF_SIZE, allocated on first use */
+    snapshot_stats_t stats;
+};
+
+static uint64_t stat_mtime_ns(const struct stat* st) {
+#if defined(__APPLE__)
+    return (uint64_t)st->st_mtimespec.tv_sec * 1000000000ULL + (uint64_t)st->st_mtimespec.tv_nsec;
+#else
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+#endif
+}
+
+static mem_error_t list_push(file_list_t* list, const char* name, uint64_t size, uint64_t mtime_ns) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        snapshot_file_t* grown = realloc(list->files, capacity * sizeof(snapshot_file_t));
+        MEM_CHECK_ALLOC(grown);
+        list->files = grown;
+        list->capacity = capacity;
+    }
+
+    char* copy = strdup(name);
+    MEM_CHECK_ALLOC(copy);
+    list->files[list->count++] = (snapshot_file_t){ copy, size, mtime_ns };
+    return MEM_OK;
+}
+
+static const snapshot_file_t* list_find(const file_list_t* list, const char* name) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (strcmp(list->files[i].name, name) == 0) return &list->files[i];
+    }
+    return NULL;
+}
+
+static void list_free(file_list_t* list) {
+    for (size_t i = 0; i < list->count; i++) free(list->files[i].name);
+    free(list->files);
+    memset(list, 0, sizeof(*list));
+}
+
+/* dir/name into out; false if it does not fit */
+static bool join_path(char* out, size_t size, const char* dir, const char* name) {
+    int len = snprintf(out, size, "%s/%s", dir, name);
+    return len >= 0 && (size_t)len < size;
+}
+
+static void sync_path(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static void snapshot_free(snapshot_t* s) {
+    list_free(&s->files);
+    list_free(&s->base_files);
+    for (size_t i = 0; i < s->dir_count; i++) free(s->dirs[i]);
+    free(s->dirs);
+    free(s->buf);
+    free(s->src);
+    free(s->dest);
+    free(s->base);
+    free(s);
+}
+
+/* Read a completed snapshot's manifest */
+static mem_error_t load_base(snapshot_t* s) {
+    char path[PATH_MAX];
+    FILE* f = join_path(path, sizeof(path), s->base, SNAPSHOT_MANIFEST) ? fopen(path, "r") : NULL;
+    if (!f) {
+        MEM_RETURN_ERROR(MEM_ERR_NOT_FOUND, "%s is not a complete snapshot", s->base);
+    }
+
+    char line[PATH_MAX + 64];
+    unsigned version = 0;
+    bool ok = fgets(line, sizeof(line), f) &&
+              sscanf(line, "memory-snapshot %u", &version) == 1 &&
+              version == SNAPSHOT_FORMAT_VERSION &&
+              fgets(line, sizeof(line), f) &&
+              sscanf(line, "started_ns %" SCNu64, &s->base_started_ns) == 1;
+
+    mem_error_t err = MEM_OK;
+    while (ok && err == MEM_OK && fgets(line, sizeof(line), f)) {
+        uint64_t size, mtime_ns;
+        int name_at = 0;
+        if (sscanf(line, "file %" SCNu64 " %" SCNu64 " %n", &size, &mtime_ns, &name_at) != 2 ||
+            name_at == 0) {
+            continue;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        err = list_push(&s->base_files, line + name_at, size, mtime_ns);
+    }
+    fclose(f);
+
+    if (err != MEM_OK) return err;
+    if (!ok) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "unreadable manifest in %s", s->base);
+    }
+    return MEM_OK;
+}
+
+mem_error_t snapshot_begin(snapshot_t** snap, const char* src_dir,
+                           const char* dest_dir, const char* base_dir) {
+    MEM_CHECK_ERR(snap != NULL, MEM_ERR_INVALID_ARG, "snap is NULL");
+    MEM_CHECK_ERR(src_dir != NULL, MEM_ERR_INVALID_ARG, "src_dir is NULL");
+    MEM_CHECK_ERR(dest_dir != NULL, MEM_ERR_INVALID_ARG, "dest_dir is NULL");
+
+    char src_real[PATH_MAX];
+    MEM_CHECK_ERR(realpath(src_dir, src_real) != NULL, MEM_ERR_NOT_FOUND,
+                  "data directory %s not found", src_dir);
+
+    if (mkdir(dest_dir, 0755) < 0) {
+        if (errno == EEXIST) {
+            MEM_RETURN_ERROR(MEM_ERR_EXISTS, "%s already exists", dest_dir);
+        }
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to create %s: %s", dest_dir, strerror(errno));
+    }
+
+    /* A copy inside the source would copy itself */
+    char dest_real[PATH_MAX];
+    size_t src_len = strlen(src_real);
+    if (!realpath(dest_dir, dest_real) ||
+        (strncmp(dest_real, src_real, src_len) == 0 &&
+         (dest_real[src_len] == '/' || dest_real[src_len] == '\0'))) {
+        rmdir(dest_dir);
+        MEM_RETURN_ERROR(MEM_ERR_INVALID_ARG, "snapshot %s is inside %s", dest_dir, src_dir);
+    }
+
+    snapshot_t* s = calloc(1, sizeof(snapshot_t));
+    if (s) {
+        s->src = strdup(src_real);
+        s->dest = strdup(dest_dir);
+        s->base = base_dir ? strdup(base_dir) : NULL;
+    }
+    if (!s || !s->src || !s->dest || (base_dir && !s->base)) {
+        if (s) snapshot_free(s);
+        rmdir(dest_dir);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate snapshot");
+    }
+    s->started_ns = time_wallclock_ns();
+    s->start = time_now_ns();
+
+    mem_error_t err = s->base ? load_base(s) : MEM_OK;
+    if (err != MEM_OK) {
+        snapshot_free(s);
+        rmdir(dest_dir);
+        return err;
+    }
+
+    *snap = s;
+    return MEM_OK;
+}
+
+/* Copy len bytes at offset, in the kernel when it can */
+static mem_error_t copy_extent(snapshot_t* s, int in, int out, size_t offset, size_t len) {
+    bool kernel = true;
+    while (len > 0) {
+        ssize_t n;
+        if (kernel) {
+            n = platform_copy_range(in, out, offset, len);
+            if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                          errno == EOPNOTSUPP)) {
+                kernel = false;
+                continue;
+            }
+        } else {
+            if (!s->buf) {
+                s->buf = malloc(COPY_BUF_SIZE);
+                MEM_CHECK_ALLOC(s->buf);
+            }
+            size_t chunk = len < COPY_BUF_SIZE ? len : COPY_BUF_SIZE;
+            n = pread(in, s->buf, chunk, (off_t)offset);
+            if (n > 0 && pwrite(out, s->buf, (size_t)n, (off_t)offset) != n) {
+                MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write snapshot file");
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            MEM_RETURN_ERROR(MEM_ERR_READ, "failed to copy snapshot file: %s", strerror(errno));
+        }
+        if (n == 0) break;  /* The file shrank; the copy keeps its size */
+
+        offset += (size_t)n;
+        len -= (size_t)n;
+        s->stats.copied_bytes += (uint64_t)n;
+    }
+    return MEM_OK;
+}
+
+/* Copy the data in [0, end) extent by extent, leaving holes as holes */
+static mem_error_t copy_data(snapshot_t* s, int in, int out, size_t end) {
+    size_t pos = 0;
+    while (pos < end) {
+        off_t data = lseek(in, (off_t)pos, SEEK_DATA);
+        off_t hole;
+        if (data < 0) {
+            if (errno == ENXIO) break;  /* Only holes remain */
+            data = (off_t)pos;          /* No SEEK_DATA here: copy everything */
+            hole = (off_t)end;
+        } else {
+            hole = lseek(in, data, SEEK_HOLE);
+            if (hole < 0) hole = (off_t)end;
+        }
+        if ((size_t)data >= end) break;
+        if ((size_t)hole > end) hole = (off_t)end;
+
+        MEM_CHECK(copy_extent(s, in, out, (size_t)data, (size_t)(hole - data)));
+        pos = (size_t)hole;
+    }
+    return MEM_OK;
+}
+
+/* Link an unchanged file from the base; false if it cannot be reused */
+static bool link_from_base(snapshot_t* s, const char* name, const struct stat* st,
+                           const char* dest_path) {
+    if (!s->base) return false;
+
+    const snapshot_file_t* prev = list_find(&s->base_files, name);
+    uint64_t mtime_ns = stat_mtime_ns(st);
+    if (!prev || prev->size != (uint64_t)st->st_size || prev->mtime_ns != mtime_ns ||
+        mtime_ns + SNAPSHOT_MTIME_SLACK_NS > s->base_started_ns) {
+        return false;
+    }
+
+    char base_path[PATH_MAX];
+    return join_path(base_path, sizeof(base_path), s->base, name) &&
+           link(base_path, dest_path) == 0;
+}
+
+/* Copy one file into the snapshot and record it */
+static mem_error_t add_file(snapshot_t* s, const char* name) {
+    char src_path[PATH_MAX], dest_path[PATH_MAX];
+    if (!join_path(src_path, sizeof(src_path), s->src, name) ||
+        !join_path(dest_path, sizeof(dest_path), s->dest, name)) {
+        MEM_RETURN_ERROR(MEM_ERR_INVALID_ARG, "snapshot path too long");
+    }
+
+    int in = open(src_path, O_RDONLY);
+    if (in < 0) {
+        if (errno == ENOENT) return MEM_OK;  /* Removed since it was listed */
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open %s: %s", name, strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(in, &st) < 0) {
+        close(in);
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to stat %s", name);
+    }
+
+    mem_error_t err = MEM_OK;
+    if (link_from_base(s, name, &st, dest_path)) {
+        s->stats.linked++;
+    } else if (platform_clone_file(in, dest_path) == 0) {
+        sync_path(dest_path);
+        s->stats.cloned++;
+    } else {
+        int out = open(dest_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (out < 0) {
+            close(in);
+            MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to create %s: %s", name, strerror(errno));
+        }
+
+        err = copy_data(s, in, out, (size_t)st.st_size);
+        if (err == MEM_OK && ftruncate(out, st.st_size) < 0) {
+            err = MEM_ERR_TRUNCATE;
+            MEM_SET_ERROR(err, "failed to size %s", name);
+        }
+        if (err == MEM_OK && fsync(out) < 0) {
+            err = MEM_ERR_SYNC;
+            MEM_SET_ERROR(err, "failed to sync %s", name);
+        }
+        close(out);
+    }
+    close(in);
+    if (err != MEM_OK) return err;
+
+    s->stats.files++;
+    s->stats.bytes += (uint64_t)st.st_size;
+    return list_push(&s->files, name, (uint64_t)st.st_size, stat_mtime_ns(&st));
+}
+
+static bool has_suffix(const char* name, const char* suffix) {
+    size_t n = strlen(name), m = strlen(suffix);
+    return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+/* Create a snapshot subdirectory once */
+static mem_error_t add_dir(snapshot_t* s, const char* name) {
+    for (size_t i = 0; i < s->dir_count; i++) {
+        if (strcmp(s->dirs[i], name) == 0) return MEM_OK;
+    }
+
+    char path[PATH_MAX];
+    MEM_CHECK_ERR(join_path(path, sizeof(path), s->dest, name), MEM_ERR_INVALID_ARG,
+                  "snapshot path too long");
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to create snapshot directory: %s", strerror(errno));
+    }
+
+    char** grown = realloc(s->dirs, (s->dir_count + 1) * sizeof(char*));
+    MEM_CHECK_ALLOC(grown);
+    s->dirs = grown;
+    s->dirs[s->dir_count] = strdup(name);
+    MEM_CHECK_ALLOC(s->dirs[s->dir_count]);
+    s->dir_count++;
+    return MEM_OK;
+}
+
+/* Whether name starts with one of a NULL-terminated list of prefixes */
+static bool has_prefix(const char* name, const char* const* prefixes) {
+    for (; *prefixes; prefixes++) {
+        if (strncmp(name, *prefixes, strlen(*prefixes)) == 0) return true;
+    }
+    return false;
+}
+
+/* Copy the files under rel (empty for the root); the lists filter the root */
+static mem_error_t copy_dir(snapshot_t* s, const char* rel, const char* const* only,
+                            const char* const* skip) {
+    char path[PATH_MAX];
+    if (!*rel) {
+        snprintf(path, sizeof(path), "%s", s->src);
+    } else if (!join_path(path, sizeof(path), s->src, rel)) {
+        MEM_RETURN_ERROR(MEM_ERR_INVALID_ARG, "snapshot path too long");
+    }
+
+    DIR* d = opendir(path);
+    if (!d) {
+        if (errno == ENOENT && *rel) return MEM_OK;
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to list %s", *rel ? rel : s->src);
+    }
+
+    mem_error_t err = MEM_OK;
+    struct dirent* de;
+    while (err == MEM_OK && (de = readdir(d)) != NULL) {
+        const char* entry = de->d_name;
+        if (strcmp(entry, ".") == 0 || strcmp(entry, "..") == 0) continue;
+        if (has_suffix(entry, ".tmp")) continue;
+        if (!*rel && ((only && !has_prefix(entry, only)) || (skip && has_prefix(entry, skip)))) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(dirfd(d), entry, &st, AT_SYMLINK_NOFOLLOW) < 0) continue;
+
+        /* Relative name; paths joined from it are length-checked */
+        size_t len = strlen(rel) + 1 + strlen(entry) + 1;
+        char* name = malloc(len);
+        if (!name) {
+            err = MEM_ERR_NOMEM;
+            MEM_SET_ERROR(err, "failed to allocate snapshot name");
+            break;
+        }
+        snprintf(name, len, "%s%s%s", rel, *rel ? "/" : "", entry);
+
+        if (S_ISDIR(st.st_mode)) {
+            err = add_dir(s, name);
+            if (err == MEM_OK) err = copy_dir(s, name, NULL, NULL);
+        } else if (S_ISREG(st.st_mode)) {
+            err = add_file(s, name);
+        }
+        free(name);
+    }
+    closedir(d);
+    return err;
+}
+
+mem_error_t snapshot_copy_tree(snapshot_t* snap, const char* const* only,
+                               const char* const* skip) {
+    MEM_CHECK_ERR(snap != NULL, MEM_ERR_INVALID_ARG, "snap is NULL");
+    return copy_dir(snap, "", only, skip);
+}
+
+static mem_error_t write_manifest(snapshot_t* s, uint64_t wal_sequence) {
+    char path[PATH_MAX], tmp_path[PATH_MAX + 8];
+    MEM_CHECK_ERR(join_path(path, sizeof(path), s->dest, SNAPSHOT_MANIFEST), MEM_ERR_INVALID_ARG,
+                  "snapshot path too long");
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* f = fopen(tmp_path, "w");
+    if (!f) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to create snapshot manifest");
+    }
+
+    fprintf(f, "memory-snapshot %u\n", SNAPSHOT_FORMAT_VERSION);
+    fprintf(f, "started_ns %" PRIu64 "\n", s->started_ns);
+    fprintf(f, "wal_sequence %" PRIu64 "\n", wal_sequence);
+    for (size_t i = 0; i < s->files.count; i++) {
+        const snapshot_file_t* file = &s->files.files[i];
+        fprintf(f, "file %" PRIu64 " %" PRIu64 " %s\n", file->size, file->mtime_ns, file->name);
+    }
+
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write snapshot manifest");
+    }
+    return MEM_OK;
+}
+
+mem_error_t snapshot_commit(snapshot_t* snap, uint64_t wal_sequence,
+                            snapshot_stats_t* stats) {
+    MEM_CHECK_ERR(snap != NULL, MEM_ERR_INVALID_ARG, "snap is NULL");
+
+    /* Entries first, then the manifest that marks them complete */
+    char path[PATH_MAX];
+    for (size_t i = 0; i < snap->dir_count; i++) {
+        if (join_path(path, sizeof(path), snap->dest, snap->dirs[i])) sync_path(path);
+    }
+    sync_path(snap->dest);
+
+    mem_error_t err = write_manifest(snap, wal_sequence);
+    if (err != MEM_OK) {
+        snapshot_abort(snap);
+        return err;
+    }
+    sync_path(snap->dest);
+
+    snap->stats.wal_sequence = wal_sequence;
+    snap->stats.elapsed_ns = time_now_ns() - snap->start;
+    LOG_INFO("Snapshot %s: %" PRIu64 " files, %" PRIu64 " bytes copied, %" PRIu64
+             " cloned, %" PRIu64 " linked in %.1f ms",
+             snap->dest, snap->stats.files, snap->stats.copied_bytes, snap->stats.cloned,
+             snap->stats.linked, (double)snap->stats.elapsed_ns / 1e6);
+
+    if (stats) *stats = snap->stats;
+    snapshot_free(snap);
+    return MEM_OK;
+}
+
+static int remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+void snapshot_abort(snapshot_t* snap) {
+    if (!snap) return;
+
+    /* Everything under dest was created by this snapshot */
+    nftw(snap->dest, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    snapshot_free(snap);
+}
@@ -0,0 +1,75 @@
+/*
+ * Memory Service - Data Directory Snapshots
+ *
+ * Copies a data directory file by file into a new directory. Each file
+ * is cloned copy-on-write where the filesystem supports it (FICLONE,
+ * clonefile), else copied in the kernel, skipping holes. Given the directory of an earlier snapshot as
+ * a base, a file whose size and mtime match what the base recorded, and
+ * that was last written well before the base started, is hard-linked
+ * from the base instead, so a backup costs about as much as the data
+ * changed since the last one.
+ *
+ * A SNAPSHOT manifest, written last, marks the copy complete and records
+ * each file's size and mtime for the next snapshot to compare against.
+ * Files linked from a base are shared: restore a snapshot by copying it,
+ * never by opening it in place.
+ *
+ * Files are copied as they are when reached. Making the result
+ * consistent, by holding writes off or by including a log that repairs
+ * it, is up to the caller (see hierarchy_snapshot).
+ */
+
+#ifndef MEMORY_SERVICE_SNAPSHOT_H
+#define MEMORY_SERVICE_SNAPSHOT_H
+
+#include "../../include/error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Manifest file in the snapshot directory */
+#define SNAPSHOT_MANIFEST "SNAPSHOT"
+#define SNAPSHOT_FORMAT_VERSION 1
+
+/* A base file is reused only if last written this long before the base
+ * started, so a later write cannot leave its mtime unchanged */
+#define SNAPSHOT_MTIME_SLACK_NS (2ULL * 1000000000ULL)
+
+/* Forward declaration */
+typedef struct snapshot snapshot_t;
+
+/* Snapshot counters */
+typedef struct {
+    uint64_t    files;              /* Files in the snapshot */
+    uint64_t    bytes;              /* Their total size */
+    uint64_t    copied_bytes;       /* Data bytes copied */
+    uint64_t    cloned;             /* Files cloned copy-on-write */
+    uint64_t    linked;             /* Files hard-linked from the base */
+    uint64_t    wal_sequence;       /* WAL records before this are included */
+    uint64_t    elapsed_ns;
+} snapshot_stats_t;
+
+/*
+ * Start a snapshot of src_dir into dest_dir, which is created and must
+ * not exist or lie inside src_dir. base_dir, if not NULL, is a completed
+ * snapshot to reuse unchanged files from.
+ */
+mem_error_t snapshot_begin(snapshot_t** snap, const char* src_dir,
+                           const char* dest_dir, const char* base_dir);
+
+/*
+ * Copy every regular file under src_dir whose top-level name starts with
+ * one of only (all if NULL) and with none of skip, except *.tmp files.
+ * Both lists are NULL-terminated. May be called more than once to copy
+ * parts of the tree at different times.
+ */
+mem_error_t snapshot_copy_tree(snapshot_t* snap, const char* const* only,
+                               const char* const* skip);
+
+/* Write the manifest, make the snapshot durable and free snap */
+mem_error_t snapshot_commit(snapshot_t* snap, uint64_t wal_sequence,
+                            snapshot_stats_t* stats);
+
+/* Remove the partial snapshot and free snap */
+void snapshot_abort(snapshot_t* snap);
+
+#endif /* MEMORY_SERVICE_SNAPSHOT_H */
@@ -0,0 +1,956 @@
+/*
+ * Memory Service - Text Storage Implementation
+ */
+
+#include "text_store.h"
+#include "../util/lz.h"
+#include "../util/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* File names */
+#define INDEX_FILE "index.bin"
+#define DICT_FILE "dict.bin"
+#define SEGMENT_FILE_FMT "%s/segment_%u.log"
+#define PACKED_FILE_FMT "%s/segment_%u.lz"
+
+/* Header at start of the index file */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;             /* Highest node_id with an entry + 1 */
+    uint32_t capacity;          /* Entries allocated */
+    uint64_t segment_size;
+    uint64_t total_bytes;       /* Bytes appended across all segments */
+    uint64_t tail_offset;       /* Bytes used in the last segment */
+    uint32_t segment_count;
+    uint32_t reserved;
+} text_header_t;
+
+/* Location of one node's text; segment == UINT32_MAX means none */
+typedef struct {
+    uint64_t offset;
+    uint32_t length;            /* Excluding the NUL terminator */
+    uint32_t segment;
+} text_entry_t;
+
+/*
+ * Header of a packed segment. It is followed by block_count + 1 offsets
+ * (relative to the end of the offset table) bounding each block; a block
+ * whose stored size equals its raw size is kept uncompressed.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint64_t raw_size;
+    uint32_t dict_check;        /* 0 if compressed without dictionary */
+    uint32_t reserved;
+} packed_header_t;
+
+#define TEXT_MAGIC 0x54585430  /* "TXT0" */
+#define TEXT_VERSION 1
+#define PACKED_MAGIC 0x544C5A30  /* "TLZ0" */
+#define PACKED_VERSION 1
+#define HEADER_SIZE sizeof(text_header_t)
+#define INITIAL_ENTRIES 1024
+#define NO_SEGMENT UINT32_MAX
+
+/* Dictionary training: evenly spaced samples from a sealed segment */
+#define DICT_SAMPLES 64
+#define DICT_SAMPLE_SIZE 512
+
+/* One run of decompressed blocks */
+typedef struct {
+    uint32_t    segment;
+    uint32_t    first_block;
+    uint32_t    blocks;         /* 0 = empty slot */
+    uint64_t    last_used;
+    uint8_t*    data;
+} cache_entry_t;
+
+struct text_block_cache {
+    pthread_mutex_t lock;
+    cache_entry_t*  entries;
+    size_t          capacity;
+    uint64_t        tick;
+    uint64_t        hits;
+    uint64_t        misses;
+};
+
+static inline text_header_t* get_header(const text_store_t* store) {
+    return (text_header_t*)store->index_arena->base;
+}
+
+static inline text_entry_t* get_entries(const text_store_t* store) {
+    return (text_entry_t*)((char*)store->index_arena->base + HEADER_SIZE);
+}
+
+static inline const packed_header_t* packed_header(const arena_t* packed) {
+    return (const packed_header_t*)packed->base;
+}
+
+static inline const uint64_t* packed_offsets(const arena_t* packed) {
+    return (const uint64_t*)((const char*)packed->base + sizeof(packed_header_t));
+}
+
+static inline const uint8_t* packed_data(const arena_t* packed) {
+    return (const uint8_t*)(packed_offsets(packed) + packed_header(packed)->block_count + 1);
+}
+
+static uint32_t checksum32(const uint8_t* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+/*
+ * Block cache
+ */
+
+static mem_error_t cache_create(text_block_cache_t** cache, size_t capacity) {
+    text_block_cache_t* c = calloc(1, sizeof(text_block_cache_t));
+    MEM_CHECK_ALLOC(c);
+
+    c->capacity = capacity ? capacity : 1;
+    c->entries = calloc(c->capacity, sizeof(cache_entry_t));
+    if (!c->entries) {
+        free(c);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate block cache");
+    }
+    pthread_mutex_init(&c->lock, NULL);
+
+    *cache = c;
+    return MEM_OK;
+}
+
+static void cache_destroy(text_block_cache_t* cache) {
+    if (!cache) return;
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        free(cache->entries[i].data);
+    }
+    free(cache->entries);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/* Decompress one block of a packed segment into dst */
+static mem_error_t unpack_block(const text_store_t* store, const arena_t* packed,
+                                uint32_t block, uint8_t* dst, size_t raw_len) {
+    const packed_header_t* hdr = packed_header(packed);
+    const uint64_t* offsets = packed_offsets(packed);
+    const uint8_t* src = packed_data(packed) + offsets[block];
+    size_t stored = (size_t)(offsets[block + 1] - offsets[block]);
+
+    if (stored == raw_len) {
+        memcpy(dst, src, raw_len);
+        return MEM_OK;
+    }
+
+    const uint8_t* dict = NULL;
+    size_t dict_len = 0;
+    if (hdr->dict_check) {
+        dict = store->dict;
+        dict_len = store->dict_len;
+    }
+    return lz_decompress(src, stored, dst, raw_len, dict, dict_len);
+}
+
+/*
+ * Copy the decompressed bytes [offset, offset + len) of a packed segment
+ * into dst. The copy happens under the cache lock, since another read
+ * may evict the run as soon as the lock is released.
+ */
+static bool cache_read(const text_store_t* store, uint32_t segment,
+                       uint64_t offset, size_t len, char* dst) {
+    text_block_cache_t* cache = store->cache;
+    const arena_t* packed = store->segments[segment].packed;
+    const packed_header_t* hdr = packed_header(packed);
+
+    uint32_t first = (uint32_t)(offset / hdr->block_size);
+    uint32_t last = (uint32_t)((offset + len - 1) / hdr->block_size);
+    uint32_t blocks = last - first + 1;
+    uint64_t base = (uint64_t)first * hdr->block_size;
+    if (last >= hdr->block_count) return false;
+
+    pthread_mutex_lock(&cache->lock);
+    cache->tick++;
+
+    cache_entry_t* victim = &cache->entries[0];
+    for (size_t i = 0; i < cache->capacity; i++) {
+        cache_entry_t* e = &cache->entries[i];
+        if (e->blocks == blocks && e->segment == segment && e->first_block == first) {
+            e->last_used = cache->tick;
+            cache->hits++;
+            memcpy(dst, e->data + (offset - base), len);
+            pthread_mutex_unlock(&cache->lock);
+            return true;
+        }
+        if (e->last_used < victim->last_used) victim = e;
+    }
+    cache->misses++;
+
+    uint64_t end = (uint64_t)(last + 1) * hdr->block_size;
+    if (end > hdr->raw_size) end = hdr->raw_size;
+    uint8_t* data = malloc((size_t)(end - base));
+    if (!data) {
+        pthread_mutex_unlock(&cache->lock);
+        return false;
+    }
+
+    for (uint32_t b = first; b <= last; b++) {
+        uint64_t b_start = (uint64_t)b * hdr->block_size;
+        uint64_t b_end = b_start + hdr->block_size;
+        if (b_end > hdr->raw_size) b_end = hdr->raw_size;
+        if (unpack_block(store, packed, b, data + (b_start - base),
+                         (size_t)(b_end - b_start)) != MEM_OK) {
+            free(data);
+            pthread_mutex_unlock(&cache->lock);
+            LOG_WARN("Text segment %u block %u failed to decompress", segment, b);
+            return false;
+        }
+    }
+
+    free(victim->data);
+    victim->segment = segment;
+    victim->first_block = first;
+    victim->blocks = blocks;
+    victim->last_used = cache->tick;
+    victim->data = data;
+
+    memcpy(dst, data + (offset - base), len);
+    pthread_mutex_unlock(&cache->lock);
+    return true;
+}
+
+/*
+ * Segments
+ */
+
+/* Grow entry array to hold at least needed entries */
+static mem_error_t ensure_entries(text_store_t* store, size_t needed) {
+    text_header_t* hdr = get_header(store);
+    if (needed <= hdr->capacity) return MEM_OK;
+
+    size_t old_capacity = hdr->capacity;
+    size_t new_capacity = old_capacity * 2;
+    if (new_capacity < needed) new_capacity = needed;
+
+    MEM_CHECK(arena_grow(store->index_arena, HEADER_SIZE + new_capacity * sizeof(text_entry_t)));
+
+    /* 0xFF fill marks new entries as having no text */
+    memset(get_entries(store) + old_capacity, 0xFF,
+           (new_capacity - old_capacity) * sizeof(text_entry_t));
+    get_header(store)->capacity = (uint32_t)new_capacity;
+    arena_mark_dirty(store->index_arena, HEADER_SIZE + old_capacity * sizeof(text_entry_t),
+                     (new_capacity - old_capacity) * sizeof(text_entry_t));
+    return MEM_OK;
+}
+
+/* Track one more segment */
+static mem_error_t push_segment(text_store_t* store, arena_t* raw, arena_t* packed) {
+    if (store->segment_count == store->segment_slots) {
+        size_t slots = store->segment_slots ? store->segment_slots * 2 : 8;
+        text_segment_t* grown = realloc(store->segments, slots * sizeof(text_segment_t));
+        MEM_CHECK_ALLOC(grown);
+        store->segments = grown;
+        store->segment_slots = slots;
+    }
+    store->segments[store->segment_count].raw = raw;
+    store->segments[store->segment_count].packed = packed;
+    store->segment_count++;
+    return MEM_OK;
+}
+
+/* Sample a dictionary from the written part of a raw segment and persist it */
+static mem_error_t train_dictionary(text_store_t* store, const arena_t* raw) {
+    const uint8_t* data = raw->base;
+
+    /* Sealed segments end in unused zero bytes; sample only written text */
+    size_t used = raw->size;
+    while (used > 0 && data[used - 1] == 0) used--;
+    if (used < DICT_SAMPLE_SIZE * 2) return MEM_OK;
+
+    size_t samples = used / DICT_SAMPLE_SIZE;
+    if (samples > DICT_SAMPLES) samples = DICT_SAMPLES;
+    size_t stride = used / samples;
+
+    uint8_t* dict = malloc(samples * DICT_SAMPLE_SIZE);
+    MEM_CHECK_ALLOC(dict);
+    for (size_t i = 0; i < samples; i++) {
+        memcpy(dict + i * DICT_SAMPLE_SIZE, data + i * stride, DICT_SAMPLE_SIZE);
+    }
+    size_t dict_len = samples * DICT_SAMPLE_SIZE;
+
+    char path[PATH_MAX], tmp_path[PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s/%s", store->base_dir, DICT_FILE);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* f = fopen(tmp_path, "wb");
+    bool ok = f && fwrite(dict, 1, dict_len, f) == dict_len &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (f) fclose(f);
+    if (!ok || rename(tmp_path, path) != 0) {
+        free(dict);
+        remove(tmp_path);
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to write text dictionary");
+    }
+
+    store->dict = dict;
+    store->dict_len = dict_len;
+    store->dict_check = checksum32(dict, dict_len);
+    LOG_INFO("Trained %zu byte text dictionary", dict_len);
+    return MEM_OK;
+}
+
+/* Load dict.bin if one was trained */
+static mem_error_t load_dictionary(text_store_t* store) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", store->base_dir, DICT_FILE);
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return MEM_OK;
+
+    uint8_t* dict = malloc(LZ_MAX_DICT);
+    if (!dict) {
+        fclose(f);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dictionary");
+    }
+    size_t len = fread(dict, 1, LZ_MAX_DICT, f);
+    fclose(f);
+
+    store->dict = dict;
+    store->dict_len = len;
+    store->dict_check = checksum32(dict, len);
+    return MEM_OK;
+}
+
+/*
+ * Write a packed copy of raw segment i and switch the segment over to it.
+ * Runs on the packer thread, the only one that changes a sealed segment,
+ * so it reads the raw mapping without holding the store lock.
+ */
+static mem_error_t pack_segment(text_store_t* store, size_t i, const text_compression_t* cfg) {
+    pthread_rwlock_rdlock(&store->lock);
+    arena_t* raw = store->segments[i].raw;
+    pthread_rwlock_unlock(&store->lock);
+
+    if (cfg->dictionary && !store->dict) {
+        MEM_CHECK(train_dictionary(store, raw));
+    }
+    const uint8_t* dict = cfg->dictionary ? store->dict : NULL;
+    size_t dict_len = dict ? store->dict_len : 0;
+
+    packed_header_t hdr = {
+        .magic = PACKED_MAGIC,
+        .version = PACKED_VERSION,
+        .block_size = cfg->block_size,
+        .block_count = (uint32_t)((raw->size + cfg->block_size - 1) / cfg->block_size),
+        .raw_size = raw->size,
+        .dict_check = dict ? store->dict_check : 0,
+        .reserved = 0
+    };
+
+    char path[PATH_MAX], tmp_path[PATH_MAX + 8], raw_path[PATH_MAX];
+    snprintf(path, sizeof(path), PACKED_FILE_FMT, store->base_dir, (unsigned)i);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    snprintf(raw_path, sizeof(raw_path), SEGMENT_FILE_FMT, store->base_dir, (unsigned)i);
+
+    size_t bound = lz_compress_bound(cfg->block_size);
+    uint64_t* offsets = calloc(hdr.block_count + 1, sizeof(uint64_t));
+    uint8_t* buf = malloc(bound);
+    FILE* f = fopen(tmp_path, "wb");
+    mem_error_t err = MEM_OK;
+
+    if (!offsets || !buf || !f) {
+        err = f ? MEM_ERR_NOMEM : MEM_ERR_IO;
+        goto done;
+    }
+
+    /* Offsets are rewritten once block sizes are known */
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+        fwrite(offsets, sizeof(uint64_t), hdr.block_count + 1, f) != hdr.block_count + 1) {
+        err = MEM_ERR_IO;
+        goto done;
+    }
+
+    const uint8_t* data = raw->base;
+    for (uint32_t b = 0; b < hdr.block_count; b++) {
+        size_t start = (size_t)b * cfg->block_size;
+        size_t len = raw->size - start < cfg->block_size ? raw->size - start : cfg->block_size;
+
+        /* Blocks that do not shrink are stored as is */
+        size_t n = lz_compress(data + start, len, buf, bound, dict, dict_len);
+        const void* out = (n > 0 && n < len) ? (const void*)buf : (const void*)(data + start);
+        size_t out_len = (n > 0 && n < len) ? n : len;
+
+        if (fwrite(out, 1, out_len, f) != out_len) {
+            err = MEM_ERR_IO;
+            goto done;
+        }
+        offsets[b + 1] = offsets[b] + out_len;
+    }
+
+    if (fseek(f, (long)sizeof(hdr), SEEK_SET) != 0 ||
+        fwrite(offsets, sizeof(uint64_t), hdr.block_count + 1, f) != hdr.block_count + 1 ||
+        fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        err = MEM_ERR_IO;
+    }
+
+done:
+    if (f) fclose(f);
+    free(buf);
+    if (err == MEM_OK && rename(tmp_path, path) != 0) err = MEM_ERR_IO;
+    if (err != MEM_OK) {
+        free(offsets);
+        remove(tmp_path);
+        MEM_RETURN_ERROR(err, "failed to pack text segment %zu", i);
+    }
+
+    arena_t* packed = NULL;
+    err = arena_open_mmap(&packed, path, ARENA_FLAG_READONLY);
+    if (err != MEM_OK) {
+        free(offsets);
+        return err;
+    }
+
+    LOG_DEBUG("Packed text segment %zu: %zu -> %llu bytes", i, raw->size,
+             (unsigned long long)offsets[hdr.block_count]);
+    free(offsets);
+
+    /* Reads copy out under the shared lock, so once the swap has held it
+     * exclusive nothing uses raw any more and it can be unmapped */
+    pthread_mutex_lock(&store->pack_lock);
+    pthread_rwlock_wrlock(&store->lock);
+    store->segments[i].raw = NULL;
+    store->segments[i].packed = packed;
+    pthread_rwlock_unlock(&store->lock);
+
+    arena_destroy(raw);
+    unlink(raw_path);
+    pthread_mutex_unlock(&store->pack_lock);
+    return MEM_OK;
+}
+
+/* First raw segment outside the hot window (SIZE_MAX if none), with the settings to pack it */
+static size_t next_cold(text_store_t* store, text_compression_t* cfg) {
+    size_t found = SIZE_MAX;
+
+    pthread_rwlock_rdlock(&store->lock);
+    *cfg = store->compression;
+    if (cfg->enabled && store->segment_count > cfg->hot_segments) {
+        size_t cold = store->segment_count - cfg->hot_segments;
+        for (size_t i = 0; i < cold && found == SIZE_MAX; i++) {
+            if (store->segments[i].raw) found = i;
+        }
+    }
+    pthread_rwlock_unlock(&store->lock);
+    return found;
+}
+
+/* Wait out a pause, then mark a segment mid-pack; false when stopping */
+static bool begin_pack(text_store_t* store) {
+    pthread_mutex_lock(&store->pack_lock);
+    while (store->pack_paused && !store->pack_stopping) {
+        pthread_cond_wait(&store->pack_wake, &store->pack_lock);
+    }
+    bool go = !store->pack_stopping;
+    store->pack_active = go;
+    pthread_mutex_unlock(&store->pack_lock);
+    return go;
+}
+
+static void end_pack(text_store_t* store) {
+    pthread_mutex_lock(&store->pack_lock);
+    store->pack_active = false;
+    pthread_cond_broadcast(&store->pack_done);
+    pthread_mutex_unlock(&store->pack_lock);
+}
+
+/* Pack every raw segment outside the hot window */
+static void pack_cold(text_store_t* store) {
+    while (begin_pack(store)) {
+        text_compression_t cfg;
+        size_t i = next_cold(store, &cfg);
+        mem_error_t err = i != SIZE_MAX ? pack_segment(store, i, &cfg) : MEM_OK;
+        end_pack(store);
+
+        if (i == SIZE_MAX) return;
+        if (err != MEM_OK) {
+            /* Compression is an optimization; the raw segment stays valid */
+            LOG_WARN("Leaving text segment %zu uncompressed", i);
+            return;
+        }
+    }
+}
+
+static void* packer_main(void* arg) {
+    text_store_t* store = arg;
+
+    pthread_mutex_lock(&store->pack_lock);
+    while (!store->pack_stopping) {
+        if (store->pack_served == store->pack_requested) {
+            pthread_cond_wait(&store->pack_wake, &store->pack_lock);
+            continue;
+        }
+
+        uint64_t target = store->pack_requested;
+        pthread_mutex_unlock(&store->pack_lock);
+        pack_cold(store);
+        pthread_mutex_lock(&store->pack_lock);
+
+        store->pack_served = target;
+        pthread_cond_broadcast(&store->pack_done);
+    }
+    pthread_cond_broadcast(&store->pack_done);
+    pthread_mutex_unlock(&store->pack_lock);
+    return NULL;
+}
+
+/* Ask the packer for a pass over the cold segments */
+static void request_pack(text_store_t* store) {
+    pthread_mutex_lock(&store->pack_lock);
+    store->pack_requested++;
+    pthread_cond_signal(&store->pack_wake);
+    pthread_mutex_unlock(&store->pack_lock);
+}
+
+static void stop_packer(text_store_t* store) {
+    if (!store->packer_running) return;
+
+    pthread_mutex_lock(&store->pack_lock);
+    store->pack_stopping = true;
+    pthread_cond_signal(&store->pack_wake);
+    pthread_mutex_unlock(&store->pack_lock);
+
+    pthread_join(store->packer, NULL);
+    store->packer_running = false;
+}
+
+/* Start a new segment large enough for at least min_size bytes */
+static mem_error_t add_segment(text_store_t* store, size_t min_size) {
+    text_header_t* hdr = get_header(store);
+    size_t size = hdr->segment_size;
+    if (size < min_size) size = min_size;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), SEGMENT_FILE_FMT, store->base_dir, (unsigned)store->segment_count);
+
+    arena_t* segment = NULL;
+    MEM_CHECK(arena_create_mmap(&segment, path, size, 0));
+
+    mem_error_t err = push_segment(store, segment, NULL);
+    if (err != MEM_OK) {
+        arena_destroy(segment);
+        return err;
+    }
+
+    hdr->segment_count = (uint32_t)store->segment_count;
+    hdr->tail_offset = 0;
+    return MEM_OK;
+}
+
+/* Map packed segment i, checking it against the loaded dictionary */
+static mem_error_t open_packed(text_store_t* store, const char* path, arena_t** out) {
+    arena_t* packed = NULL;
+    MEM_CHECK(arena_open_mmap(&packed, path, ARENA_FLAG_READONLY));
+
+    const packed_header_t* hdr = packed_header(packed);
+    bool ok = packed->size >= sizeof(packed_header_t) &&
+              hdr->magic == PACKED_MAGIC && hdr->version == PACKED_VERSION &&
+              hdr->block_size > 0 &&
+              hdr->block_count == (hdr->raw_size + hdr->block_size - 1) / hdr->block_size &&
+              packed->size >= sizeof(packed_header_t) + (hdr->block_count + 1) * sizeof(uint64_t) &&
+              (hdr->dict_check == 0 || hdr->dict_check == store->dict_check);
+    if (ok) {
+        size_t data_start = sizeof(packed_header_t) + (hdr->block_count + 1) * sizeof(uint64_t);
+        ok = packed_offsets(packed)[hdr->block_count] <= packed->size - data_start;
+    }
+    if (!ok) {
+        arena_destroy(packed);
+        MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid packed text segment");
+    }
+
+    *out = packed;
+    return MEM_OK;
+}
+
+static void close_all(text_store_t* s) {
+    stop_packer(s);
+
+    for (size_t i = 0; i < s->segment_count; i++) {
+        if (s->segments[i].raw) arena_destroy(s->segments[i].raw);
+        if (s->segments[i].packed) arena_destroy(s->segments[i].packed);
+    }
+    free(s->segments);
+    if (s->index_arena) arena_destroy(s->index_arena);
+    cache_destroy(s->cache);
+    free(s->dict);
+    free(s->base_dir);
+    pthread_cond_destroy(&s->pack_done);
+    pthread_cond_destroy(&s->pack_wake);
+    pthread_mutex_destroy(&s->pack_lock);
+    pthread_rwlock_destroy(&s->lock);
+    free(s);
+}
+
+/* Allocate store with default compression settings and start its packer */
+static mem_error_t alloc_store(text_store_t** store, const char* dir) {
+    text_store_t* s = calloc(1, sizeof(text_store_t));
+    MEM_CHECK_ALLOC(s);
+
+    s->compression = TEXT_COMPRESSION_DEFAULT;
+    s->base_dir = strdup(dir);
+    if (!s->base_dir) {
+        free(s);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate dir path");
+    }
+
+    mem_error_t err = cache_create(&s->cache, s->compression.cache_entries);
+    if (err != MEM_OK) {
+        free(s->base_dir);
+        free(s);
+        return err;
+    }
+
+    pthread_rwlock_init(&s->lock, NULL);
+    pthread_mutex_init(&s->pack_lock, NULL);
+    pthread_cond_init(&s->pack_wake, NULL);
+    pthread_cond_init(&s->pack_done, NULL);
+    if (pthread_create(&s->packer, NULL, packer_main, s) != 0) {
+        close_all(s);
+        MEM_RETURN_ERROR(MEM_ERR_THREAD, "failed to start text packer");
+    }
+    s->packer_running = true;
+
+    *store = s;
+    return MEM_OK;
+}
+
+mem_error_t text_store_create(text_store_t** store, const char* dir, size_t segment_size) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
+
+    text_store_t* s = NULL;
+    MEM_CHECK(alloc_store(&s, dir));
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, INDEX_FILE);
+
+    mem_error_t err = arena_create_mmap(&s->index_arena, path,
+                                        HEADER_SIZE + INITIAL_ENTRIES * sizeof(text_entry_t), 0);
+    if (err != MEM_OK) {
+        close_all(s);
+        return err;
+    }
+
+    text_header_t* hdr = get_header(s);
+    memset(hdr, 0, HEADER_SIZE);
+    hdr->magic = TEXT_MAGIC;
+    hdr->version = TEXT_VERSION;
+    hdr->capacity = INITIAL_ENTRIES;
+    hdr->segment_size = segment_size ? segment_size : TEXT_SEGMENT_SIZE_DEFAULT;
+    memset(get_entries(s), 0xFF, INITIAL_ENTRIES * sizeof(text_entry_t));
+
+    *store = s;
+    LOG_INFO("Text store created at %s", dir);
+    return MEM_OK;
+}
+
+mem_error_t text_store_open(text_store_t** store, const char* dir) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(dir != NULL, MEM_ERR_INVALID_ARG, "dir is NULL");
+
+    text_store_t* s = NULL;
+    MEM_CHECK(alloc_store(&s, dir));
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, INDEX_FILE);
+
+    mem_error_t err = arena_open_mmap(&s->index_arena, path, 0);
+    if (err != MEM_OK) {
+        close_all(s);
+        return err;
+    }
+
+    text_header_t* hdr = get_header(s);
+    if (s->index_arena->size < HEADER_SIZE ||
+        hdr->magic != TEXT_MAGIC || hdr->version != TEXT_VERSION ||
+        s->index_arena->size < HEADER_SIZE + (size_t)hdr->capacity * sizeof(text_entry_t) ||
+        hdr->count > hdr->capacity || hdr->segment_size == 0) {
+        close_all(s);
+        MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid text index in %s", dir);
+    }
+
+    err = load_dictionary(s);
+    if (err != MEM_OK) {
+        close_all(s);
+        return err;
+    }
+
+    for (uint32_t i = 0; i < hdr->segment_count; i++) {
+        char raw_path[PATH_MAX];
+        arena_t* raw = NULL;
+        arena_t* packed = NULL;
+
+        /* A packed copy wins; a leftover raw file means packing was interrupted */
+        snprintf(path, sizeof(path), PACKED_FILE_FMT, dir, (unsigned)i);
+        snprintf(raw_path, sizeof(raw_path), SEGMENT_FILE_FMT, dir, (unsigned)i);
+        if (access(path, F_OK) == 0) {
+            err = open_packed(s, path, &packed);
+            if (err == MEM_OK) unlink(raw_path);
+        } else {
+            err = arena_open_mmap(&raw, raw_path, 0);
+        }
+        if (err == MEM_OK) {
+            err = push_segment(s, raw, packed);
+            if (err != MEM_OK) {
+                if (raw) arena_destroy(raw);
+                if (packed) arena_destroy(packed);
+            }
+        }
+        if (err != MEM_OK) {
+            close_all(s);
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "missing text segment %u in %s", i, dir);
+        }
+    }
+
+    if (s->segment_count > 0) {
+        const text_segment_t* tail = &s->segments[s->segment_count - 1];
+        if (!tail->raw || hdr->tail_offset > tail->raw->size) {
+            close_all(s);
+            MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "invalid text tail in %s", dir);
+        }
+    }
+
+    s->dirty_from = s->segment_count;
+    request_pack(s);
+
+    *store = s;
+    LOG_INFO("Text store opened at %s with %zu segments", dir, s->segment_count);
+    return MEM_OK;
+}
+
+mem_error_t text_store_set_compression(text_store_t* store, const text_compression_t* config) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(config != NULL, MEM_ERR_INVALID_ARG, "config is NULL");
+    MEM_CHECK_ERR(config->hot_segments >= 1, MEM_ERR_INVALID_ARG, "hot_segments must be >= 1");
+    MEM_CHECK_ERR(config->block_size > 0, MEM_ERR_INVALID_ARG, "block_size must be > 0");
+
+    text_block_cache_t* cache = NULL;
+    if (config->cache_entries != store->compression.cache_entries) {
+        MEM_CHECK(cache_create(&cache, config->cache_entries));
+    }
+
+    pthread_rwlock_wrlock(&store->lock);
+    if (cache) {
+        text_block_cache_t* old = store->cache;
+        store->cache = cache;
+        cache = old;
+    }
+    store->compression = *config;
+    pthread_rwlock_unlock(&store->lock);
+
+    cache_destroy(cache);
+    request_pack(store);
+    return MEM_OK;
+}
+
+/* Append with the store lock held exclusive; *added is set if a segment was sealed */
+static mem_error_t put_locked(text_store_t* store, node_id_t node_id,
+                              const char* text, size_t len, bool* added) {
+    MEM_CHECK(ensure_entries(store, (size_t)node_id + 1));
+
+    text_header_t* hdr = get_header(store);
+    size_t need = len + 1;
+
+    if (store->segment_count == 0 ||
+        hdr->tail_offset + need > store->segments[store->segment_count - 1].raw->size) {
+        MEM_CHECK(add_segment(store, need));
+        *added = true;
+    }
+
+    size_t segment = store->segment_count - 1;
+    char* dst = (char*)store->segments[segment].raw->base + hdr->tail_offset;
+    if (len > 0) memcpy(dst, text, len);
+    dst[len] = '\0';
+    arena_mark_dirty(store->segments[segment].raw, hdr->tail_offset, need);
+
+    /* Publish the entry only after its bytes are in place */
+    text_entry_t* entry = &get_entries(store)[node_id];
+    entry->offset = hdr->tail_offset;
+    entry->length = (uint32_t)len;
+    entry->segment = (uint32_t)segment;
+
+    hdr->tail_offset += need;
+    hdr->total_bytes += need;
+    if (node_id >= hdr->count) hdr->count = node_id + 1;
+    if (segment < store->dirty_from) store->dirty_from = segment;
+    arena_mark_dirty(store->index_arena, 0, HEADER_SIZE);
+    arena_mark_dirty(store->index_arena, HEADER_SIZE + (size_t)node_id * sizeof(text_entry_t),
+                     sizeof(text_entry_t));
+
+    return MEM_OK;
+}
+
+mem_error_t text_store_put(text_store_t* store, node_id_t node_id,
+                           const char* text, size_t len) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+    MEM_CHECK_ERR(text != NULL || len == 0, MEM_ERR_INVALID_ARG, "text is NULL");
+    MEM_CHECK_ERR(node_id != NODE_ID_INVALID, MEM_ERR_INVALID_ARG, "invalid node id");
+    MEM_CHECK_ERR(len < UINT32_MAX, MEM_ERR_INVALID_ARG, "text too long");
+
+    bool added = false;
+    pthread_rwlock_wrlock(&store->lock);
+    mem_error_t err = put_locked(store, node_id, text, len, &added);
+    pthread_rwlock_unlock(&store->lock);
+
+    /* Compression of the segment that just went cold happens off this path */
+    if (added) request_pack(store);
+    return err;
+}
+
+bool text_store_get(const text_store_t* store, node_id_t node_id,
+                    char* buf, size_t size, size_t* len) {
+    if (len) *len = 0;
+    if (size > 0) buf[0] = '\0';
+    if (!store) return false;
+
+    pthread_rwlock_t* lock = (pthread_rwlock_t*)&store->lock;
+    pthread_rwlock_rdlock(lock);
+
+    bool found = false;
+    const text_entry_t* entry = node_id < get_header(store)->count
+                                ? &get_entries(store)[node_id] : NULL;
+    if (entry && entry->segment != NO_SEGMENT && entry->segment < store->segment_count) {
+        size_t n = entry->length;
+        if (size == 0) n = 0;
+        else if (n > size - 1) n = size - 1;
+
+        /* Cold text decompresses only the blocks covering the part copied */
+        const text_segment_t* seg = &store->segments[entry->segment];
+        found = true;
+        if (n > 0) {
+            if (seg->raw) {
+                memcpy(buf, (const char*)seg->raw->base + entry->offset, n);
+            } else if (!cache_read(store, entry->segment, entry->offset, n, buf)) {
+                n = 0;
+                found = false;
+            }
+        }
+        if (size > 0) buf[n] = '\0';
+        if (found && len) *len = entry->length;
+    }
+
+    pthread_rwlock_unlock(lock);
+    return found;
+}
+
+void text_store_flush(text_store_t* store) {
+    if (!store) return;
+
+    pthread_mutex_lock(&store->pack_lock);
+    uint64_t ticket = ++store->pack_requested;
+    pthread_cond_signal(&store->pack_wake);
+    while (store->pack_served < ticket && !store->pack_stopping) {
+        pthread_cond_wait(&store->pack_done, &store->pack_lock);
+    }
+    pthread_mutex_unlock(&store->pack_lock);
+}
+
+size_t text_store_bytes(const text_store_t* store) {
+    if (!store) return 0;
+
+    pthread_rwlock_t* lock = (pthread_rwlock_t*)&store->lock;
+    pthread_rwlock_rdlock(lock);
+    size_t bytes = (size_t)get_header(store)->total_bytes;
+    pthread_rwlock_unlock(lock);
+    return bytes;
+}
+
+void text_store_get_stats(const text_store_t* store, text_store_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!store) return;
+
+    pthread_rwlock_t* lock = (pthread_rwlock_t*)&store->lock;
+    pthread_rwlock_rdlock(lock);
+    for (size_t i = 0; i < store->segment_count; i++) {
+        const arena_t* packed = store->segments[i].packed;
+        if (!packed) {
+            stats->raw_segments++;
+            continue;
+        }
+        stats->packed_segments++;
+        stats->packed_raw_bytes += packed_header(packed)->raw_size;
+        stats->packed_bytes += packed->size;
+    }
+
+    pthread_mutex_lock(&store->cache->lock);
+    stats->cache_hits = store->cache->hits;
+    stats->cache_misses = store->cache->misses;
+    pthread_mutex_unlock(&store->cache->lock);
+    pthread_rwlock_unlock(lock);
+}
+
+mem_error_t text_store_sync(text_store_t* store) {
+    MEM_CHECK_ERR(store != NULL, MEM_ERR_INVALID_ARG, "store is NULL");
+
+    /* Puts wait; pack_lock keeps the packer from unmapping a segment here,
+     * and serializes syncs, which both update dirty_from */
+    pthread_mutex_lock(&store->pack_lock);
+    pthread_rwlock_rdlock(&store->lock);
+
+    /* Text first, so a synced index never points at unsynced bytes */
+    mem_error_t err = MEM_OK;
+    for (size_t i = store->dirty_from; i < store->segment_count && err == MEM_OK; i++) {
+        if (store->segments[i].raw) err = arena_sync(store->segments[i].raw);
+    }
+    if (err == MEM_OK) {
+        store->dirty_from = store->segment_count;
+        err = arena_sync(store->index_arena);
+    }
+
+    pthread_rwlock_unlock(&store->lock);
+    pthread_mutex_unlock(&store->pack_lock);
+    return err;
+}
+
+void text_store_pause_writes(text_store_t* store) {
+    if (!store) return;
+
+    /* Packing writes and renames files outside pack_lock, so let the
+     * segment in hand finish and keep the packer from starting another */
+    pthread_mutex_lock(&store->pack_lock);
+    store->pack_paused = true;
+    while (store->pack_active) {
+        pthread_cond_wait(&store->pack_done, &store->pack_lock);
+    }
+    pthread_rwlock_rdlock(&store->lock);
+}
+
+void text_store_resume_writes(text_store_t* store) {
+    if (!store) return;
+
+    pthread_rwlock_unlock(&store->lock);
+    store->pack_paused = false;
+    pthread_cond_signal(&store->pack_wake);
+    pthread_mutex_unlock(&store->pack_lock);
+}
+
+void text_store_close(text_store_t* store) {
+    if (!store) return;
+
+    stop_packer(store);
+    text_store_sync(store);
+    close_all(store);
+}
@@ -0,0 +1,146 @@
+/*
+ * Memory Service - Text Storage
+ *
+ * Append-only, mmap'd log of node text:
+ * - segment_N.log files hold NUL-terminated text back to back
+ * - index.bin holds (segment, offset, length) per node_id
+ *
+ * Rewriting a node's text appends a new copy; the old bytes are left in
+ * place. Text lives in file-backed pages only, so once synced the kernel
+ * can drop cold text from memory and fault it back in on access.
+ *
+ * Once a segment falls out of the newest hot_segments it is sealed, and
+ * a background packer thread rewrites it as segment_N.lz off the put
+ * path: fixed-size blocks, each compressed on its
+ * own (see util/lz.h), optionally against a dictionary sampled from the
+ * first sealed segment (dict.bin). Reads copy hot text straight out of
+ * the mapping; reads of cold text decompress only the blocks covering it
+ * into a small LRU of decompressed blocks and copy out of that. The raw
+ * segment is unmapped only once no read can still be copying from it.
+ */
+
+#ifndef MEMORY_SERVICE_TEXT_STORE_H
+#define MEMORY_SERVICE_TEXT_STORE_H
+
+#include "../core/arena.h"
+#include "../../include/types.h"
+#include "../../include/error.h"
+
+#include <pthread.h>
+
+/* Default size of one log segment */
+#define TEXT_SEGMENT_SIZE_DEFAULT (64 * 1024 * 1024)
+
+/* Compression of sealed segments */
+typedef struct {
+    bool        enabled;
+    uint32_t    hot_segments;       /* Newest segments left uncompressed (min 1) */
+    uint32_t    block_size;         /* Raw bytes per compressed block */
+    uint32_t    cache_entries;      /* Decompressed block runs kept in the LRU */
+    bool        dictionary;         /* Train and use a shared dictionary */
+} text_compression_t;
+
+#define TEXT_COMPRESSION_DEFAULT ((text_compression_t){ \
+    .enabled = true, .hot_segments = 2, .block_size = 64 * 1024, \
+    .cache_entries = 64, .dictionary = true })
+
+/* One log segment: mapped raw while hot, block-compressed once cold */
+typedef struct {
+    arena_t*        raw;                /* segment_N.log, NULL once compressed */
+    arena_t*        packed;             /* segment_N.lz, NULL while raw */
+} text_segment_t;
+
+/* Text store counters */
+typedef struct {
+    size_t      raw_segments;
+    size_t      packed_segments;
+    uint64_t    packed_raw_bytes;       /* Uncompressed size of packed segments */
+    uint64_t    packed_bytes;           /* On-disk size of packed segments */
+    uint64_t    cache_hits;
+    uint64_t    cache_misses;
+} text_store_stats_t;
+
+/* Decompressed block cache (opaque) */
+typedef struct text_block_cache text_block_cache_t;
+
+/* Text store */
+typedef struct {
+    arena_t*            index_arena;    /* header + entry[node_id] */
+    text_segment_t*     segments;
+    size_t              segment_count;
+    size_t              segment_slots;  /* Allocated length of segments[] */
+    size_t              dirty_from;     /* First segment written since last sync */
+    text_compression_t  compression;
+    uint8_t*            dict;           /* Shared dictionary, NULL if none */
+    size_t              dict_len;
+    uint32_t            dict_check;     /* Checksum recorded in packed segments */
+    text_block_cache_t* cache;
+    char*               base_dir;
+
+    /*
+     * Reads hold lock shared; puts, packed-segment swaps and settings
+     * changes hold it exclusive, so once a swap has held it no read is
+     * still copying from the raw segment it replaced.
+     */
+    pthread_rwlock_t    lock;
+
+    /* Background packer, woken per request; syncs hold pack_lock so the
+     * packer does not unmap a raw segment they are flushing, and pauses
+     * hold it once no segment is mid-pack */
+    pthread_t           packer;
+    bool                packer_running;
+    pthread_mutex_t     pack_lock;
+    pthread_cond_t      pack_wake;      /* Pass requested, resumed or stopping */
+    pthread_cond_t      pack_done;      /* A pass or a segment finished */
+    uint64_t            pack_requested;
+    uint64_t            pack_served;
+    bool                pack_stopping;
+    bool                pack_active;    /* A segment is being packed */
+    bool                pack_paused;    /* Start no segment until resumed */
+} text_store_t;
+
+/* Create text store; segment_size 0 selects TEXT_SEGMENT_SIZE_DEFAULT */
+mem_error_t text_store_create(text_store_t** store, const char* dir, size_t segment_size);
+
+/* Open existing text store (MEM_ERR_OPEN if missing) */
+mem_error_t text_store_open(text_store_t** store, const char* dir);
+
+/* Change compression settings; the packer compresses any segments now cold */
+mem_error_t text_store_set_compression(text_store_t* store, const text_compression_t* config);
+
+/* Append text for node_id, replacing any earlier text */
+mem_error_t text_store_put(text_store_t* store, node_id_t node_id,
+                           const char* text, size_t len);
+
+/*
+ * Copy node_id's text into buf as a C string, truncated to fit in size
+ * bytes, and set *len to its full length. Returns false if it has none.
+ * With size 0 (buf may be NULL) it only reports the length.
+ */
+bool text_store_get(const text_store_t* store, node_id_t node_id,
+                    char* buf, size_t size, size_t* len);
+
+/* Wait until the packer has compressed every cold segment it can */
+void text_store_flush(text_store_t* store);
+
+/* Total bytes appended to the log, including superseded text */
+size_t text_store_bytes(const text_store_t* store);
+
+/* Get counters */
+void text_store_get_stats(const text_store_t* store, text_store_stats_t* stats);
+
+/* Sync to disk */
+mem_error_t text_store_sync(text_store_t* store);
+
+/*
+ * Hold off puts and packing so the files can be copied as one consistent
+ * store; reads go on. Every pause must be matched by a resume, with no
+ * put or sync from the same thread in between.
+ */
+void text_store_pause_writes(text_store_t* store);
+void text_store_resume_writes(text_store_t* store);
+
+/* Close store */
+void text_store_close(text_store_t* store);
+
+#endif /* MEMORY_SERVICE_TEXT_STORE_H */
@@ -5,15 +5,18 @@
 #include "wal.h"
 #include "../util/log.h"
 #include "../util/time.h"
+#include "../util/checksum.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <dirent.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <inttypes.h>
-#include <pthread.h>
+#include <limits.h>
 
 /* Default write buffer size */
 #define DEFAULT_WRITE_BUF_SIZE (64 * 1024)
@@ -21,83 +24,626 @@
 /* Maximum allowed WAL data length to prevent DoS from corrupted/malicious files */
 #define MAX_WAL_DATA_LEN (64 * 1024 * 1024)  /* 64 MB */
 
-/* CRC32 lookup table - thread-safe initialization using pthread_once */
-static uint32_t crc32_table[256];
-static pthread_once_t crc32_init_once = PTHREAD_ONCE_INIT;
+/* O_DIRECT alignment and staging buffer size */
+#define DIRECT_ALIGN 4096
+#define DIRECT_BUF_SIZE (1024 * 1024)
 
-static void init_crc32_table_impl(void) {
-    for (uint32_t i = 0; i < 256; i++) {
-        uint32_t crc = i;
-        for (int j = 0; j < 8; j++) {
-            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
-        }
-        crc32_table[i] = crc;
+static inline size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static bool all_zero(const void* p, size_t len) {
+    const uint8_t* b = p;
+    for (size_t i = 0; i < len; i++) {
+        if (b[i]) return false;
     }
+    return true;
 }
 
-static void init_crc32_table(void) {
-    pthread_once(&crc32_init_once, init_crc32_table_impl);
+static void segment_name(const wal_t* w, uint32_t slot, char* buf, size_t len) {
+    snprintf(buf, len, WAL_SEGMENT_NAME_FMT, w->path, slot);
 }
 
-static uint32_t compute_crc32(const void* data, size_t len) {
-    init_crc32_table();
+/* Directory holding the segments; base receives the file name prefix */
+static void split_path(const char* path, char* dir, size_t len, const char** base) {
+    const char* slash = strrchr(path, '/');
+    if (!slash) {
+        snprintf(dir, len, ".");
+        *base = path;
+    } else if (slash == path) {
+        snprintf(dir, len, "/");
+        *base = slash + 1;
+    } else {
+        snprintf(dir, len, "%.*s", (int)(slash - path), path);
+        *base = slash + 1;
+    }
+}
 
-    const uint8_t* buf = (const uint8_t*)data;
-    uint32_t crc = 0xFFFFFFFF;
+/* Make a new directory entry durable */
+static void sync_dir(const wal_t* w) {
+    char dir[PATH_MAX];
+    const char* base;
+    split_path(w->path, dir, sizeof(dir), &base);
 
-    for (size_t i = 0; i < len; i++) {
-        crc = crc32_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
     }
+}
 
-    return crc ^ 0xFFFFFFFF;
+static mem_error_t push_slot(uint32_t** slots, size_t* count, uint32_t slot) {
+    uint32_t* grown = realloc(*slots, (*count + 1) * sizeof(uint32_t));
+    MEM_CHECK_ALLOC(grown);
+    grown[(*count)++] = slot;
+    *slots = grown;
+    return MEM_OK;
 }
 
-mem_error_t wal_create(wal_t** wal, const char* path, size_t max_size) {
-    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal pointer is NULL");
-    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
-    MEM_CHECK_ERR(max_size > 0, MEM_ERR_INVALID_ARG, "max_size must be > 0");
+static int open_flags(wal_io_mode_t mode) {
+    switch (mode) {
+        case WAL_IO_DSYNC:  return O_RDWR | O_DSYNC;
+        case WAL_IO_DIRECT: return O_RDWR | O_DSYNC | O_DIRECT;
+        default:            return O_RDWR;
+    }
+}
 
-    wal_t* w = calloc(1, sizeof(wal_t));
-    MEM_CHECK_ALLOC(w);
+/* Open a segment for writing in the current I/O mode */
+static mem_error_t open_segment(wal_t* w, uint32_t slot, int extra, int* out) {
+    char name[PATH_MAX];
+    segment_name(w, slot, name, sizeof(name));
 
-    /* Open or create file */
-    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    int fd = open(name, open_flags(w->io_mode) | extra, 0644);
+    if (fd < 0 && errno == EINVAL && w->io_mode == WAL_IO_DIRECT) {
+        LOG_WARN("WAL: O_DIRECT not supported for %s, using O_DSYNC", name);
+        w->io_mode = WAL_IO_DSYNC;
+        fd = open(name, open_flags(w->io_mode) | extra, 0644);
+    }
     if (fd < 0) {
-        free(w);
-        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL %s", path);
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL segment %u", slot);
     }
+    *out = fd;
+    return MEM_OK;
+}
+
+/* Reserve blocks so appends do not extend the file */
+static mem_error_t preallocate(int fd, size_t size) {
+    if (fallocate(fd, 0, 0, (off_t)size) == 0) return MEM_OK;
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to preallocate WAL segment");
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_TRUNCATE, "failed to size WAL segment");
+    }
+    return MEM_OK;
+}
+
+/* Write a segment header block and sync it; direct when fd is O_DIRECT */
+static mem_error_t write_segment_header(wal_t* w, int fd, bool direct, uint64_t start_seq) {
+    wal_segment_header_t hdr = {
+        .magic = WAL_SEGMENT_MAGIC,
+        .version = WAL_SEGMENT_VERSION,
+        .start_seq = start_seq
+    };
+
+    const void* buf = &hdr;
+    size_t len = sizeof(hdr);
+    if (direct) {
+        memset(w->direct_buf, 0, WAL_SEGMENT_HEADER_SIZE);
+        memcpy(w->direct_buf, &hdr, sizeof(hdr));
+        buf = w->direct_buf;
+        len = WAL_SEGMENT_HEADER_SIZE;
+    }
+
+    if (pwrite(fd, buf, len, 0) != (ssize_t)len) {
+        MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write WAL segment header");
+    }
+    if (fdatasync(fd) < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_SYNC, "failed to sync WAL segment header");
+    }
+    return MEM_OK;
+}
+
+static mem_error_t read_segment_header(const wal_t* w, uint32_t slot, wal_segment_header_t* hdr) {
+    char name[PATH_MAX];
+    segment_name(w, slot, name, sizeof(name));
+
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL segment %u", slot);
+    }
+    ssize_t n = pread(fd, hdr, sizeof(*hdr), 0);
+    close(fd);
+
+    if (n != (ssize_t)sizeof(*hdr) || hdr->magic != WAL_SEGMENT_MAGIC ||
+        hdr->version < WAL_SEGMENT_VERSION_CRC32 || hdr->version > WAL_SEGMENT_VERSION) {
+        MEM_RETURN_ERROR(MEM_ERR_WAL_CORRUPT, "bad header in WAL segment %u", slot);
+    }
+    return MEM_OK;
+}
+
+/* Stage the tail block of the current segment for aligned rewrites */
+static mem_error_t load_direct_tail(wal_t* w) {
+    if (w->io_mode != WAL_IO_DIRECT || w->offset % DIRECT_ALIGN == 0) return MEM_OK;
+
+    off_t block = (off_t)(w->offset - w->offset % DIRECT_ALIGN);
+    if (pread(w->fd, w->direct_buf, DIRECT_ALIGN, block) != DIRECT_ALIGN) {
+        MEM_RETURN_ERROR(MEM_ERR_READ, "failed to read WAL tail block");
+    }
+    return MEM_OK;
+}
+
+/* Make slot the current segment, appending at offset */
+static mem_error_t open_current(wal_t* w, uint32_t slot, size_t offset) {
+    int fd;
+    MEM_CHECK(open_segment(w, slot, 0, &fd));
 
-    /* Get current size */
     struct stat st;
     if (fstat(fd, &st) < 0) {
         close(fd);
-        free(w);
-        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to stat WAL");
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to stat WAL segment");
+    }
+
+    w->fd = fd;
+    w->offset = offset;
+    w->segment_end = (size_t)st.st_size;
+    return load_direct_tail(w);
+}
+
+/* Close the current segment, syncing what buffered writes left behind */
+static mem_error_t close_current(wal_t* w) {
+    if (w->fd < 0) return MEM_OK;
+
+    int fd = w->fd;
+    w->fd = -1;
+    bool synced = w->io_mode != WAL_IO_BUFFERED || fdatasync(fd) == 0;
+    close(fd);
+    if (!synced) {
+        MEM_RETURN_ERROR(MEM_ERR_SYNC, "failed to sync WAL segment");
+    }
+    return MEM_OK;
+}
+
+/* Create a preallocated spare segment file */
+static mem_error_t create_spare(wal_t* w, size_t size) {
+    uint32_t slot = w->next_slot;
+
+    int fd;
+    MEM_CHECK(open_segment(w, slot, O_CREAT | O_EXCL, &fd));
+    mem_error_t err = preallocate(fd, size);
+    close(fd);
+    if (err != MEM_OK) return err;
+
+    w->next_slot++;
+    sync_dir(w);
+    return push_slot(&w->spares, &w->spare_count, slot);
+}
+
+/* Start a new current segment for records from first_seq, big enough for bytes */
+static mem_error_t roll_segment(wal_t* w, size_t bytes, uint64_t first_seq) {
+    size_t size = round_up(WAL_SEGMENT_HEADER_SIZE + bytes, DIRECT_ALIGN);
+    if (size < w->config.segment_size) size = round_up(w->config.segment_size, DIRECT_ALIGN);
+
+    MEM_CHECK(close_current(w));
+    if (w->spare_count == 0) MEM_CHECK(create_spare(w, size));
+
+    uint32_t slot = w->spares[--w->spare_count];
+    MEM_CHECK(open_current(w, slot, WAL_SEGMENT_HEADER_SIZE));
+
+    mem_error_t err = MEM_OK;
+    if (w->segment_end < size) {
+        err = preallocate(w->fd, size);
+        if (err == MEM_OK) w->segment_end = size;
+    }
+    if (err == MEM_OK) {
+        err = write_segment_header(w, w->fd, w->io_mode == WAL_IO_DIRECT, first_seq);
+    }
+    if (err == MEM_OK) err = push_slot(&w->segments, &w->segment_count, slot);
+    if (err != MEM_OK) {
+        close(w->fd);
+        w->fd = -1;
+        w->spare_count++;
+        return err;
+    }
+
+    LOG_DEBUG("WAL segment %u started at sequence %" PRIu64, slot, first_seq);
+    return MEM_OK;
+}
+
+/* Write all of iov at offset, resuming after short writes */
+static mem_error_t pwrite_all(int fd, struct iovec* iov, int iovcnt, off_t offset) {
+    while (iovcnt > 0) {
+        int n = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+        ssize_t written = pwritev(fd, iov, n, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write WAL records");
+        }
+        offset += written;
+
+        size_t left = (size_t)written;
+        while (iovcnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (left > 0) {
+            iov->iov_base = (char*)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
     }
+    return MEM_OK;
+}
+
+static mem_error_t pwrite_block(int fd, void* buf, size_t len, off_t offset) {
+    struct iovec iov = { buf, len };
+    return pwrite_all(fd, &iov, 1, offset);
+}
 
-    /* Allocate write buffer */
-    void* buf = malloc(DEFAULT_WRITE_BUF_SIZE);
-    if (!buf) {
+/*
+ * O_DIRECT writes whole aligned blocks: the partial tail block is kept in
+ * the staging buffer and rewritten, padded with zeros, by the next write.
+ */
+static mem_error_t write_direct(wal_t* w, const struct iovec* iov, int iovcnt) {
+    size_t fill = w->offset % DIRECT_ALIGN;
+    off_t base = (off_t)(w->offset - fill);
+
+    for (int i = 0; i < iovcnt; i++) {
+        const char* src = iov[i].iov_base;
+        size_t left = iov[i].iov_len;
+        while (left > 0) {
+            size_t n = DIRECT_BUF_SIZE - fill;
+            if (n > left) n = left;
+            memcpy(w->direct_buf + fill, src, n);
+            fill += n;
+            src += n;
+            left -= n;
+
+            if (fill == DIRECT_BUF_SIZE) {
+                MEM_CHECK(pwrite_block(w->fd, w->direct_buf, fill, base));
+                base += (off_t)fill;
+                fill = 0;
+            }
+        }
+    }
+
+    if (fill > 0) {
+        size_t padded = round_up(fill, DIRECT_ALIGN);
+        memset(w->direct_buf + fill, 0, padded - fill);
+        MEM_CHECK(pwrite_block(w->fd, w->direct_buf, padded, base));
+
+        size_t tail = fill % DIRECT_ALIGN;
+        memmove(w->direct_buf, w->direct_buf + fill - tail, tail);
+    }
+    return MEM_OK;
+}
+
+/* Write records at the end of the current segment */
+static mem_error_t write_records(wal_t* w, struct iovec* iov, int iovcnt, size_t bytes) {
+    if (w->io_mode == WAL_IO_DIRECT) {
+        MEM_CHECK(write_direct(w, iov, iovcnt));
+    } else {
+        MEM_CHECK(pwrite_all(w->fd, iov, iovcnt, (off_t)w->offset));
+    }
+    w->offset += bytes;
+    w->size += bytes;
+    return MEM_OK;
+}
+
+static inline size_t record_bytes(const wal_record_t* r) {
+    return sizeof(wal_entry_header_t) + (r->data ? r->len : 0);
+}
+
+/* Result of walking one segment */
+typedef struct {
+    size_t      end;                /* Offset after the last intact record */
+    size_t      bytes;              /* Record bytes before end */
+    uint64_t    next_seq;           /* Sequence the next record must carry */
+    uint64_t    start_seq;
+    uint64_t    checkpoint_seq;     /* Last checkpoint marker, 0 if none */
+    uint64_t    replayed;
+    uint32_t    version;            /* Segment format version */
+    bool        torn;               /* Ended on damage rather than the clean end */
+} segment_scan_t;
+
+/* Checksum of a record payload in a segment of the given version */
+static uint32_t record_crc(uint32_t version, const void* data, size_t len) {
+    return version == WAL_SEGMENT_VERSION_CRC32 ? checksum_crc32_ieee(data, len)
+                                                : checksum_crc32c(data, len);
+}
+
+/*
+ * Walk a segment's records, passing those after from_seq to callback (if
+ * any). The walk ends at zeroed space, at a record left from an earlier
+ * use of the file (older sequence), or at damage.
+ */
+static mem_error_t scan_segment(wal_t* w, uint32_t slot, uint64_t from_seq,
+                                wal_replay_fn callback, void* user_data,
+                                segment_scan_t* scan) {
+    wal_segment_header_t hdr;
+    MEM_CHECK(read_segment_header(w, slot, &hdr));
+
+    char name[PATH_MAX];
+    segment_name(w, slot, name, sizeof(name));
+    int fd = open(name, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) close(fd);
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL segment %u", slot);
+    }
+    size_t file_size = (size_t)st.st_size;
+
+    memset(scan, 0, sizeof(*scan));
+    scan->start_seq = hdr.start_seq;
+    scan->next_seq = hdr.start_seq;
+    scan->version = hdr.version;
+    scan->end = WAL_SEGMENT_HEADER_SIZE;
+
+    mem_error_t err = MEM_OK;
+    for (;;) {
+        wal_entry_header_t header;
+        ssize_t n = pread(fd, &header, sizeof(header), (off_t)scan->end);
+        if (n < 0) {
+            err = MEM_ERR_READ;
+            LOG_ERROR("failed to read WAL segment %u", slot);
+            break;
+        }
+        if ((size_t)n < sizeof(header)) {
+            scan->torn = !all_zero(&header, (size_t)n);
+            break;
+        }
+        if (header.magic != WAL_MAGIC) {
+            scan->torn = !all_zero(&header, sizeof(header));
+            break;
+        }
+        if (header.sequence != scan->next_seq) {
+            /* Lower sequences are left over from the segment's last use */
+            scan->torn = header.sequence > scan->next_seq;
+            break;
+        }
+        if (header.data_len > MAX_WAL_DATA_LEN ||
+            scan->end + sizeof(header) + header.data_len > file_size) {
+            scan->torn = true;
+            break;
+        }
+
+        void* data = NULL;
+        if (header.data_len > 0) {
+            data = header.data_len <= w->write_buf_size ? w->write_buf : malloc(header.data_len);
+            if (!data) {
+                err = MEM_ERR_NOMEM;
+                LOG_ERROR("failed to allocate WAL data buffer");
+                break;
+            }
+            n = pread(fd, data, header.data_len, (off_t)(scan->end + sizeof(header)));
+            if (n != (ssize_t)header.data_len ||
+                record_crc(hdr.version, data, header.data_len) != header.crc32) {
+                if (data != w->write_buf) free(data);
+                scan->torn = true;
+                break;
+            }
+        }
+
+        if (header.op_type == WAL_OP_CHECKPOINT) {
+            scan->checkpoint_seq = header.sequence;
+        } else if (callback && header.sequence > from_seq) {
+            err = callback(header.op_type, data, header.data_len, user_data);
+            scan->replayed++;
+        }
+        if (data && data != w->write_buf) free(data);
+        if (err != MEM_OK) break;
+
+        scan->end += sizeof(header) + header.data_len;
+        scan->bytes += sizeof(header) + header.data_len;
+        scan->next_seq++;
+    }
+
+    close(fd);
+    return err;
+}
+
+/* Live segment ordering entry */
+typedef struct {
+    uint32_t    slot;
+    uint64_t    start_seq;
+} live_segment_t;
+
+static int compare_live(const void* a, const void* b) {
+    const live_segment_t* x = a;
+    const live_segment_t* y = b;
+    return x->start_seq < y->start_seq ? -1 : x->start_seq > y->start_seq;
+}
+
+/* Find segment files; live ones are ordered by their first sequence */
+static mem_error_t discover_segments(wal_t* w) {
+    char dir[PATH_MAX];
+    const char* base;
+    split_path(w->path, dir, sizeof(dir), &base);
+    size_t base_len = strlen(base);
+
+    DIR* d = opendir(dir);
+    if (!d) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL directory");
+    }
+
+    live_segment_t* live = NULL;
+    size_t live_count = 0;
+    mem_error_t err = MEM_OK;
+
+    struct dirent* de;
+    while (err == MEM_OK && (de = readdir(d)) != NULL) {
+        const char* name = de->d_name;
+        if (strncmp(name, base, base_len) != 0 || name[base_len] != '.') continue;
+
+        const char* digits = name + base_len + 1;
+        char* end;
+        errno = 0;
+        unsigned long slot = strtoul(digits, &end, 10);
+        if (*digits < '0' || *digits > '9' || *end != '\0' || errno || slot > UINT32_MAX) continue;
+
+        if (slot >= w->next_slot) w->next_slot = (uint32_t)slot + 1;
+
+        wal_segment_header_t hdr;
+        if (read_segment_header(w, (uint32_t)slot, &hdr) != MEM_OK || hdr.start_seq == 0) {
+            err = push_slot(&w->spares, &w->spare_count, (uint32_t)slot);
+            continue;
+        }
+
+        live_segment_t* grown = realloc(live, (live_count + 1) * sizeof(live_segment_t));
+        if (!grown) {
+            err = MEM_ERR_NOMEM;
+            break;
+        }
+        live = grown;
+        live[live_count++] = (live_segment_t){ (uint32_t)slot, hdr.start_seq };
+    }
+    closedir(d);
+
+    if (live_count > 0) qsort(live, live_count, sizeof(live_segment_t), compare_live);
+    for (size_t i = 0; err == MEM_OK && i < live_count; i++) {
+        err = push_slot(&w->segments, &w->segment_count, live[i].slot);
+    }
+    free(live);
+
+    if (err != MEM_OK) {
+        MEM_RETURN_ERROR(err, "failed to list WAL segments");
+    }
+    return MEM_OK;
+}
+
+/* Find where the log ends and continue appending there */
+static mem_error_t open_tail(wal_t* w) {
+    for (size_t i = 0; i < w->segment_count; i++) {
+        segment_scan_t scan;
+        MEM_CHECK(scan_segment(w, w->segments[i], 0, NULL, NULL, &scan));
+
+        w->size += scan.bytes;
+        if (scan.next_seq > w->sequence) w->sequence = scan.next_seq;
+        if (scan.checkpoint_seq) w->checkpoint_seq = scan.checkpoint_seq;
+
+        if (i + 1 < w->segment_count) continue;
+
+        if (scan.torn) {
+            /* Leave the damage behind; the next append starts a new segment */
+            LOG_WARN("WAL: damaged record in segment %u at offset %zu, "
+                     "continuing in a new segment", w->segments[i], scan.end);
+            return MEM_OK;
+        }
+        if (scan.version != WAL_SEGMENT_VERSION) {
+            /* Records are only appended in the current format */
+            return MEM_OK;
+        }
+        MEM_CHECK(open_current(w, w->segments[i], scan.end));
+    }
+    return MEM_OK;
+}
+
+/* Carry records over from the single-file log older versions kept at path */
+static mem_error_t import_legacy_log(wal_t* w) {
+    int fd = open(w->path, O_RDONLY);
+    if (fd < 0) return MEM_OK;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
         close(fd);
-        free(w);
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate write buffer");
+        return MEM_OK;
     }
 
-    w->fd = fd;
+    bool sync = w->sync_on_write;
+    w->sync_on_write = false;
+
+    mem_error_t err = MEM_OK;
+    size_t imported = 0;
+    off_t offset = 0;
+    for (;;) {
+        wal_entry_header_t header;
+        if (pread(fd, &header, sizeof(header), offset) != (ssize_t)sizeof(header) ||
+            header.magic != WAL_MAGIC || header.data_len > MAX_WAL_DATA_LEN) {
+            break;
+        }
+
+        void* data = NULL;
+        if (header.data_len > 0) {
+            data = malloc(header.data_len);
+            if (!data) {
+                err = MEM_ERR_NOMEM;
+                break;
+            }
+            if (pread(fd, data, header.data_len, offset + (off_t)sizeof(header)) !=
+                    (ssize_t)header.data_len ||
+                checksum_crc32_ieee(data, header.data_len) != header.crc32) {
+                free(data);
+                break;
+            }
+        }
+
+        err = wal_append(w, header.op_type, data, header.data_len);
+        free(data);
+        if (err != MEM_OK) break;
+        if (header.op_type == WAL_OP_CHECKPOINT) w->checkpoint_seq = w->sequence - 1;
+
+        offset += (off_t)(sizeof(header) + header.data_len);
+        imported++;
+    }
+    close(fd);
+    w->sync_on_write = sync;
+
+    if (err == MEM_OK && w->fd >= 0 && fdatasync(w->fd) < 0) err = MEM_ERR_SYNC;
+    if (err != MEM_OK) {
+        MEM_RETURN_ERROR(err, "failed to import legacy WAL");
+    }
+
+    unlink(w->path);
+    LOG_INFO("WAL: imported %zu records from the single-file log", imported);
+    return MEM_OK;
+}
+
+void wal_close(wal_t* wal) {
+    if (!wal) return;
+
+    if (wal->fd >= 0) {
+        fsync(wal->fd);
+        close(wal->fd);
+    }
+
+    free(wal->segments);
+    free(wal->spares);
+    free(wal->path);
+    free(wal->write_buf);
+    free(wal->direct_buf);
+    free(wal);
+}
+
+mem_error_t wal_create(wal_t** wal, const char* path, size_t max_size) {
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal pointer is NULL");
+    MEM_CHECK_ERR(path != NULL, MEM_ERR_INVALID_ARG, "path is NULL");
+    MEM_CHECK_ERR(max_size > 0, MEM_ERR_INVALID_ARG, "max_size must be > 0");
+
+    wal_t* w = calloc(1, sizeof(wal_t));
+    MEM_CHECK_ALLOC(w);
+
+    w->fd = -1;
     w->path = strdup(path);
-    if (!w->path) {
-        close(fd);
-        free(buf);
-        free(w);
-        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL path");
+    w->write_buf = malloc(DEFAULT_WRITE_BUF_SIZE);
+    if (!w->path || !w->write_buf) {
+        wal_close(w);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL");
     }
-    w->size = (size_t)st.st_size;
     w->max_size = max_size;
-    w->sequence = 1;  /* Will be updated on replay */
+    w->sequence = 1;
     w->checkpoint_seq = 0;
     w->sync_on_write = true;
-    w->write_buf = buf;
     w->write_buf_size = DEFAULT_WRITE_BUF_SIZE;
+    w->config = WAL_CONFIG_DEFAULT;
+    w->io_mode = w->config.io_mode;
+
+    mem_error_t err = discover_segments(w);
+    if (err == MEM_OK) err = open_tail(w);
+    if (err == MEM_OK) err = import_legacy_log(w);
+    if (err != MEM_OK) {
+        wal_close(w);
+        return err;
+    }
 
     *wal = w;
     return MEM_OK;
@@ -107,51 +653,203 @@ mem_error_t wal_open(wal_t** wal, const char* path) {
     return wal_create(wal, path, SIZE_MAX);
 }
 
+mem_error_t wal_set_config(wal_t* wal, const wal_config_t* config) {
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+    MEM_CHECK_ERR(config != NULL, MEM_ERR_INVALID_ARG, "config is NULL");
+    MEM_CHECK_ERR(config->segment_size >= 2 * WAL_SEGMENT_HEADER_SIZE, MEM_ERR_INVALID_ARG,
+                  "segment_size must be at least %d", 2 * WAL_SEGMENT_HEADER_SIZE);
+    MEM_CHECK_ERR(config->io_mode <= WAL_IO_DIRECT, MEM_ERR_INVALID_ARG,
+                  "unknown io_mode %d", (int)config->io_mode);
+    MEM_CHECK_ERR(config->backend <= AIO_BACKEND_IO_URING, MEM_ERR_INVALID_ARG,
+                  "unknown backend %d", (int)config->backend);
+
+    if (config->io_mode == WAL_IO_DIRECT && !wal->direct_buf) {
+        void* buf = NULL;
+        if (posix_memalign(&buf, DIRECT_ALIGN, DIRECT_BUF_SIZE) != 0) {
+            MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL staging buffer");
+        }
+        wal->direct_buf = buf;
+    }
+
+    wal->config = *config;
+    if (config->io_mode != wal->io_mode) {
+        wal->io_mode = config->io_mode;
+        if (wal->fd >= 0) {
+            uint32_t slot = wal->segments[wal->segment_count - 1];
+            size_t offset = wal->offset;
+            MEM_CHECK(close_current(wal));
+            MEM_CHECK(open_current(wal, slot, offset));
+        }
+    }
+    return MEM_OK;
+}
+
+mem_error_t wal_prepare_segment(wal_t* wal) {
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+    if (wal->spare_count > 0) return MEM_OK;
+    return create_spare(wal, round_up(wal->config.segment_size, DIRECT_ALIGN));
+}
+
 mem_error_t wal_append(wal_t* wal, wal_op_type_t op,
                        const void* data, size_t len) {
     MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
 
-    /* Prepare header */
-    wal_entry_header_t header = {
-        .magic = WAL_MAGIC,
-        .crc32 = data ? compute_crc32(data, len) : 0,
-        .sequence = wal->sequence,
-        .timestamp_ns = time_wallclock_ns(),
-        .op_type = op,
-        .data_len = (uint32_t)len
-    };
+    wal_record_t record = { op, data, data ? len : 0 };
+    return wal_append_batch(wal, &record, 1);
+}
 
-    /* Write header */
-    ssize_t written = write(wal->fd, &header, sizeof(header));
-    if (written != sizeof(header)) {
-        MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write WAL header");
+/* Receives each segment's share of a batch, as iov to write at the tail */
+typedef mem_error_t (*batch_sink_fn)(wal_t* w, struct iovec* iov, int iovcnt,
+                                     size_t bytes, void* arg);
+
+/*
+ * Lay records out as headers and payload iovecs, rolling segments as
+ * needed, and pass each segment's part to sink. headers and iov need
+ * room for count and 2 * count entries.
+ */
+static mem_error_t append_records(wal_t* wal, const wal_record_t* records, size_t count,
+                                  wal_entry_header_t* headers, struct iovec* iov,
+                                  batch_sink_fn sink, void* arg) {
+    for (size_t i = 0; i < count; i++) {
+        MEM_CHECK_ERR(records[i].len <= MAX_WAL_DATA_LEN, MEM_ERR_INVALID_ARG,
+                      "WAL record of %zu bytes is too large", records[i].len);
     }
-    wal->size += sizeof(header);
 
-    /* Write data if present */
-    if (data && len > 0) {
-        written = write(wal->fd, data, len);
-        if (written != (ssize_t)len) {
-            MEM_RETURN_ERROR(MEM_ERR_WRITE, "failed to write WAL data");
+    uint64_t now = time_wallclock_ns();
+    size_t i = 0;
+
+    /* One write per segment the batch touches */
+    while (i < count) {
+        if (wal->fd < 0 || wal->offset + record_bytes(&records[i]) > wal->segment_end) {
+            MEM_CHECK(roll_segment(wal, record_bytes(&records[i]), wal->sequence));
+        }
+
+        size_t first = i;
+        size_t bytes = 0;
+        struct iovec* part = iov;
+        int iovcnt = 0;
+        while (i < count && wal->offset + bytes + record_bytes(&records[i]) <= wal->segment_end) {
+            const wal_record_t* r = &records[i];
+            headers[i] = (wal_entry_header_t){
+                .magic = WAL_MAGIC,
+                .crc32 = r->data ? checksum_crc32c(r->data, r->len) : 0,
+                .sequence = wal->sequence + (i - first),
+                .timestamp_ns = now,
+                .op_type = r->op,
+                .data_len = r->data ? (uint32_t)r->len : 0
+            };
+            part[iovcnt++] = (struct iovec){ &headers[i], sizeof(wal_entry_header_t) };
+            if (r->data && r->len > 0) {
+                part[iovcnt++] = (struct iovec){ (void*)r->data, r->len };
+            }
+            bytes += record_bytes(r);
+            i++;
         }
-        wal->size += len;
+
+        MEM_CHECK(sink(wal, part, iovcnt, bytes, arg));
+        wal->sequence += i - first;
+        iov += iovcnt;
+    }
+    return MEM_OK;
+}
+
+static mem_error_t write_sink(wal_t* w, struct iovec* iov, int iovcnt, size_t bytes, void* arg) {
+    (void)arg;
+    return write_records(w, iov, iovcnt, bytes);
+}
+
+mem_error_t wal_append_batch(wal_t* wal, const wal_record_t* records, size_t count) {
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+    MEM_CHECK_ERR(records != NULL || count == 0, MEM_ERR_INVALID_ARG, "records is NULL");
+    if (count == 0) return MEM_OK;
+
+    wal_entry_header_t* headers = malloc(count * sizeof(wal_entry_header_t));
+    struct iovec* iov = malloc(2 * count * sizeof(struct iovec));
+    if (!headers || !iov) {
+        free(headers);
+        free(iov);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL batch");
     }
 
-    /* Sync if enabled */
-    if (wal->sync_on_write) {
+    mem_error_t err = append_records(wal, records, count, headers, iov, write_sink, NULL);
+    free(iov);
+    free(headers);
+    if (err != MEM_OK) return err;
+
+    if (wal->sync_on_write && wal->io_mode == WAL_IO_BUFFERED) {
         if (fdatasync(wal->fd) < 0) {
             MEM_RETURN_ERROR(MEM_ERR_SYNC, "failed to sync WAL");
         }
     }
+    return MEM_OK;
+}
+
+/* Record a segment's part of a staged batch; it is written later */
+static mem_error_t stage_sink(wal_t* w, struct iovec* iov, int iovcnt, size_t bytes, void* arg) {
+    wal_batch_t* batch = arg;
+
+    int fd = dup(w->fd);
+    if (fd < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_IO, "failed to hold WAL segment open");
+    }
+    batch->writes[batch->write_count++] = (wal_write_t){
+        .fd = fd,
+        .iov = iov,
+        .iovcnt = iovcnt,
+        .offset = w->offset,
+        .len = bytes
+    };
+    w->offset += bytes;
+    w->size += bytes;
+    return MEM_OK;
+}
+
+mem_error_t wal_stage_batch(wal_t* wal, const wal_record_t* records, size_t count,
+                            wal_batch_t* batch) {
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+    MEM_CHECK_ERR(records != NULL || count == 0, MEM_ERR_INVALID_ARG, "records is NULL");
+    MEM_CHECK_ERR(batch != NULL, MEM_ERR_INVALID_ARG, "batch is NULL");
+    MEM_CHECK_ERR(wal->io_mode != WAL_IO_DIRECT, MEM_ERR_INVALID_ARG,
+                  "direct WAL writes cannot be staged");
+
+    memset(batch, 0, sizeof(*batch));
+    batch->sync = wal->sync_on_write && wal->io_mode == WAL_IO_BUFFERED;
+    if (count == 0) return MEM_OK;
+
+    /* A segment holds at least one record, so there are at most count writes */
+    batch->headers = malloc(count * sizeof(wal_entry_header_t));
+    batch->iov = malloc(2 * count * sizeof(struct iovec));
+    batch->writes = malloc(count * sizeof(wal_write_t));
+    if (!batch->headers || !batch->iov || !batch->writes) {
+        wal_batch_release(batch);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL batch");
+    }
 
-    wal->sequence++;
+    mem_error_t err = append_records(wal, records, count, batch->headers, batch->iov,
+                                     stage_sink, batch);
+    if (err != MEM_OK) {
+        wal_batch_release(batch);
+        return err;
+    }
     return MEM_OK;
 }
 
+void wal_batch_release(wal_batch_t* batch) {
+    if (!batch) return;
+
+    for (size_t i = 0; i < batch->write_count; i++) {
+        close(batch->writes[i].fd);
+    }
+    free(batch->writes);
+    free(batch->iov);
+    free(batch->headers);
+    memset(batch, 0, sizeof(*batch));
+}
+
 mem_error_t wal_sync(wal_t* wal) {
     MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
 
-    if (fsync(wal->fd) < 0) {
+    if (wal->fd >= 0 && fsync(wal->fd) < 0) {
         MEM_RETURN_ERROR(MEM_ERR_SYNC, "failed to sync WAL");
     }
 
@@ -172,18 +870,48 @@ mem_error_t wal_checkpoint(wal_t* wal) {
     return MEM_OK;
 }
 
+/* Free an old segment for reuse, or delete it past the spare limit */
+static mem_error_t recycle_segment(wal_t* w, uint32_t slot) {
+    char name[PATH_MAX];
+    segment_name(w, slot, name, sizeof(name));
+
+    if (w->spare_count >= w->config.spare_segments) {
+        if (unlink(name) < 0) {
+            MEM_RETURN_ERROR(MEM_ERR_IO, "failed to remove WAL segment %u", slot);
+        }
+        return MEM_OK;
+    }
+
+    int fd = open(name, O_RDWR);
+    if (fd < 0) {
+        MEM_RETURN_ERROR(MEM_ERR_OPEN, "failed to open WAL segment %u", slot);
+    }
+    mem_error_t err = write_segment_header(w, fd, false, 0);
+    close(fd);
+    if (err != MEM_OK) return err;
+
+    return push_slot(&w->spares, &w->spare_count, slot);
+}
+
 mem_error_t wal_truncate(wal_t* wal) {
     MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
 
-    /* Truncate file */
-    if (ftruncate(wal->fd, 0) < 0) {
-        MEM_RETURN_ERROR(MEM_ERR_TRUNCATE, "failed to truncate WAL");
+    /* Restart the current segment in place; what it held now reads as stale */
+    size_t keep = 0;
+    if (wal->fd >= 0) {
+        MEM_CHECK(write_segment_header(wal, wal->fd, wal->io_mode == WAL_IO_DIRECT,
+                                       wal->sequence));
+        wal->offset = WAL_SEGMENT_HEADER_SIZE;
+        keep = 1;
     }
 
-    /* Seek to beginning */
-    if (lseek(wal->fd, 0, SEEK_SET) < 0) {
-        MEM_RETURN_ERROR(MEM_ERR_SEEK, "failed to seek WAL");
+    /* Older segments go back to the spare pool */
+    size_t old = wal->segment_count - keep;
+    for (size_t i = 0; i < old; i++) {
+        MEM_CHECK(recycle_segment(wal, wal->segments[i]));
     }
+    if (keep) wal->segments[0] = wal->segments[wal->segment_count - 1];
+    wal->segment_count = keep;
 
     wal->size = 0;
     wal->checkpoint_seq = wal->sequence;
@@ -194,7 +922,8 @@ mem_error_t wal_truncate(wal_t* wal) {
 }
 
 mem_error_t wal_replay(wal_t* wal, wal_replay_fn callback, void* user_data) {
-    return wal_replay_from(wal, 0, callback, user_data);
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+    return wal_replay_from(wal, wal->checkpoint_seq, callback, user_data);
 }
 
 mem_error_t wal_replay_from(wal_t* wal, uint64_t from_seq,
@@ -202,113 +931,13 @@ mem_error_t wal_replay_from(wal_t* wal, uint64_t from_seq,
     MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
     MEM_CHECK_ERR(callback != NULL, MEM_ERR_INVALID_ARG, "callback is NULL");
 
-    /* Seek to beginning */
-    if (lseek(wal->fd, 0, SEEK_SET) < 0) {
-        MEM_RETURN_ERROR(MEM_ERR_SEEK, "failed to seek WAL");
-    }
-
-    uint64_t max_seq = 0;
     uint64_t entries_replayed = 0;
-    uint64_t checkpoint_seq = 0;
-
-    /* Read and replay entries */
-    while (1) {
-        wal_entry_header_t header;
-        ssize_t n = read(wal->fd, &header, sizeof(header));
-
-        if (n == 0) {
-            /* EOF */
-            break;
-        }
-
-        if (n != sizeof(header)) {
-            if (n < 0) {
-                MEM_RETURN_ERROR(MEM_ERR_READ, "failed to read WAL header");
-            }
-            /* Partial header - truncated entry, stop here */
-            LOG_WARN("WAL truncated entry at offset %lu",
-                    (unsigned long)(lseek(wal->fd, 0, SEEK_CUR) - n));
-            break;
-        }
-
-        /* Validate magic */
-        if (header.magic != WAL_MAGIC) {
-            MEM_RETURN_ERROR(MEM_ERR_WAL_CORRUPT,
-                           "invalid WAL magic at sequence %" PRIu64, header.sequence);
-        }
-
-        /* Read data */
-        void* data = NULL;
-        if (header.data_len > 0) {
-            /* Bounds check to prevent DoS from corrupted/malicious WAL files */
-            if (header.data_len > MAX_WAL_DATA_LEN) {
-                LOG_ERROR("WAL data length %u exceeds maximum %u at sequence %" PRIu64,
-                          header.data_len, MAX_WAL_DATA_LEN, header.sequence);
-                MEM_RETURN_ERROR(MEM_ERR_WAL_CORRUPT,
-                               "WAL data length exceeds maximum allowed");
-            }
-
-            /* Use write buffer if large enough, otherwise allocate */
-            if (header.data_len <= wal->write_buf_size) {
-                data = wal->write_buf;
-            } else {
-                data = malloc(header.data_len);
-                if (!data) {
-                    MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL data buffer");
-                }
-            }
-
-            n = read(wal->fd, data, header.data_len);
-            if (n != (ssize_t)header.data_len) {
-                if (data != wal->write_buf) free(data);
-                if (n < 0) {
-                    MEM_RETURN_ERROR(MEM_ERR_READ, "failed to read WAL data");
-                }
-                /* Partial data - truncated entry, stop here gracefully */
-                LOG_WARN("WAL truncated data at sequence %lu", header.sequence);
-                break;
-            }
-
-            /* Verify CRC */
-            uint32_t crc = compute_crc32(data, header.data_len);
-            if (crc != header.crc32) {
-                if (data != wal->write_buf) free(data);
-                /* CRC mismatch could be from truncated write - stop gracefully */
-                LOG_WARN("WAL CRC mismatch at sequence %lu, treating as truncation",
-                        header.sequence);
-                break;
-            }
-        }
-
-        /* Track sequence */
-        if (header.sequence > max_seq) {
-            max_seq = header.sequence;
-        }
-
-        /* Track last checkpoint */
-        if (header.op_type == WAL_OP_CHECKPOINT) {
-            checkpoint_seq = header.sequence;
-        }
-
-        /* Replay if after from_seq */
-        if (header.sequence > from_seq && header.op_type != WAL_OP_CHECKPOINT) {
-            mem_error_t err = callback(header.op_type, data, header.data_len, user_data);
-            if (err != MEM_OK) {
-                if (data && data != wal->write_buf) free(data);
-                return err;
-            }
-            entries_replayed++;
-        }
-
-        if (data && data != wal->write_buf) {
-            free(data);
-        }
+    for (size_t i = 0; i < wal->segment_count; i++) {
+        segment_scan_t scan;
+        MEM_CHECK(scan_segment(wal, wal->segments[i], from_seq, callback, user_data, &scan));
+        entries_replayed += scan.replayed;
     }
 
-    /* Update WAL state */
-    wal->sequence = max_seq + 1;
-    wal->checkpoint_seq = checkpoint_seq;
-
     LOG_INFO("WAL replay complete: %lu entries replayed, sequence at %lu",
              entries_replayed, wal->sequence);
 
@@ -326,16 +955,3 @@ size_t wal_size(const wal_t* wal) {
 bool wal_needs_checkpoint(const wal_t* wal) {
     return wal && wal->size >= wal->max_size;
 }
-
-void wal_close(wal_t* wal) {
-    if (!wal) return;
-
-    if (wal->fd >= 0) {
-        fsync(wal->fd);
-        close(wal->fd);
-    }
-
-    free(wal->path);
-    free(wal->write_buf);
-    free(wal);
-}
@@ -4,6 +4,19 @@
  * WAL provides durability for mmap'd data structures.
  * Operations are first written to the log, then applied.
  * On crash, the WAL is replayed to recover consistent state.
+ *
+ * The log is a set of fixed-size segment files, <path>.N, preallocated
+ * so that appends never extend a file. Each segment starts with a header
+ * block naming the sequence of its first record; live segments are
+ * replayed in that order. Truncating restarts the current segment in
+ * place and keeps older ones as spares for later roll-overs. A recycled
+ * segment still holds its old records, which carry older sequences and
+ * end the scan like zeroed space does.
+ *
+ * Record checksums are CRC32C. The segment header version tells which
+ * checksum a segment's records carry, so version 1 segments (IEEE CRC32)
+ * and the older single-file log still replay; new records always go to
+ * a version 2 segment.
  */
 
 #ifndef MEMORY_SERVICE_WAL_H
@@ -12,8 +25,11 @@
 #include "../core/arena.h"
 #include "../../include/types.h"
 #include "../../include/error.h"
+#include "aio.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
 
 /* WAL operation types */
 typedef enum {
@@ -29,12 +45,14 @@ typedef enum {
     WAL_OP_SESSION_UPDATE,      /* Update session metadata */
     WAL_OP_CHECKPOINT,          /* Checkpoint marker */
     WAL_OP_COMMIT,              /* Transaction commit */
+    WAL_OP_TEXT_SET,            /* Set node text */
+    WAL_OP_TOKENS_SET,          /* Set node token count */
 } wal_op_type_t;
 
 /* WAL entry header */
 typedef struct {
     uint32_t        magic;          /* Magic number for validation */
-    uint32_t        crc32;          /* CRC32 of data */
+    uint32_t        crc32;          /* CRC32C of data (IEEE CRC32 in version 1 segments) */
     uint64_t        sequence;       /* Monotonic sequence number */
     uint64_t        timestamp_ns;   /* Wall-clock timestamp */
     wal_op_type_t   op_type;        /* Operation type */
@@ -44,19 +62,89 @@ typedef struct {
 #define WAL_MAGIC 0x57414C30        /* "WAL0" */
 #define WAL_HEADER_SIZE sizeof(wal_entry_header_t)
 
+/* Segment files */
+#define WAL_SEGMENT_NAME_FMT "%s.%u"    /* path, slot */
+#define WAL_SEGMENT_MAGIC 0x57414C53    /* "WALS" */
+#define WAL_SEGMENT_VERSION 2           /* Record checksums are CRC32C */
+#define WAL_SEGMENT_VERSION_CRC32 1     /* Read only: IEEE CRC32 checksums */
+#define WAL_SEGMENT_HEADER_SIZE 4096    /* Records start block-aligned */
+#define WAL_SEGMENT_SIZE_DEFAULT (16 * 1024 * 1024)
+
+/* Segment header, at the start of the header block */
+typedef struct {
+    uint32_t        magic;
+    uint32_t        version;
+    uint64_t        start_seq;      /* Sequence of the first record; 0 = spare */
+} wal_segment_header_t;
+
+/* How appends are made durable */
+typedef enum {
+    WAL_IO_BUFFERED = 0,            /* write, then fdatasync per append */
+    WAL_IO_DSYNC,                   /* O_DSYNC: writes return once durable */
+    WAL_IO_DIRECT                   /* O_DIRECT | O_DSYNC via an aligned buffer */
+} wal_io_mode_t;
+
+/* WAL configuration */
+typedef struct {
+    size_t          segment_size;   /* Bytes per segment file */
+    uint32_t        spare_segments; /* Truncated segments kept for reuse */
+    wal_io_mode_t   io_mode;
+    aio_backend_t   backend;        /* How the group-commit writer submits batches */
+} wal_config_t;
+
+#define WAL_CONFIG_DEFAULT ((wal_config_t){ \
+    .segment_size = WAL_SEGMENT_SIZE_DEFAULT, .spare_segments = 2, \
+    .io_mode = WAL_IO_BUFFERED, .backend = AIO_BACKEND_BLOCKING })
+
 /* WAL state */
 typedef struct wal {
-    int             fd;             /* File descriptor */
-    char*           path;           /* File path */
-    size_t          size;           /* Current file size */
+    int             fd;             /* Current segment, -1 if none */
+    char*           path;           /* Segment path prefix */
+    size_t          size;           /* Record bytes since the last truncate */
     size_t          max_size;       /* Max size before checkpoint */
     uint64_t        sequence;       /* Next sequence number */
     uint64_t        checkpoint_seq; /* Last checkpoint sequence */
     bool            sync_on_write;  /* fsync after each write */
-    void*           write_buf;      /* Write buffer */
+    void*           write_buf;      /* Replay read buffer */
     size_t          write_buf_size;
+
+    wal_config_t    config;
+    wal_io_mode_t   io_mode;        /* Mode in use; direct falls back to dsync */
+    uint32_t*       segments;       /* Live segment slots, oldest first */
+    size_t          segment_count;
+    uint32_t*       spares;         /* Free segment slots */
+    size_t          spare_count;
+    uint32_t        next_slot;      /* Slot for the next new segment file */
+    size_t          offset;         /* Write position in the current segment */
+    size_t          segment_end;    /* Size of the current segment */
+    uint8_t*        direct_buf;     /* Staging buffer for WAL_IO_DIRECT */
 } wal_t;
 
+/* One record of a batch append */
+typedef struct {
+    wal_op_type_t   op;
+    const void*     data;
+    size_t          len;
+} wal_record_t;
+
+/* One write of a staged batch: iov at offset in a segment */
+typedef struct {
+    int             fd;             /* Segment, held open by the batch */
+    struct iovec*   iov;
+    int             iovcnt;
+    size_t          offset;
+    size_t          len;
+} wal_write_t;
+
+/* Records laid out for writing by the caller */
+typedef struct {
+    wal_write_t*    writes;         /* One per segment touched, in order */
+    size_t          write_count;
+    bool            sync;           /* Each write must be followed by fdatasync */
+    wal_entry_header_t* headers;
+    struct iovec*   iov;
+} wal_batch_t;
+
 /* WAL replay callback */
 typedef mem_error_t (*wal_replay_fn)(wal_op_type_t op, const void* data,
                                       size_t len, void* user_data);
@@ -67,20 +155,52 @@ mem_error_t wal_create(wal_t** wal, const char* path, size_t max_size);
 /* Open existing WAL for replay */
 mem_error_t wal_open(wal_t** wal, const char* path);
 
-/* Append entry to WAL */
+/*
+ * Change segment size, spare count, I/O mode and writer backend. A new
+ * segment size applies to segments created from here on; the backend is
+ * read when a group-commit writer starts.
+ */
+mem_error_t wal_set_config(wal_t* wal, const wal_config_t* config);
+
+/* Preallocate a spare segment unless one is ready */
+mem_error_t wal_prepare_segment(wal_t* wal);
+
+/* Append entry to WAL with a single write */
 mem_error_t wal_append(wal_t* wal, wal_op_type_t op,
                        const void* data, size_t len);
 
+/*
+ * Append records with as few writev calls as possible, followed by a
+ * single fdatasync (when sync_on_write is set)
+ */
+mem_error_t wal_append_batch(wal_t* wal, const wal_record_t* records, size_t count);
+
+/*
+ * Assign sequences and log space to records like wal_append_batch, but
+ * leave the writing to the caller. Record payloads must stay valid until
+ * the batch is written. The log counts the records as appended; a write
+ * that then fails leaves it unusable. Not available with WAL_IO_DIRECT.
+ */
+mem_error_t wal_stage_batch(wal_t* wal, const wal_record_t* records, size_t count,
+                            wal_batch_t* batch);
+
+/* Free a staged batch once its writes are done */
+void wal_batch_release(wal_batch_t* batch);
+
 /* Sync WAL to disk */
 mem_error_t wal_sync(wal_t* wal);
 
 /* Write checkpoint marker */
 mem_error_t wal_checkpoint(wal_t* wal);
 
-/* Truncate WAL (after checkpoint) */
+/* Truncate WAL (after checkpoint); older segments become spares */
 mem_error_t wal_truncate(wal_t* wal);
 
-/* Replay WAL from last checkpoint */
+/*
+ * Replay WAL entries after the last checkpoint marker. A damaged record
+ * ends its segment; when that is the last segment, appends continue in a
+ * fresh one so nothing is written after the damage.
+ */
 mem_error_t wal_replay(wal_t* wal, wal_replay_fn callback, void* user_data);
 
 /* Replay WAL from specific sequence */
@@ -109,15 +229,34 @@ typedef struct {
     uint32_t        embedding_idx;
     char            agent_id[MAX_AGENT_ID_LEN];
     char            session_id[MAX_SESSION_ID_LEN];
+    timestamp_ns_t  created_at;
+    node_id_t       prev_sibling;   /* Parent's last child before this one */
+    uint32_t        child_index;    /* Position among the parent's children */
 } wal_node_data_t;
 
+/* Node records written before prev_sibling and child_index existed */
+#define WAL_NODE_DATA_V1_SIZE offsetof(wal_node_data_t, prev_sibling)
+
 /* Embedding set data */
 typedef struct {
+    node_id_t       node_id;
     hierarchy_level_t level;
     uint32_t        embedding_idx;
     float           values[EMBEDDING_DIM];
 } wal_embedding_data_t;
 
+/* Text set data, followed by len bytes of text */
+typedef struct {
+    node_id_t       node_id;
+    uint32_t        len;
+} wal_text_data_t;
+
+/* Token count set data */
+typedef struct {
+    node_id_t       node_id;
+    uint32_t        token_count;
+} wal_tokens_data_t;
+
 /* Relation set data */
 typedef struct {
     node_id_t       node_id;
@@ -0,0 +1,506 @@
+/*
+ * Memory Service - WAL Group Commit Implementation
+ */
+
+#include "wal_writer.h"
+#include "../util/log.h"
+#include "../util/time.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Queued record; the payload follows the struct */
+typedef struct wal_pending {
+    struct wal_pending* next;
+    wal_op_type_t       op;
+    size_t              len;
+} wal_pending_t;
+
+static inline void* pending_data(wal_pending_t* p) {
+    return p + 1;
+}
+
+/* Batch submitted asynchronously and not yet retired */
+typedef struct wal_flight {
+    struct wal_flight*  next;
+    wal_writer_t*       writer;
+    wal_pending_t*      records;    /* Payloads the batch's writes point into */
+    wal_batch_t         batch;
+    size_t              count;
+    size_t              bytes;
+    uint64_t            last;       /* Last ticket of the batch */
+    uint64_t            start;
+    uint64_t            elapsed;
+    size_t              pending;    /* Writes not yet completed */
+    mem_error_t         err;
+    bool                done;
+} wal_flight_t;
+
+struct wal_writer {
+    wal_t*          wal;
+    pthread_t       thread;
+    aio_t*          aio;            /* NULL: batches are written inline */
+
+    pthread_mutex_t io_lock;        /* Held while a batch or checkpoint touches the file */
+    pthread_mutex_t lock;
+    pthread_cond_t  work;           /* Records queued or shutdown */
+    pthread_cond_t  done;           /* A batch became durable or failed */
+
+    /* Queue of records not yet handed to the writer thread */
+    wal_pending_t*  head;
+    wal_pending_t*  tail;
+    size_t          queued;
+
+    uint64_t        next_ticket;    /* Ticket of the next queued record */
+    uint64_t        durable;        /* Highest ticket written and synced */
+    mem_error_t     error;          /* First write failure; sticky */
+    size_t          wal_size;       /* Log size after the last batch */
+    bool            shutdown;
+
+    /* Submitted batches, oldest first; they retire in this order */
+    wal_flight_t*   flights;
+    wal_flight_t*   flights_tail;
+    size_t          inflight;
+
+    wal_writer_stats_t stats;
+};
+
+static void free_pending(wal_pending_t* p) {
+    while (p) {
+        wal_pending_t* next = p->next;
+        free(p);
+        p = next;
+    }
+}
+
+/* Write one detached batch; returns the append result */
+static mem_error_t write_batch(wal_writer_t* w, wal_pending_t* batch, size_t count) {
+    wal_record_t* records = malloc(count * sizeof(wal_record_t));
+    if (!records) {
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate WAL batch");
+    }
+
+    size_t i = 0;
+    for (wal_pending_t* p = batch; p; p = p->next) {
+        records[i++] = (wal_record_t){ p->op, pending_data(p), p->len };
+    }
+
+    mem_error_t err = wal_append_batch(w->wal, records, count);
+    free(records);
+    return err;
+}
+
+/* Record a batch as written; caller holds the lock */
+static void batch_written(wal_writer_t* w, size_t count, size_t bytes,
+                          uint64_t last, uint64_t elapsed) {
+    w->durable = last;
+    w->stats.records += count;
+    w->stats.batches++;
+    w->stats.bytes += bytes;
+    w->stats.sync_ns += elapsed;
+    if (count > w->stats.max_batch) w->stats.max_batch = count;
+}
+
+static void batch_failed(wal_writer_t* w, size_t count, mem_error_t err) {
+    if (w->error == MEM_OK) {
+        LOG_ERROR("WAL batch of %zu records failed: %s", count, mem_error_str(err));
+        w->error = err;
+    }
+}
+
+static void free_flight(wal_flight_t* f) {
+    wal_batch_release(&f->batch);
+    free_pending(f->records);
+    free(f);
+}
+
+/*
+ * One write of a flight finished. Batches complete out of order, so a
+ * batch only becomes durable once every batch before it has.
+ */
+static void flight_write_done(void* arg, mem_error_t err) {
+    wal_flight_t* f = arg;
+    wal_writer_t* w = f->writer;
+    wal_flight_t* retired = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    if (err != MEM_OK && f->err == MEM_OK) f->err = err;
+    if (--f->pending == 0) {
+        f->done = true;
+        f->elapsed = time_now_ns() - f->start;
+    }
+
+    while (w->flights && w->flights->done) {
+        wal_flight_t* head = w->flights;
+        w->flights = head->next;
+        if (!w->flights) w->flights_tail = NULL;
+        w->inflight--;
+
+        if (head->err != MEM_OK) {
+            batch_failed(w, head->count, head->err);
+        } else if (w->error == MEM_OK) {
+            batch_written(w, head->count, head->bytes, head->last, head->elapsed);
+        }
+        head->next = retired;
+        retired = head;
+    }
+    pthread_cond_broadcast(&w->done);
+    pthread_mutex_unlock(&w->lock);
+
+    while (retired) {
+        wal_flight_t* next = retired->next;
+        free_flight(retired);
+        retired = next;
+    }
+}
+
+/* Stage a detached batch and hand its writes to the aio backend */
+static void submit_batch(wal_writer_t* w, wal_pending_t* batch, size_t count,
+                         size_t bytes, uint64_t last) {
+    wal_flight_t* f = calloc(1, sizeof(wal_flight_t));
+    wal_record_t* records = malloc(count * sizeof(wal_record_t));
+    if (!f || !records) {
+        free(f);
+        free(records);
+        free_pending(batch);
+        pthread_mutex_lock(&w->lock);
+        batch_failed(w, count, MEM_ERR_NOMEM);
+        pthread_cond_broadcast(&w->done);
+        pthread_mutex_unlock(&w->lock);
+        return;
+    }
+
+    size_t i = 0;
+    for (wal_pending_t* p = batch; p; p = p->next) {
+        records[i++] = (wal_record_t){ p->op, pending_data(p), p->len };
+    }
+    *f = (wal_flight_t){
+        .writer = w, .records = batch, .count = count, .bytes = bytes,
+        .last = last, .start = time_now_ns()
+    };
+
+    pthread_mutex_lock(&w->io_lock);
+    mem_error_t err = wal_stage_batch(w->wal, records, count, &f->batch);
+    size_t size = wal_size(w->wal);
+    free(records);
+
+    pthread_mutex_lock(&w->lock);
+    w->wal_size = size;
+    if (err != MEM_OK) {
+        batch_failed(w, count, err);
+        pthread_cond_broadcast(&w->done);
+        pthread_mutex_unlock(&w->lock);
+        pthread_mutex_unlock(&w->io_lock);
+        free_flight(f);
+        return;
+    }
+    f->pending = f->batch.write_count;
+    if (w->flights_tail) {
+        w->flights_tail->next = f;
+    } else {
+        w->flights = f;
+    }
+    w->flights_tail = f;
+    w->inflight++;
+    pthread_mutex_unlock(&w->lock);
+
+    /* f may be retired by the last completion, so count writes up front */
+    size_t writes = f->batch.write_count;
+    bool sync = f->batch.sync;
+    for (size_t k = 0; k < writes; k++) {
+        const wal_write_t* wr = &f->batch.writes[k];
+        err = aio_write(w->aio, wr->fd, wr->iov, wr->iovcnt, (off_t)wr->offset,
+                        sync, flight_write_done, f);
+        if (err != MEM_OK) {
+            /* Fail this write and every one not yet submitted */
+            for (size_t rest = k; rest < writes; rest++) flight_write_done(f, err);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&w->io_lock);
+}
+
+/* Wait until no submitted batch is outstanding; caller holds the lock */
+static void wait_flights(wal_writer_t* w) {
+    while (w->inflight > 0) {
+        pthread_cond_wait(&w->done, &w->lock);
+    }
+}
+
+/* Write and sync a detached batch on the writer thread */
+static mem_error_t write_sync_batch(wal_writer_t* w, wal_pending_t* batch, size_t count,
+                                    size_t bytes, uint64_t last) {
+    pthread_mutex_lock(&w->io_lock);
+    uint64_t start = time_now_ns();
+    mem_error_t err = write_batch(w, batch, count);
+    uint64_t elapsed = time_now_ns() - start;
+    size_t size = wal_size(w->wal);
+    pthread_mutex_unlock(&w->io_lock);
+    free_pending(batch);
+
+    pthread_mutex_lock(&w->lock);
+    w->wal_size = size;
+    if (err == MEM_OK) {
+        batch_written(w, count, bytes, last, elapsed);
+    } else {
+        batch_failed(w, count, err);
+    }
+    pthread_cond_broadcast(&w->done);
+    pthread_mutex_unlock(&w->lock);
+    return err;
+}
+
+static void* writer_main(void* arg) {
+    wal_writer_t* w = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        while (!w->head && !w->shutdown) {
+            pthread_cond_wait(&w->work, &w->lock);
+        }
+        if (!w->head && w->shutdown) {
+            wait_flights(w);
+            pthread_mutex_unlock(&w->lock);
+            return NULL;
+        }
+        while (w->inflight >= WAL_WRITER_MAX_INFLIGHT) {
+            pthread_cond_wait(&w->done, &w->lock);
+        }
+
+        /* Take everything queued so far as one batch */
+        wal_pending_t* batch = w->head;
+        size_t count = w->queued;
+        uint64_t last = w->next_ticket - 1;
+        mem_error_t failed = w->error;
+        w->head = w->tail = NULL;
+        w->queued = 0;
+        pthread_mutex_unlock(&w->lock);
+
+        /* Nothing may become durable after a record that was lost */
+        if (failed != MEM_OK) {
+            free_pending(batch);
+            continue;
+        }
+
+        size_t bytes = 0;
+        for (wal_pending_t* p = batch; p; p = p->next) bytes += p->len;
+
+        mem_error_t err = MEM_OK;
+        if (w->aio) {
+            submit_batch(w, batch, count, bytes, last);
+        } else {
+            err = write_sync_batch(w, batch, count, bytes, last);
+        }
+
+        /* Have the next segment preallocated before this one fills */
+        if (err == MEM_OK) {
+            pthread_mutex_lock(&w->io_lock);
+            mem_error_t prep = wal_prepare_segment(w->wal);
+            pthread_mutex_unlock(&w->io_lock);
+            if (prep != MEM_OK) {
+                LOG_WARN("WAL segment preallocation failed: %s", mem_error_str(prep));
+            }
+        }
+    }
+}
+
+mem_error_t wal_writer_create(wal_writer_t** writer, wal_t* wal) {
+    MEM_CHECK_ERR(writer != NULL, MEM_ERR_INVALID_ARG, "writer is NULL");
+    MEM_CHECK_ERR(wal != NULL, MEM_ERR_INVALID_ARG, "wal is NULL");
+
+    wal_writer_t* w = calloc(1, sizeof(wal_writer_t));
+    MEM_CHECK_ALLOC(w);
+    w->wal = wal;
+    w->next_ticket = 1;
+    w->wal_size = wal_size(wal);
+
+    /* Staged writes are unaligned, so O_DIRECT logs stay on the writer thread */
+    if (wal->config.backend == AIO_BACKEND_IO_URING && wal->io_mode != WAL_IO_DIRECT) {
+        MEM_CHECK(aio_create(&w->aio, AIO_BACKEND_IO_URING, 0));
+        if (aio_get_backend(w->aio) != AIO_BACKEND_IO_URING) {
+            aio_destroy(w->aio);
+            w->aio = NULL;
+        }
+    }
+    w->stats.backend = w->aio ? AIO_BACKEND_IO_URING : AIO_BACKEND_BLOCKING;
+    LOG_DEBUG("WAL writer using %s I/O", aio_backend_name(w->stats.backend));
+
+    if (pthread_mutex_init(&w->io_lock, NULL) != 0) {
+        aio_destroy(w->aio);
+        free(w);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init WAL writer mutex");
+    }
+    if (pthread_mutex_init(&w->lock, NULL) != 0) {
+        pthread_mutex_destroy(&w->io_lock);
+        aio_destroy(w->aio);
+        free(w);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init WAL writer mutex");
+    }
+    if (pthread_cond_init(&w->work, NULL) != 0) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_mutex_destroy(&w->io_lock);
+        aio_destroy(w->aio);
+        free(w);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init WAL writer condition");
+    }
+    if (pthread_cond_init(&w->done, NULL) != 0) {
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->lock);
+        pthread_mutex_destroy(&w->io_lock);
+        aio_destroy(w->aio);
+        free(w);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init WAL writer condition");
+    }
+    if (pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->lock);
+        pthread_mutex_destroy(&w->io_lock);
+        aio_destroy(w->aio);
+        free(w);
+        MEM_RETURN_ERROR(MEM_ERR_THREAD, "failed to start WAL writer");
+    }
+
+    *writer = w;
+    return MEM_OK;
+}
+
+void wal_writer_destroy(wal_writer_t* writer) {
+    if (!writer) return;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->shutdown = true;
+    pthread_cond_signal(&writer->work);
+    pthread_mutex_unlock(&writer->lock);
+
+    pthread_join(writer->thread, NULL);
+
+    LOG_DEBUG("WAL writer: %lu records in %lu batches",
+              (unsigned long)writer->stats.records, (unsigned long)writer->stats.batches);
+
+    aio_destroy(writer->aio);
+    free_pending(writer->head);
+    pthread_cond_destroy(&writer->done);
+    pthread_cond_destroy(&writer->work);
+    pthread_mutex_destroy(&writer->lock);
+    pthread_mutex_destroy(&writer->io_lock);
+    free(writer);
+}
+
+mem_error_t wal_writer_log(wal_writer_t* writer, wal_op_type_t op,
+                           const struct iovec* parts, int count, uint64_t* ticket) {
+    MEM_CHECK_ERR(writer != NULL, MEM_ERR_INVALID_ARG, "writer is NULL");
+    MEM_CHECK_ERR(parts != NULL || count == 0, MEM_ERR_INVALID_ARG, "parts is NULL");
+
+    size_t len = 0;
+    for (int i = 0; i < count; i++) len += parts[i].iov_len;
+
+    wal_pending_t* p = malloc(sizeof(wal_pending_t) + len);
+    MEM_CHECK_ALLOC(p);
+    p->next = NULL;
+    p->op = op;
+    p->len = len;
+
+    char* out = pending_data(p);
+    for (int i = 0; i < count; i++) {
+        memcpy(out, parts[i].iov_base, parts[i].iov_len);
+        out += parts[i].iov_len;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    if (writer->error != MEM_OK) {
+        mem_error_t err = writer->error;
+        pthread_mutex_unlock(&writer->lock);
+        free(p);
+        MEM_RETURN_ERROR(err, "WAL writer failed earlier");
+    }
+
+    if (writer->tail) {
+        writer->tail->next = p;
+    } else {
+        writer->head = p;
+    }
+    writer->tail = p;
+    writer->queued++;
+
+    uint64_t t = writer->next_ticket++;
+    pthread_cond_signal(&writer->work);
+    pthread_mutex_unlock(&writer->lock);
+
+    if (ticket) *ticket = t;
+    return MEM_OK;
+}
+
+mem_error_t wal_writer_wait(wal_writer_t* writer, uint64_t ticket) {
+    MEM_CHECK_ERR(writer != NULL, MEM_ERR_INVALID_ARG, "writer is NULL");
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->durable < ticket && writer->error == MEM_OK) {
+        pthread_cond_wait(&writer->done, &writer->lock);
+    }
+    mem_error_t err = writer->durable >= ticket ? MEM_OK : writer->error;
+    pthread_mutex_unlock(&writer->lock);
+
+    if (err != MEM_OK) {
+        MEM_RETURN_ERROR(err, "WAL record %lu not durable", (unsigned long)ticket);
+    }
+    return MEM_OK;
+}
+
+mem_error_t wal_writer_flush(wal_writer_t* writer) {
+    MEM_CHECK_ERR(writer != NULL, MEM_ERR_INVALID_ARG, "writer is NULL");
+
+    pthread_mutex_lock(&writer->lock);
+    uint64_t last = writer->next_ticket - 1;
+    pthread_mutex_unlock(&writer->lock);
+
+    return wal_writer_wait(writer, last);
+}
+
+bool wal_writer_needs_checkpoint(wal_writer_t* writer) {
+    if (!writer) return false;
+
+    pthread_mutex_lock(&writer->lock);
+    bool due = writer->wal_size >= writer->wal->max_size;
+    pthread_mutex_unlock(&writer->lock);
+    return due;
+}
+
+mem_error_t wal_writer_checkpoint(wal_writer_t* writer, wal_sync_fn sync, void* arg) {
+    MEM_CHECK_ERR(writer != NULL, MEM_ERR_INVALID_ARG, "writer is NULL");
+
+    /* Everything logged so far reaches the file first; records queued
+     * from here on wait for the checkpoint and land in the emptied log */
+    MEM_CHECK(wal_writer_flush(writer));
+
+    /* Batches already submitted finish before the log is emptied; none
+     * start while io_lock is held */
+    pthread_mutex_lock(&writer->io_lock);
+    pthread_mutex_lock(&writer->lock);
+    wait_flights(writer);
+    pthread_mutex_unlock(&writer->lock);
+
+    mem_error_t err = sync ? sync(arg) : MEM_OK;
+    if (err == MEM_OK) err = wal_checkpoint(writer->wal);
+    if (err == MEM_OK) err = wal_truncate(writer->wal);
+    pthread_mutex_unlock(&writer->io_lock);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->wal_size = wal_size(writer->wal);
+    if (err == MEM_OK) writer->stats.checkpoints++;
+    pthread_mutex_unlock(&writer->lock);
+
+    return err;
+}
+
+void wal_writer_get_stats(wal_writer_t* writer, wal_writer_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!writer) return;
+
+    pthread_mutex_lock(&writer->lock);
+    *stats = writer->stats;
+    pthread_mutex_unlock(&writer->lock);
+}
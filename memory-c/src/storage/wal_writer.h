@@ -0,0 +1,81 @@
+/*
+ * Memory Service - WAL Group Commit
+ *
+ * Request threads enqueue records and receive a ticket; a single writer
+ * thread drains everything queued with one writev and one fdatasync, then
+ * wakes all waiters of that batch together. Records arriving while a
+ * batch is being synced form the next batch, so under load the cost of a
+ * sync is shared by every request that reached it. Between batches the
+ * writer preallocates the next log segment, keeping that off the
+ * request path.
+ *
+ * With the io_uring backend (wal_config_t.backend) the writer stages a
+ * batch, submits its writes and linked fdatasync, and goes on to the
+ * next batch; a completion thread wakes the waiters. Up to
+ * WAL_WRITER_MAX_INFLIGHT batches are in flight, and each becomes
+ * durable only after all batches before it. O_DIRECT logs and systems
+ * without io_uring write on the writer thread as before.
+ *
+ * A checkpoint makes the logged state durable elsewhere (the caller's
+ * sync function) and then empties the log. No batch is written while it
+ * runs, so nothing appended in between can be cut off.
+ */
+
+#ifndef MEMORY_SERVICE_WAL_WRITER_H
+#define MEMORY_SERVICE_WAL_WRITER_H
+
+#include "wal.h"
+#include <sys/uio.h>
+
+/* Batches submitted asynchronously before the writer waits for one */
+#define WAL_WRITER_MAX_INFLIGHT 4
+
+/* Forward declaration */
+typedef struct wal_writer wal_writer_t;
+
+/* Makes everything logged so far durable outside the WAL */
+typedef mem_error_t (*wal_sync_fn)(void* arg);
+
+/* Group commit counters */
+typedef struct {
+    uint64_t    records;            /* Records written */
+    uint64_t    batches;            /* writev + fdatasync rounds */
+    uint64_t    bytes;              /* Payload bytes written */
+    uint64_t    sync_ns;            /* Total time spent writing and syncing */
+    size_t      max_batch;          /* Largest batch seen */
+    uint64_t    checkpoints;        /* Completed checkpoints */
+    aio_backend_t backend;          /* How batches are written */
+} wal_writer_stats_t;
+
+/* Start a writer for wal; the writer does not own wal */
+mem_error_t wal_writer_create(wal_writer_t** writer, wal_t* wal);
+
+/* Write everything queued, stop the writer thread and free it */
+void wal_writer_destroy(wal_writer_t* writer);
+
+/*
+ * Queue a record whose payload is the concatenation of parts (copied).
+ * ticket, if not NULL, receives the value to pass to wal_writer_wait.
+ */
+mem_error_t wal_writer_log(wal_writer_t* writer, wal_op_type_t op,
+                           const struct iovec* parts, int count, uint64_t* ticket);
+
+/* Block until the record with ticket (and all before it) is durable */
+mem_error_t wal_writer_wait(wal_writer_t* writer, uint64_t ticket);
+
+/* Block until everything queued so far is durable */
+mem_error_t wal_writer_flush(wal_writer_t* writer);
+
+/* True once the log has reached its checkpoint size */
+bool wal_writer_needs_checkpoint(wal_writer_t* writer);
+
+/*
+ * Flush, run sync(arg), then write a checkpoint marker and truncate the
+ * log. The log is left untouched if sync fails.
+ */
+mem_error_t wal_writer_checkpoint(wal_writer_t* writer, wal_sync_fn sync, void* arg);
+
+/* Get counters */
+void wal_writer_get_stats(wal_writer_t* writer, wal_writer_stats_t* stats);
+
+#endif /* MEMORY_SERVICE_WAL_WRITER_H */
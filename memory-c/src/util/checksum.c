@@ -0,0 +1,158 @@
+/*
+ * Memory Service - Checksum Implementation
+ */
+
+#include "checksum.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* Reflected polynomials */
+#define CRC32C_POLY 0x82F63B78
+#define CRC32_IEEE_POLY 0xEDB88320
+
+/* Slicing-by-8: table k advances a byte k positions further */
+typedef struct {
+    uint32_t    t[8][256];
+} crc_tables_t;
+
+static crc_tables_t crc32c_tables;
+static crc_tables_t ieee_tables;
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(crc_tables_t* tb, uint32_t poly) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+        }
+        tb->t[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = tb->t[k - 1][i];
+            tb->t[k][i] = (prev >> 8) ^ tb->t[0][prev & 0xFF];
+        }
+    }
+}
+
+static void init_tables(void) {
+    build_tables(&crc32c_tables, CRC32C_POLY);
+    build_tables(&ieee_tables, CRC32_IEEE_POLY);
+}
+
+/* Advance the raw (pre-inverted) CRC state over len bytes */
+static uint32_t slice8(const crc_tables_t* tb, uint32_t crc, const uint8_t* p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7)) {
+        crc = tb->t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = tb->t[7][lo & 0xFF] ^ tb->t[6][(lo >> 8) & 0xFF] ^
+              tb->t[5][(lo >> 16) & 0xFF] ^ tb->t[4][lo >> 24] ^
+              tb->t[3][hi & 0xFF] ^ tb->t[2][(hi >> 8) & 0xFF] ^
+              tb->t[1][(hi >> 16) & 0xFF] ^ tb->t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+
+    while (len-- > 0) {
+        crc = tb->t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__SSE4_2__)
+
+#define CRC32C_IMPL "sse4.2"
+
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7)) {
+        crc = _mm_crc32_u8(crc, *p++);
+        len--;
+    }
+
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+
+    while (len-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+#elif defined(__ARM_FEATURE_CRC32)
+
+#define CRC32C_IMPL "armv8-crc"
+
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7)) {
+        crc = __crc32cb(crc, *p++);
+        len--;
+    }
+
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+
+    while (len-- > 0) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+#else
+
+#define CRC32C_IMPL "slicing-by-8"
+
+#endif
+
+uint32_t checksum_crc32c_portable(uint32_t crc, const void* data, size_t len) {
+    pthread_once(&tables_once, init_tables);
+    return ~slice8(&crc32c_tables, ~crc, data, len);
+}
+
+uint32_t checksum_crc32c_update(uint32_t crc, const void* data, size_t len) {
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+    return ~crc32c_hw(~crc, data, len);
+#else
+    return checksum_crc32c_portable(crc, data, len);
+#endif
+}
+
+uint32_t checksum_crc32c(const void* data, size_t len) {
+    return checksum_crc32c_update(0, data, len);
+}
+
+uint32_t checksum_crc32_ieee(const void* data, size_t len) {
+    pthread_once(&tables_once, init_tables);
+    return ~slice8(&ieee_tables, 0xFFFFFFFF, data, len);
+}
+
+const char* checksum_crc32c_impl(void) {
+    return CRC32C_IMPL;
+}
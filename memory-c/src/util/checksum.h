@@ -0,0 +1,35 @@
+/*
+ * Memory Service - Checksums
+ *
+ * CRC32C (Castagnoli) for on-disk formats. Builds targeting SSE4.2 or
+ * the ARMv8 CRC extension use the crc32 instructions, eight bytes at a
+ * time; other builds use slicing-by-8 tables. Both give identical
+ * results. The IEEE CRC32 older WAL files were written with is kept for
+ * reading them.
+ */
+
+#ifndef MEMORY_SERVICE_CHECKSUM_H
+#define MEMORY_SERVICE_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC32C of len bytes */
+uint32_t checksum_crc32c(const void* data, size_t len);
+
+/*
+ * Extend a CRC32C over more bytes: start from 0, and pass each result
+ * back in to checksum data split across buffers.
+ */
+uint32_t checksum_crc32c_update(uint32_t crc, const void* data, size_t len);
+
+/* Table-driven CRC32C, whichever path the build uses (for tests) */
+uint32_t checksum_crc32c_portable(uint32_t crc, const void* data, size_t len);
+
+/* IEEE 802.3 CRC32 (zlib's), used by version 1 WAL files */
+uint32_t checksum_crc32_ieee(const void* data, size_t len);
+
+/* Name of the CRC32C implementation in use */
+const char* checksum_crc32c_impl(void);
+
+#endif /* MEMORY_SERVICE_CHECKSUM_H */
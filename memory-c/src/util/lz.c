@@ -0,0 +1,214 @@
+/*
+ * Memory Service - Block Compression Implementation
+ */
+
+#include "lz.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define HASH_BITS 12
+#define MIN_MATCH 4
+#define LAST_LITERALS 5         /* Block always ends with this many literals */
+#define MF_LIMIT 12             /* No match may start this close to the end */
+#define MAX_DISTANCE 65535
+#define NO_POS UINT32_MAX
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Write a length continuation (runs of 255, then the remainder) */
+static inline uint8_t* put_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* Emit one sequence; match_len 0 means a final literal-only sequence */
+static uint8_t* put_sequence(uint8_t* op, uint8_t* end,
+                             const uint8_t* literals, size_t lit_len,
+                             size_t offset, size_t match_len) {
+    size_t ml = match_len ? match_len - MIN_MATCH : 0;
+
+    /* token + length bytes + literals + offset, rounded up */
+    size_t need = 1 + lit_len / 255 + 1 + lit_len + 2 + ml / 255 + 1;
+    if ((size_t)(end - op) < need) return NULL;
+
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15) op = put_length(op, lit_len - 15);
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+
+    if (match_len) {
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(ml < 15 ? ml : 15);
+        if (ml >= 15) op = put_length(op, ml - 15);
+    }
+    return op;
+}
+
+size_t lz_compress_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap,
+                   const uint8_t* dict, size_t dict_len) {
+    if (!dst || (!src && n > 0)) return 0;
+    if (!dict) dict_len = 0;
+    if (dict_len > LZ_MAX_DICT) {
+        dict += dict_len - LZ_MAX_DICT;
+        dict_len = LZ_MAX_DICT;
+    }
+
+    /* Matches address one buffer: dictionary followed by the input */
+    const uint8_t* buf = src;
+    uint8_t* joined = NULL;
+    if (dict_len > 0) {
+        joined = malloc(dict_len + n);
+        if (!joined) return 0;
+        memcpy(joined, dict, dict_len);
+        if (n > 0) memcpy(joined + dict_len, src, n);
+        buf = joined;
+    }
+
+    size_t start = dict_len;
+    size_t total = dict_len + n;
+
+    uint32_t table[1 << HASH_BITS];
+    for (size_t i = 0; i < (1 << HASH_BITS); i++) table[i] = NO_POS;
+    for (size_t p = 0; p + MIN_MATCH <= dict_len; p++) {
+        table[hash4(read32(buf + p))] = (uint32_t)p;
+    }
+
+    uint8_t* op = dst;
+    uint8_t* end = dst + cap;
+    size_t anchor = start;
+    size_t ip = start;
+
+    if (n > MF_LIMIT) {
+        size_t match_start_limit = total - MF_LIMIT;
+        size_t match_end_limit = total - LAST_LITERALS;
+
+        while (ip < match_start_limit) {
+            uint32_t seq = read32(buf + ip);
+            uint32_t h = hash4(seq);
+            uint32_t ref = table[h];
+            table[h] = (uint32_t)ip;
+
+            if (ref == NO_POS || ip - ref > MAX_DISTANCE || read32(buf + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            /* Extend backwards over pending literals, then forwards */
+            size_t mref = ref;
+            while (ip > anchor && mref > 0 && buf[ip - 1] == buf[mref - 1]) {
+                ip--;
+                mref--;
+            }
+            size_t len = MIN_MATCH + (ref - mref);
+            while (ip + len < match_end_limit && buf[mref + len] == buf[ip + len]) {
+                len++;
+            }
+
+            op = put_sequence(op, end, buf + anchor, ip - anchor, ip - mref, len);
+            if (!op) {
+                free(joined);
+                return 0;
+            }
+
+            ip += len;
+            anchor = ip;
+            if (ip - 2 >= start && ip < match_start_limit) {
+                table[hash4(read32(buf + ip - 2))] = (uint32_t)(ip - 2);
+            }
+        }
+    }
+
+    op = put_sequence(op, end, buf + anchor, total - anchor, 0, 0);
+    free(joined);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+/* Read a length continuation; false if it runs past the input */
+static inline bool get_length(const uint8_t** ip, const uint8_t* end, size_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+mem_error_t lz_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t raw_len,
+                          const uint8_t* dict, size_t dict_len) {
+    MEM_CHECK_ERR(src != NULL && dst != NULL, MEM_ERR_INVALID_ARG, "NULL buffer");
+    if (!dict) dict_len = 0;
+
+    const uint8_t* ip = src;
+    const uint8_t* end = src + n;
+    size_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !get_length(&ip, end, &lit_len)) goto corrupt;
+        if (lit_len > (size_t)(end - ip) || lit_len > raw_len - op) goto corrupt;
+        memcpy(dst + op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        /* Final sequence carries literals only */
+        if (ip == end) break;
+
+        if (end - ip < 2) goto corrupt;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op + dict_len) goto corrupt;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !get_length(&ip, end, &match_len)) goto corrupt;
+        match_len += MIN_MATCH;
+        if (match_len > raw_len - op) goto corrupt;
+
+        /* Part of the match may lie in the dictionary */
+        if (offset > op) {
+            size_t back = offset - op;
+            const uint8_t* from = dict + dict_len - back;
+            size_t chunk = back < match_len ? back : match_len;
+            memcpy(dst + op, from, chunk);
+            op += chunk;
+            match_len -= chunk;
+        }
+
+        /* Byte copy handles overlapping (repeating) matches */
+        if (match_len > 0) {
+            const uint8_t* from = dst + op - offset;
+            for (size_t i = 0; i < match_len; i++) {
+                dst[op + i] = from[i];
+            }
+            op += match_len;
+        }
+    }
+
+    if (op != raw_len) goto corrupt;
+    return MEM_OK;
+
+corrupt:
+    MEM_RETURN_ERROR(MEM_ERR_INDEX_CORRUPT, "corrupt compressed block");
+}
@@ -0,0 +1,38 @@
+/*
+ * Memory Service - Block Compression
+ *
+ * Small LZ77 codec producing the LZ4 block format: sequences of
+ * literals and (offset, length) back-references within a 64 KiB window.
+ * Greedy single-probe matching keeps compression cheap; decompression is
+ * a tight copy loop. An optional dictionary acts as history preceding
+ * the block, so short blocks can reference content shared across blocks.
+ */
+
+#ifndef MEMORY_SERVICE_LZ_H
+#define MEMORY_SERVICE_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/error.h"
+
+/* Largest usable dictionary (the match window) */
+#define LZ_MAX_DICT (64 * 1024)
+
+/* Worst-case compressed size for n input bytes */
+size_t lz_compress_bound(size_t n);
+
+/*
+ * Compress n bytes of src into dst (capacity cap). Returns compressed
+ * size, or 0 if the output would not fit in cap. dict may be NULL.
+ */
+size_t lz_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap,
+                   const uint8_t* dict, size_t dict_len);
+
+/*
+ * Decompress n bytes of src into exactly raw_len bytes of dst, using the
+ * same dictionary the block was compressed with.
+ */
+mem_error_t lz_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t raw_len,
+                          const uint8_t* dict, size_t dict_len);
+
+#endif /* MEMORY_SERVICE_LZ_H */
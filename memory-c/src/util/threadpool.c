@@ -0,0 +1,196 @@
+/*
+ * Memory Service - Thread Pool Implementation
+ */
+
+#include "threadpool.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    thread_task_fn  fn;
+    void*           arg;
+    task_group_t*   group;
+} pool_task_t;
+
+struct thread_pool {
+    pthread_t*      threads;
+    size_t          num_threads;
+
+    /* Ring buffer of queued tasks */
+    pool_task_t*    queue;
+    size_t          capacity;
+    size_t          head;
+    size_t          count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    bool            shutdown;
+};
+
+static void task_group_finish(task_group_t* group) {
+    pthread_mutex_lock(&group->lock);
+    if (--group->pending == 0) {
+        pthread_cond_broadcast(&group->done);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+static void* worker_main(void* arg) {
+    thread_pool_t* pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (pool->count == 0 && pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+
+        pool_task_t task = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        pthread_mutex_unlock(&pool->lock);
+
+        task.fn(task.arg);
+        if (task.group) task_group_finish(task.group);
+    }
+}
+
+mem_error_t thread_pool_create(thread_pool_t** pool, size_t num_threads,
+                               size_t queue_capacity) {
+    MEM_CHECK_ERR(pool != NULL, MEM_ERR_INVALID_ARG, "pool is NULL");
+
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 1 ? (size_t)cpus - 1 : 1;
+    }
+    if (queue_capacity == 0) {
+        queue_capacity = num_threads * 8;
+    }
+
+    thread_pool_t* p = calloc(1, sizeof(thread_pool_t));
+    MEM_CHECK_ALLOC(p);
+
+    p->queue = calloc(queue_capacity, sizeof(pool_task_t));
+    p->threads = calloc(num_threads, sizeof(pthread_t));
+    if (!p->queue || !p->threads) {
+        free(p->queue);
+        free(p->threads);
+        free(p);
+        MEM_RETURN_ERROR(MEM_ERR_NOMEM, "failed to allocate thread pool");
+    }
+    p->capacity = queue_capacity;
+
+    if (pthread_mutex_init(&p->lock, NULL) != 0) {
+        free(p->queue);
+        free(p->threads);
+        free(p);
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init pool mutex");
+    }
+    if (pthread_cond_init(&p->not_empty, NULL) != 0) {
+        pthread_mutex_destroy(&p->lock);
+        free(p->queue);
+        free(p->threads);
+        free(p);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init pool condition");
+    }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&p->threads[i], NULL, worker_main, p) != 0) {
+            p->num_threads = i;
+            thread_pool_destroy(p);
+            MEM_RETURN_ERROR(MEM_ERR_THREAD, "failed to start worker %zu", i);
+        }
+    }
+    p->num_threads = num_threads;
+
+    LOG_DEBUG("Thread pool started with %zu workers", num_threads);
+    *pool = p;
+    return MEM_OK;
+}
+
+void thread_pool_destroy(thread_pool_t* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->queue);
+    free(pool->threads);
+    free(pool);
+}
+
+size_t thread_pool_size(const thread_pool_t* pool) {
+    return pool ? pool->num_threads : 0;
+}
+
+mem_error_t thread_pool_try_submit(thread_pool_t* pool, task_group_t* group,
+                                   thread_task_fn fn, void* arg) {
+    MEM_CHECK_ERR(pool != NULL, MEM_ERR_INVALID_ARG, "pool is NULL");
+    MEM_CHECK_ERR(fn != NULL, MEM_ERR_INVALID_ARG, "fn is NULL");
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count >= pool->capacity || pool->shutdown) {
+        pthread_mutex_unlock(&pool->lock);
+        return MEM_ERR_FULL;
+    }
+
+    if (group) {
+        pthread_mutex_lock(&group->lock);
+        group->pending++;
+        pthread_mutex_unlock(&group->lock);
+    }
+
+    size_t tail = (pool->head + pool->count) % pool->capacity;
+    pool->queue[tail] = (pool_task_t){ .fn = fn, .arg = arg, .group = group };
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    return MEM_OK;
+}
+
+mem_error_t task_group_init(task_group_t* group) {
+    MEM_CHECK_ERR(group != NULL, MEM_ERR_INVALID_ARG, "group is NULL");
+
+    group->pending = 0;
+    if (pthread_mutex_init(&group->lock, NULL) != 0) {
+        MEM_RETURN_ERROR(MEM_ERR_MUTEX, "failed to init group mutex");
+    }
+    if (pthread_cond_init(&group->done, NULL) != 0) {
+        pthread_mutex_destroy(&group->lock);
+        MEM_RETURN_ERROR(MEM_ERR_COND, "failed to init group condition");
+    }
+    return MEM_OK;
+}
+
+void task_group_wait(task_group_t* group) {
+    if (!group) return;
+
+    pthread_mutex_lock(&group->lock);
+    while (group->pending > 0) {
+        pthread_cond_wait(&group->done, &group->lock);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+void task_group_destroy(task_group_t* group) {
+    if (!group) return;
+
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->lock);
+}
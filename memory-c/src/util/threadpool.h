@@ -0,0 +1,54 @@
+/*
+ * Memory Service - Thread Pool
+ *
+ * Fixed-size worker pool with a bounded task queue. Submission never
+ * blocks: when the queue is full the caller is told to run the task
+ * itself, which keeps latency bounded under load.
+ */
+
+#ifndef MEMORY_SERVICE_THREADPOOL_H
+#define MEMORY_SERVICE_THREADPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "../../include/error.h"
+
+/* Forward declaration */
+typedef struct thread_pool thread_pool_t;
+
+/* Task function */
+typedef void (*thread_task_fn)(void* arg);
+
+/* Completion tracker for a batch of tasks */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  done;
+    size_t          pending;
+} task_group_t;
+
+/*
+ * Create pool with num_threads workers (0 = online CPUs - 1, min 1) and
+ * room for queue_capacity pending tasks (0 = 8 per worker)
+ */
+mem_error_t thread_pool_create(thread_pool_t** pool, size_t num_threads,
+                               size_t queue_capacity);
+
+/* Stop workers (queued tasks are drained first) and free pool */
+void thread_pool_destroy(thread_pool_t* pool);
+
+/* Number of worker threads */
+size_t thread_pool_size(const thread_pool_t* pool);
+
+/*
+ * Queue a task as part of group. Returns MEM_ERR_FULL if the queue is
+ * full; the caller should then run the task inline.
+ */
+mem_error_t thread_pool_try_submit(thread_pool_t* pool, task_group_t* group,
+                                   thread_task_fn fn, void* arg);
+
+/* Task group lifecycle */
+mem_error_t task_group_init(task_group_t* group);
+void task_group_wait(task_group_t* group);
+void task_group_destroy(task_group_t* group);
+
+#endif /* MEMORY_SERVICE_THREADPOOL_H */
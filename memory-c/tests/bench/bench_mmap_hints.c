@@ -0,0 +1,184 @@
+/*
+ * Memory Service - mmap Access Hint Benchmark
+ *
+ * Random vector lookups over a file-backed arena, the access pattern of
+ * HNSW traversal over an embedding level, under each arena hint set.
+ * Reports open time, lookup latency percentiles and dTLB load misses
+ * (via perf_event_open; "n/a" where perf counters are unavailable).
+ *
+ * Usage: bench_mmap_hints [size_mb] [lookups]
+ */
+
+#include "../../src/core/arena.h"
+#include "../../include/types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define BENCH_PATH "/tmp/bench_mmap_hints.bin"
+#define VECTOR_BYTES (EMBEDDING_DIM * sizeof(float))
+
+typedef struct {
+    const char* name;
+    uint32_t    flags;
+} bench_case_t;
+
+static const bench_case_t CASES[] = {
+    { "default",            0 },
+    { "random",             ARENA_FLAG_RANDOM },
+    { "random+hugepage",    ARENA_FLAG_RANDOM | ARENA_FLAG_HUGEPAGE },
+    { "random+populate",    ARENA_FLAG_RANDOM | ARENA_FLAG_POPULATE },
+    { "populate+mlock",     ARENA_FLAG_RANDOM | ARENA_FLAG_POPULATE | ARENA_FLAG_LOCK },
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Open a dTLB load-miss counter for this thread; -1 if unsupported */
+static int open_dtlb_counter(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void counter_start(int fd) {
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static long long counter_stop(int fd) {
+#ifdef __linux__
+    long long value = 0;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) return value;
+    }
+#else
+    (void)fd;
+#endif
+    return -1;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Drop the file's clean pages so every case starts cold */
+static void evict_file(void) {
+    int fd = open(BENCH_PATH, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t size_mb = argc > 1 ? (size_t)atol(argv[1]) : 512;
+    size_t lookups = argc > 2 ? (size_t)atol(argv[2]) : 200000;
+    size_t size = size_mb << 20;
+    size_t vectors = size / VECTOR_BYTES;
+    if (vectors == 0 || lookups == 0) {
+        fprintf(stderr, "usage: %s [size_mb] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    /* Fill the file once */
+    arena_t* arena = NULL;
+    if (arena_create_mmap(&arena, BENCH_PATH, size, 0) != MEM_OK) {
+        fprintf(stderr, "failed to create %s\n", BENCH_PATH);
+        return 1;
+    }
+    float* data = arena->base;
+    for (size_t i = 0; i < size / sizeof(float); i++) data[i] = (float)(i & 0xFFFF);
+    arena_sync(arena);
+    arena_destroy(arena);
+
+    uint64_t* lat = malloc(lookups * sizeof(uint64_t));
+    size_t* order = malloc(lookups * sizeof(size_t));
+    if (!lat || !order) return 1;
+
+    /* Same lookup sequence for every case */
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < lookups; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        order[i] = (size_t)(x % vectors);
+    }
+
+    int counter = open_dtlb_counter();
+    printf("%zu MB, %zu vectors, %zu random lookups\n\n", size_mb, vectors, lookups);
+    printf("%-18s %10s %10s %10s %10s %14s\n",
+           "hints", "open ms", "p50 ns", "p99 ns", "max ns", "dTLB misses");
+
+    volatile float sink = 0.0f;
+    for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+        evict_file();
+
+        uint64_t t0 = now_ns();
+        if (arena_open_mmap(&arena, BENCH_PATH, CASES[c].flags) != MEM_OK) {
+            fprintf(stderr, "failed to open %s\n", BENCH_PATH);
+            return 1;
+        }
+        uint64_t open_ns = now_ns() - t0;
+
+        counter_start(counter);
+        for (size_t i = 0; i < lookups; i++) {
+            uint64_t start = now_ns();
+            const float* v = (const float*)((char*)arena->base + order[i] * VECTOR_BYTES);
+            float sum = 0.0f;
+            for (size_t d = 0; d < EMBEDDING_DIM; d++) sum += v[d];
+            sink += sum;
+            lat[i] = now_ns() - start;
+        }
+        long long misses = counter_stop(counter);
+        arena_destroy(arena);
+
+        qsort(lat, lookups, sizeof(uint64_t), cmp_u64);
+        char miss_buf[32];
+        if (misses >= 0) snprintf(miss_buf, sizeof(miss_buf), "%lld", misses);
+        else snprintf(miss_buf, sizeof(miss_buf), "n/a");
+
+        printf("%-18s %10.1f %10llu %10llu %10llu %14s\n", CASES[c].name,
+               (double)open_ns / 1e6,
+               (unsigned long long)lat[lookups / 2],
+               (unsigned long long)lat[lookups * 99 / 100],
+               (unsigned long long)lat[lookups - 1], miss_buf);
+    }
+
+    if (counter >= 0) close(counter);
+    free(lat);
+    free(order);
+    unlink(BENCH_PATH);
+    (void)sink;
+    return 0;
+}
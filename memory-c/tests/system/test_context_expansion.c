@@ -53,7 +53,7 @@ TEST(context_expansion_parent) {
     /* Create hierarchy: session -> message -> block -> statements */
     node_id_t session, message, block, stmt1, stmt2, stmt3;
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt1));
@@ -115,7 +115,7 @@ TEST(context_expansion_navigation) {
     node_id_t blocks[3];
     node_id_t stmts[3][2];
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "sess", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "sess", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
 
     for (int b = 0; b < 3; b++) {
@@ -159,7 +159,7 @@ TEST(context_expansion_ancestors) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "sess", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "sess", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
@@ -168,7 +168,7 @@ TEST(context_expansion_ancestors) {
     node_id_t ancestors[10];
     size_t count = hierarchy_get_ancestors(h, stmt, ancestors, 10);
 
-    ASSERT_EQ(count, 3);  /* block, message, session */
+    ASSERT_EQ(count, 4);  /* block, message, session, agent */
     ASSERT_EQ(ancestors[0], block);
     ASSERT_EQ(ancestors[1], message);
     ASSERT_EQ(ancestors[2], session);
@@ -187,7 +187,7 @@ TEST(context_expansion_descendant_count) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "sess", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "sess", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
 
     /* Create 2 blocks with 3 statements each */
@@ -222,7 +222,7 @@ TEST(context_expansion_api) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "sess", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "sess", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
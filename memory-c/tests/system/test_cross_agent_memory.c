@@ -122,9 +122,9 @@ TEST(memory_attribution) {
 
     /* Create sessions with different agents */
     node_id_t sess_a, sess_b, sess_c;
-    ASSERT_OK(hierarchy_create_session(h, "agent-alpha", "session-alpha", &sess_a));
-    ASSERT_OK(hierarchy_create_session(h, "agent-beta", "session-beta", &sess_b));
-    ASSERT_OK(hierarchy_create_session(h, "agent-gamma", "session-gamma", &sess_c));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent-alpha"), "session-alpha", &sess_a));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent-beta"), "session-beta", &sess_b));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent-gamma"), "session-gamma", &sess_c));
 
     /* Verify node info includes agent_id */
     node_info_t info;
@@ -208,7 +208,7 @@ TEST(attribution_persistence) {
         ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
         node_id_t sess;
-        ASSERT_OK(hierarchy_create_session(h, "persistent-agent", "persistent-session", &sess));
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "persistent-agent"), "persistent-session", &sess));
 
         node_info_t info;
         ASSERT_OK(hierarchy_get_node(h, sess, &info));
@@ -223,9 +223,9 @@ TEST(attribution_persistence) {
         hierarchy_t* h = NULL;
         ASSERT_OK(hierarchy_open(&h, TEST_DIR));
 
-        /* Session is node 0 (first node created) */
+        /* Session is node 1 (created right after its agent) */
         node_info_t info;
-        ASSERT_OK(hierarchy_get_node(h, 0, &info));
+        ASSERT_OK(hierarchy_get_node(h, 1, &info));
         ASSERT_STR_EQ(info.agent_id, "persistent-agent");
         ASSERT_STR_EQ(info.session_id, "persistent-session");
 
@@ -152,18 +152,23 @@ TEST(wal_file_format) {
     ASSERT_OK(wal_sync(wal));
     wal_close(wal);
 
-    /* Verify WAL file exists */
-    ASSERT_MSG(file_exists(wal_path), "WAL file should exist");
-    ASSERT_GT(file_size(wal_path), 0);
-
-    /* Read WAL file directly and verify magic number */
-    int fd = open(wal_path, O_RDONLY);
+    /* Verify the first segment exists, preallocated */
+    char segment_path[300];
+    snprintf(segment_path, sizeof(segment_path), WAL_SEGMENT_NAME_FMT, wal_path, 0u);
+    ASSERT_MSG(file_exists(segment_path), "WAL segment should exist");
+    ASSERT_EQ(file_size(segment_path), WAL_SEGMENT_SIZE_DEFAULT);
+
+    /* Read the segment directly and verify both magic numbers */
+    int fd = open(segment_path, O_RDONLY);
     ASSERT_GE(fd, 0);
 
     uint32_t magic;
-    ssize_t n = read(fd, &magic, sizeof(magic));
-    close(fd);
+    ssize_t n = pread(fd, &magic, sizeof(magic), 0);
+    ASSERT_EQ(n, sizeof(magic));
+    ASSERT_EQ(magic, 0x57414C53);  /* "WALS" */
 
+    n = pread(fd, &magic, sizeof(magic), WAL_SEGMENT_HEADER_SIZE);
+    close(fd);
     ASSERT_EQ(n, sizeof(magic));
     ASSERT_EQ(magic, 0x57414C30);  /* "WAL0" */
 
@@ -246,7 +251,7 @@ TEST(mmap_files_readable_offline) {
  *   │   ├── next_sibling.bin
  *   │   └── level.bin
  *   └── wal/
- *       └── operations.log
+ *       └── operations.log.0
  */
 TEST(complete_file_layout) {
     setup_dirs();
@@ -303,7 +308,8 @@ TEST(complete_file_layout) {
     }
 
     /* WAL directory */
-    ASSERT_MSG(file_exists(wal_path), "WAL file should exist");
+    snprintf(path, sizeof(path), WAL_SEGMENT_NAME_FMT, wal_path, 0u);
+    ASSERT_MSG(file_exists(path), "WAL segment should exist");
 
     cleanup_dir(TEST_DIR);
 }
@@ -60,7 +60,7 @@ TEST(hierarchical_relationships) {
 
     /* Create session */
     node_id_t session;
-    ASSERT_OK(hierarchy_create_session(h, "test-agent", "test-session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "test-agent"), "test-session", &session));
     ASSERT_EQ(hierarchy_get_level(h, session), LEVEL_SESSION);
 
     /* Create message under session */
@@ -81,8 +81,8 @@ TEST(hierarchical_relationships) {
         }
     }
 
-    /* Total nodes: 1 session + 1 message + 2 blocks + 6 statements = 10 */
-    ASSERT_EQ(hierarchy_count(h), 10);
+    /* Total nodes: 1 agent + 1 session + 1 message + 2 blocks + 6 statements = 11 */
+    ASSERT_EQ(hierarchy_count(h), 11);
 
     /*
      * Verify parent-child relationships: message -> blocks -> statements
@@ -140,11 +140,11 @@ TEST(hierarchical_relationships) {
     ASSERT_EQ(hierarchy_get_next_sibling(h, stmts[1][2]), NODE_ID_INVALID);
 
     /*
-     * Verify ancestor traversal: statement -> block -> message -> session
+     * Verify ancestor traversal: statement -> block -> message -> session -> agent
      */
     node_id_t ancestors[10];
     count = hierarchy_get_ancestors(h, stmts[0][2], ancestors, 10);
-    ASSERT_EQ(count, 3);
+    ASSERT_EQ(count, 4);
     ASSERT_EQ(ancestors[0], blocks[0]);    /* Immediate parent */
     ASSERT_EQ(ancestors[1], message);       /* Grandparent */
     ASSERT_EQ(ancestors[2], session);       /* Great-grandparent */
@@ -201,7 +201,7 @@ TEST(hierarchical_relationships_persist) {
         hierarchy_t* h = NULL;
         ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
-        ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
         ASSERT_OK(hierarchy_create_message(h, session, &message));
         ASSERT_OK(hierarchy_create_block(h, message, &blocks[0]));
         ASSERT_OK(hierarchy_create_block(h, message, &blocks[1]));
@@ -221,7 +221,7 @@ TEST(hierarchical_relationships_persist) {
         hierarchy_t* h = NULL;
         ASSERT_OK(hierarchy_open(&h, TEST_DIR));
 
-        ASSERT_EQ(hierarchy_count(h), 10);
+        ASSERT_EQ(hierarchy_count(h), 11);
 
         /* Verify parent-child */
         ASSERT_EQ(hierarchy_get_parent(h, message), session);
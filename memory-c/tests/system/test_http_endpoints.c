@@ -51,7 +51,7 @@ TEST(http_health_endpoint) {
 
     /* Create some nodes */
     node_id_t session, message;
-    ASSERT_OK(hierarchy_create_session(h, "agent1", "session1", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent1"), "session1", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
 
     api_server_t* server = NULL;
@@ -62,7 +62,7 @@ TEST(http_health_endpoint) {
     ASSERT_OK(api_get_health(server, &health));
 
     ASSERT_TRUE(health.healthy);
-    ASSERT_EQ(health.node_count, 2);  /* session + message */
+    ASSERT_EQ(health.node_count, 3);  /* agent + session + message */
     /* uptime_ms is valid uint64_t calculated from timestamps */
 
     /* Format as JSON */
@@ -83,7 +83,7 @@ TEST(http_health_endpoint) {
 
     yyjson_val* node_count = yyjson_obj_get(root, "node_count");
     ASSERT_NOT_NULL(node_count);
-    ASSERT_EQ(yyjson_get_uint(node_count), 2);
+    ASSERT_EQ(yyjson_get_uint(node_count), 3);
 
     yyjson_doc_free(doc);
     free(json);
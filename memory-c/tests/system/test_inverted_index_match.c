@@ -64,7 +64,7 @@ TEST(inverted_index_exact_match) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -117,7 +117,7 @@ TEST(merged_search_results) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -202,7 +202,7 @@ TEST(jsonrpc_get_context_method) {
 
     /* Create a session to get context for */
     node_id_t session;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
 
     api_server_t* server = NULL;
     ASSERT_OK(api_server_create(&server, h, NULL, NULL, NULL));
@@ -79,7 +79,7 @@ TEST(multilevel_semantic_search) {
         snprintf(agent, sizeof(agent), "agent-%d", s);
         snprintf(sess, sizeof(sess), "session-%d", s);
 
-        ASSERT_OK(hierarchy_create_session(h, agent, sess, &sessions[s]));
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, agent), sess, &sessions[s]));
         ASSERT_OK(hierarchy_create_message(h, sessions[s], &messages[s]));
         ASSERT_OK(hierarchy_create_block(h, messages[s], &blocks[s]));
 
@@ -192,7 +192,7 @@ TEST(multilevel_search_ranking) {
     ASSERT_OK(search_engine_create(&engine, h, &config));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -206,11 +206,11 @@ TEST(multilevel_search_ranking) {
 
     const char* tokens[] = {"test", "content"};
 
-    /* Old statement: timestamp 1000ms */
+    /* Old statement: timestamp near the epoch */
     ASSERT_OK(search_engine_index(engine, stmt_old, emb, tokens, 2, 1000));
 
-    /* New statement: timestamp far in future (to ensure recency boost) */
-    ASSERT_OK(search_engine_index(engine, stmt_new, emb, tokens, 2, 9999999999ULL));
+    /* New statement: indexed just now (full recency boost) */
+    ASSERT_OK(search_engine_index(engine, stmt_new, emb, tokens, 2, timestamp_now_ns()));
 
     /* Search */
     search_match_t results[10];
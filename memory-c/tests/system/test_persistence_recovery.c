@@ -13,6 +13,7 @@
 #include "../../src/storage/wal.h"
 #include "../../src/storage/embeddings.h"
 #include "../../src/storage/relations.h"
+#include "../../src/core/hierarchy.h"
 #include "../../include/types.h"
 #include "../../include/error.h"
 
@@ -21,6 +22,8 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <sys/wait.h>
+#include <fcntl.h>
 
 #define TEST_DIR "/tmp/test_persistence_recovery"
 #define NUM_MESSAGES 100
@@ -196,13 +199,18 @@ TEST(partial_write_recovery) {
         data.node_id = 2;
         ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &data, sizeof(data)));
 
+        off_t end = (off_t)(WAL_SEGMENT_HEADER_SIZE + wal_size(wal));
         wal_close(wal);
 
-        /* Truncate file to simulate partial write */
-        /* Remove last few bytes from the file */
-        struct stat st;
-        stat(wal_path, &st);
-        truncate(wal_path, st.st_size - 10);
+        /* Overwrite the last few bytes to simulate a partial write */
+        char segment_path[300];
+        snprintf(segment_path, sizeof(segment_path), WAL_SEGMENT_NAME_FMT, wal_path, 0u);
+        int fd = open(segment_path, O_WRONLY);
+        ASSERT_GE(fd, 0);
+        char garbage[10];
+        memset(garbage, 0xff, sizeof(garbage));
+        ASSERT_EQ(pwrite(fd, garbage, sizeof(garbage), end - (off_t)sizeof(garbage)), sizeof(garbage));
+        close(fd);
     }
 
     /* Recovery should handle truncated entry gracefully */
@@ -214,8 +222,8 @@ TEST(partial_write_recovery) {
         /* Should recover complete entries, skip truncated one */
         ASSERT_OK(wal_replay(wal, recovery_callback, NULL));
 
-        /* At least one entry should be recovered */
-        ASSERT_GE(g_recovered_count, 1);
+        /* The intact entry is recovered, the damaged one is not */
+        ASSERT_EQ(g_recovered_count, 1);
 
         wal_close(wal);
     }
@@ -223,4 +231,92 @@ TEST(partial_write_recovery) {
     cleanup_dir(TEST_DIR);
 }
 
+/*
+ * TEST: SIGKILL mid-ingest loses nothing that was acknowledged
+ *
+ * A child ingests messages and reports each committed one over a pipe;
+ * the parent kills it without warning and reopens the same directory.
+ */
+#define KILL_AFTER 200
+
+static void ingest_until_killed(int ack_fd) {
+    hierarchy_t* h = NULL;
+    if (hierarchy_create(&h, TEST_DIR, 64) != MEM_OK) _exit(1);
+    if (hierarchy_enable_wal(h, 0, NULL) != MEM_OK) _exit(1);
+
+    node_id_t agent, session;
+    if (hierarchy_create_agent(h, "agent", &agent) != MEM_OK) _exit(1);
+    if (hierarchy_create_session(h, agent, "session", &session) != MEM_OK) _exit(1);
+
+    float values[EMBEDDING_DIM] = {0};
+    char text[64];
+    for (uint32_t i = 0;; i++) {
+        node_id_t msg;
+        int n = snprintf(text, sizeof(text), "acknowledged message %u", i);
+        values[i % EMBEDDING_DIM] = (float)i;
+        if (hierarchy_create_message(h, session, &msg) != MEM_OK ||
+            hierarchy_set_text(h, msg, text, (size_t)n) != MEM_OK ||
+            hierarchy_set_embedding(h, msg, values) != MEM_OK ||
+            hierarchy_commit(h) != MEM_OK) {
+            _exit(1);
+        }
+        values[i % EMBEDDING_DIM] = 0.0f;
+        if (write(ack_fd, &i, sizeof(i)) != sizeof(i)) _exit(1);
+    }
+}
+
+TEST(kill_during_ingest_recovery) {
+    setup_dirs();
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        close(fds[0]);
+        ingest_until_killed(fds[1]);
+    }
+    close(fds[1]);
+
+    uint32_t acked = 0, seq;
+    while (acked < KILL_AFTER && read(fds[0], &seq, sizeof(seq)) == sizeof(seq)) {
+        acked = seq + 1;
+    }
+    kill(pid, SIGKILL);
+
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFSIGNALED(status));
+    close(fds[0]);
+    ASSERT_EQ(acked, KILL_AFTER);
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    node_id_t agent = hierarchy_find_agent(h, "agent");
+    ASSERT_NE(agent, NODE_ID_INVALID);
+    node_id_t session = hierarchy_find_session(h, agent, "session");
+    ASSERT_NE(session, NODE_ID_INVALID);
+    ASSERT_GE(hierarchy_get_child_count(h, session), acked);
+
+    /* Messages are the session's children in ingest order */
+    char text[64];
+    node_id_t msg = hierarchy_get_first_child(h, session);
+    for (uint32_t i = 0; i < acked; i++) {
+        ASSERT_NE(msg, NODE_ID_INVALID);
+        snprintf(text, sizeof(text), "acknowledged message %u", i);
+        ASSERT_STR_EQ(test_text(h, msg, NULL), text);
+
+        const float* values = hierarchy_get_embedding(h, msg);
+        ASSERT_NOT_NULL(values);
+        ASSERT_FLOAT_EQ(values[i % EMBEDDING_DIM], (float)i, 0.0001f);
+        msg = hierarchy_get_next_sibling(h, msg);
+    }
+
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
 TEST_MAIN()
@@ -71,7 +71,7 @@ TEST(pooled_embeddings_hierarchy) {
     node_id_t block1, block2;
     node_id_t stmts1[3], stmts2[2];
 
-    ASSERT_OK(hierarchy_create_session(h, "test-agent", "test-session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "test-agent"), "test-session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
 
     /* Block 1: code block */
@@ -219,7 +219,7 @@ TEST(pooling_is_mean_not_other) {
     node_id_t session, message, block;
     node_id_t stmt1, stmt2;
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt1));
@@ -77,7 +77,7 @@ TEST(ranking_formula_weights) {
     ASSERT_OK(search_engine_create(&engine, h, &config));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -97,7 +97,7 @@ TEST(ranking_formula_weights) {
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt_relevant_new));
     const char* tokens2[] = {"relevant", "new"};
     ASSERT_OK(search_engine_index(engine, stmt_relevant_new, query,
-                                  tokens2, 2, 9999999999999ULL));  /* Far future */
+                                  tokens2, 2, timestamp_now_ns()));  /* Just now */
 
     /* Search */
     search_match_t results[10];
@@ -137,7 +137,7 @@ TEST(ranking_score_components) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -63,7 +63,7 @@ TEST(token_budget_truncation) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -120,17 +120,19 @@ TEST(token_budget_levels) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
 
     /* Create results with different levels */
-    search_match_t results[4];
-    results[0].level = LEVEL_STATEMENT;  /* 50 tokens */
-    results[1].level = LEVEL_BLOCK;      /* 200 tokens */
-    results[2].level = LEVEL_MESSAGE;    /* 500 tokens */
-    results[3].level = LEVEL_SESSION;    /* 1000 tokens */
+    /* No recorded token counts, so per-level estimates apply */
+    search_match_t results[4] = {
+        { .node_id = NODE_ID_INVALID, .level = LEVEL_STATEMENT, .score = 1.0f },  /* 50 tokens */
+        { .node_id = NODE_ID_INVALID, .level = LEVEL_BLOCK,     .score = 1.0f },  /* 200 tokens */
+        { .node_id = NODE_ID_INVALID, .level = LEVEL_MESSAGE,   .score = 1.0f },  /* 500 tokens */
+        { .node_id = NODE_ID_INVALID, .level = LEVEL_SESSION,   .score = 1.0f },  /* 1000 tokens */
+    };
 
     size_t budget_count;
 
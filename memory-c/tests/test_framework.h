@@ -13,6 +13,8 @@
 #include <math.h>
 #include <stdbool.h>
 
+#include "../src/core/hierarchy.h"
+
 /* Test result tracking */
 static int g_tests_run = 0;
 static int g_tests_passed = 0;
@@ -209,6 +211,19 @@ static int g_test_count = 0;
     return; \
 } while(0)
 
+/* Find or create the agent node that owns a test session */
+static inline node_id_t test_agent(hierarchy_t* h, const char* agent_id) {
+    node_id_t agent = NODE_ID_INVALID;
+    mem_error_t err = hierarchy_create_agent(h, agent_id, &agent);
+    return (err == MEM_OK || err == MEM_ERR_EXISTS) ? agent : NODE_ID_INVALID;
+}
+
+/* Read a node's text into a buffer reused by every call, or NULL if it has none */
+static inline const char* test_text(const hierarchy_t* h, node_id_t id, size_t* len) {
+    static char buf[4096];
+    return hierarchy_get_text(h, id, buf, sizeof(buf), len) ? buf : NULL;
+}
+
 /* Run all registered tests */
 static inline int run_tests(void) {
     printf("\n========================================\n");
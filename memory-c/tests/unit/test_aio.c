@@ -0,0 +1,211 @@
+/*
+ * Memory Service - Asynchronous File I/O Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/storage/aio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+
+#define TEST_FILE "/tmp/test_aio.dat"
+
+/* Counts completions so a test can wait for them */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             done;
+    int             failed;
+} completions_t;
+
+static void completions_init(completions_t* c) {
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    c->done = 0;
+    c->failed = 0;
+}
+
+static void completions_destroy(completions_t* c) {
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+}
+
+static void on_done(void* arg, mem_error_t err) {
+    completions_t* c = arg;
+    pthread_mutex_lock(&c->lock);
+    c->done++;
+    if (err != MEM_OK) c->failed++;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void completions_wait(completions_t* c, int n) {
+    pthread_mutex_lock(&c->lock);
+    while (c->done < n) {
+        pthread_cond_wait(&c->cond, &c->lock);
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* Write count blocks of 64 bytes, block i filled with byte i, and check them */
+static void write_blocks(aio_backend_t backend, int count) {
+    unlink(TEST_FILE);
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+
+    aio_t* aio = NULL;
+    ASSERT_OK(aio_create(&aio, backend, 8));
+
+    char (*blocks)[64] = malloc((size_t)count * 64);
+    ASSERT_NOT_NULL(blocks);
+
+    completions_t c;
+    completions_init(&c);
+    for (int i = 0; i < count; i++) {
+        memset(blocks[i], i & 0xff, 64);
+        struct iovec iov[2] = { { blocks[i], 16 }, { blocks[i] + 16, 48 } };
+        ASSERT_OK(aio_write(aio, fd, iov, 2, (off_t)i * 64, i % 2 == 0, on_done, &c));
+    }
+    completions_wait(&c, count);
+    ASSERT_EQ(c.failed, 0);
+    ASSERT_OK(aio_fsync(aio, fd, on_done, &c));
+    completions_wait(&c, count + 1);
+
+    aio_stats_t stats;
+    aio_get_stats(aio, &stats);
+    ASSERT_EQ(stats.requests, (uint64_t)count + 1);
+    ASSERT_EQ(stats.bytes, (uint64_t)count * 64);
+    aio_destroy(aio);
+
+    char buf[64];
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(pread(fd, buf, sizeof(buf), (off_t)i * 64), 64);
+        ASSERT_EQ(memcmp(buf, blocks[i], 64), 0);
+    }
+
+    close(fd);
+    completions_destroy(&c);
+    free(blocks);
+    unlink(TEST_FILE);
+}
+
+/* Test the blocking backend completes each request before returning */
+TEST(aio_blocking_write) {
+    aio_t* aio = NULL;
+    ASSERT_OK(aio_create(&aio, AIO_BACKEND_BLOCKING, 0));
+    ASSERT_EQ(aio_get_backend(aio), AIO_BACKEND_BLOCKING);
+
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+
+    completions_t c;
+    completions_init(&c);
+    struct iovec iov = { "hello", 5 };
+    ASSERT_OK(aio_write(aio, fd, &iov, 1, 3, true, on_done, &c));
+    ASSERT_EQ(c.done, 1);
+    ASSERT_EQ(c.failed, 0);
+
+    char buf[8] = {0};
+    ASSERT_EQ(pread(fd, buf, 5, 3), 5);
+    ASSERT_STR_EQ(buf, "hello");
+
+    close(fd);
+    aio_destroy(aio);
+    completions_destroy(&c);
+    unlink(TEST_FILE);
+
+    write_blocks(AIO_BACKEND_BLOCKING, 100);
+}
+
+/* Test io_uring (or its blocking fallback) with more requests than ring slots */
+TEST(aio_io_uring_write) {
+    aio_t* aio = NULL;
+    ASSERT_OK(aio_create(&aio, AIO_BACKEND_IO_URING, 0));
+    aio_backend_t backend = aio_get_backend(aio);
+    ASSERT(backend == AIO_BACKEND_IO_URING || backend == AIO_BACKEND_BLOCKING);
+    aio_destroy(aio);
+
+    write_blocks(AIO_BACKEND_IO_URING, 500);
+}
+
+/* Test a request with more iovecs than one writev takes */
+TEST(aio_io_uring_long_iov) {
+    int count = IOV_MAX * 2 + 7;
+    char* bytes = malloc((size_t)count);
+    struct iovec* iov = malloc((size_t)count * sizeof(struct iovec));
+    ASSERT_NOT_NULL(bytes);
+    ASSERT_NOT_NULL(iov);
+    for (int i = 0; i < count; i++) {
+        bytes[i] = (char)(i * 7);
+        iov[i] = (struct iovec){ &bytes[i], 1 };
+    }
+
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+
+    aio_t* aio = NULL;
+    ASSERT_OK(aio_create(&aio, AIO_BACKEND_IO_URING, 0));
+    completions_t c;
+    completions_init(&c);
+    ASSERT_OK(aio_write(aio, fd, iov, count, 0, true, on_done, &c));
+    completions_wait(&c, 1);
+    ASSERT_EQ(c.failed, 0);
+    aio_destroy(aio);
+
+    char* back = malloc((size_t)count);
+    ASSERT_NOT_NULL(back);
+    ASSERT_EQ(pread(fd, back, (size_t)count, 0), count);
+    ASSERT_EQ(memcmp(back, bytes, (size_t)count), 0);
+
+    close(fd);
+    completions_destroy(&c);
+    free(back);
+    free(iov);
+    free(bytes);
+    unlink(TEST_FILE);
+}
+
+/* Test a failing write is reported through the callback */
+TEST(aio_write_error) {
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    fd = open(TEST_FILE, O_RDONLY);
+    ASSERT_GE(fd, 0);
+
+    aio_backend_t backends[] = { AIO_BACKEND_BLOCKING, AIO_BACKEND_IO_URING };
+    for (int b = 0; b < 2; b++) {
+        aio_t* aio = NULL;
+        ASSERT_OK(aio_create(&aio, backends[b], 0));
+        completions_t c;
+        completions_init(&c);
+
+        struct iovec iov = { "x", 1 };
+        ASSERT_OK(aio_write(aio, fd, &iov, 1, 0, true, on_done, &c));
+        completions_wait(&c, 1);
+        ASSERT_EQ(c.failed, 1);
+
+        aio_stats_t stats;
+        aio_get_stats(aio, &stats);
+        ASSERT_EQ(stats.requests, 1);
+        aio_destroy(aio);
+        completions_destroy(&c);
+    }
+
+    close(fd);
+    unlink(TEST_FILE);
+
+    aio_t* aio = NULL;
+    ASSERT_ERR(aio_create(NULL, AIO_BACKEND_BLOCKING, 0), MEM_ERR_INVALID_ARG);
+    ASSERT_OK(aio_create(&aio, AIO_BACKEND_BLOCKING, 0));
+    ASSERT_ERR(aio_write(aio, 0, NULL, 1, 0, false, on_done, NULL), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(aio_write(aio, 0, NULL, 0, 0, false, NULL, NULL), MEM_ERR_INVALID_ARG);
+    aio_destroy(aio);
+    aio_destroy(NULL);
+}
+
+TEST_MAIN()
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #define TEST_DIR "/tmp/test_api"
 
@@ -350,7 +351,7 @@ TEST(rpc_method_get_context) {
 
     /* Create a session */
     node_id_t session;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
 
     rpc_context_t* ctx = NULL;
     ASSERT_OK(rpc_context_create(&ctx, h, NULL, NULL));
@@ -397,6 +398,55 @@ TEST(rpc_method_list_sessions) {
     rpc_context_destroy(ctx);
 }
 
+/* Run a snapshot request; the error code, 0 on success */
+static int execute_snapshot(rpc_context_t* ctx, const char* params) {
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"jsonrpc\":\"2.0\",\"method\":\"snapshot\",\"params\":%s,\"id\":1}",
+             params);
+
+    rpc_request_t request;
+    void* doc = NULL;
+    if (rpc_parse_request(json, strlen(json), &request, &doc) != MEM_OK) return -1;
+
+    rpc_response_t response;
+    int code = rpc_execute(ctx, &request, &response) != MEM_OK ? -1 :
+               response.is_error ? response.error_code : 0;
+    rpc_request_free(doc);
+    return code;
+}
+
+/* Test snapshot method */
+TEST(rpc_method_snapshot) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snapshots");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    rpc_context_t* ctx = NULL;
+    ASSERT_OK(rpc_context_create(&ctx, h, NULL, NULL));
+
+    /* Off until a directory is set */
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"first\"}"), RPC_ERROR_SERVER);
+
+    mkdir(TEST_DIR "_snapshots", 0755);
+    ASSERT_OK(rpc_context_set_snapshot_dir(ctx, TEST_DIR "_snapshots"));
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"first\"}"), 0);
+    ASSERT_EQ(access(TEST_DIR "_snapshots/first/SNAPSHOT", F_OK), 0);
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"second\",\"base\":\"first\"}"), 0);
+
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"first\"}"), RPC_ERROR_INVALID_PARAMS);
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"../escape\"}"), RPC_ERROR_INVALID_PARAMS);
+    ASSERT_EQ(execute_snapshot(ctx, "{\"name\":\"third\",\"base\":\"none\"}"),
+              RPC_ERROR_INVALID_PARAMS);
+
+    rpc_context_destroy(ctx);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR "_snapshots");
+    cleanup_dir(TEST_DIR);
+}
+
 /* Test health formatting */
 TEST(api_format_health) {
     health_result_t health = {
@@ -185,6 +185,195 @@ TEST(arena_mmap_persistence) {
     unlink(path);
 }
 
+/* Test growth inside a reservation keeps the mapping in place */
+TEST(arena_mmap_reserve) {
+    const char* path = "/tmp/test_arena_reserve.bin";
+    arena_t* arena = NULL;
+    ASSERT_OK(arena_create_mmap(&arena, path, 1000, 0));
+
+    uint32_t* data = arena_get_ptr(arena, 0);
+    data[0] = 0xDEADBEEF;
+
+    ASSERT_OK(arena_reserve(arena, 1 << 20));
+    data = arena_get_ptr(arena, 0);
+    ASSERT_EQ(data[0], 0xDEADBEEF);
+
+    /* Grow from a partial page; existing pointers stay valid */
+    ASSERT_OK(arena_grow(arena, 10000));
+    ASSERT_TRUE(arena_get_ptr(arena, 0) == data);
+    ASSERT_EQ(data[0], 0xDEADBEEF);
+    uint32_t* tail = arena_get_ptr(arena, 9996);
+    ASSERT_NOT_NULL(tail);
+    *tail = 0xCAFEBABE;
+
+    ASSERT_OK(arena_grow(arena, 1 << 20));
+    ASSERT_TRUE(arena_get_ptr(arena, 0) == data);
+    ASSERT_ERR(arena_grow(arena, (1 << 20) + 1), MEM_ERR_FULL);
+    arena_destroy(arena);
+
+    ASSERT_OK(arena_open_mmap(&arena, path, 0));
+    ASSERT_EQ(arena_size(arena), 1 << 20);
+    ASSERT_EQ(*(uint32_t*)arena_get_ptr(arena, 0), 0xDEADBEEF);
+    ASSERT_EQ(*(uint32_t*)arena_get_ptr(arena, 9996), 0xCAFEBABE);
+    arena_destroy(arena);
+
+    /* Heap arenas cannot reserve */
+    ASSERT_OK(arena_create(&arena, 64));
+    ASSERT_ERR(arena_reserve(arena, 4096), MEM_ERR_INVALID_ARG);
+    arena_destroy(arena);
+
+    unlink(path);
+}
+
+/* Test access hints are recorded, validated and kept across growth */
+TEST(arena_mmap_hints) {
+    const char* path = "/tmp/test_arena_hints.bin";
+    arena_t* arena = NULL;
+    ASSERT_OK(arena_create_mmap(&arena, path, 8192,
+                                ARENA_FLAG_RANDOM | ARENA_FLAG_POPULATE));
+    ASSERT_EQ(arena->flags & ARENA_HINT_MASK, ARENA_FLAG_RANDOM | ARENA_FLAG_POPULATE);
+
+    /* Hints are advisory; a refused mlock still succeeds */
+    ASSERT_OK(arena_advise(arena, ARENA_FLAG_SEQUENTIAL | ARENA_FLAG_HUGEPAGE |
+                                  ARENA_FLAG_LOCK));
+    ASSERT_EQ(arena->flags & ARENA_HINT_MASK,
+              ARENA_FLAG_SEQUENTIAL | ARENA_FLAG_HUGEPAGE | ARENA_FLAG_LOCK);
+    ASSERT_TRUE(arena_is_mmap(arena));
+
+    ASSERT_OK(arena_grow(arena, 65536));
+    ASSERT_EQ(arena->flags & ARENA_HINT_MASK,
+              ARENA_FLAG_SEQUENTIAL | ARENA_FLAG_HUGEPAGE | ARENA_FLAG_LOCK);
+    *(uint32_t*)arena_get_ptr(arena, 65532) = 7;
+
+    ASSERT_OK(arena_advise(arena, 0));
+    ASSERT_EQ(arena->flags & ARENA_HINT_MASK, 0);
+
+    ASSERT_ERR(arena_advise(arena, ARENA_FLAG_RANDOM | ARENA_FLAG_SEQUENTIAL),
+               MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(arena_advise(arena, ARENA_FLAG_READONLY), MEM_ERR_INVALID_ARG);
+    arena_destroy(arena);
+
+    ASSERT_OK(arena_create(&arena, 64));
+    ASSERT_ERR(arena_advise(arena, ARENA_FLAG_RANDOM), MEM_ERR_INVALID_ARG);
+    arena_destroy(arena);
+
+    unlink(path);
+}
+
+/* Test range sync covers partial pages and ignores out-of-range requests */
+TEST(arena_mmap_sync_range) {
+    const char* path = "/tmp/test_arena_sync_range.bin";
+    arena_t* arena = NULL;
+    ASSERT_OK(arena_create_mmap(&arena, path, 3 * 4096, 0));
+
+    uint32_t* p = arena_get_ptr(arena, 4096 + 100);
+    *p = 42;
+    ASSERT_OK(arena_sync_range(arena, 4096 + 100, sizeof(*p)));
+    ASSERT_OK(arena_sync_range(arena, 4000, 5000));
+    ASSERT_OK(arena_sync_range(arena, 0, 0));
+    ASSERT_OK(arena_sync_range(arena, 1 << 20, 10));
+    ASSERT_OK(arena_sync_range(arena, 2 * 4096, 1 << 20));
+    arena_destroy(arena);
+
+    ASSERT_OK(arena_open_mmap(&arena, path, 0));
+    ASSERT_EQ(*(uint32_t*)arena_get_ptr(arena, 4096 + 100), 42);
+    arena_destroy(arena);
+
+    ASSERT_ERR(arena_sync_range(NULL, 0, 1), MEM_ERR_INVALID_ARG);
+    unlink(path);
+}
+
+/* Test writeback covers only marked pages, in separate ranges */
+TEST(arena_dirty_writeback) {
+    const char* path = "/tmp/test_arena_dirty.bin";
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    arena_t* arena = NULL;
+    ASSERT_OK(arena_create_mmap(&arena, path, 64 * page, 0));
+
+    size_t bytes = 1;
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, 0);
+
+    /* A header and a far slot stay two ranges */
+    memset(arena->base, 1, 16);
+    memset((char*)arena->base + 40 * page + 100, 2, 8);
+    arena_mark_dirty(arena, 0, 16);
+    arena_mark_dirty(arena, 40 * page + 100, 8);
+    ASSERT_EQ(arena->dirty_count, 2);
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, 16 + 108);
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, 0);
+
+    /* Writes within a page of each other extend one range */
+    arena_mark_dirty(arena, 100, 4);
+    arena_mark_dirty(arena, 200, 4);
+    arena_mark_dirty(arena, page + 50, 4);
+    ASSERT_EQ(arena->dirty_count, 1);
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, page + 54);
+
+    /* Past the limit, new ranges join the closest */
+    for (size_t i = 0; i < 2 * ARENA_DIRTY_RANGES; i++) {
+        arena_mark_dirty(arena, i * 8 * page, 1);
+    }
+    ASSERT_EQ(arena->dirty_count, ARENA_DIRTY_RANGES);
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, (ARENA_DIRTY_RANGES - 1) + (ARENA_DIRTY_RANGES * 8 * page + 1));
+
+    /* A full sync leaves nothing to write back */
+    arena_mark_dirty(arena, 5 * page, 10);
+    ASSERT_OK(arena_sync(arena));
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, 0);
+    arena_destroy(arena);
+    unlink(path);
+
+    /* Heap arenas track nothing */
+    ASSERT_OK(arena_create(&arena, 1024));
+    arena_mark_dirty(arena, 0, 100);
+    ASSERT_OK(arena_writeback(arena, &bytes));
+    ASSERT_EQ(bytes, 0);
+    arena_destroy(arena);
+
+    ASSERT_ERR(arena_writeback(NULL, &bytes), MEM_ERR_INVALID_ARG);
+}
+
+/* Test writeback of every mapped arena skips destroyed and read-only ones */
+TEST(arena_writeback_all) {
+    const char* path_a = "/tmp/test_arena_wb_a.bin";
+    const char* path_b = "/tmp/test_arena_wb_b.bin";
+    arena_t* a = NULL;
+    arena_t* b = NULL;
+    arena_t* ro = NULL;
+    ASSERT_OK(arena_create_mmap(&a, path_a, 4096, 0));
+    ASSERT_OK(arena_create_mmap(&b, path_b, 4096, 0));
+    ASSERT_OK(arena_open_mmap(&ro, path_a, ARENA_FLAG_READONLY));
+
+    size_t arenas = 0;
+    size_t bytes = 0;
+    arena_mark_dirty(a, 0, 10);
+    arena_mark_dirty(b, 0, 20);
+    ASSERT_OK(arena_writeback_all(&arenas, &bytes));
+    ASSERT_EQ(arenas, 2);
+    ASSERT_EQ(bytes, 30);
+
+    ASSERT_OK(arena_writeback_all(&arenas, &bytes));
+    ASSERT_EQ(arenas, 0);
+
+    arena_mark_dirty(a, 0, 10);
+    arena_mark_dirty(b, 0, 20);
+    arena_destroy(a);
+    ASSERT_OK(arena_writeback_all(&arenas, &bytes));
+    ASSERT_EQ(arenas, 1);
+    ASSERT_EQ(bytes, 20);
+
+    arena_destroy(ro);
+    arena_destroy(b);
+    unlink(path_a);
+    unlink(path_b);
+}
+
 /* Test arena offset operations */
 TEST(arena_offset_operations) {
     arena_t* arena = NULL;
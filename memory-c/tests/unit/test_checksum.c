@@ -0,0 +1,67 @@
+/*
+ * Memory Service - Checksum Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/util/checksum.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Test the standard check values */
+TEST(checksum_check_values) {
+    const char* digits = "123456789";
+    ASSERT_EQ(checksum_crc32c(digits, 9), 0xE3069283u);
+    ASSERT_EQ(checksum_crc32c_portable(0, digits, 9), 0xE3069283u);
+    ASSERT_EQ(checksum_crc32_ieee(digits, 9), 0xCBF43926u);
+
+    ASSERT_EQ(checksum_crc32c(NULL, 0), 0);
+    ASSERT_EQ(checksum_crc32_ieee(NULL, 0), 0);
+
+    /* RFC 3720 B.4: 32 bytes of zeros */
+    uint8_t zeros[32] = {0};
+    ASSERT_EQ(checksum_crc32c(zeros, sizeof(zeros)), 0x8A9136AAu);
+
+    ASSERT_NOT_NULL(checksum_crc32c_impl());
+}
+
+/* Test the build's path matches the tables at every length and alignment */
+TEST(checksum_paths_agree) {
+    size_t n = 4096 + 64;
+    uint8_t* buf = malloc(n);
+    ASSERT_NOT_NULL(buf);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < n; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len = 0; len < 300; len++) {
+            ASSERT_EQ(checksum_crc32c(buf + offset, len),
+                      checksum_crc32c_portable(0, buf + offset, len));
+        }
+        ASSERT_EQ(checksum_crc32c(buf + offset, 4096),
+                  checksum_crc32c_portable(0, buf + offset, 4096));
+    }
+    free(buf);
+}
+
+/* Test a checksum split across buffers equals the whole */
+TEST(checksum_update) {
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    size_t len = strlen(text);
+    uint32_t whole = checksum_crc32c(text, len);
+
+    for (size_t cut = 0; cut <= len; cut++) {
+        uint32_t crc = checksum_crc32c_update(0, text, cut);
+        crc = checksum_crc32c_update(crc, text + cut, len - cut);
+        ASSERT_EQ(crc, whole);
+
+        crc = checksum_crc32c_portable(0, text, cut);
+        crc = checksum_crc32c_portable(crc, text + cut, len - cut);
+        ASSERT_EQ(crc, whole);
+    }
+}
+
+TEST_MAIN()
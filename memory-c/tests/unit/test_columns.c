@@ -0,0 +1,174 @@
+/*
+ * Memory Service - Node Columns Storage Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/storage/columns.h"
+#include "../../include/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static void cleanup_dir(const char* dir) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    system(cmd);
+}
+
+/* Test column store creation */
+TEST(columns_create_basic) {
+    const char* dir = "/tmp/test_columns_create";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    columns_store_t* store = NULL;
+    ASSERT_OK(columns_create(&store, dir, 100));
+    ASSERT_NOT_NULL(store);
+    ASSERT_EQ(columns_count(store), 0);
+
+    /* Out-of-range reads return defaults */
+    ASSERT_EQ(columns_get_created_at(store, 0), 0);
+    ASSERT_EQ(columns_get_agent(store, 0), NODE_ID_INVALID);
+
+    columns_close(store);
+    cleanup_dir(dir);
+}
+
+/* Test appending rows and reading columns */
+TEST(columns_append_rows) {
+    const char* dir = "/tmp/test_columns_append";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    columns_store_t* store = NULL;
+    ASSERT_OK(columns_create(&store, dir, 100));
+
+    column_row_t agent = {
+        .created_at = 1000, .level = LEVEL_AGENT,
+        .agent = 0, .session = NODE_ID_INVALID
+    };
+    column_row_t session = {
+        .created_at = 2000, .level = LEVEL_SESSION,
+        .agent = 0, .session = 1
+    };
+    ASSERT_OK(columns_append(store, 0, &agent));
+    ASSERT_OK(columns_append(store, 1, &session));
+    ASSERT_EQ(columns_count(store), 2);
+
+    /* Rows must be appended in node_id order */
+    ASSERT_ERR(columns_append(store, 5, &session), MEM_ERR_INVALID_ARG);
+
+    ASSERT_EQ(columns_get_created_at(store, 1), 2000);
+    ASSERT_EQ(columns_get_level(store, 0), LEVEL_AGENT);
+    ASSERT_EQ(columns_get_session(store, 0), NODE_ID_INVALID);
+    ASSERT_EQ(columns_get_session(store, 1), 1);
+
+    ASSERT_OK(columns_set_token_count(store, 1, 42));
+    ASSERT_OK(columns_set_created_at(store, 1, 3000));
+    ASSERT_ERR(columns_set_token_count(store, 2, 1), MEM_ERR_NOT_FOUND);
+
+    /* Raw columns see the same values */
+    ASSERT_EQ(columns_token_count(store)[1], 42);
+    ASSERT_EQ(columns_created_at(store)[1], 3000);
+    ASSERT_EQ(columns_level(store)[1], LEVEL_SESSION);
+    ASSERT_EQ(columns_agent(store)[1], 0);
+
+    columns_close(store);
+    cleanup_dir(dir);
+}
+
+/* Test appending past capacity grows the columns without moving them */
+TEST(columns_grow) {
+    const char* dir = "/tmp/test_columns_grow";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    columns_store_t* store = NULL;
+    ASSERT_OK(columns_create(&store, dir, 2));
+    const timestamp_ns_t* created_at = columns_created_at(store);
+
+    for (node_id_t i = 0; i < 5000; i++) {
+        column_row_t row = { .created_at = 1000 + i, .token_count = i,
+                             .level = LEVEL_STATEMENT,
+                             .agent = NODE_ID_INVALID, .session = i / 10 };
+        ASSERT_OK(columns_append(store, i, &row));
+    }
+    ASSERT_EQ(columns_count(store), 5000);
+    ASSERT_GE(store->capacity, 5000);
+
+    /* Arrays handed out before growth are still the live ones */
+    ASSERT_TRUE(columns_created_at(store) == created_at);
+    ASSERT_EQ(created_at[4999], 5999);
+    ASSERT_EQ(columns_created_at(store)[0], 1000);
+    ASSERT_EQ(columns_token_count(store)[4999], 4999);
+    ASSERT_EQ(columns_get_session(store, 33), 3);
+    ASSERT_EQ(columns_get_agent(store, 33), NODE_ID_INVALID);
+    columns_close(store);
+
+    ASSERT_OK(columns_open(&store, dir));
+    ASSERT_EQ(columns_count(store), 5000);
+    ASSERT_EQ(columns_get_created_at(store, 42), 1042);
+    ASSERT_EQ(columns_get_session(store, 4999), 499);
+    columns_close(store);
+
+    cleanup_dir(dir);
+}
+
+/* Test persistence across reopen */
+TEST(columns_persistence) {
+    const char* dir = "/tmp/test_columns_persist";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    {
+        columns_store_t* store = NULL;
+        ASSERT_OK(columns_create(&store, dir, 100));
+
+        for (node_id_t i = 0; i < 10; i++) {
+            column_row_t row = {
+                .created_at = 1000000ULL * (i + 1),
+                .token_count = i * 3,
+                .level = LEVEL_STATEMENT,
+                .agent = 0,
+                .session = 1
+            };
+            ASSERT_OK(columns_append(store, i, &row));
+        }
+
+        ASSERT_OK(columns_sync(store));
+        columns_close(store);
+    }
+
+    {
+        columns_store_t* store = NULL;
+        ASSERT_OK(columns_open(&store, dir));
+        ASSERT_EQ(columns_count(store), 10);
+
+        for (node_id_t i = 0; i < 10; i++) {
+            ASSERT_EQ(columns_get_created_at(store, i), 1000000ULL * (i + 1));
+            ASSERT_EQ(columns_get_token_count(store, i), i * 3);
+            ASSERT_EQ(columns_get_session(store, i), 1);
+        }
+
+        columns_close(store);
+    }
+
+    cleanup_dir(dir);
+}
+
+/* Test opening a missing store */
+TEST(columns_open_missing) {
+    const char* dir = "/tmp/test_columns_missing";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    columns_store_t* store = NULL;
+    ASSERT_ERR(columns_open(&store, dir), MEM_ERR_OPEN);
+    ASSERT_NULL(store);
+
+    cleanup_dir(dir);
+}
+
+TEST_MAIN()
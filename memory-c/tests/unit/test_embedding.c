@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 
 /* Test basic creation */
 TEST(embedding_engine_create_basic) {
@@ -208,6 +209,63 @@ TEST(embedding_onnx_check) {
     (void)available;
 }
 
+/* Test cached generation matches uncached and counts hits */
+TEST(embedding_generate_cached) {
+    embedding_engine_t* engine = NULL;
+    ASSERT_OK(embedding_engine_create(&engine, NULL));
+
+    const char* text = "what changed in the build";
+    float direct[EMBEDDING_DIM], first[EMBEDDING_DIM], second[EMBEDDING_DIM];
+
+    ASSERT_OK(embedding_generate(engine, text, strlen(text), direct));
+    ASSERT_OK(embedding_generate_cached(engine, text, strlen(text), first));
+    ASSERT_OK(embedding_generate_cached(engine, text, strlen(text), second));
+    ASSERT_MEM_EQ(first, direct, sizeof(direct));
+    ASSERT_MEM_EQ(second, direct, sizeof(direct));
+
+    embedding_cache_stats_t stats;
+    embedding_get_cache_stats(engine, &stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 1);
+    embedding_engine_destroy(engine);
+
+    /* Disabled cache still generates */
+    embedding_config_t config = EMBEDDING_CONFIG_DEFAULT;
+    config.cache_mb = 0;
+    ASSERT_OK(embedding_engine_create(&engine, &config));
+    ASSERT_OK(embedding_generate_cached(engine, text, strlen(text), first));
+    ASSERT_MEM_EQ(first, direct, sizeof(direct));
+    embedding_get_cache_stats(engine, &stats);
+    ASSERT_EQ(stats.hits + stats.misses, 0);
+    embedding_engine_destroy(engine);
+}
+
+/* Test the cache file is written on destroy and reloaded on create */
+TEST(embedding_cache_persisted_by_engine) {
+    const char* path = "/tmp/test_embedding_engine_cache.bin";
+    unlink(path);
+
+    embedding_config_t config = EMBEDDING_CONFIG_DEFAULT;
+    config.cache_path = path;
+    const char* text = "persist me";
+    float out[EMBEDDING_DIM];
+
+    embedding_engine_t* engine = NULL;
+    ASSERT_OK(embedding_engine_create(&engine, &config));
+    ASSERT_OK(embedding_generate_cached(engine, text, strlen(text), out));
+    embedding_engine_destroy(engine);
+
+    ASSERT_OK(embedding_engine_create(&engine, &config));
+    ASSERT_OK(embedding_generate_cached(engine, text, strlen(text), out));
+    embedding_cache_stats_t stats;
+    embedding_get_cache_stats(engine, &stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 0);
+    embedding_engine_destroy(engine);
+
+    unlink(path);
+}
+
 /* Test invalid arguments */
 TEST(embedding_invalid_args) {
     ASSERT_NE(embedding_engine_create(NULL, NULL), MEM_OK);
@@ -0,0 +1,149 @@
+/*
+ * Memory Service - Query Embedding Cache Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/embedding/embedding_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CACHE_FILE "/tmp/test_embedding_cache.bin"
+
+/* Rough per-entry footprint, enough to size tiny caches in tests */
+#define ENTRY_BYTES (sizeof(float) * EMBEDDING_DIM + 64)
+
+static void fill_vector(float* vec, float value) {
+    for (int i = 0; i < EMBEDDING_DIM; i++) {
+        vec[i] = value + (float)i * 0.001f;
+    }
+}
+
+/* Test miss, store and hit */
+TEST(embedding_cache_hit_miss) {
+    embedding_cache_t* cache = NULL;
+    ASSERT_OK(embedding_cache_create(&cache, 1024 * 1024));
+
+    float in[EMBEDDING_DIM], out[EMBEDDING_DIM];
+    fill_vector(in, 0.5f);
+
+    const char* text = "how do I deploy";
+    ASSERT_FALSE(embedding_cache_get(cache, text, strlen(text), out));
+
+    embedding_cache_put(cache, text, strlen(text), in);
+    ASSERT_TRUE(embedding_cache_get(cache, text, strlen(text), out));
+    ASSERT_MEM_EQ(out, in, sizeof(in));
+
+    /* Keys are exact: a prefix of the same text is a different entry */
+    ASSERT_FALSE(embedding_cache_get(cache, text, strlen(text) - 1, out));
+
+    embedding_cache_stats_t stats;
+    embedding_cache_get_stats(cache, &stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.entries, 1);
+    ASSERT_GT(stats.capacity, 100);
+
+    embedding_cache_destroy(cache);
+}
+
+/* Test byte budget bounds the entry count and evicts LRU */
+TEST(embedding_cache_lru_eviction) {
+    embedding_cache_t* cache = NULL;
+    ASSERT_OK(embedding_cache_create(&cache, 2 * ENTRY_BYTES));
+
+    embedding_cache_stats_t stats;
+    embedding_cache_get_stats(cache, &stats);
+    ASSERT_EQ(stats.capacity, 2);
+
+    float vec[EMBEDDING_DIM], out[EMBEDDING_DIM];
+    fill_vector(vec, 1.0f);
+
+    embedding_cache_put(cache, "alpha", 5, vec);
+    embedding_cache_put(cache, "beta", 4, vec);
+    ASSERT_TRUE(embedding_cache_get(cache, "alpha", 5, out));
+    embedding_cache_put(cache, "gamma", 5, vec);
+
+    ASSERT_TRUE(embedding_cache_get(cache, "alpha", 5, out));
+    ASSERT_FALSE(embedding_cache_get(cache, "beta", 4, out));
+    ASSERT_TRUE(embedding_cache_get(cache, "gamma", 5, out));
+
+    embedding_cache_get_stats(cache, &stats);
+    ASSERT_EQ(stats.entries, 2);
+    ASSERT_EQ(stats.evictions, 1);
+
+    embedding_cache_destroy(cache);
+}
+
+/* Test entries and recency order survive save/load */
+TEST(embedding_cache_persistence) {
+    unlink(CACHE_FILE);
+
+    float a[EMBEDDING_DIM], b[EMBEDDING_DIM], c[EMBEDDING_DIM], out[EMBEDDING_DIM];
+    fill_vector(a, 1.0f);
+    fill_vector(b, 2.0f);
+    fill_vector(c, 3.0f);
+
+    {
+        embedding_cache_t* cache = NULL;
+        ASSERT_OK(embedding_cache_create(&cache, 1024 * 1024));
+        embedding_cache_put(cache, "first", 5, a);
+        embedding_cache_put(cache, "second", 6, b);
+        embedding_cache_put(cache, "third", 5, c);
+        ASSERT_OK(embedding_cache_save(cache, CACHE_FILE));
+        embedding_cache_destroy(cache);
+    }
+
+    {
+        /* Room for two: the least recently used entry is dropped on load */
+        embedding_cache_t* cache = NULL;
+        ASSERT_OK(embedding_cache_create(&cache, 2 * ENTRY_BYTES));
+        ASSERT_OK(embedding_cache_load(cache, CACHE_FILE));
+
+        ASSERT_FALSE(embedding_cache_get(cache, "first", 5, out));
+        ASSERT_TRUE(embedding_cache_get(cache, "second", 6, out));
+        ASSERT_MEM_EQ(out, b, sizeof(b));
+        ASSERT_TRUE(embedding_cache_get(cache, "third", 5, out));
+        ASSERT_MEM_EQ(out, c, sizeof(c));
+
+        embedding_cache_stats_t stats;
+        embedding_cache_get_stats(cache, &stats);
+        ASSERT_EQ(stats.evictions, 0);
+        embedding_cache_destroy(cache);
+    }
+
+    unlink(CACHE_FILE);
+}
+
+/* Test loading missing or corrupt files */
+TEST(embedding_cache_load_invalid) {
+    embedding_cache_t* cache = NULL;
+    ASSERT_OK(embedding_cache_create(&cache, 1024 * 1024));
+
+    unlink(CACHE_FILE);
+    ASSERT_ERR(embedding_cache_load(cache, CACHE_FILE), MEM_ERR_OPEN);
+
+    FILE* f = fopen(CACHE_FILE, "wb");
+    ASSERT_NOT_NULL(f);
+    fputs("not a cache file", f);
+    fclose(f);
+    ASSERT_ERR(embedding_cache_load(cache, CACHE_FILE), MEM_ERR_INDEX_CORRUPT);
+
+    embedding_cache_destroy(cache);
+    unlink(CACHE_FILE);
+}
+
+/* Test invalid arguments */
+TEST(embedding_cache_invalid_args) {
+    embedding_cache_t* cache = NULL;
+    ASSERT_ERR(embedding_cache_create(NULL, 1024), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(embedding_cache_create(&cache, 16), MEM_ERR_INVALID_ARG);
+
+    float out[EMBEDDING_DIM];
+    ASSERT_FALSE(embedding_cache_get(NULL, "x", 1, out));
+    embedding_cache_put(NULL, "x", 1, out);
+    embedding_cache_destroy(NULL);
+}
+
+TEST_MAIN()
@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 
 static void cleanup_dir(const char* dir) {
     char cmd[256];
@@ -72,6 +73,146 @@ TEST(embeddings_alloc_and_set) {
     cleanup_dir(dir);
 }
 
+/* Test levels are sized per level and extend by whole segments */
+TEST(embeddings_segments) {
+    const char* dir = "/tmp/test_embeddings_segments";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    embeddings_store_t* store = NULL;
+    ASSERT_OK(embeddings_create(&store, dir, 1000));
+    ASSERT_EQ(store->levels[LEVEL_STATEMENT].capacity, 1000);
+    ASSERT_LT(store->levels[LEVEL_AGENT].capacity, store->levels[LEVEL_BLOCK].capacity);
+
+    float values[EMBEDDING_DIM] = {0};
+    uint32_t idx;
+    ASSERT_OK(embeddings_alloc(store, LEVEL_AGENT, &idx));
+    values[0] = 42.0f;
+    ASSERT_OK(embeddings_set(store, LEVEL_AGENT, idx, values));
+    const float* first = embeddings_get(store, LEVEL_AGENT, 0);
+    ASSERT_NOT_NULL(first);
+
+    embedding_level_t* lev = &store->levels[LEVEL_AGENT];
+    size_t total = lev->first_capacity + 3 * lev->segment_vectors;
+    for (size_t i = 1; i < total; i++) {
+        ASSERT_OK(embeddings_alloc(store, LEVEL_AGENT, &idx));
+        values[0] = (float)i;
+        ASSERT_OK(embeddings_set(store, LEVEL_AGENT, idx, values));
+    }
+    ASSERT_EQ(lev->segment_count, 4);
+    ASSERT_EQ(lev->capacity, total);
+    ASSERT_EQ(access("/tmp/test_embeddings_segments/level_4.3.bin", F_OK), 0);
+    ASSERT_NE(access("/tmp/test_embeddings_segments/level_4.4.bin", F_OK), 0);
+
+    /* Pointers taken before new segments were mapped still see the data */
+    ASSERT_TRUE(embeddings_get(store, LEVEL_AGENT, 0) == first);
+    ASSERT_FLOAT_EQ(first[0], 42.0f, 0.0001f);
+
+    /* Indexes either side of a segment boundary */
+    size_t edge = lev->first_capacity + lev->segment_vectors;
+    ASSERT_FLOAT_EQ(embeddings_get(store, LEVEL_AGENT, (uint32_t)edge - 1)[0],
+                    (float)(edge - 1), 0.0001f);
+    ASSERT_FLOAT_EQ(embeddings_get(store, LEVEL_AGENT, (uint32_t)edge)[0],
+                    (float)edge, 0.0001f);
+    embeddings_close(store);
+
+    ASSERT_OK(embeddings_open(&store, dir));
+    ASSERT_EQ(embeddings_count(store, LEVEL_AGENT), total);
+    ASSERT_EQ(store->levels[LEVEL_AGENT].segment_count, 4);
+    ASSERT_FLOAT_EQ(embeddings_get(store, LEVEL_AGENT, (uint32_t)total - 1)[0],
+                    (float)(total - 1), 0.0001f);
+    ASSERT_OK(embeddings_alloc(store, LEVEL_AGENT, &idx));
+    ASSERT_EQ(idx, total);
+    ASSERT_EQ(store->levels[LEVEL_AGENT].segment_count, 5);
+    embeddings_close(store);
+
+    cleanup_dir(dir);
+}
+
+/* Test a header that counts segment files not on disk opens with the whole ones */
+TEST(embeddings_missing_segment) {
+    const char* dir = "/tmp/test_embeddings_missing";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    embeddings_store_t* store = NULL;
+    ASSERT_OK(embeddings_create(&store, dir, 1000));
+
+    float values[EMBEDDING_DIM] = {0};
+    uint32_t idx;
+    embedding_level_t* lev = &store->levels[LEVEL_AGENT];
+    size_t whole = lev->first_capacity + lev->segment_vectors;
+    size_t total = whole + lev->segment_vectors;
+    for (size_t i = 0; i < total; i++) {
+        ASSERT_OK(embeddings_alloc(store, LEVEL_AGENT, &idx));
+        values[0] = (float)i;
+        ASSERT_OK(embeddings_set(store, LEVEL_AGENT, idx, values));
+    }
+    embeddings_close(store);
+
+    /* Segment 2 never made it; segment 1 stays whole */
+    ASSERT_EQ(truncate("/tmp/test_embeddings_missing/level_4.2.bin", 100), 0);
+    ASSERT_OK(embeddings_open(&store, dir));
+    lev = &store->levels[LEVEL_AGENT];
+    ASSERT_EQ(lev->segment_count, 2);
+    ASSERT_EQ(embeddings_count(store, LEVEL_AGENT), whole);
+    ASSERT_FLOAT_EQ(embeddings_get(store, LEVEL_AGENT, (uint32_t)whole - 1)[0],
+                    (float)(whole - 1), 0.0001f);
+
+    /* Allocating again brings the segment back at full size */
+    ASSERT_OK(embeddings_alloc(store, LEVEL_AGENT, &idx));
+    ASSERT_EQ(idx, whole);
+    ASSERT_EQ(lev->segment_count, 3);
+    embeddings_close(store);
+
+    unlink("/tmp/test_embeddings_missing/level_4.2.bin");
+    ASSERT_OK(embeddings_open(&store, dir));
+    ASSERT_EQ(store->levels[LEVEL_AGENT].segment_count, 2);
+    ASSERT_EQ(embeddings_count(store, LEVEL_AGENT), whole);
+    embeddings_close(store);
+
+    cleanup_dir(dir);
+}
+
+/* Test single-file version 1 levels open and extend with segments */
+TEST(embeddings_open_v1) {
+    const char* dir = "/tmp/test_embeddings_v1";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    embeddings_store_t* store = NULL;
+    ASSERT_OK(embeddings_create(&store, dir, 100));
+    size_t first = store->levels[LEVEL_STATEMENT].first_capacity;
+    float values[EMBEDDING_DIM] = {0};
+    uint32_t idx;
+    for (size_t i = 0; i < first; i++) {
+        ASSERT_OK(embeddings_alloc(store, LEVEL_STATEMENT, &idx));
+        values[0] = (float)i;
+        ASSERT_OK(embeddings_set(store, LEVEL_STATEMENT, idx, values));
+    }
+    embeddings_close(store);
+
+    /* Rewrite the header as version 1: no segment fields */
+    int fd = open("/tmp/test_embeddings_v1/level_0.bin", O_WRONLY);
+    ASSERT_GE(fd, 0);
+    uint32_t v1 = 1, zero[2] = {0, 0};
+    ASSERT_EQ(pwrite(fd, &v1, sizeof(v1), 4), (ssize_t)sizeof(v1));
+    ASSERT_EQ(pwrite(fd, zero, sizeof(zero), 20), (ssize_t)sizeof(zero));
+    close(fd);
+
+    ASSERT_OK(embeddings_open(&store, dir));
+    ASSERT_EQ(embeddings_count(store, LEVEL_STATEMENT), first);
+    ASSERT_EQ(store->levels[LEVEL_STATEMENT].segment_count, 1);
+    ASSERT_OK(embeddings_alloc(store, LEVEL_STATEMENT, &idx));
+    ASSERT_EQ(idx, first);
+    ASSERT_EQ(store->levels[LEVEL_STATEMENT].segment_count, 2);
+    ASSERT_FLOAT_EQ(embeddings_get(store, LEVEL_STATEMENT, (uint32_t)first - 1)[0],
+                    (float)(first - 1), 0.0001f);
+    embeddings_close(store);
+
+    cleanup_dir(dir);
+}
+
 /* Test embeddings persistence */
 TEST(embeddings_persistence) {
     const char* dir = "/tmp/test_embeddings_persist";
@@ -4,11 +4,15 @@
 
 #include "../test_framework.h"
 #include "../../src/core/hierarchy.h"
+#include "../../src/storage/wal.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 
 #define TEST_DIR "/tmp/test_hierarchy"
 
@@ -49,16 +53,17 @@ TEST(hierarchy_create_session) {
     hierarchy_t* h = NULL;
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
+    node_id_t agent = test_agent(h, "agent-1");
     node_id_t session_id;
-    ASSERT_OK(hierarchy_create_session(h, "agent-1", "session-1", &session_id));
-    ASSERT_EQ(session_id, 0);
-    ASSERT_EQ(hierarchy_count(h), 1);
+    ASSERT_OK(hierarchy_create_session(h, agent, "session-1", &session_id));
+    ASSERT_EQ(session_id, 1);
+    ASSERT_EQ(hierarchy_count(h), 2);
 
     /* Verify node info */
     node_info_t info;
     ASSERT_OK(hierarchy_get_node(h, session_id, &info));
     ASSERT_EQ(info.level, LEVEL_SESSION);
-    ASSERT_EQ(info.parent_id, NODE_ID_INVALID);
+    ASSERT_EQ(info.parent_id, agent);
     ASSERT_STR_EQ(info.agent_id, "agent-1");
     ASSERT_STR_EQ(info.session_id, "session-1");
 
@@ -75,7 +80,7 @@ TEST(hierarchy_full_tree) {
 
     /* Create session */
     node_id_t session;
-    ASSERT_OK(hierarchy_create_session(h, "agent-1", "session-1", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent-1"), "session-1", &session));
 
     /* Create message under session */
     node_id_t message;
@@ -95,7 +100,7 @@ TEST(hierarchy_full_tree) {
     ASSERT_EQ(hierarchy_get_level(h, stmt), LEVEL_STATEMENT);
     ASSERT_EQ(hierarchy_get_parent(h, stmt), block);
 
-    ASSERT_EQ(hierarchy_count(h), 4);
+    ASSERT_EQ(hierarchy_count(h), 5);  /* agent, session, message, block, statement */
 
     hierarchy_close(h);
     cleanup_dir(TEST_DIR);
@@ -110,7 +115,7 @@ TEST(hierarchy_parent_child) {
 
     /* Create session with message and two blocks */
     node_id_t session, message, block1, block2;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block1));
     ASSERT_OK(hierarchy_create_block(h, message, &block2));
@@ -145,7 +150,7 @@ TEST(hierarchy_siblings) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -177,7 +182,7 @@ TEST(hierarchy_ancestors) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
@@ -185,7 +190,7 @@ TEST(hierarchy_ancestors) {
     /* Get ancestors of statement */
     node_id_t ancestors[10];
     size_t count = hierarchy_get_ancestors(h, stmt, ancestors, 10);
-    ASSERT_EQ(count, 3);  /* block, message, session */
+    ASSERT_EQ(count, 4);  /* block, message, session, agent */
     ASSERT_EQ(ancestors[0], block);
     ASSERT_EQ(ancestors[1], message);
     ASSERT_EQ(ancestors[2], session);
@@ -202,7 +207,7 @@ TEST(hierarchy_descendants) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block1, block2;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block1));
     ASSERT_OK(hierarchy_create_block(h, message, &block2));
@@ -231,7 +236,7 @@ TEST(hierarchy_embeddings) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
 
     /* Set embedding for message */
@@ -259,7 +264,7 @@ TEST(hierarchy_level_validation) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -290,7 +295,7 @@ TEST(hierarchy_persistence) {
         hierarchy_t* h = NULL;
         ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
-        ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
         ASSERT_OK(hierarchy_create_message(h, session, &message));
         ASSERT_OK(hierarchy_create_block(h, message, &block));
         ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
@@ -304,7 +309,7 @@ TEST(hierarchy_persistence) {
         hierarchy_t* h = NULL;
         ASSERT_OK(hierarchy_open(&h, TEST_DIR));
 
-        ASSERT_EQ(hierarchy_count(h), 4);
+        ASSERT_EQ(hierarchy_count(h), 5);
         ASSERT_EQ(hierarchy_get_level(h, session), LEVEL_SESSION);
         ASSERT_EQ(hierarchy_get_level(h, message), LEVEL_MESSAGE);
         ASSERT_EQ(hierarchy_get_level(h, block), LEVEL_BLOCK);
@@ -335,4 +340,1067 @@ TEST(hierarchy_invalid_args) {
     ASSERT_EQ(hierarchy_count(NULL), 0);
 }
 
+/* Test scoring columns track level and agent/session ownership */
+TEST(hierarchy_columns) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session, message, block, stmt;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+    ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+
+    const columns_store_t* cols = hierarchy_get_columns(h);
+    ASSERT_NOT_NULL(cols);
+    ASSERT_EQ(columns_count(cols), 5);
+
+    ASSERT_EQ(columns_get_level(cols, stmt), LEVEL_STATEMENT);
+    ASSERT_EQ(columns_get_agent(cols, agent), agent);
+    ASSERT_EQ(columns_get_session(cols, agent), NODE_ID_INVALID);
+    ASSERT_EQ(columns_get_agent(cols, stmt), agent);
+    ASSERT_EQ(columns_get_session(cols, stmt), session);
+
+    node_info_t info;
+    ASSERT_OK(hierarchy_get_node(h, stmt, &info));
+    ASSERT_EQ(columns_get_created_at(cols, stmt), info.created_at);
+
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test columns are rebuilt for hierarchies written before they existed */
+TEST(hierarchy_columns_backfill) {
+    setup_dir();
+
+    node_id_t agent, session, message;
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+        agent = test_agent(h, "agent");
+        ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+
+        ASSERT_OK(hierarchy_sync(h));
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR "/columns");
+
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+
+        const columns_store_t* cols = hierarchy_get_columns(h);
+        ASSERT_EQ(columns_count(cols), 3);
+        ASSERT_EQ(columns_get_level(cols, message), LEVEL_MESSAGE);
+        ASSERT_EQ(columns_get_agent(cols, message), agent);
+        ASSERT_EQ(columns_get_session(cols, message), session);
+
+        node_info_t info;
+        ASSERT_OK(hierarchy_get_node(h, message, &info));
+        ASSERT_EQ(columns_get_created_at(cols, message), info.created_at);
+
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test node text persists across reopen */
+TEST(hierarchy_text_persistence) {
+    setup_dir();
+
+    node_id_t session, message;
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_set_text(h, message, "remember the milk", 17));
+
+        size_t len = 0;
+        ASSERT_NULL(test_text(h, session, &len));
+        ASSERT_EQ(len, 0);
+
+        hierarchy_close(h);
+    }
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+
+        size_t len = 0;
+        const char* text = test_text(h, message, &len);
+        ASSERT_NOT_NULL(text);
+        ASSERT_EQ(len, 17);
+        ASSERT_EQ(strcmp(text, "remember the milk"), 0);
+        hierarchy_close(h);
+    }
+
+    /* Hierarchies without a text log open with no text */
+    cleanup_dir(TEST_DIR "/text");
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        ASSERT_NULL(test_text(h, message, NULL));
+        ASSERT_OK(hierarchy_set_text(h, message, "again", 5));
+        ASSERT_EQ(strcmp(test_text(h, message, NULL), "again"), 0);
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test agent/session lookup by string id, across reopen and index loss */
+TEST(hierarchy_id_lookup) {
+    setup_dir();
+
+    node_id_t a1, a2, s1, s2, s3;
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+        a1 = test_agent(h, "agent-1");
+        a2 = test_agent(h, "agent-2");
+        ASSERT_EQ(test_agent(h, "agent-1"), a1);
+
+        ASSERT_OK(hierarchy_create_session(h, a1, "shared", &s1));
+        ASSERT_OK(hierarchy_create_session(h, a2, "shared", &s2));
+        ASSERT_OK(hierarchy_create_session(h, a2, "only-2", &s3));
+
+        node_id_t again;
+        ASSERT_ERR(hierarchy_create_session(h, a2, "shared", &again), MEM_ERR_EXISTS);
+        ASSERT_EQ(again, s2);
+
+        ASSERT_EQ(hierarchy_find_agent(h, "agent-2"), a2);
+        ASSERT_EQ(hierarchy_find_agent(h, "agent-3"), NODE_ID_INVALID);
+        ASSERT_EQ(hierarchy_find_session(h, a1, "shared"), s1);
+        ASSERT_EQ(hierarchy_find_session(h, a2, "shared"), s2);
+        ASSERT_EQ(hierarchy_find_session(h, a1, "only-2"), NODE_ID_INVALID);
+
+        /* Without an agent, the first session created with the id wins */
+        ASSERT_EQ(hierarchy_find_session(h, NODE_ID_INVALID, "shared"), s1);
+        ASSERT_EQ(hierarchy_find_session(h, NODE_ID_INVALID, "only-2"), s3);
+
+        ASSERT_OK(hierarchy_sync(h));
+        hierarchy_close(h);
+    }
+
+    /* Loaded from disk on open */
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        ASSERT_EQ(hierarchy_find_agent(h, "agent-1"), a1);
+        ASSERT_EQ(hierarchy_find_session(h, a2, "shared"), s2);
+
+        node_id_t a3 = test_agent(h, "agent-3");
+        ASSERT_NE(a3, NODE_ID_INVALID);
+        ASSERT_EQ(hierarchy_find_agent(h, "agent-3"), a3);
+        hierarchy_close(h);
+    }
+
+    /* Rebuilt for hierarchies without an index file */
+    unlink(TEST_DIR "/id_index.bin");
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        ASSERT_EQ(hierarchy_find_agent(h, "agent-2"), a2);
+        ASSERT_NE(hierarchy_find_agent(h, "agent-3"), NODE_ID_INVALID);
+        ASSERT_EQ(hierarchy_find_session(h, a1, "shared"), s1);
+        ASSERT_EQ(hierarchy_find_session(h, NODE_ID_INVALID, "shared"), s1);
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test a hierarchy created small grows past its initial capacity */
+TEST(hierarchy_growth) {
+    setup_dir();
+
+    node_id_t session, block, first = NODE_ID_INVALID;
+    float emb[EMBEDDING_DIM] = {0};
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 8));
+
+        node_id_t message;
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+        const float* first_emb = NULL;
+        for (int i = 0; i < 500; i++) {
+            node_id_t stmt;
+            ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+            emb[0] = (float)i;
+            ASSERT_OK(hierarchy_set_embedding(h, stmt, emb));
+            if (i == 0) {
+                first = stmt;
+                first_emb = hierarchy_get_embedding(h, stmt);
+            }
+        }
+        ASSERT_EQ(hierarchy_count(h), 504);
+        ASSERT_EQ(hierarchy_get_child_count(h, block), 500);
+
+        /* Embedding pointers survive growth of their level */
+        ASSERT_TRUE(hierarchy_get_embedding(h, first) == first_emb);
+        ASSERT_FLOAT_EQ(first_emb[0], 0.0f, 0.0001f);
+
+        hierarchy_close(h);
+    }
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        ASSERT_EQ(hierarchy_count(h), 504);
+        ASSERT_EQ(hierarchy_get_child_count(h, block), 500);
+        ASSERT_FLOAT_EQ(hierarchy_get_embedding(h, first + 499)[0], 499.0f, 0.0001f);
+
+        node_id_t more;
+        ASSERT_OK(hierarchy_create_message(h, session, &more));
+        ASSERT_EQ(more, 504);
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test an insert that cannot grow the stores leaves them in step */
+TEST(hierarchy_failed_insert) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 8));
+
+    node_id_t session, message, block, stmt;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+    while (hierarchy_count(h) < 8) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+    }
+
+    /* No file may be extended, so the next node cannot get space */
+    struct rlimit saved, limit;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &saved), 0);
+    limit = saved;
+    limit.rlim_cur = 1;
+    signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+    mem_error_t err = hierarchy_create_statement(h, block, &stmt);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &saved), 0);
+    signal(SIGXFSZ, SIG_DFL);
+
+    ASSERT_NE(err, MEM_OK);
+    ASSERT_EQ(hierarchy_count(h), 8);
+    ASSERT_EQ(hierarchy_get_child_count(h, block), 4);
+
+    /* Once space is back, inserts carry on where they stopped */
+    ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+    ASSERT_EQ(stmt, 8);
+    ASSERT_EQ(columns_count(hierarchy_get_columns(h)), 9);
+    ASSERT_EQ(hierarchy_get_parent(h, stmt), block);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test node metadata lives in node_meta.bin and is read back on open */
+TEST(hierarchy_metadata_file) {
+    setup_dir();
+
+    node_id_t session, last = NODE_ID_INVALID;
+    node_info_t before;
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 8));
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+
+        /* Grow the metadata file while children copy the parent's ids */
+        for (int i = 0; i < 2000; i++) {
+            ASSERT_OK(hierarchy_create_message(h, session, &last));
+        }
+        ASSERT_OK(hierarchy_get_node(h, last, &before));
+        ASSERT_STR_EQ(before.agent_id, "agent");
+        ASSERT_STR_EQ(before.session_id, "session");
+        ASSERT_GT(before.created_at, 0);
+
+        ASSERT_OK(hierarchy_sync(h));
+        hierarchy_close(h);
+    }
+    ASSERT_EQ(access(TEST_DIR "/node_meta.bin", F_OK), 0);
+    ASSERT_NE(access(TEST_DIR "/metadata.dat", F_OK), 0);
+
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+
+        node_info_t after;
+        ASSERT_OK(hierarchy_get_node(h, last, &after));
+        ASSERT_EQ(after.created_at, before.created_at);
+        ASSERT_EQ(after.embedding_idx, before.embedding_idx);
+        ASSERT_STR_EQ(after.agent_id, "agent");
+        ASSERT_STR_EQ(after.session_id, "session");
+
+        /* Nodes added after reopen are persisted too */
+        ASSERT_OK(hierarchy_create_message(h, session, &last));
+        ASSERT_OK(hierarchy_sync(h));
+        hierarchy_close(h);
+    }
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        node_info_t info;
+        ASSERT_OK(hierarchy_get_node(h, last, &info));
+        ASSERT_STR_EQ(info.session_id, "session");
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Version 1 metadata.dat record layout */
+typedef struct {
+    timestamp_ns_t  created_at;
+    uint32_t        embedding_idx;
+    char            agent_id[MAX_AGENT_ID_LEN];
+    char            session_id[MAX_SESSION_ID_LEN];
+} legacy_meta_t;
+
+/* Test a hierarchy saved with metadata.dat is migrated on open */
+TEST(hierarchy_metadata_migration) {
+    setup_dir();
+
+    node_id_t agent, session, message;
+    node_info_t info[3];
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+        agent = test_agent(h, "agent");
+        ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_get_node(h, agent, &info[0]));
+        ASSERT_OK(hierarchy_get_node(h, session, &info[1]));
+        ASSERT_OK(hierarchy_get_node(h, message, &info[2]));
+        hierarchy_close(h);
+    }
+
+    /* Replace node_meta.bin with the old format */
+    unlink(TEST_DIR "/node_meta.bin");
+    FILE* f = fopen(TEST_DIR "/metadata.dat", "wb");
+    ASSERT_NOT_NULL(f);
+    uint32_t header[3] = {0x4D454D4F, 1, 3};
+    ASSERT_EQ(fwrite(header, sizeof(header), 1, f), 1);
+    for (int i = 0; i < 3; i++) {
+        legacy_meta_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.created_at = info[i].created_at;
+        rec.embedding_idx = info[i].embedding_idx;
+        snprintf(rec.agent_id, sizeof(rec.agent_id), "%s", info[i].agent_id);
+        snprintf(rec.session_id, sizeof(rec.session_id), "%s", info[i].session_id);
+        ASSERT_EQ(fwrite(&rec, sizeof(rec), 1, f), 1);
+    }
+    fclose(f);
+
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+        ASSERT_EQ(access(TEST_DIR "/node_meta.bin", F_OK), 0);
+        ASSERT_NE(access(TEST_DIR "/metadata.dat", F_OK), 0);
+
+        node_info_t got;
+        ASSERT_OK(hierarchy_get_node(h, message, &got));
+        ASSERT_EQ(got.created_at, info[2].created_at);
+        ASSERT_STR_EQ(got.agent_id, "agent");
+        ASSERT_STR_EQ(got.session_id, "session");
+        ASSERT_OK(hierarchy_get_node(h, agent, &got));
+        ASSERT_STR_EQ(got.agent_id, "agent");
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Replay callback counting records by op */
+static mem_error_t count_ops(wal_op_type_t op, const void* data, size_t len, void* user_data) {
+    (void)data;
+    (void)len;
+    ((int*)user_data)[op]++;
+    return MEM_OK;
+}
+
+/* Bytes of records in a WAL, as found by reopening it */
+static size_t logged_bytes(const char* path) {
+    wal_t* wal = NULL;
+    if (wal_open(&wal, path) != MEM_OK) return SIZE_MAX;
+    size_t size = wal_size(wal);
+    wal_close(wal);
+    return size;
+}
+
+/* Test mutations are logged once the WAL is enabled and cleared on close */
+TEST(hierarchy_wal_logging) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+    ASSERT_OK(hierarchy_commit(h));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+    ASSERT_ERR(hierarchy_enable_wal(h, 0, NULL), MEM_ERR_EXISTS);
+
+    node_id_t session, message;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_set_text(h, message, "hello wal", 9));
+    float emb[EMBEDDING_DIM] = {0};
+    emb[3] = 1.0f;
+    ASSERT_OK(hierarchy_set_embedding(h, message, emb));
+    ASSERT_OK(hierarchy_commit(h));
+
+    /* Durable before close */
+    int ops[WAL_OP_TEXT_SET + 1] = {0};
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_open(&wal, TEST_DIR "/wal.log"));
+    ASSERT_OK(wal_replay(wal, count_ops, ops));
+    wal_close(wal);
+    ASSERT_EQ(ops[WAL_OP_NODE_INSERT], 3);
+    ASSERT_EQ(ops[WAL_OP_TEXT_SET], 1);
+    ASSERT_EQ(ops[WAL_OP_EMBEDDING_SET], 1);
+
+    hierarchy_close(h);
+
+    ASSERT_EQ(logged_bytes(TEST_DIR "/wal.log"), 0);
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test the WAL restores mutations whose pages never reached disk */
+TEST(hierarchy_wal_recovery) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+    ASSERT_OK(hierarchy_checkpoint(h));
+
+    /* The snapshot stands in for the disk as of the checkpoint */
+    ASSERT_EQ(system("cp -r " TEST_DIR " " TEST_DIR "_snap"), 0);
+
+    node_id_t messages[20];
+    float emb[EMBEDDING_DIM] = {0};
+    char text[32];
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(hierarchy_create_message(h, session, &messages[i]));
+        int n = snprintf(text, sizeof(text), "message %d", i);
+        ASSERT_OK(hierarchy_set_text(h, messages[i], text, (size_t)n));
+        emb[i] = 1.0f;
+        ASSERT_OK(hierarchy_set_embedding(h, messages[i], emb));
+        emb[i] = 0.0f;
+        ASSERT_OK(hierarchy_set_token_count(h, messages[i], (uint32_t)(i + 1)));
+    }
+    ASSERT_OK(hierarchy_commit(h));
+
+    /* Only the log made it */
+    ASSERT_EQ(system("cp " TEST_DIR "/wal.log.* " TEST_DIR "_snap/"), 0);
+    hierarchy_close(h);
+
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_snap"));
+    ASSERT_EQ(hierarchy_count(h), 2);
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+    ASSERT_EQ(hierarchy_count(h), 22);
+
+    ASSERT_EQ(hierarchy_find_agent(h, "agent"), agent);
+    ASSERT_EQ(hierarchy_find_session(h, agent, "session"), session);
+    ASSERT_EQ(hierarchy_get_child_count(h, session), 20);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_EQ(hierarchy_get_parent(h, messages[i]), session);
+        snprintf(text, sizeof(text), "message %d", i);
+        ASSERT_STR_EQ(test_text(h, messages[i], NULL), text);
+        const float* got = hierarchy_get_embedding(h, messages[i]);
+        ASSERT_NOT_NULL(got);
+        ASSERT_EQ(got[i], 1.0f);
+        ASSERT_EQ(columns_get_token_count(hierarchy_get_columns(h), messages[i]), (uint32_t)(i + 1));
+    }
+
+    /* Recovery checkpoints, so the log starts empty */
+    ASSERT_EQ(logged_bytes(TEST_DIR "_snap/wal.log"), 0);
+
+    /* New nodes continue after the recovered ones */
+    node_id_t next;
+    ASSERT_OK(hierarchy_create_message(h, session, &next));
+    ASSERT_EQ(next, 22);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test replay repairs nodes whose count reached disk before their rows */
+TEST(hierarchy_wal_torn_recovery) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+    ASSERT_OK(hierarchy_checkpoint(h));
+    ASSERT_EQ(system("cp -r " TEST_DIR " " TEST_DIR "_snap"), 0);
+
+    node_id_t late_agent = test_agent(h, "late");
+    node_id_t late_session;
+    ASSERT_OK(hierarchy_create_session(h, late_agent, "late-session", &late_session));
+    node_id_t messages[10];
+    node_info_t infos[10];
+    for (int i = 0; i < 10; i++) {
+        ASSERT_OK(hierarchy_create_message(h, i % 2 ? late_session : session, &messages[i]));
+        ASSERT_OK(hierarchy_set_token_count(h, messages[i], (uint32_t)(i + 1)));
+        ASSERT_OK(hierarchy_get_node(h, messages[i], &infos[i]));
+    }
+    ASSERT_OK(hierarchy_commit(h));
+
+    /* The relations count and parent links made it, the rows they
+     * describe, the other links and the id index did not */
+    ASSERT_EQ(system("cp " TEST_DIR "/wal.log.* " TEST_DIR "_snap/"), 0);
+    ASSERT_EQ(system("cp " TEST_DIR "/relations/parent.bin " TEST_DIR "_snap/relations/"), 0);
+    hierarchy_close(h);
+
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_snap"));
+    ASSERT_EQ(hierarchy_count(h), 14);
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+    ASSERT_EQ(hierarchy_count(h), 14);
+
+    const columns_store_t* cols = hierarchy_get_columns(h);
+    ASSERT_EQ(columns_count(cols), 14);
+    ASSERT_EQ(hierarchy_find_agent(h, "late"), late_agent);
+    ASSERT_EQ(hierarchy_find_session(h, late_agent, "late-session"), late_session);
+    ASSERT_EQ(hierarchy_get_child_count(h, agent), 1);
+    ASSERT_EQ(hierarchy_get_child_count(h, session), 5);
+    ASSERT_EQ(hierarchy_get_child_count(h, late_session), 5);
+
+    node_id_t children[8];
+    ASSERT_EQ(hierarchy_get_children(h, session, children, 8), 5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(children[i], messages[2 * i]);
+    }
+
+    for (int i = 0; i < 10; i++) {
+        node_info_t info;
+        ASSERT_OK(hierarchy_get_node(h, messages[i], &info));
+        ASSERT_EQ(info.level, LEVEL_MESSAGE);
+        ASSERT_EQ(info.parent_id, infos[i].parent_id);
+        ASSERT_EQ(info.embedding_idx, infos[i].embedding_idx);
+        ASSERT_EQ(info.created_at, infos[i].created_at);
+        ASSERT_STR_EQ(info.agent_id, infos[i].agent_id);
+        ASSERT_STR_EQ(info.session_id, infos[i].session_id);
+
+        ASSERT_EQ(columns_get_created_at(cols, messages[i]), infos[i].created_at);
+        ASSERT_EQ(columns_get_level(cols, messages[i]), LEVEL_MESSAGE);
+        ASSERT_EQ(columns_get_agent(cols, messages[i]), i % 2 ? late_agent : agent);
+        ASSERT_EQ(columns_get_session(cols, messages[i]), info.parent_id);
+        ASSERT_EQ(columns_get_token_count(cols, messages[i]), (uint32_t)(i + 1));
+    }
+
+    /* New nodes continue after the recovered ones */
+    node_id_t next;
+    ASSERT_OK(hierarchy_create_message(h, session, &next));
+    ASSERT_EQ(next, 14);
+    ASSERT_EQ(hierarchy_get_child_count(h, session), 6);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Store thread for the concurrency tests: messages under a shared
+ * session, and now and then a session of its own */
+typedef struct {
+    hierarchy_t* h;
+    node_id_t agent;
+    node_id_t session;
+    int thread;
+} storer_t;
+
+#define STORE_THREADS 4
+#define STORE_MESSAGES 150
+
+static void* store_main(void* arg) {
+    storer_t* st = arg;
+    char text[32];
+    for (int i = 0; i < STORE_MESSAGES; i++) {
+        node_id_t id;
+        if (i % 25 == 0) {
+            snprintf(text, sizeof(text), "t%d-%d", st->thread, i);
+            if (hierarchy_create_session(st->h, st->agent, text, &id) != MEM_OK) break;
+        }
+        if (hierarchy_create_message(st->h, st->session, &id) != MEM_OK) break;
+        int n = snprintf(text, sizeof(text), "message %u", id);
+        if (hierarchy_set_text(st->h, id, text, (size_t)n) != MEM_OK ||
+            hierarchy_commit(st->h) != MEM_OK) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Test concurrent stores log in id order and replay after a crash */
+TEST(hierarchy_wal_concurrent_recovery) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 64));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+    ASSERT_OK(hierarchy_checkpoint(h));
+    ASSERT_EQ(system("cp -r " TEST_DIR " " TEST_DIR "_snap"), 0);
+
+    pthread_t threads[STORE_THREADS];
+    storer_t storers[STORE_THREADS];
+    for (int t = 0; t < STORE_THREADS; t++) {
+        storers[t] = (storer_t){ .h = h, .agent = agent, .session = session, .thread = t };
+        ASSERT_EQ(pthread_create(&threads[t], NULL, store_main, &storers[t]), 0);
+    }
+    for (int t = 0; t < STORE_THREADS; t++) pthread_join(threads[t], NULL);
+
+    size_t messages = STORE_THREADS * STORE_MESSAGES;
+    size_t count = 2 + messages + STORE_THREADS * (STORE_MESSAGES / 25);
+    ASSERT_EQ(hierarchy_count(h), count);
+
+    /* Only the log made it */
+    ASSERT_EQ(system("cp " TEST_DIR "/wal.log.* " TEST_DIR "_snap/"), 0);
+    hierarchy_close(h);
+
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_snap"));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+    ASSERT_EQ(hierarchy_count(h), count);
+    ASSERT_EQ(columns_count(hierarchy_get_columns(h)), count);
+    ASSERT_EQ(hierarchy_get_child_count(h, agent), 1 + STORE_THREADS * (STORE_MESSAGES / 25));
+    ASSERT_NE(hierarchy_find_session(h, agent, "t3-125"), NODE_ID_INVALID);
+
+    /* Children were linked in id order, each with its own text */
+    node_id_t* children = malloc(messages * sizeof(node_id_t));
+    ASSERT_NOT_NULL(children);
+    ASSERT_EQ(hierarchy_get_children(h, session, children, messages), messages);
+    char text[32];
+    for (size_t i = 0; i < messages; i++) {
+        if (i > 0) ASSERT_GT(children[i], children[i - 1]);
+        ASSERT_EQ(hierarchy_get_parent(h, children[i]), session);
+        snprintf(text, sizeof(text), "message %u", children[i]);
+        ASSERT_STR_EQ(test_text(h, children[i], NULL), text);
+    }
+    free(children);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test commits checkpoint the WAL once it reaches its size limit */
+TEST(hierarchy_wal_checkpoint) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+    ASSERT_OK(hierarchy_enable_wal(h, 4096, NULL));
+
+    node_id_t session, message;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    float emb[EMBEDDING_DIM] = {0};
+    for (int i = 0; i < 10; i++) {
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_set_embedding(h, message, emb));
+        ASSERT_OK(hierarchy_commit(h));
+
+        /* Never much past the limit */
+        ASSERT_LT(logged_bytes(TEST_DIR "/wal.log"), 4096);
+    }
+    hierarchy_close(h);
+
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+    ASSERT_EQ(hierarchy_count(h), 12);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test ingest with the background flusher running, across growth */
+TEST(hierarchy_flusher) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 16));
+    ASSERT_OK(hierarchy_enable_flusher(h, 1));
+    ASSERT_ERR(hierarchy_enable_flusher(h, 1), MEM_ERR_EXISTS);
+
+    node_id_t session, message;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    float emb[EMBEDDING_DIM] = {0};
+    char text[32];
+    for (int i = 0; i < 300; i++) {
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        snprintf(text, sizeof(text), "message %d", i);
+        ASSERT_OK(hierarchy_set_text(h, message, text, strlen(text)));
+        emb[i % EMBEDDING_DIM] = (float)i;
+        ASSERT_OK(hierarchy_set_embedding(h, message, emb));
+    }
+    hierarchy_close(h);
+
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+    ASSERT_EQ(hierarchy_count(h), 302);
+    ASSERT_STR_EQ(test_text(h, message, NULL), "message 299");
+    ASSERT_EQ(hierarchy_get_embedding(h, message)[299 % EMBEDDING_DIM], 299.0f);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR);
+}
+
+/*
+ * Files the flusher (or the kernel) may write back in any order: each
+ * group is either as of the checkpoint or as of the crash.
+ */
+static const char* const writeback_groups[] = {
+    "relations/parent.bin",
+    "relations/first_child.bin relations/next_sibling.bin relations/last_child.bin "
+        "relations/child_count.bin relations/level.bin",
+    "columns/created_at.bin",
+    "columns/token_count.bin columns/level.bin columns/agent.bin columns/session.bin",
+    "embeddings/*",
+    "node_meta.bin",
+    "id_index.bin text",
+};
+#define WRITEBACK_GROUPS (sizeof(writeback_groups) / sizeof(writeback_groups[0]))
+
+/* Test replay recovers from any order the stores reached disk in */
+TEST(hierarchy_writeback_order) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR "_live");
+
+    /* Small segments keep the copies below cheap */
+    wal_config_t cfg = WAL_CONFIG_DEFAULT;
+    cfg.segment_size = 1024 * 1024;
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 16));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, &cfg));
+    ASSERT_OK(hierarchy_enable_flusher(h, 1));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+    ASSERT_OK(hierarchy_checkpoint(h));
+    ASSERT_EQ(system("cp -r " TEST_DIR " " TEST_DIR "_snap"), 0);
+
+    /* Grows every store past what the checkpoint saw */
+    node_id_t late;
+    ASSERT_OK(hierarchy_create_session(h, agent, "late", &late));
+    node_id_t messages[40];
+    timestamp_ns_t created[40];
+    float emb[EMBEDDING_DIM] = {0};
+    char text[32];
+    for (int i = 0; i < 40; i++) {
+        ASSERT_OK(hierarchy_create_message(h, i % 2 ? late : session, &messages[i]));
+        int n = snprintf(text, sizeof(text), "message %d", i);
+        ASSERT_OK(hierarchy_set_text(h, messages[i], text, (size_t)n));
+        emb[i] = 1.0f;
+        ASSERT_OK(hierarchy_set_embedding(h, messages[i], emb));
+        emb[i] = 0.0f;
+        ASSERT_OK(hierarchy_set_token_count(h, messages[i], (uint32_t)(i + 1)));
+        created[i] = columns_get_created_at(hierarchy_get_columns(h), messages[i]);
+    }
+    ASSERT_OK(hierarchy_commit(h));
+    ASSERT_EQ(system("cp -r " TEST_DIR " " TEST_DIR "_live"), 0);
+    hierarchy_close(h);
+
+    char cmd[2048];
+    for (unsigned mask = 0; mask < 1u << WRITEBACK_GROUPS; mask++) {
+        int len = snprintf(cmd, sizeof(cmd),
+                           "rm -rf " TEST_DIR "_trial && cp -r " TEST_DIR "_snap " TEST_DIR "_trial"
+                           " && cp " TEST_DIR "_live/wal.log.* " TEST_DIR "_trial/"
+                           " && cd " TEST_DIR "_live && for f in");
+        for (size_t g = 0; g < WRITEBACK_GROUPS; g++) {
+            if (mask & (1u << g)) {
+                len += snprintf(cmd + len, sizeof(cmd) - (size_t)len, " %s", writeback_groups[g]);
+            }
+        }
+        snprintf(cmd + len, sizeof(cmd) - (size_t)len,
+                 "; do rm -rf " TEST_DIR "_trial/$f && cp -r $f " TEST_DIR "_trial/$f; done");
+        ASSERT_EQ(system(cmd), 0);
+
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR "_trial"));
+        ASSERT_OK(hierarchy_enable_wal(h, 0, &cfg));
+        ASSERT_EQ(hierarchy_count(h), 43);
+
+        const columns_store_t* cols = hierarchy_get_columns(h);
+        ASSERT_EQ(columns_count(cols), 43);
+        ASSERT_EQ(hierarchy_find_session(h, agent, "late"), late);
+        ASSERT_EQ(hierarchy_get_child_count(h, agent), 2);
+        ASSERT_EQ(hierarchy_get_child_count(h, session), 20);
+        ASSERT_EQ(hierarchy_get_child_count(h, late), 20);
+
+        node_id_t children[24];
+        ASSERT_EQ(hierarchy_get_children(h, late, children, 24), 20);
+        for (int i = 0; i < 20; i++) {
+            ASSERT_EQ(children[i], messages[2 * i + 1]);
+        }
+
+        for (int i = 0; i < 40; i++) {
+            node_id_t parent = i % 2 ? late : session;
+            ASSERT_EQ(hierarchy_get_parent(h, messages[i]), parent);
+            ASSERT_EQ(hierarchy_get_level(h, messages[i]), LEVEL_MESSAGE);
+            ASSERT_EQ(columns_get_created_at(cols, messages[i]), created[i]);
+            ASSERT_EQ(columns_get_session(cols, messages[i]), parent);
+            ASSERT_EQ(columns_get_agent(cols, messages[i]), agent);
+            ASSERT_EQ(columns_get_token_count(cols, messages[i]), (uint32_t)(i + 1));
+
+            snprintf(text, sizeof(text), "message %d", i);
+            ASSERT_STR_EQ(test_text(h, messages[i], NULL), text);
+            const float* got = hierarchy_get_embedding(h, messages[i]);
+            ASSERT_NOT_NULL(got);
+            ASSERT_EQ(got[i], 1.0f);
+        }
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR "_trial");
+    cleanup_dir(TEST_DIR "_live");
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Ingest thread for the snapshot tests: messages whose text names their id */
+typedef struct {
+    hierarchy_t* h;
+    node_id_t session;
+    int stop;
+    int committed;
+} ingest_t;
+
+static void* ingest_main(void* arg) {
+    ingest_t* in = arg;
+    char text[32];
+    while (!__atomic_load_n(&in->stop, __ATOMIC_ACQUIRE)) {
+        node_id_t message;
+        if (hierarchy_create_message(in->h, in->session, &message) != MEM_OK) break;
+        snprintf(text, sizeof(text), "message %u", message);
+        if (hierarchy_set_text(in->h, message, text, strlen(text)) != MEM_OK ||
+            hierarchy_commit(in->h) != MEM_OK) {
+            break;
+        }
+        __atomic_add_fetch(&in->committed, 1, __ATOMIC_RELEASE);
+        if (__atomic_load_n(&in->committed, __ATOMIC_ACQUIRE) >= 3000) break;
+    }
+    return NULL;
+}
+
+static ino_t inode_of(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_ino : 0;
+}
+
+/* Test a snapshot taken during ingest restores everything committed before it */
+TEST(hierarchy_snapshot) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR "_restore");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 8192));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    ingest_t in = { .h = h };
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &in.session));
+
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, ingest_main, &in), 0);
+    while (__atomic_load_n(&in.committed, __ATOMIC_ACQUIRE) < 200) usleep(1000);
+
+    int before = __atomic_load_n(&in.committed, __ATOMIC_ACQUIRE);
+    snapshot_stats_t stats;
+    ASSERT_OK(hierarchy_snapshot(h, TEST_DIR "_snap", NULL, &stats));
+    int after = __atomic_load_n(&in.committed, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(&in.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    ASSERT_GT(stats.files, 0);
+    ASSERT_GT(stats.wal_sequence, 0);
+    ASSERT_EQ(access(TEST_DIR "_snap/" SNAPSHOT_MANIFEST, F_OK), 0);
+    ASSERT_EQ(access(TEST_DIR "_snap/wal.log.0", F_OK), 0);
+
+    /* Not over an existing directory, nor inside the data directory */
+    ASSERT_ERR(hierarchy_snapshot(h, TEST_DIR "_snap", NULL, NULL), MEM_ERR_EXISTS);
+    ASSERT_ERR(hierarchy_snapshot(h, TEST_DIR "/snap", NULL, NULL), MEM_ERR_INVALID_ARG);
+    ASSERT_NE(access(TEST_DIR "/snap", F_OK), 0);
+    hierarchy_close(h);
+
+    /* Restore a copy: the stores were copied during ingest, and replaying
+     * the WAL copied after them completes them */
+    ASSERT_EQ(system("cp -r " TEST_DIR "_snap " TEST_DIR "_restore"), 0);
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_restore"));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    size_t count = hierarchy_count(h);
+    ASSERT_GE(count, (size_t)(2 + before));
+    ASSERT_LE(count, (size_t)(3 + after));
+    ASSERT_EQ(hierarchy_get_child_count(h, in.session), count - 2);
+
+    /* Only the node created just before the snapshot may lack its text */
+    char text[32];
+    for (node_id_t id = 2; id < count; id++) {
+        ASSERT_EQ(hierarchy_get_parent(h, id), in.session);
+        const char* got = test_text(h, id, NULL);
+        if (!got && id + 1 == count) break;
+        snprintf(text, sizeof(text), "message %u", id);
+        ASSERT_STR_EQ(got, text);
+    }
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_restore");
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test a snapshot taken while several threads store reopens consistent */
+TEST(hierarchy_snapshot_concurrent_stores) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR "_restore");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 64));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "session", &session));
+
+    pthread_t threads[STORE_THREADS];
+    storer_t storers[STORE_THREADS];
+    for (int t = 0; t < STORE_THREADS; t++) {
+        storers[t] = (storer_t){ .h = h, .agent = agent, .session = session, .thread = t };
+        ASSERT_EQ(pthread_create(&threads[t], NULL, store_main, &storers[t]), 0);
+    }
+    while (hierarchy_count(h) < 50) usleep(100);
+    ASSERT_OK(hierarchy_snapshot(h, TEST_DIR "_snap", NULL, NULL));
+    for (int t = 0; t < STORE_THREADS; t++) pthread_join(threads[t], NULL);
+    hierarchy_close(h);
+
+    ASSERT_EQ(system("cp -r " TEST_DIR "_snap " TEST_DIR "_restore"), 0);
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_restore"));
+    ASSERT_OK(hierarchy_enable_wal(h, 0, NULL));
+
+    /* Every store agrees on the nodes, and children follow id order */
+    size_t count = hierarchy_count(h);
+    ASSERT_GE(count, 50);
+    ASSERT_EQ(columns_count(hierarchy_get_columns(h)), count);
+
+    size_t messages = hierarchy_get_child_count(h, session);
+    size_t sessions = hierarchy_get_child_count(h, agent);
+    ASSERT_EQ(2 + messages + (sessions - 1), count);
+
+    node_id_t* children = malloc((messages + 1) * sizeof(node_id_t));
+    ASSERT_NOT_NULL(children);
+    ASSERT_EQ(hierarchy_get_children(h, session, children, messages + 1), messages);
+
+    /* A message created just before the final flush may lack its text */
+    char text[32];
+    size_t missing = 0;
+    for (size_t i = 0; i < messages; i++) {
+        if (i > 0) ASSERT_GT(children[i], children[i - 1]);
+        ASSERT_EQ(hierarchy_get_parent(h, children[i]), session);
+        ASSERT_EQ(columns_get_session(hierarchy_get_columns(h), children[i]), session);
+        const char* got = test_text(h, children[i], NULL);
+        if (!got) {
+            missing++;
+            continue;
+        }
+        snprintf(text, sizeof(text), "message %u", children[i]);
+        ASSERT_STR_EQ(got, text);
+    }
+    ASSERT_LE(missing, (size_t)STORE_THREADS);
+    free(children);
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_restore");
+    cleanup_dir(TEST_DIR "_snap");
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test a snapshot links files unchanged since its base */
+TEST(hierarchy_snapshot_incremental) {
+    setup_dir();
+    cleanup_dir(TEST_DIR "_a");
+    cleanup_dir(TEST_DIR "_b");
+    cleanup_dir(TEST_DIR "_c");
+    cleanup_dir(TEST_DIR "_restore");
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    node_id_t session, message;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    for (int i = 0; i < 3; i++) {
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_set_text(h, message, "original", 8));
+    }
+    ASSERT_OK(hierarchy_sync(h));
+
+    /* Written long before the first snapshot */
+    ASSERT_EQ(system("find " TEST_DIR " -type f -exec touch -d '1 hour ago' {} +"), 0);
+
+    snapshot_stats_t a, b, c;
+    ASSERT_OK(hierarchy_snapshot(h, TEST_DIR "_a", NULL, &a));
+    ASSERT_EQ(a.linked, 0);
+    ASSERT_GT(a.files, 0);
+
+    /* Nothing changed: everything comes from the base */
+    ASSERT_OK(hierarchy_snapshot(h, TEST_DIR "_b", TEST_DIR "_a", &b));
+    ASSERT_EQ(b.files, a.files);
+    ASSERT_EQ(b.linked, a.files);
+    ASSERT_EQ(b.copied_bytes, 0);
+    ASSERT_EQ(b.cloned, 0);
+
+    /* New text changes the text store only */
+    ASSERT_OK(hierarchy_set_text(h, message, "rewritten", 9));
+    ASSERT_OK(hierarchy_snapshot(h, TEST_DIR "_c", TEST_DIR "_b", &c));
+    ASSERT_GT(c.linked, 0);
+    ASSERT_LT(c.linked, c.files);
+    ASSERT_EQ(inode_of(TEST_DIR "_c/id_index.bin"), inode_of(TEST_DIR "_a/id_index.bin"));
+
+    ASSERT_ERR(hierarchy_snapshot(h, TEST_DIR "_d", TEST_DIR "_missing", NULL), MEM_ERR_NOT_FOUND);
+    ASSERT_NE(access(TEST_DIR "_d", F_OK), 0);
+    hierarchy_close(h);
+
+    ASSERT_EQ(system("cp -r " TEST_DIR "_c " TEST_DIR "_restore"), 0);
+    ASSERT_OK(hierarchy_open(&h, TEST_DIR "_restore"));
+    ASSERT_EQ(hierarchy_count(h), 5);
+    ASSERT_STR_EQ(test_text(h, message, NULL), "rewritten");
+    ASSERT_STR_EQ(test_text(h, message - 1, NULL), "original");
+    hierarchy_close(h);
+
+    cleanup_dir(TEST_DIR "_restore");
+    cleanup_dir(TEST_DIR "_c");
+    cleanup_dir(TEST_DIR "_b");
+    cleanup_dir(TEST_DIR "_a");
+    cleanup_dir(TEST_DIR);
+}
+
 TEST_MAIN()
@@ -110,6 +110,42 @@ TEST(hnsw_add_duplicate) {
     hnsw_destroy(index);
 }
 
+/* Test IDs far apart in either direction of the first one */
+TEST(hnsw_sparse_ids) {
+    hnsw_index_t* index = NULL;
+    ASSERT_OK(hnsw_create(&index, NULL));
+
+    const node_id_t ids[] = {50000, 50001, 7, 1200000, 0};
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < 5; i++) {
+        unit_vector(vec, i);
+        ASSERT_OK(hnsw_add(index, ids[i], vec));
+    }
+    ASSERT_EQ(hnsw_size(index), 5);
+
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(hnsw_contains(index, ids[i]));
+        const float* stored = hnsw_get_vector(index, ids[i]);
+        ASSERT_NOT_NULL(stored);
+        ASSERT_FLOAT_EQ(stored[i], 1.0f, 1e-6f);
+    }
+    ASSERT_FALSE(hnsw_contains(index, 8));
+    ASSERT_FALSE(hnsw_contains(index, 2000000));
+    ASSERT_ERR(hnsw_add(index, 7, vec), MEM_ERR_EXISTS);
+
+    unit_vector(vec, 2);
+    hnsw_result_t results[5];
+    size_t count = 0;
+    ASSERT_OK(hnsw_search(index, vec, 1, results, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(results[0].id, 7);
+
+    ASSERT_OK(hnsw_remove(index, 1200000));
+    ASSERT_FALSE(hnsw_contains(index, 1200000));
+
+    hnsw_destroy(index);
+}
+
 /* Test basic search */
 TEST(hnsw_search_basic) {
     hnsw_index_t* index = NULL;
@@ -207,6 +243,41 @@ TEST(hnsw_remove) {
     hnsw_destroy(index);
 }
 
+/* Test re-adding a removed ID revives its slot with the new vector */
+TEST(hnsw_readd_after_remove) {
+    hnsw_index_t* index = NULL;
+    ASSERT_OK(hnsw_create(&index, NULL));
+
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < 3; i++) {
+        unit_vector(vec, i);
+        ASSERT_OK(hnsw_add(index, (node_id_t)(10 + i), vec));
+    }
+    ASSERT_OK(hnsw_remove(index, 11));
+    ASSERT_EQ(hnsw_slot_count(index), 3);
+    ASSERT_FALSE(hnsw_slot(index, 1, NULL, NULL));
+
+    unit_vector(vec, 5);
+    ASSERT_OK(hnsw_add(index, 11, vec));
+    ASSERT_ERR(hnsw_add(index, 11, vec), MEM_ERR_EXISTS);
+    ASSERT_EQ(hnsw_slot_count(index), 3);
+
+    node_id_t id = NODE_ID_INVALID;
+    const float* stored = NULL;
+    ASSERT_TRUE(hnsw_slot(index, 1, &id, &stored));
+    ASSERT_EQ(id, 11);
+    ASSERT_TRUE(stored[5] == 1.0f);
+    ASSERT_FALSE(hnsw_slot(index, 3, &id, &stored));
+
+    hnsw_result_t results[1];
+    size_t count = 0;
+    ASSERT_OK(hnsw_search(index, vec, 1, results, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(results[0].id, 11);
+
+    hnsw_destroy(index);
+}
+
 /* Test remove non-existent ID */
 TEST(hnsw_remove_not_found) {
     hnsw_index_t* index = NULL;
@@ -288,6 +359,87 @@ TEST(hnsw_search_quality) {
     hnsw_destroy(index);
 }
 
+/* Test k above ef_search still returns k true neighbors */
+TEST(hnsw_search_k_above_ef) {
+    hnsw_index_t* index = NULL;
+    hnsw_config_t config = HNSW_CONFIG_DEFAULT;
+    config.ef_search = 10;
+    ASSERT_OK(hnsw_create(&index, &config));
+
+    static float vecs[300][EMBEDDING_DIM];
+    for (int i = 0; i < 300; i++) {
+        random_vector(vecs[i], 7000 + (unsigned int)i);
+        ASSERT_OK(hnsw_add(index, (node_id_t)i, vecs[i]));
+    }
+
+    float query[EMBEDDING_DIM];
+    random_vector(query, 7999);
+    hnsw_result_t results[100];
+    size_t count = 0;
+    ASSERT_OK(hnsw_search(index, query, 100, results, &count));
+    ASSERT_EQ(count, 100);
+
+    /* A hit is correct if fewer than k vectors are closer */
+    size_t matched = 0;
+    for (size_t r = 0; r < count; r++) {
+        size_t closer = 0;
+        for (int i = 0; i < 300; i++) {
+            float dist = 1.0f;
+            for (int d = 0; d < EMBEDDING_DIM; d++) dist -= query[d] * vecs[i][d];
+            if (dist < results[r].distance - 1e-5f) closer++;
+        }
+        if (closer < 100) matched++;
+    }
+    ASSERT_GE(matched, 95);
+
+    hnsw_destroy(index);
+}
+
+/* Filter accepting one id in a hundred */
+static bool one_percent(node_id_t id, void* ctx) {
+    (void)ctx;
+    return id % 100 == 0;
+}
+
+#define SELECTIVE_COUNT 2000
+
+/* Test a 1% filter finds the true nearest accepted vectors */
+TEST(hnsw_filtered_selective_recall) {
+    hnsw_index_t* index = NULL;
+    ASSERT_OK(hnsw_create(&index, NULL));
+
+    static float vecs[SELECTIVE_COUNT][EMBEDDING_DIM];
+    for (int i = 0; i < SELECTIVE_COUNT; i++) {
+        random_vector(vecs[i], 5000 + (unsigned int)i);
+        ASSERT_OK(hnsw_add(index, (node_id_t)i, vecs[i]));
+    }
+
+    float query[EMBEDDING_DIM];
+    hnsw_result_t results[10];
+    size_t count = 0, matched = 0;
+    for (int q = 0; q < 10; q++) {
+        random_vector(query, 9000 + (unsigned int)q);
+        ASSERT_OK(hnsw_search_filtered(index, query, 10, 0, one_percent, NULL,
+                                       results, &count));
+        ASSERT_EQ(count, 10);
+
+        /* A hit is correct if fewer than ten accepted vectors are closer */
+        for (size_t r = 0; r < count; r++) {
+            ASSERT_TRUE(one_percent(results[r].id, NULL));
+            size_t closer = 0;
+            for (int i = 0; i < SELECTIVE_COUNT; i += 100) {
+                float dist = 1.0f;
+                for (int d = 0; d < EMBEDDING_DIM; d++) dist -= query[d] * vecs[i][d];
+                if (dist < results[r].distance - 1e-5f) closer++;
+            }
+            if (closer < 10) matched++;
+        }
+    }
+    ASSERT_GE(matched, 95);
+
+    hnsw_destroy(index);
+}
+
 /* Test invalid arguments */
 TEST(hnsw_invalid_args) {
     hnsw_index_t* index = NULL;
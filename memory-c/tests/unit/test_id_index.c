@@ -0,0 +1,128 @@
+/*
+ * Memory Service - ID Index Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/storage/id_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_PATH "/tmp/test_id_index.bin"
+
+/* Match callback accepting only the node passed as user_data */
+static bool match_node(node_id_t node, void* user_data) {
+    return node == *(node_id_t*)user_data;
+}
+
+/* Test insert and lookup */
+TEST(id_index_insert_find) {
+    unlink(TEST_PATH);
+
+    id_index_t* idx = NULL;
+    ASSERT_OK(id_index_create(&idx, TEST_PATH, 16));
+
+    uint64_t alpha = id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, "alpha");
+    uint64_t beta = id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, "beta");
+    ASSERT_NE(alpha, beta);
+
+    /* Kind and scope are part of the key */
+    ASSERT_NE(alpha, id_index_key(ID_KEY_SESSION, NODE_ID_INVALID, "alpha"));
+    ASSERT_NE(id_index_key(ID_KEY_SESSION, 1, "s"), id_index_key(ID_KEY_SESSION, 2, "s"));
+
+    ASSERT_EQ(id_index_find(idx, alpha, NULL, NULL), NODE_ID_INVALID);
+
+    ASSERT_OK(id_index_insert(idx, alpha, 3));
+    ASSERT_OK(id_index_insert(idx, beta, 7));
+    ASSERT_EQ(id_index_find(idx, alpha, NULL, NULL), 3);
+    ASSERT_EQ(id_index_find(idx, beta, NULL, NULL), 7);
+    ASSERT_EQ(id_index_count(idx), 2);
+
+    /* Equal keys: the match callback picks the right candidate */
+    ASSERT_OK(id_index_insert(idx, alpha, 9));
+    ASSERT_EQ(id_index_find(idx, alpha, NULL, NULL), 3);
+    node_id_t want = 9;
+    ASSERT_EQ(id_index_find(idx, alpha, match_node, &want), 9);
+    want = 42;
+    ASSERT_EQ(id_index_find(idx, alpha, match_node, &want), NODE_ID_INVALID);
+
+    ASSERT_ERR(id_index_insert(idx, alpha, NODE_ID_INVALID), MEM_ERR_INVALID_ARG);
+
+    id_index_close(idx);
+    unlink(TEST_PATH);
+}
+
+/* Test growth keeps every entry and the order of equal keys */
+TEST(id_index_grow) {
+    unlink(TEST_PATH);
+
+    id_index_t* idx = NULL;
+    ASSERT_OK(id_index_create(&idx, TEST_PATH, 1));
+    size_t initial = idx->capacity;
+
+    char name[32];
+    for (node_id_t i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "agent-%u", i);
+        ASSERT_OK(id_index_insert(idx, id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, name), i));
+    }
+    uint64_t dup = id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, "agent-5");
+    ASSERT_OK(id_index_insert(idx, dup, 5000));
+
+    ASSERT_GT(idx->capacity, initial);
+    ASSERT_EQ(id_index_count(idx), 1001);
+
+    for (node_id_t i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "agent-%u", i);
+        node_id_t want = i;
+        ASSERT_EQ(id_index_find(idx, id_index_key(ID_KEY_AGENT, NODE_ID_INVALID, name),
+                                match_node, &want), i);
+    }
+    ASSERT_EQ(id_index_find(idx, dup, NULL, NULL), 5);
+
+    /* Growth leaves no temporary file behind */
+    ASSERT_NE(access(TEST_PATH ".tmp", F_OK), 0);
+
+    id_index_close(idx);
+    unlink(TEST_PATH);
+}
+
+/* Test entries and watermark survive reopen */
+TEST(id_index_persistence) {
+    unlink(TEST_PATH);
+
+    uint64_t key = id_index_key(ID_KEY_SESSION, 4, "session-a");
+    {
+        id_index_t* idx = NULL;
+        ASSERT_OK(id_index_create(&idx, TEST_PATH, 64));
+        ASSERT_EQ(id_index_watermark(idx), 0);
+        ASSERT_OK(id_index_insert(idx, key, 11));
+        id_index_set_watermark(idx, 12);
+        ASSERT_OK(id_index_sync(idx));
+        id_index_close(idx);
+    }
+    {
+        id_index_t* idx = NULL;
+        ASSERT_OK(id_index_open(&idx, TEST_PATH));
+        ASSERT_EQ(id_index_count(idx), 1);
+        ASSERT_EQ(id_index_watermark(idx), 12);
+        ASSERT_EQ(id_index_find(idx, key, NULL, NULL), 11);
+        id_index_close(idx);
+    }
+
+    /* Missing and corrupt files are reported */
+    unlink(TEST_PATH);
+    id_index_t* idx = NULL;
+    ASSERT_ERR(id_index_open(&idx, TEST_PATH), MEM_ERR_OPEN);
+
+    FILE* f = fopen(TEST_PATH, "wb");
+    ASSERT_NOT_NULL(f);
+    char junk[256] = {0};
+    fwrite(junk, 1, sizeof(junk), f);
+    fclose(f);
+    ASSERT_ERR(id_index_open(&idx, TEST_PATH), MEM_ERR_INDEX_CORRUPT);
+
+    unlink(TEST_PATH);
+}
+
+TEST_MAIN()
@@ -134,6 +134,39 @@ TEST(inverted_index_search_or) {
     inverted_index_destroy(index);
 }
 
+static bool odd_docs_only(node_id_t doc_id, void* ctx) {
+    (void)ctx;
+    return doc_id % 2 == 1;
+}
+
+/* Test filtered OR search skips rejected documents before top-k */
+TEST(inverted_index_search_or_filtered) {
+    inverted_index_t* index = NULL;
+    ASSERT_OK(inverted_index_create(&index, NULL));
+
+    const char* doc[] = {"shared"};
+    for (node_id_t id = 0; id < 6; id++) {
+        ASSERT_OK(inverted_index_add(index, id, doc, 1));
+    }
+
+    const char* query[] = {"shared"};
+    inverted_result_t results[10];
+    size_t count = 0;
+
+    /* k = 2 still yields two matches from the accepted set */
+    ASSERT_OK(inverted_index_search_any_filtered(index, query, 1, 2, odd_docs_only,
+                                                 NULL, results, &count));
+    ASSERT_EQ(count, 2);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(results[i].doc_id % 2, 1);
+    }
+
+    ASSERT_ERR(inverted_index_search_any_filtered(index, query, 1, 2, NULL, NULL,
+                                                  results, &count), MEM_ERR_INVALID_ARG);
+
+    inverted_index_destroy(index);
+}
+
 /* Test search on empty index */
 TEST(inverted_index_search_empty) {
     inverted_index_t* index = NULL;
@@ -193,6 +226,39 @@ TEST(inverted_index_remove_not_found) {
     inverted_index_destroy(index);
 }
 
+/* Test batch remove */
+TEST(inverted_index_remove_batch) {
+    inverted_index_t* index = NULL;
+    ASSERT_OK(inverted_index_create(&index, NULL));
+
+    const char* tokens[] = {"shared", "word"};
+    for (node_id_t id = 1; id <= 6; id++) {
+        ASSERT_OK(inverted_index_add(index, id, tokens, 2));
+    }
+
+    /* Unknown IDs are ignored */
+    const node_id_t drop[] = {5, 2, 99, 3};
+    ASSERT_OK(inverted_index_remove_batch(index, drop, 4));
+    ASSERT_EQ(inverted_index_doc_count(index), 3);
+    ASSERT_FALSE(inverted_index_contains(index, 2));
+    ASSERT_TRUE(inverted_index_contains(index, 4));
+
+    const char* query[] = {"shared"};
+    inverted_result_t results[10];
+    size_t count = 0;
+    ASSERT_OK(inverted_index_search_any(index, query, 1, 10, results, &count));
+    ASSERT_EQ(count, 3);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(results[i].doc_id == 1 || results[i].doc_id == 4 ||
+                    results[i].doc_id == 6);
+    }
+
+    ASSERT_OK(inverted_index_remove_batch(index, NULL, 0));
+    ASSERT_ERR(inverted_index_remove_batch(NULL, drop, 1), MEM_ERR_INVALID_ARG);
+
+    inverted_index_destroy(index);
+}
+
 /* Test search excludes removed documents */
 TEST(inverted_index_search_after_remove) {
     inverted_index_t* index = NULL;
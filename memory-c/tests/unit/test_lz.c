@@ -0,0 +1,96 @@
+/*
+ * Memory Service - Block Compression Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/util/lz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Compress then decompress, returning the compressed size */
+static size_t roundtrip(const uint8_t* src, size_t n, const uint8_t* dict, size_t dict_len,
+                        bool* same) {
+    size_t cap = lz_compress_bound(n);
+    uint8_t* packed = malloc(cap);
+    uint8_t* out = malloc(n + 1);
+
+    size_t c = lz_compress(src, n, packed, cap, dict, dict_len);
+    *same = c > 0 && lz_decompress(packed, c, out, n, dict, dict_len) == MEM_OK &&
+            memcmp(out, src, n) == 0;
+
+    free(packed);
+    free(out);
+    return c;
+}
+
+/* Test repetitive and random data round-trip */
+TEST(lz_roundtrip) {
+    size_t n = 64 * 1024;
+    uint8_t* text = malloc(n);
+    for (size_t i = 0; i < n; i++) {
+        text[i] = (uint8_t)"INFO request completed in 12 ms\n"[i % 32];
+    }
+
+    bool same = false;
+    size_t c = roundtrip(text, n, NULL, 0, &same);
+    ASSERT_TRUE(same);
+    ASSERT_LT(c, n / 20);
+
+    /* Pseudo-random bytes do not compress but still round-trip */
+    uint32_t x = 12345;
+    for (size_t i = 0; i < n; i++) {
+        x = x * 1103515245u + 12345u;
+        text[i] = (uint8_t)(x >> 16);
+    }
+    c = roundtrip(text, n, NULL, 0, &same);
+    ASSERT_TRUE(same);
+    ASSERT_LE(c, lz_compress_bound(n));
+
+    /* Inputs shorter than the minimum match length */
+    for (size_t len = 0; len < 20; len++) {
+        roundtrip((const uint8_t*)"aaaaaaaaaaaaaaaaaaaa", len, NULL, 0, &same);
+        ASSERT_TRUE(same);
+    }
+
+    free(text);
+}
+
+/* Test a dictionary lets short blocks reference shared content */
+TEST(lz_dictionary) {
+    const char* dict = "ERROR connection refused while contacting upstream service; retrying";
+    const char* block = "ERROR connection refused while contacting upstream service; giving up";
+    size_t n = strlen(block);
+
+    bool same = false;
+    size_t plain = roundtrip((const uint8_t*)block, n, NULL, 0, &same);
+    ASSERT_TRUE(same);
+
+    size_t with_dict = roundtrip((const uint8_t*)block, n,
+                                 (const uint8_t*)dict, strlen(dict), &same);
+    ASSERT_TRUE(same);
+    ASSERT_LT(with_dict, plain / 2);
+}
+
+/* Test output limits and corrupt input */
+TEST(lz_errors) {
+    uint8_t src[256];
+    for (size_t i = 0; i < sizeof(src); i++) src[i] = (uint8_t)(i * 31);
+
+    uint8_t small[8];
+    ASSERT_EQ(lz_compress(src, sizeof(src), small, sizeof(small), NULL, 0), 0);
+
+    uint8_t packed[512], out[256];
+    size_t c = lz_compress(src, sizeof(src), packed, sizeof(packed), NULL, 0);
+    ASSERT_GT(c, 0);
+
+    /* Wrong expected size and truncated input are rejected */
+    ASSERT_ERR(lz_decompress(packed, c, out, sizeof(out) - 1, NULL, 0), MEM_ERR_INDEX_CORRUPT);
+    ASSERT_ERR(lz_decompress(packed, c - 1, out, sizeof(out), NULL, 0), MEM_ERR_INDEX_CORRUPT);
+
+    /* A back-reference before the start of output */
+    uint8_t bad[] = { 0x10, 'a', 0x05, 0x00 };
+    ASSERT_ERR(lz_decompress(bad, sizeof(bad), out, 5, NULL, 0), MEM_ERR_INDEX_CORRUPT);
+}
+
+TEST_MAIN()
@@ -42,7 +42,7 @@ TEST(pooling_aggregate_children) {
     node_id_t session, message, block;
     node_id_t stmts[3];
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -99,7 +99,7 @@ TEST(pooling_propagate_session) {
     node_id_t session, message, block1, block2;
     node_id_t stmt1, stmt2, stmt3;
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block1));
     ASSERT_OK(hierarchy_create_block(h, message, &block2));
@@ -165,7 +165,7 @@ TEST(pooling_embed_message) {
     node_id_t session, message, block1, block2;
     node_id_t stmt1, stmt2, stmt3;
 
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block1));
     ASSERT_OK(hierarchy_create_block(h, message, &block2));
@@ -218,7 +218,7 @@ TEST(pooling_no_children) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
 
     /* Aggregating with no children should not fail */
     ASSERT_OK(pooling_aggregate_children(h, session));
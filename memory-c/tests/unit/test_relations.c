@@ -10,6 +10,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 
 static void cleanup_dir(const char* dir) {
     char cmd[256];
@@ -57,6 +58,47 @@ TEST(relations_alloc_node) {
     cleanup_dir(dir);
 }
 
+/* Test allocation past the initial capacity grows every file */
+TEST(relations_grow) {
+    const char* dir = "/tmp/test_relations_grow";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    {
+        relations_store_t* store = NULL;
+        ASSERT_OK(relations_create(&store, dir, 4));
+
+        node_id_t root;
+        ASSERT_OK(relations_alloc_node(store, &root));
+        for (int i = 0; i < 99; i++) {
+            node_id_t id;
+            ASSERT_OK(relations_alloc_node(store, &id));
+            ASSERT_OK(relations_set_level(store, id, LEVEL_STATEMENT));
+            ASSERT_OK(relations_append_child(store, root, id));
+        }
+        ASSERT_EQ(relations_count(store), 100);
+        ASSERT_GE(store->capacity, 100);
+
+        /* Slots added by growth start out empty */
+        ASSERT_EQ(relations_get_first_child(store, 99), NODE_ID_INVALID);
+        ASSERT_EQ(relations_get_child_count(store, 99), 0);
+        relations_close(store);
+    }
+    {
+        relations_store_t* store = NULL;
+        ASSERT_OK(relations_open(&store, dir));
+        ASSERT_EQ(relations_count(store), 100);
+        ASSERT_GE(store->capacity, 100);
+        ASSERT_EQ(relations_get_child_count(store, 0), 99);
+        ASSERT_EQ(relations_get_last_child(store, 0), 99);
+        ASSERT_EQ(relations_get_parent(store, 57), 0);
+        ASSERT_EQ(relations_get_next_sibling(store, 57), 58);
+        relations_close(store);
+    }
+
+    cleanup_dir(dir);
+}
+
 /* Test parent-child relationships */
 TEST(relations_parent_child) {
     const char* dir = "/tmp/test_relations_parent";
@@ -252,6 +294,122 @@ TEST(relations_persistence) {
     cleanup_dir(dir);
 }
 
+/* Test constant-time child append */
+TEST(relations_append_child) {
+    const char* dir = "/tmp/test_relations_append";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    relations_store_t* store = NULL;
+    ASSERT_OK(relations_create(&store, dir, 100));
+
+    node_id_t parent, c1, c2, c3;
+    ASSERT_OK(relations_alloc_node(store, &parent));
+    ASSERT_OK(relations_alloc_node(store, &c1));
+    ASSERT_OK(relations_alloc_node(store, &c2));
+    ASSERT_OK(relations_alloc_node(store, &c3));
+
+    ASSERT_EQ(relations_get_last_child(store, parent), NODE_ID_INVALID);
+    ASSERT_EQ(relations_get_child_count(store, parent), 0);
+
+    ASSERT_OK(relations_append_child(store, parent, c1));
+    ASSERT_EQ(relations_get_first_child(store, parent), c1);
+    ASSERT_EQ(relations_get_last_child(store, parent), c1);
+
+    ASSERT_OK(relations_append_child(store, parent, c2));
+    ASSERT_OK(relations_append_child(store, parent, c3));
+    ASSERT_EQ(relations_get_first_child(store, parent), c1);
+    ASSERT_EQ(relations_get_last_child(store, parent), c3);
+    ASSERT_EQ(relations_get_child_count(store, parent), 3);
+    ASSERT_EQ(relations_get_parent(store, c3), parent);
+
+    node_id_t children[10];
+    ASSERT_EQ(relations_get_children(store, parent, children, 10), 3);
+    ASSERT_EQ(children[0], c1);
+    ASSERT_EQ(children[1], c2);
+    ASSERT_EQ(children[2], c3);
+
+    ASSERT_EQ(relations_append_child(store, parent, 99), MEM_ERR_NOT_FOUND);
+    relations_close(store);
+
+    /* Tail and count survive reopen */
+    ASSERT_OK(relations_open(&store, dir));
+    ASSERT_EQ(relations_get_last_child(store, parent), c3);
+    ASSERT_EQ(relations_get_child_count(store, parent), 3);
+    relations_close(store);
+
+    cleanup_dir(dir);
+}
+
+/* Rewrite the version field of a relations file header */
+static void set_file_version(const char* dir, const char* name, uint32_t version) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return;
+    ssize_t n = pwrite(fd, &version, sizeof(version), sizeof(uint32_t));
+    (void)n;
+    close(fd);
+}
+
+/* Test version 1 stores gain last_child and child_count on open */
+TEST(relations_upgrade_v1) {
+    const char* dir = "/tmp/test_relations_upgrade";
+    cleanup_dir(dir);
+    mkdir(dir, 0755);
+
+    /* Build a store as version 1 would have: chains only */
+    relations_store_t* store = NULL;
+    ASSERT_OK(relations_create(&store, dir, 100));
+
+    node_id_t root, a, b, c;
+    ASSERT_OK(relations_alloc_node(store, &root));
+    ASSERT_OK(relations_alloc_node(store, &a));
+    ASSERT_OK(relations_alloc_node(store, &b));
+    ASSERT_OK(relations_alloc_node(store, &c));
+    ASSERT_OK(relations_set_parent(store, a, root));
+    ASSERT_OK(relations_set_parent(store, b, root));
+    ASSERT_OK(relations_set_parent(store, c, a));
+    ASSERT_OK(relations_set_first_child(store, root, a));
+    ASSERT_OK(relations_set_next_sibling(store, a, b));
+    ASSERT_OK(relations_set_first_child(store, a, c));
+    relations_close(store);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/last_child.bin", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/child_count.bin", dir);
+    unlink(path);
+    set_file_version(dir, "parent.bin", 1);
+    set_file_version(dir, "first_child.bin", 1);
+    set_file_version(dir, "next_sibling.bin", 1);
+    set_file_version(dir, "level.bin", 1);
+
+    ASSERT_OK(relations_open(&store, dir));
+    ASSERT_EQ(relations_get_last_child(store, root), b);
+    ASSERT_EQ(relations_get_child_count(store, root), 2);
+    ASSERT_EQ(relations_get_last_child(store, a), c);
+    ASSERT_EQ(relations_get_child_count(store, a), 1);
+    ASSERT_EQ(relations_get_last_child(store, b), NODE_ID_INVALID);
+    ASSERT_EQ(relations_get_child_count(store, c), 0);
+
+    /* Appends continue from the rebuilt tail */
+    node_id_t d;
+    ASSERT_OK(relations_alloc_node(store, &d));
+    ASSERT_OK(relations_append_child(store, root, d));
+    ASSERT_EQ(relations_get_next_sibling(store, b), d);
+    ASSERT_EQ(relations_get_child_count(store, root), 3);
+    relations_close(store);
+
+    /* Upgraded store reopens as the current version */
+    ASSERT_OK(relations_open(&store, dir));
+    ASSERT_EQ(relations_get_last_child(store, root), d);
+    ASSERT_EQ(relations_get_child_count(store, root), 3);
+    relations_close(store);
+
+    cleanup_dir(dir);
+}
+
 /* Test invalid arguments */
 TEST(relations_invalid_args) {
     relations_store_t* store = NULL;
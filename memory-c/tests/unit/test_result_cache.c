@@ -0,0 +1,196 @@
+/*
+ * Memory Service - Query Result Cache Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/search/result_cache.h"
+
+#include <string.h>
+
+static search_cache_query_t make_query(const char* text, size_t k) {
+    search_cache_query_t q = {
+        .text = text,
+        .text_len = strlen(text),
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_SESSION,
+        .k = k
+    };
+    return q;
+}
+
+static void fill_matches(search_match_t* matches, size_t count, node_id_t base) {
+    for (size_t i = 0; i < count; i++) {
+        matches[i] = (search_match_t){
+            .node_id = base + (node_id_t)i,
+            .level = LEVEL_STATEMENT,
+            .score = 1.0f - 0.1f * (float)i
+        };
+    }
+}
+
+/* Test store then hit, and miss on unknown query */
+TEST(result_cache_hit_miss) {
+    result_cache_t* cache = NULL;
+    ASSERT_OK(result_cache_create(&cache, 8));
+
+    search_match_t stored[3], out[10];
+    fill_matches(stored, 3, 100);
+
+    search_cache_query_t q = make_query("where is the config", 10);
+    size_t count = 0;
+    ASSERT_FALSE(result_cache_get(cache, &q, out, 10, &count));
+
+    ASSERT_OK(result_cache_put(cache, &q, stored, 3));
+    ASSERT_TRUE(result_cache_get(cache, &q, out, 10, &count));
+    ASSERT_EQ(count, 3);
+    ASSERT_EQ(out[0].node_id, 100);
+    ASSERT_FLOAT_EQ(out[2].score, stored[2].score, 1e-6f);
+
+    /* Output is capped by the caller's buffer */
+    ASSERT_TRUE(result_cache_get(cache, &q, out, 2, &count));
+    ASSERT_EQ(count, 2);
+
+    result_cache_stats_t stats;
+    result_cache_get_stats(cache, &stats);
+    ASSERT_EQ(stats.hits, 2);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.evictions, 0);
+
+    result_cache_destroy(cache);
+}
+
+/* Test fingerprint normalization and key fields */
+TEST(result_cache_fingerprint) {
+    result_cache_t* cache = NULL;
+    ASSERT_OK(result_cache_create(&cache, 8));
+
+    search_match_t stored[1], out[10];
+    fill_matches(stored, 1, 7);
+
+    search_cache_query_t q = make_query("  Where IS\tthe   config\n", 10);
+    ASSERT_OK(result_cache_put(cache, &q, stored, 1));
+
+    /* Case and whitespace differences share an entry */
+    size_t count = 0;
+    search_cache_query_t same = make_query("where is the config", 10);
+    ASSERT_TRUE(result_cache_get(cache, &same, out, 10, &count));
+
+    /* Different text, k or level range do not */
+    search_cache_query_t other_text = make_query("where is the configs", 10);
+    ASSERT_FALSE(result_cache_get(cache, &other_text, out, 10, &count));
+
+    search_cache_query_t other_k = make_query("where is the config", 5);
+    ASSERT_FALSE(result_cache_get(cache, &other_k, out, 10, &count));
+
+    search_cache_query_t other_levels = make_query("where is the config", 10);
+    other_levels.max_level = LEVEL_BLOCK;
+    ASSERT_FALSE(result_cache_get(cache, &other_levels, out, 10, &count));
+
+    /* Nor does a filter, and equal filters share an entry */
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    filter.session = 12;
+    search_cache_query_t filtered = make_query("where is the config", 10);
+    filtered.filter = &filter;
+    ASSERT_FALSE(result_cache_get(cache, &filtered, out, 10, &count));
+
+    ASSERT_OK(result_cache_put(cache, &filtered, stored, 1));
+    search_filter_t same_filter = filter;
+    filtered.filter = &same_filter;
+    ASSERT_TRUE(result_cache_get(cache, &filtered, out, 10, &count));
+    same_filter.after_time = 1;
+    ASSERT_FALSE(result_cache_get(cache, &filtered, out, 10, &count));
+
+    result_cache_destroy(cache);
+}
+
+/* Test generation-based invalidation only covers the query's levels */
+TEST(result_cache_generations) {
+    result_cache_t* cache = NULL;
+    ASSERT_OK(result_cache_create(&cache, 8));
+
+    search_match_t stored[2], out[10];
+    fill_matches(stored, 2, 1);
+
+    search_cache_query_t q = make_query("budget", 10);
+    q.min_level = LEVEL_STATEMENT;
+    q.max_level = LEVEL_BLOCK;
+    ASSERT_OK(result_cache_put(cache, &q, stored, 2));
+
+    /* A write to a level outside the range keeps the entry */
+    size_t count = 0;
+    q.generations[LEVEL_SESSION]++;
+    ASSERT_TRUE(result_cache_get(cache, &q, out, 10, &count));
+
+    /* A write to a covered level invalidates it */
+    q.generations[LEVEL_BLOCK]++;
+    ASSERT_FALSE(result_cache_get(cache, &q, out, 10, &count));
+
+    /* Stale entry was dropped, so the old generations miss too */
+    q.generations[LEVEL_BLOCK]--;
+    ASSERT_FALSE(result_cache_get(cache, &q, out, 10, &count));
+
+    result_cache_destroy(cache);
+}
+
+/* Test least recently used entry is evicted at capacity */
+TEST(result_cache_lru_eviction) {
+    result_cache_t* cache = NULL;
+    ASSERT_OK(result_cache_create(&cache, 2));
+
+    search_match_t stored[1], out[10];
+    fill_matches(stored, 1, 1);
+    size_t count = 0;
+
+    search_cache_query_t a = make_query("alpha", 10);
+    search_cache_query_t b = make_query("beta", 10);
+    search_cache_query_t c = make_query("gamma", 10);
+
+    ASSERT_OK(result_cache_put(cache, &a, stored, 1));
+    ASSERT_OK(result_cache_put(cache, &b, stored, 1));
+
+    /* Touch a so b becomes least recently used */
+    ASSERT_TRUE(result_cache_get(cache, &a, out, 10, &count));
+    ASSERT_OK(result_cache_put(cache, &c, stored, 1));
+
+    ASSERT_TRUE(result_cache_get(cache, &a, out, 10, &count));
+    ASSERT_FALSE(result_cache_get(cache, &b, out, 10, &count));
+    ASSERT_TRUE(result_cache_get(cache, &c, out, 10, &count));
+
+    /* Re-storing an existing key replaces it without evicting */
+    search_match_t updated[2];
+    fill_matches(updated, 2, 50);
+    ASSERT_OK(result_cache_put(cache, &c, updated, 2));
+    ASSERT_TRUE(result_cache_get(cache, &c, out, 10, &count));
+    ASSERT_EQ(count, 2);
+    ASSERT_EQ(out[0].node_id, 50);
+
+    result_cache_stats_t stats;
+    result_cache_get_stats(cache, &stats);
+    ASSERT_EQ(stats.evictions, 1);
+
+    result_cache_destroy(cache);
+}
+
+/* Test invalid arguments */
+TEST(result_cache_invalid_args) {
+    result_cache_t* cache = NULL;
+    ASSERT_ERR(result_cache_create(NULL, 8), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(result_cache_create(&cache, 0), MEM_ERR_INVALID_ARG);
+
+    ASSERT_OK(result_cache_create(&cache, 1));
+    search_cache_query_t q = make_query("x", 1);
+    ASSERT_ERR(result_cache_put(NULL, &q, NULL, 0), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(result_cache_put(cache, NULL, NULL, 0), MEM_ERR_INVALID_ARG);
+
+    /* Empty result sets are cacheable */
+    search_match_t out[1];
+    size_t count = 99;
+    ASSERT_OK(result_cache_put(cache, &q, NULL, 0));
+    ASSERT_TRUE(result_cache_get(cache, &q, out, 1, &count));
+    ASSERT_EQ(count, 0);
+
+    result_cache_destroy(cache);
+    result_cache_destroy(NULL);
+}
+
+TEST_MAIN()
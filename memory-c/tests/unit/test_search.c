@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include <sys/stat.h>
 
 #define TEST_DIR "/tmp/test_search"
@@ -92,7 +93,7 @@ TEST(search_index_nodes) {
 
     /* Create hierarchy */
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
@@ -122,7 +123,7 @@ TEST(search_semantic) {
 
     /* Create statements with different vectors */
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -165,7 +166,7 @@ TEST(search_exact) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -210,7 +211,7 @@ TEST(search_combined) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -270,7 +271,7 @@ TEST(search_ranking) {
     ASSERT_OK(search_engine_create(&engine, h, &config));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
@@ -284,7 +285,7 @@ TEST(search_ranking) {
 
     const char* tokens[] = {"test"};
     ASSERT_OK(search_engine_index(engine, stmt_old, vec, tokens, 1, 1000));
-    ASSERT_OK(search_engine_index(engine, stmt_new, vec, tokens, 1, 9999999999ULL));  /* Very recent */
+    ASSERT_OK(search_engine_index(engine, stmt_new, vec, tokens, 1, timestamp_now_ns()));  /* Very recent */
 
     /* Search */
     search_match_t results[10];
@@ -308,14 +309,18 @@ TEST(search_token_budget) {
     ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
 
     node_id_t session, message, block;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
 
     /* Create results array */
     search_match_t results[10];
     for (int i = 0; i < 10; i++) {
-        results[i].level = LEVEL_STATEMENT;  /* 50 tokens each */
+        results[i] = (search_match_t){
+            .node_id = NODE_ID_INVALID,   /* No recorded count: level estimate */
+            .level = LEVEL_STATEMENT,     /* 50 tokens each */
+            .score = 1.0f
+        };
     }
 
     size_t final_count = 0;
@@ -336,6 +341,129 @@ TEST(search_token_budget) {
     cleanup_dir(TEST_DIR);
 }
 
+/* Test budget uses recorded token counts and substitutes parents */
+TEST(search_token_budget_knapsack) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    node_id_t session, message, block, big, stmts[4];
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+    ASSERT_OK(hierarchy_create_block(h, message, &big));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmts[i]));
+    }
+
+    columns_store_t* columns = hierarchy_get_columns(h);
+    ASSERT_OK(columns_set_token_count(columns, block, 100));
+    ASSERT_OK(columns_set_token_count(columns, big, 5000));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_OK(columns_set_token_count(columns, stmts[i], 30));
+    }
+
+    search_match_t results[6];
+    size_t final_count = 0;
+    #define FILL_RESULTS() do { \
+        results[0] = (search_match_t){ .node_id = big,      .level = LEVEL_BLOCK,     .score = 0.95f }; \
+        results[1] = (search_match_t){ .node_id = stmts[0], .level = LEVEL_STATEMENT, .score = 0.9f }; \
+        results[2] = (search_match_t){ .node_id = stmts[1], .level = LEVEL_STATEMENT, .score = 0.8f }; \
+        results[3] = (search_match_t){ .node_id = stmts[2], .level = LEVEL_STATEMENT, .score = 0.7f }; \
+        results[4] = (search_match_t){ .node_id = stmts[3], .level = LEVEL_STATEMENT, .score = 0.6f }; \
+        results[5] = (search_match_t){ .node_id = block,    .level = LEVEL_BLOCK,     .score = 0.5f }; \
+    } while (0)
+
+    /* 90 tokens: three statements fit, the oversized block never does */
+    FILL_RESULTS();
+    ASSERT_OK(search_apply_budget(h, results, 6, 90, &final_count));
+    ASSERT_EQ(final_count, 3);
+    ASSERT_EQ(results[0].node_id, stmts[0]);
+    ASSERT_EQ(results[1].node_id, stmts[1]);
+    ASSERT_EQ(results[2].node_id, stmts[2]);
+
+    /* 100 tokens: the parent block replaces its statements */
+    FILL_RESULTS();
+    ASSERT_OK(search_apply_budget(h, results, 6, 100, &final_count));
+    ASSERT_EQ(final_count, 1);
+    ASSERT_EQ(results[0].node_id, block);
+
+    /* Enough for everything: the parent still covers its statements */
+    FILL_RESULTS();
+    ASSERT_OK(search_apply_budget(h, results, 6, 10000, &final_count));
+    ASSERT_EQ(final_count, 2);
+    ASSERT_EQ(results[0].node_id, big);
+    ASSERT_EQ(results[1].node_id, block);
+    #undef FILL_RESULTS
+
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test semantic candidates are not capped by the HNSW ef_search (50) */
+TEST(search_candidates_above_ef) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 1000));
+
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.max_candidates = 200;
+    config.fresh_buffer_capacity = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    static float vecs[600][EMBEDDING_DIM];
+    for (int i = 0; i < 600; i++) {
+        node_id_t stmt;
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+        random_vector(vecs[i], 6000 + (unsigned int)i);
+        ASSERT_OK(search_engine_index(engine, stmt, vecs[i], NULL, 0, 1000));
+    }
+
+    /* Semantic only: every result is an HNSW candidate */
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 6999);
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 200,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t* results = calloc(query.k, sizeof(search_match_t));
+    ASSERT_NOT_NULL(results);
+    size_t count = 0;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 200);
+
+    /* Nearly all of the true 200 nearest are found */
+    float sims[600];
+    for (int i = 0; i < 600; i++) {
+        sims[i] = 0.0f;
+        for (int d = 0; d < EMBEDDING_DIM; d++) sims[i] += query_vec[d] * vecs[i][d];
+    }
+    size_t matched = 0;
+    for (size_t r = 0; r < count; r++) {
+        size_t better = 0;
+        for (int i = 0; i < 600; i++) {
+            if (sims[i] > results[r].semantic_score + 1e-5f) better++;
+        }
+        if (better < 200) matched++;
+    }
+    ASSERT_GE(matched, 190);
+
+    free(results);
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
 /* Test remove operation */
 TEST(search_remove) {
     setup_dir();
@@ -347,7 +475,7 @@ TEST(search_remove) {
     ASSERT_OK(search_engine_create(&engine, h, NULL));
 
     node_id_t session, message, block, stmt;
-    ASSERT_OK(hierarchy_create_session(h, "agent", "session", &session));
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
     ASSERT_OK(hierarchy_create_message(h, session, &message));
     ASSERT_OK(hierarchy_create_block(h, message, &block));
     ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
@@ -373,6 +501,298 @@ TEST(search_remove) {
     cleanup_dir(TEST_DIR);
 }
 
+/* Test large candidate pools: dedup across semantic/exact hits and top-k order */
+TEST(search_large_candidate_pool) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 2000));
+
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.max_candidates = 1000;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    /* Every statement matches both semantically and by token */
+    const char* tokens[] = {"shared"};
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < 400; i++) {
+        node_id_t stmt;
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+        random_vector(vec, 1000 + i);
+        ASSERT_OK(search_engine_index(engine, stmt, vec, tokens, 1, 1000));
+    }
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 1000 + 123);
+
+    search_query_t query = {
+        .embedding = query_vec,
+        .tokens = tokens,
+        .token_count = 1,
+        .k = 300,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+
+    search_match_t* results = calloc(query.k, sizeof(search_match_t));
+    ASSERT_NOT_NULL(results);
+    size_t count = 0;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 300);
+
+    /* Sorted by descending score, no duplicate node IDs */
+    for (size_t i = 1; i < count; i++) {
+        ASSERT_GE(results[i - 1].score, results[i].score);
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            ASSERT_NE(results[i].node_id, results[j].node_id);
+        }
+    }
+
+    /* Semantic and exact hits for the same node were merged */
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_GT(results[i].exact_score, 0.0f);
+    }
+
+    free(results);
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test recency inputs survive a restart (rebuild reads persisted columns) */
+TEST(search_recency_after_reopen) {
+    setup_dir();
+
+    node_id_t stmt_old, stmt_new;
+    float vec[EMBEDDING_DIM];
+    random_vector(vec, 7);
+    timestamp_ns_t now = timestamp_now_ns();
+
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+        search_engine_t* engine = NULL;
+        ASSERT_OK(search_engine_create(&engine, h, NULL));
+
+        node_id_t session, message, block;
+        ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_create_block(h, message, &block));
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt_old));
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt_new));
+
+        /* Index the newer node first so node order cannot explain the ranking */
+        ASSERT_OK(hierarchy_set_embedding(h, stmt_new, vec));
+        ASSERT_OK(hierarchy_set_embedding(h, stmt_old, vec));
+        ASSERT_OK(search_engine_index(engine, stmt_new, vec, NULL, 0, now));
+        ASSERT_OK(search_engine_index(engine, stmt_old, vec, NULL, 0,
+                                      now - 48ULL * 3600 * 1000000000ULL));
+
+        search_engine_destroy(engine);
+        ASSERT_OK(hierarchy_sync(h));
+        hierarchy_close(h);
+    }
+
+    {
+        hierarchy_t* h = NULL;
+        ASSERT_OK(hierarchy_open(&h, TEST_DIR));
+
+        search_engine_t* engine = NULL;
+        ASSERT_OK(search_engine_create(&engine, h, NULL));
+
+        search_query_t query = {
+            .embedding = vec,
+            .k = 10,
+            .min_level = LEVEL_STATEMENT,
+            .max_level = LEVEL_STATEMENT
+        };
+        search_match_t results[10];
+        size_t count = 0;
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        ASSERT_EQ(count, 2);
+
+        ASSERT_EQ(results[0].node_id, stmt_new);
+        ASSERT_EQ(results[0].timestamp, now);
+        ASSERT_GT(results[0].score, results[1].score);
+
+        search_engine_destroy(engine);
+        hierarchy_close(h);
+    }
+
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test per-level fan-out returns exactly the serial results */
+TEST(search_parallel_fanout) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 500));
+
+    search_engine_t* serial = NULL;
+    ASSERT_OK(search_engine_create(&serial, h, NULL));
+
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.parallel_fanout = LEVEL_COUNT;
+    config.parallel_threads = 2;
+    search_engine_t* parallel = NULL;
+    ASSERT_OK(search_engine_create(&parallel, h, &config));
+
+    /* Populate every level so each per-level search has work */
+    node_id_t agent = test_agent(h, "agent");
+    const char* tokens[] = {"fanout"};
+    float vec[EMBEDDING_DIM];
+    timestamp_ns_t now = timestamp_now_ns();
+    unsigned int seed = 500;
+
+    random_vector(vec, seed++);
+    ASSERT_OK(search_engine_index(serial, agent, vec, tokens, 1, now));
+    ASSERT_OK(search_engine_index(parallel, agent, vec, tokens, 1, now));
+
+    for (int s = 0; s < 3; s++) {
+        node_id_t session, message, block, stmt;
+        char name[32];
+        snprintf(name, sizeof(name), "session-%d", s);
+        ASSERT_OK(hierarchy_create_session(h, agent, name, &session));
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+        node_id_t ids[] = {session, message, block};
+        for (size_t i = 0; i < 3; i++) {
+            random_vector(vec, seed++);
+            ASSERT_OK(search_engine_index(serial, ids[i], vec, tokens, 1, now));
+            ASSERT_OK(search_engine_index(parallel, ids[i], vec, tokens, 1, now));
+        }
+        for (int j = 0; j < 10; j++) {
+            ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+            random_vector(vec, seed++);
+            ASSERT_OK(search_engine_index(serial, stmt, vec, tokens, 1, now));
+            ASSERT_OK(search_engine_index(parallel, stmt, vec, tokens, 1, now));
+        }
+    }
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 42);
+    search_query_t query = {
+        .embedding = query_vec,
+        .tokens = tokens,
+        .token_count = 1,
+        .k = 20,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_AGENT
+    };
+
+    /* Fan-out covers HNSW segments, so merge the fresh buffers first */
+    search_engine_flush(serial);
+    search_engine_flush(parallel);
+
+    search_match_t expected[20], actual[20];
+    size_t expected_count = 0, actual_count = 0;
+    ASSERT_OK(search_engine_search(serial, &query, expected, &expected_count));
+    ASSERT_OK(search_engine_search(parallel, &query, actual, &actual_count));
+
+    ASSERT_EQ(actual_count, expected_count);
+    for (size_t i = 0; i < expected_count; i++) {
+        ASSERT_EQ(actual[i].node_id, expected[i].node_id);
+        ASSERT_FLOAT_EQ(actual[i].score, expected[i].score, 1e-6f);
+    }
+
+    search_stats_t stats;
+    search_engine_get_stats(parallel, &stats);
+    ASSERT_EQ(stats.parallel_searches, 1);
+    ASSERT_EQ(stats.serial_fallbacks, 0);
+
+    /* Serial engine never fans out */
+    search_engine_get_stats(serial, &stats);
+    ASSERT_EQ(stats.parallel_searches, 0);
+
+    search_engine_destroy(parallel);
+    search_engine_destroy(serial);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test cached results are invalidated by index and remove on covered levels */
+TEST(search_result_cache_invalidation) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, NULL));
+
+    node_id_t session, message, block, stmt1, stmt2;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+    ASSERT_OK(hierarchy_create_statement(h, block, &stmt1));
+    ASSERT_OK(hierarchy_create_statement(h, block, &stmt2));
+
+    float vec[EMBEDDING_DIM];
+    random_vector(vec, 11);
+    ASSERT_OK(search_engine_index(engine, stmt1, vec, NULL, 0, timestamp_now_ns()));
+
+    search_cache_query_t cq = {
+        .text = "Deploy steps",
+        .text_len = strlen("Deploy steps"),
+        .k = 10,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t results[10];
+    size_t count = 0;
+
+    ASSERT_FALSE(search_engine_cache_lookup(engine, &cq, results, &count));
+    search_query_t query = {
+        .embedding = vec, .k = 10,
+        .min_level = LEVEL_STATEMENT, .max_level = LEVEL_STATEMENT
+    };
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 1);
+    search_engine_cache_store(engine, &cq, results, count);
+
+    memset(results, 0, sizeof(results));
+    ASSERT_TRUE(search_engine_cache_lookup(engine, &cq, results, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(results[0].node_id, stmt1);
+
+    /* Indexing a block does not touch the statement level */
+    ASSERT_OK(search_engine_index(engine, block, vec, NULL, 0, timestamp_now_ns()));
+    ASSERT_TRUE(search_engine_cache_lookup(engine, &cq, results, &count));
+
+    /* Indexing another statement does */
+    ASSERT_OK(search_engine_index(engine, stmt2, vec, NULL, 0, timestamp_now_ns()));
+    ASSERT_FALSE(search_engine_cache_lookup(engine, &cq, results, &count));
+
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 2);
+    search_engine_cache_store(engine, &cq, results, count);
+    ASSERT_TRUE(search_engine_cache_lookup(engine, &cq, results, &count));
+
+    /* Removing a statement invalidates as well */
+    ASSERT_OK(search_engine_remove(engine, stmt2));
+    ASSERT_FALSE(search_engine_cache_lookup(engine, &cq, results, &count));
+
+    search_stats_t stats;
+    search_engine_get_stats(engine, &stats);
+    ASSERT_EQ(stats.cache_hits, 3);
+    ASSERT_EQ(stats.cache_misses, 3);
+
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
 /* Test invalid arguments */
 TEST(search_invalid_args) {
     setup_dir();
@@ -410,4 +830,880 @@ TEST(search_invalid_args) {
     cleanup_dir(TEST_DIR);
 }
 
+/* Helper: Ancestor of node at level (NODE_ID_INVALID if none) */
+static node_id_t ancestor_at(hierarchy_t* h, node_id_t id, hierarchy_level_t level) {
+    while (id != NODE_ID_INVALID && hierarchy_get_level(h, id) < level) {
+        id = hierarchy_get_parent(h, id);
+    }
+    return id;
+}
+
+/* Test coarse-to-fine restricts fine levels to the top coarse subtrees */
+TEST(search_coarse_to_fine) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 500));
+
+    /* Default config scans subtrees exactly; a tiny limit forces filtered HNSW */
+    search_engine_t* scan = NULL;
+    ASSERT_OK(search_engine_create(&scan, h, NULL));
+
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.coarse_scan_limit = 2;
+    search_engine_t* graph = NULL;
+    ASSERT_OK(search_engine_create(&graph, h, &config));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t session;
+    ASSERT_OK(hierarchy_create_session(h, agent, "coarse", &session));
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 7);
+    float vec[EMBEDDING_DIM];
+    timestamp_ns_t now = timestamp_now_ns();
+    unsigned int seed = 700;
+
+    node_id_t target = NODE_ID_INVALID, decoy = NODE_ID_INVALID;
+    for (int m = 0; m < 4; m++) {
+        node_id_t message;
+        ASSERT_OK(hierarchy_create_message(h, session, &message));
+        if (m == 0) {
+            target = message;
+            memcpy(vec, query_vec, sizeof(vec));
+        } else {
+            random_vector(vec, seed++);
+        }
+        ASSERT_OK(search_engine_index(scan, message, vec, NULL, 0, now));
+        ASSERT_OK(search_engine_index(graph, message, vec, NULL, 0, now));
+
+        for (int b = 0; b < 2; b++) {
+            node_id_t block, stmt;
+            ASSERT_OK(hierarchy_create_block(h, message, &block));
+            random_vector(vec, seed++);
+            ASSERT_OK(search_engine_index(scan, block, vec, NULL, 0, now));
+            ASSERT_OK(search_engine_index(graph, block, vec, NULL, 0, now));
+
+            for (int s = 0; s < 5; s++) {
+                ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+                /* A perfect statement match outside the target message */
+                if (m == 3 && b == 0 && s == 0) {
+                    decoy = stmt;
+                    memcpy(vec, query_vec, sizeof(vec));
+                } else {
+                    random_vector(vec, seed++);
+                }
+                ASSERT_OK(search_engine_index(scan, stmt, vec, NULL, 0, now));
+                ASSERT_OK(search_engine_index(graph, stmt, vec, NULL, 0, now));
+            }
+        }
+    }
+
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 20,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_BLOCK
+    };
+    search_match_t results[20];
+    size_t count = 0;
+
+    /* Flat search ranks the decoy first */
+    ASSERT_OK(search_engine_search(scan, &query, results, &count));
+    ASSERT_GT(count, 0);
+    ASSERT_EQ(results[0].node_id, decoy);
+
+    query.mode = SEARCH_MODE_COARSE_TO_FINE;
+    query.coarse_top_n = 1;
+
+    search_engine_t* engines[] = {scan, graph};
+    for (int e = 0; e < 2; e++) {
+        ASSERT_OK(search_engine_search(engines[e], &query, results, &count));
+
+        /* Both blocks and all ten statements of the target message */
+        ASSERT_EQ(count, 12);
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_NE(results[i].node_id, decoy);
+            ASSERT_EQ(ancestor_at(h, results[i].node_id, LEVEL_MESSAGE), target);
+        }
+    }
+
+    search_stats_t stats;
+    search_engine_get_stats(scan, &stats);
+    ASSERT_EQ(stats.coarse_searches, 1);
+    ASSERT_EQ(stats.coarse_scans, 1);
+
+    search_engine_get_stats(graph, &stats);
+    ASSERT_EQ(stats.coarse_searches, 1);
+    ASSERT_EQ(stats.coarse_scans, 0);
+
+    /* Coarse level inside the range: its own hits are kept too */
+    query.max_level = LEVEL_MESSAGE;
+    ASSERT_OK(search_engine_search(scan, &query, results, &count));
+    ASSERT_EQ(results[0].node_id, target);
+
+    search_engine_destroy(graph);
+    search_engine_destroy(scan);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test agent/session/time filters on both planner paths */
+TEST(search_filters) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 500));
+
+    /* Default config scans small subsets; a tiny limit forces filtered HNSW */
+    search_engine_t* scan = NULL;
+    ASSERT_OK(search_engine_create(&scan, h, NULL));
+
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.filter_scan_limit = 2;
+    search_engine_t* graph = NULL;
+    ASSERT_OK(search_engine_create(&graph, h, &config));
+
+    /* Two agents with two sessions each; timestamps increase per statement */
+    const char* tokens[] = {"deploy"};
+    float vec[EMBEDDING_DIM];
+    timestamp_ns_t base = 1000;
+    timestamp_ns_t t = base;
+    unsigned int seed = 900;
+    node_id_t agents[2], sessions[2][2];
+
+    for (int a = 0; a < 2; a++) {
+        char name[32];
+        snprintf(name, sizeof(name), "tenant-%d", a);
+        agents[a] = test_agent(h, name);
+
+        for (int s = 0; s < 2; s++) {
+            snprintf(name, sizeof(name), "s-%d", s);
+            ASSERT_OK(hierarchy_create_session(h, agents[a], name, &sessions[a][s]));
+
+            node_id_t message, block, stmt;
+            ASSERT_OK(hierarchy_create_message(h, sessions[a][s], &message));
+            ASSERT_OK(hierarchy_create_block(h, message, &block));
+            for (int j = 0; j < 5; j++) {
+                ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+                random_vector(vec, seed++);
+                ASSERT_OK(search_engine_index(scan, stmt, vec, tokens, 1, t));
+                ASSERT_OK(search_engine_index(graph, stmt, vec, tokens, 1, t));
+                t++;
+            }
+        }
+    }
+
+    /* Session and agent lookups used by the RPC layer */
+    ASSERT_EQ(hierarchy_find_agent(h, "tenant-1"), agents[1]);
+    ASSERT_EQ(hierarchy_find_agent(h, "missing"), NODE_ID_INVALID);
+    ASSERT_EQ(hierarchy_find_session(h, agents[1], "s-0"), sessions[1][0]);
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 77);
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    search_query_t query = {
+        .embedding = query_vec,
+        .tokens = tokens,
+        .token_count = 1,
+        .k = 20,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_SESSION,
+        .filter = &filter
+    };
+    search_match_t results[20];
+    size_t count = 0;
+
+    search_engine_t* engines[] = {scan, graph};
+    for (int e = 0; e < 2; e++) {
+        /* Agent: both of its sessions, nothing from the other tenant */
+        filter = (search_filter_t)SEARCH_FILTER_NONE;
+        filter.agent = agents[1];
+        ASSERT_OK(search_engine_search(engines[e], &query, results, &count));
+        ASSERT_EQ(count, 10);
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(ancestor_at(h, results[i].node_id, LEVEL_AGENT), agents[1]);
+        }
+
+        /* Session */
+        filter = (search_filter_t)SEARCH_FILTER_NONE;
+        filter.session = sessions[0][1];
+        ASSERT_OK(search_engine_search(engines[e], &query, results, &count));
+        ASSERT_EQ(count, 5);
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(ancestor_at(h, results[i].node_id, LEVEL_SESSION), sessions[0][1]);
+        }
+
+        /* Time window: after inclusive, before exclusive */
+        filter = (search_filter_t)SEARCH_FILTER_NONE;
+        filter.after_time = base + 3;
+        filter.before_time = base + 6;
+        ASSERT_OK(search_engine_search(engines[e], &query, results, &count));
+        ASSERT_EQ(count, 3);
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_GE(results[i].timestamp, base + 3);
+            ASSERT_TRUE(results[i].timestamp < base + 6);
+        }
+
+        /* Combined: agent 1's statements in the last 7 ticks */
+        filter.agent = agents[1];
+        filter.after_time = t - 7;
+        filter.before_time = 0;
+        ASSERT_OK(search_engine_search(engines[e], &query, results, &count));
+        ASSERT_EQ(count, 7);
+    }
+
+    search_stats_t stats;
+    search_engine_get_stats(scan, &stats);
+    ASSERT_EQ(stats.filter_scans, 4);
+    ASSERT_EQ(stats.filter_graph_searches, 0);
+
+    search_engine_get_stats(graph, &stats);
+    ASSERT_EQ(stats.filter_scans, 0);
+    ASSERT_EQ(stats.filter_graph_searches, 4);
+
+    /* Removed nodes leave the time index */
+    filter = (search_filter_t)SEARCH_FILTER_NONE;
+    filter.before_time = base + 1;
+    ASSERT_OK(search_engine_search(scan, &query, results, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_OK(search_engine_remove(scan, results[0].node_id));
+    ASSERT_OK(search_engine_search(scan, &query, results, &count));
+    ASSERT_EQ(count, 0);
+
+    search_engine_destroy(graph);
+    search_engine_destroy(scan);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+#define SELECTIVE_NODES 1500
+
+/* Test a 1% filter keeps its recall on the filtered HNSW path */
+TEST(search_selective_filter_recall) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, SELECTIVE_NODES + 16));
+
+    search_engine_t* scan = NULL;
+    ASSERT_OK(search_engine_create(&scan, h, NULL));
+
+    /* The rare session's 15 statements are above the scan limit */
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.filter_scan_limit = 8;
+    search_engine_t* graph = NULL;
+    ASSERT_OK(search_engine_create(&graph, h, &config));
+
+    node_id_t agent = test_agent(h, "agent");
+    node_id_t sessions[2], blocks[2];
+    for (int s = 0; s < 2; s++) {
+        node_id_t message;
+        ASSERT_OK(hierarchy_create_session(h, agent, s ? "rare" : "bulk", &sessions[s]));
+        ASSERT_OK(hierarchy_create_message(h, sessions[s], &message));
+        ASSERT_OK(hierarchy_create_block(h, message, &blocks[s]));
+    }
+
+    /* Every hundredth statement belongs to the rare session */
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < SELECTIVE_NODES; i++) {
+        node_id_t stmt;
+        ASSERT_OK(hierarchy_create_statement(h, blocks[i % 100 == 0], &stmt));
+        random_vector(vec, 3000 + (unsigned int)i);
+        ASSERT_OK(search_engine_index(scan, stmt, vec, NULL, 0, 1000));
+        ASSERT_OK(search_engine_index(graph, stmt, vec, NULL, 0, 1000));
+    }
+    search_engine_flush(scan);
+    search_engine_flush(graph);
+
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    filter.session = sessions[1];
+    search_query_t query = {
+        .embedding = vec,
+        .k = 10,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT,
+        .filter = &filter
+    };
+    search_match_t expected[10], results[10];
+    size_t expected_count = 0, count = 0, matched = 0;
+    for (int q = 0; q < 5; q++) {
+        random_vector(vec, 4000 + (unsigned int)q);
+        ASSERT_OK(search_engine_search(scan, &query, expected, &expected_count));
+        ASSERT_OK(search_engine_search(graph, &query, results, &count));
+        ASSERT_EQ(expected_count, 10);
+        ASSERT_EQ(count, 10);
+
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = 0; j < expected_count; j++) {
+                if (results[i].node_id == expected[j].node_id) matched++;
+            }
+        }
+    }
+
+    /* Recall against the exact scan over the same subset */
+    ASSERT_GE(matched, 48);
+
+    search_stats_t stats;
+    search_engine_get_stats(graph, &stats);
+    ASSERT_EQ(stats.filter_graph_searches, 5);
+    ASSERT_EQ(stats.filter_scans, 0);
+
+    search_engine_destroy(graph);
+    search_engine_destroy(scan);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test time segments: pruning by time filter and whole-segment retention */
+TEST(search_time_segments) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 200));
+
+    /* Hour-wide segments; a zero scan limit forces the segmented graph path */
+    const timestamp_ns_t hour = 3600ULL * 1000000000ULL;
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.segment_span_ns = hour;
+    config.filter_scan_limit = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block, stmt;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    /* Four statements in each of three consecutive hours */
+    const char* tokens[] = {"retention"};
+    float vec[EMBEDDING_DIM];
+    timestamp_ns_t base = 100 * hour;
+    for (int seg = 0; seg < 3; seg++) {
+        for (int j = 0; j < 4; j++) {
+            ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+            random_vector(vec, 1300 + (unsigned int)(seg * 4 + j));
+            ASSERT_OK(search_engine_index(engine, stmt, vec, tokens, 1,
+                                          base + seg * hour + (timestamp_ns_t)j));
+        }
+    }
+
+    /* The session lives in its level's single unsegmented index */
+    random_vector(vec, 1399);
+    ASSERT_OK(search_engine_index(engine, session, vec, NULL, 0, base));
+
+    search_engine_flush(engine);
+    search_stats_t stats;
+    search_engine_get_stats(engine, &stats);
+    ASSERT_EQ(stats.segments, 4);
+
+    /* A window inside the last hour only searches that segment */
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 88);
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    filter.after_time = base + 2 * hour;
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 20,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT,
+        .filter = &filter
+    };
+    search_match_t results[20];
+    size_t count = 0;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 4);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_GE(results[i].timestamp, base + 2 * hour);
+    }
+    search_engine_get_stats(engine, &stats);
+    ASSERT_EQ(stats.segments_pruned, 2);
+
+    /* Unfiltered search merges all segments */
+    query.filter = NULL;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 12);
+
+    /* Retention drops the first two hours whole; the session stays */
+    size_t dropped = 0;
+    ASSERT_OK(search_engine_drop_before(engine, base + 2 * hour + 5, &dropped));
+    ASSERT_EQ(dropped, 8);
+    ASSERT_EQ(search_engine_node_count(engine), 5);
+    search_engine_get_stats(engine, &stats);
+    ASSERT_EQ(stats.segments, 2);
+
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 4);
+
+    query.tokens = tokens;
+    query.token_count = 1;
+    query.embedding = NULL;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 4);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_GE(results[i].timestamp, base + 2 * hour);
+    }
+
+    /* Nothing older is left to drop */
+    ASSERT_OK(search_engine_drop_before(engine, base + 2 * hour, &dropped));
+    ASSERT_EQ(dropped, 0);
+
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Top hit of each stored vector is its own node */
+static void assert_self_hits(search_engine_t* engine, const node_id_t* ids,
+                             size_t count, unsigned int seed) {
+    float vec[EMBEDDING_DIM];
+    search_query_t query = {
+        .embedding = vec,
+        .k = 5,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t results[5];
+    size_t found = 0;
+    for (size_t i = 0; i < count; i += 7) {
+        random_vector(vec, seed + (unsigned int)i);
+        ASSERT_OK(search_engine_search(engine, &query, results, &found));
+        ASSERT_GT(found, 0);
+        ASSERT_EQ(results[0].node_id, ids[i]);
+    }
+}
+
+/* Test segment_limit bounds the segments a query searches as history grows */
+TEST(search_segment_limit) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 400));
+
+    /* Hour-wide spans, four segments per level; merges run on the merge thread */
+    const timestamp_ns_t hour = 3600ULL * 1000000000ULL;
+    const size_t hours = 40, per_hour = 5;
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.segment_span_ns = hour;
+    config.segment_limit = 4;
+    config.filter_scan_limit = 0;
+    config.result_cache_entries = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    node_id_t ids[200];
+    float vec[EMBEDDING_DIM];
+    timestamp_ns_t base = 100 * hour;
+    search_stats_t stats;
+    for (size_t hr = 0; hr < hours; hr++) {
+        for (size_t j = 0; j < per_hour; j++) {
+            size_t i = hr * per_hour + j;
+            ASSERT_OK(hierarchy_create_statement(h, block, &ids[i]));
+            random_vector(vec, 2000 + (unsigned int)i);
+            ASSERT_OK(hierarchy_set_embedding(h, ids[i], vec));
+            ASSERT_OK(search_engine_index(engine, ids[i], vec, NULL, 0,
+                                          base + hr * hour + (timestamp_ns_t)j));
+        }
+
+        /* Forty spans of history, never more than four segments to search */
+        search_engine_flush(engine);
+        search_engine_get_stats(engine, &stats);
+        ASSERT_LE(stats.segments, 4);
+    }
+    ASSERT_GE(stats.segment_merges, hours - 4);
+    ASSERT_EQ(search_engine_node_count(engine), hours * per_hour);
+    assert_self_hits(engine, ids, hours * per_hour, 2000);
+
+    /* Merged segments still prune by time, and every hit is in the window */
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 89);
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    filter.after_time = base + 38 * hour;
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 20,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT,
+        .filter = &filter
+    };
+    search_match_t results[20];
+    size_t count = 0;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 10);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_GE(results[i].timestamp, base + 38 * hour);
+    }
+    search_engine_get_stats(engine, &stats);
+    ASSERT_GT(stats.segments_pruned, 0);
+
+    /* Retention keeps a merged segment until all of it has expired */
+    size_t dropped = 0;
+    ASSERT_OK(search_engine_drop_before(engine, base + 20 * hour, &dropped));
+    ASSERT_GT(dropped, 0);
+    ASSERT_LE(dropped, 20 * per_hour);
+    ASSERT_EQ(dropped % per_hour, 0);
+    ASSERT_EQ(search_engine_node_count(engine), hours * per_hour - dropped);
+    size_t first_kept = dropped;
+    assert_self_hits(engine, ids + first_kept, hours * per_hour - first_kept,
+                     2000 + (unsigned int)first_kept);
+    search_engine_destroy(engine);
+
+    /*
+     * A rebuild plans the same bound up front; it also indexes the other
+     * levels' stored embeddings, one segment each. Without the merge
+     * thread, later merges run inline.
+     */
+    config.fresh_buffer_capacity = 0;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+    search_engine_get_stats(engine, &stats);
+    ASSERT_LE(stats.segments, 4 + 4);
+    ASSERT_EQ(stats.segment_merges, 0);
+    assert_self_hits(engine, ids, hours * per_hour, 2000);
+
+    /* New spans keep merging inline */
+    node_id_t stmt;
+    for (size_t hr = hours; hr < hours + 10; hr++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+        random_vector(vec, 2900 + (unsigned int)hr);
+        ASSERT_OK(search_engine_index(engine, stmt, vec, NULL, 0, base + hr * hour));
+    }
+    search_engine_get_stats(engine, &stats);
+    ASSERT_LE(stats.segments, 4 + 4);
+    ASSERT_GE(stats.segment_merges, 10);
+
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test the retention window drops old nodes and keeps them out after a rebuild */
+TEST(search_retention_rebuild) {
+    setup_dir();
+
+    const timestamp_ns_t day = 86400ULL * 1000000000ULL;
+    timestamp_ns_t now = timestamp_now_ns();
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.retention_ns = 3 * day;
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block, stmt;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    /* Three statements from ten days ago, two from today; the session is old too */
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < 5; i++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmt));
+        random_vector(vec, 1500 + (unsigned int)i);
+        ASSERT_OK(hierarchy_set_embedding(h, stmt, vec));
+        ASSERT_OK(search_engine_index(engine, stmt, vec, NULL, 0,
+                                      i < 3 ? now - 10 * day : now));
+    }
+    random_vector(vec, 1599);
+    ASSERT_OK(hierarchy_set_embedding(h, session, vec));
+    ASSERT_OK(search_engine_index(engine, session, vec, NULL, 0, now - 10 * day));
+    search_engine_flush(engine);
+    ASSERT_EQ(search_engine_node_count(engine), 6);
+
+    size_t dropped = 0;
+    ASSERT_OK(search_engine_expire(engine, now, &dropped));
+    ASSERT_EQ(dropped, 3);
+    ASSERT_EQ(search_engine_node_count(engine), 3);
+    search_engine_destroy(engine);
+
+    /* Storage still has every node; the rebuild indexes all but the expired ones */
+    ASSERT_EQ(hierarchy_count(h), 9);
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+    ASSERT_EQ(search_engine_node_count(engine), 6);
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 1500);
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 10,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t results[10];
+    size_t count = 0;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 2);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(results[i].timestamp, now);
+    }
+
+    ASSERT_OK(search_engine_expire(engine, now, &dropped));
+    ASSERT_EQ(dropped, 0);
+    search_engine_destroy(engine);
+
+    /* Without a window every node comes back */
+    config.retention_ns = 0;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+    ASSERT_EQ(search_engine_node_count(engine), 9);
+    ASSERT_OK(search_engine_expire(engine, now, &dropped));
+    ASSERT_EQ(dropped, 0);
+
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test fresh writes are searchable before and after the background merge */
+TEST(search_fresh_buffer) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, 100));
+
+    /* A tiny buffer, so some adds also overflow to the synchronous path */
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.fresh_buffer_capacity = 4;
+    config.result_cache_entries = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block, stmts[20];
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    float vecs[20][EMBEDDING_DIM];
+    timestamp_ns_t now = timestamp_now_ns();
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmts[i]));
+        random_vector(vecs[i], 1500 + (unsigned int)i);
+        ASSERT_OK(search_engine_index(engine, stmts[i], vecs[i], NULL, 0, now));
+    }
+
+    /* Every vector finds itself, wherever it currently lives */
+    search_query_t query = {
+        .k = 1,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t results[20];
+    size_t count = 0;
+    for (int i = 0; i < 20; i++) {
+        query.embedding = vecs[i];
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        ASSERT_EQ(count, 1);
+        ASSERT_EQ(results[0].node_id, stmts[i]);
+    }
+
+    /* Removing a node works whether or not it was merged yet */
+    ASSERT_OK(search_engine_remove(engine, stmts[19]));
+    query.embedding = vecs[19];
+    query.k = 20;
+    ASSERT_OK(search_engine_search(engine, &query, results, &count));
+    ASSERT_EQ(count, 19);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_NE(results[i].node_id, stmts[19]);
+    }
+
+    search_engine_flush(engine);
+    search_stats_t stats;
+    search_engine_get_stats(engine, &stats);
+    ASSERT_EQ(stats.fresh_vectors, 0);
+    ASSERT_EQ(stats.fresh_merged + stats.fresh_overflows, 20);
+
+    query.k = 1;
+    for (int i = 0; i < 19; i++) {
+        query.embedding = vecs[i];
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        ASSERT_EQ(results[0].node_id, stmts[i]);
+    }
+
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+#define CONCURRENT_NODES 3000
+
+typedef struct {
+    search_engine_t* engine;
+    node_id_t* stmts;
+    timestamp_ns_t base;
+    int failed;
+    int done;
+} indexer_t;
+
+/* Index every statement in time order, removing every tenth again */
+static void* indexer_main(void* arg) {
+    indexer_t* in = arg;
+    float vec[EMBEDDING_DIM];
+    for (int i = 0; i < CONCURRENT_NODES && !in->failed; i++) {
+        random_vector(vec, 2000 + (unsigned int)i);
+        if (search_engine_index(in->engine, in->stmts[i], vec, NULL, 0,
+                                in->base + (timestamp_ns_t)i) != MEM_OK ||
+            (i % 10 == 9 && search_engine_remove(in->engine, in->stmts[i]) != MEM_OK)) {
+            in->failed = 1;
+        }
+    }
+    __atomic_store_n(&in->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Test searches and retention run safely while another thread indexes */
+TEST(search_concurrent_index) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, CONCURRENT_NODES + 16));
+
+    /* Unit-wide segments, so the drop below has whole segments to retire */
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.segment_span_ns = 1000;
+    config.result_cache_entries = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    node_id_t* stmts = malloc(CONCURRENT_NODES * sizeof(node_id_t));
+    ASSERT_NOT_NULL(stmts);
+    for (int i = 0; i < CONCURRENT_NODES; i++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmts[i]));
+    }
+
+    /* The time index and indexed flags grow under readers */
+    indexer_t in = { .engine = engine, .stmts = stmts, .base = 10000 };
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, indexer_main, &in), 0);
+
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 99);
+    search_filter_t filter = SEARCH_FILTER_NONE;
+    filter.after_time = in.base + 500;
+    filter.before_time = in.base + 1500;
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 10,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT,
+        .filter = &filter
+    };
+    search_match_t results[10];
+    size_t count = 0, dropped = 0, rounds = 0;
+    while (!__atomic_load_n(&in.done, __ATOMIC_ACQUIRE)) {
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_GE(results[i].timestamp, in.base + 500);
+            ASSERT_TRUE(results[i].timestamp < in.base + 1500);
+        }
+        /* Nothing predates base, but the drop still walks the time index */
+        if (++rounds % 16 == 0) {
+            ASSERT_OK(search_engine_drop_before(engine, in.base, &dropped));
+            ASSERT_EQ(dropped, 0);
+        }
+    }
+    pthread_join(thread, NULL);
+    ASSERT_FALSE(in.failed);
+    ASSERT_EQ(search_engine_node_count(engine), CONCURRENT_NODES - CONCURRENT_NODES / 10);
+
+    /* Retention over the same range drops the first 1000 ticks' survivors */
+    ASSERT_OK(search_engine_drop_before(engine, in.base + 1000, &dropped));
+    ASSERT_EQ(dropped, 900);
+    ASSERT_EQ(search_engine_node_count(engine),
+              CONCURRENT_NODES - CONCURRENT_NODES / 10 - 900);
+
+    free(stmts);
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test segment merges run safely, and stay invisible, under searches and removals */
+TEST(search_concurrent_segment_merges) {
+    setup_dir();
+
+    hierarchy_t* h = NULL;
+    ASSERT_OK(hierarchy_create(&h, TEST_DIR, CONCURRENT_NODES + 16));
+
+    /* Thirty spans against a limit of four keep the merge thread busy */
+    search_config_t config = SEARCH_CONFIG_DEFAULT;
+    config.segment_span_ns = 100;
+    config.segment_limit = 4;
+    config.result_cache_entries = 0;
+    search_engine_t* engine = NULL;
+    ASSERT_OK(search_engine_create(&engine, h, &config));
+
+    node_id_t session, message, block;
+    ASSERT_OK(hierarchy_create_session(h, test_agent(h, "agent"), "session", &session));
+    ASSERT_OK(hierarchy_create_message(h, session, &message));
+    ASSERT_OK(hierarchy_create_block(h, message, &block));
+
+    node_id_t* stmts = malloc(CONCURRENT_NODES * sizeof(node_id_t));
+    ASSERT_NOT_NULL(stmts);
+    for (int i = 0; i < CONCURRENT_NODES; i++) {
+        ASSERT_OK(hierarchy_create_statement(h, block, &stmts[i]));
+    }
+
+    indexer_t in = { .engine = engine, .stmts = stmts, .base = 10000 };
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, indexer_main, &in), 0);
+
+    /* A vector copied into a merge target must not show up twice */
+    float query_vec[EMBEDDING_DIM];
+    random_vector(query_vec, 2005);
+    search_query_t query = {
+        .embedding = query_vec,
+        .k = 10,
+        .min_level = LEVEL_STATEMENT,
+        .max_level = LEVEL_STATEMENT
+    };
+    search_match_t results[10];
+    size_t count = 0;
+    while (!__atomic_load_n(&in.done, __ATOMIC_ACQUIRE)) {
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = 0; j < i; j++) {
+                ASSERT_NE(results[i].node_id, results[j].node_id);
+            }
+        }
+    }
+    pthread_join(thread, NULL);
+    ASSERT_FALSE(in.failed);
+
+    search_engine_flush(engine);
+    search_stats_t stats;
+    search_engine_get_stats(engine, &stats);
+    ASSERT_LE(stats.segments, 4);
+    ASSERT_GE(stats.segment_merges, 26);
+    ASSERT_EQ(search_engine_node_count(engine), CONCURRENT_NODES - CONCURRENT_NODES / 10);
+
+    /* Survivors are found, removed statements are not */
+    float vec[EMBEDDING_DIM];
+    query.embedding = vec;
+    query.k = 1;
+    for (int i = 3; i < CONCURRENT_NODES; i += 97) {
+        random_vector(vec, 2000 + (unsigned int)i);
+        ASSERT_OK(search_engine_search(engine, &query, results, &count));
+        ASSERT_EQ(count, 1);
+        if (i % 10 == 9) {
+            ASSERT_NE(results[0].node_id, stmts[i]);
+        } else {
+            ASSERT_EQ(results[0].node_id, stmts[i]);
+        }
+    }
+
+    free(stmts);
+    search_engine_destroy(engine);
+    hierarchy_close(h);
+    cleanup_dir(TEST_DIR);
+}
+
 TEST_MAIN()
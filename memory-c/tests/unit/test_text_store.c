@@ -0,0 +1,309 @@
+/*
+ * Memory Service - Text Storage Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/storage/text_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TEST_DIR "/tmp/test_text_store"
+
+static void cleanup_dir(const char* dir) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    system(cmd);
+}
+
+/* Read text into a buffer reused by every call, or NULL if none */
+static const char* read_text(const text_store_t* store, node_id_t id, size_t* len) {
+    static char buf[8192];
+    return text_store_get(store, id, buf, sizeof(buf), len) ? buf : NULL;
+}
+
+/* Test put and get */
+TEST(text_store_put_get) {
+    cleanup_dir(TEST_DIR);
+    mkdir(TEST_DIR, 0755);
+
+    text_store_t* store = NULL;
+    ASSERT_OK(text_store_create(&store, TEST_DIR, 0));
+
+    size_t len = 99;
+    ASSERT_NULL(read_text(store, 0, &len));
+    ASSERT_EQ(len, 0);
+
+    ASSERT_OK(text_store_put(store, 0, "hello", 5));
+    ASSERT_OK(text_store_put(store, 3, "world!", 6));
+
+    const char* t = read_text(store, 0, &len);
+    ASSERT_NOT_NULL(t);
+    ASSERT_EQ(len, 5);
+    ASSERT_EQ(strcmp(t, "hello"), 0);
+
+    t = read_text(store, 3, &len);
+    ASSERT_EQ(len, 6);
+    ASSERT_EQ(strcmp(t, "world!"), 0);
+
+    /* Copies truncate to the buffer but report the full length */
+    char small[4];
+    ASSERT_TRUE(text_store_get(store, 3, small, sizeof(small), &len));
+    ASSERT_EQ(len, 6);
+    ASSERT_STR_EQ(small, "wor");
+    ASSERT_TRUE(text_store_get(store, 3, NULL, 0, &len));
+    ASSERT_EQ(len, 6);
+
+    /* Gaps have no text */
+    ASSERT_NULL(read_text(store, 2, &len));
+    ASSERT_NULL(read_text(store, 1000, NULL));
+
+    /* Empty text is stored, distinct from none */
+    ASSERT_OK(text_store_put(store, 1, "", 0));
+    t = read_text(store, 1, &len);
+    ASSERT_NOT_NULL(t);
+    ASSERT_EQ(len, 0);
+
+    /* Rewrites append a new copy */
+    ASSERT_OK(text_store_put(store, 0, "replaced", 8));
+    ASSERT_EQ(strcmp(read_text(store, 0, NULL), "replaced"), 0);
+    ASSERT_EQ(text_store_bytes(store), 6 + 7 + 1 + 9);
+
+    ASSERT_ERR(text_store_put(store, NODE_ID_INVALID, "x", 1), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(text_store_put(NULL, 0, "x", 1), MEM_ERR_INVALID_ARG);
+
+    text_store_close(store);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test segment roll-over, oversized text and index growth */
+TEST(text_store_segments) {
+    cleanup_dir(TEST_DIR);
+    mkdir(TEST_DIR, 0755);
+
+    text_store_t* store = NULL;
+    ASSERT_OK(text_store_create(&store, TEST_DIR, 64));
+
+    char buf[32];
+    for (node_id_t i = 0; i < 3000; i++) {
+        int n = snprintf(buf, sizeof(buf), "text-%u", i);
+        ASSERT_OK(text_store_put(store, i, buf, (size_t)n));
+    }
+    ASSERT_GT(store->segment_count, 1);
+    ASSERT_EQ(strcmp(read_text(store, 0, NULL), "text-0"), 0);
+
+    /* Text larger than a segment gets a segment of its own */
+    char big[300];
+    memset(big, 'b', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    ASSERT_OK(text_store_put(store, 5000, big, sizeof(big) - 1));
+    ASSERT_OK(text_store_put(store, 5001, "after", 5));
+
+    size_t len = 0;
+    ASSERT_EQ(strcmp(read_text(store, 5000, &len), big), 0);
+    ASSERT_EQ(len, sizeof(big) - 1);
+    ASSERT_EQ(strcmp(read_text(store, 2999, NULL), "text-2999"), 0);
+    ASSERT_EQ(strcmp(read_text(store, 5001, NULL), "after"), 0);
+
+    text_store_close(store);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Build a log-like line for node i; some lines span several blocks */
+static size_t make_line(char* buf, size_t cap, node_id_t i) {
+    int n = snprintf(buf, cap, "2026-01-01T00:00:%02u INFO worker-%u: request %u completed in %u ms\n",
+                     i % 60, i % 8, i, (i * 7) % 500);
+    if (i % 97 == 0) {
+        /* A long tool output crossing block boundaries */
+        while ((size_t)n + 64 < cap && n < 3000) {
+            n += snprintf(buf + n, cap - (size_t)n, "    at frame %u of request %u\n", n, i);
+        }
+    }
+    return (size_t)n;
+}
+
+/* Test cold segments are block-compressed and read back through the cache */
+TEST(text_store_compression) {
+    cleanup_dir(TEST_DIR);
+    mkdir(TEST_DIR, 0755);
+
+    text_compression_t cfg = TEXT_COMPRESSION_DEFAULT;
+    cfg.hot_segments = 2;
+    cfg.block_size = 1024;
+    cfg.cache_entries = 4;
+
+    text_store_t* store = NULL;
+    ASSERT_OK(text_store_create(&store, TEST_DIR, 16 * 1024));
+    ASSERT_OK(text_store_set_compression(store, &cfg));
+
+    char buf[4096], expect[4096];
+    for (node_id_t i = 0; i < 3000; i++) {
+        size_t n = make_line(buf, sizeof(buf), i);
+        ASSERT_OK(text_store_put(store, i, buf, n));
+    }
+
+    /* Segments are packed in the background */
+    text_store_flush(store);
+    text_store_stats_t stats;
+    text_store_get_stats(store, &stats);
+    ASSERT_EQ(stats.raw_segments, 2);
+    ASSERT_GT(stats.packed_segments, 4);
+    ASSERT_LE(stats.packed_bytes * 3, stats.packed_raw_bytes);
+    ASSERT_EQ(access(TEST_DIR "/dict.bin", F_OK), 0);
+    ASSERT_NE(access(TEST_DIR "/segment_0.log", F_OK), 0);
+
+    /* Every node reads back intact, cold or hot */
+    for (node_id_t i = 0; i < 3000; i++) {
+        size_t n = make_line(expect, sizeof(expect), i);
+        size_t len = 0;
+        const char* t = read_text(store, i, &len);
+        ASSERT_NOT_NULL(t);
+        ASSERT_EQ(len, n);
+        ASSERT_EQ(memcmp(t, expect, n), 0);
+        ASSERT_EQ(t[n], '\0');
+    }
+
+    /* Repeated reads of cold text are served from the cache */
+    text_store_get_stats(store, &stats);
+    uint64_t hits = stats.cache_hits;
+    ASSERT_NOT_NULL(read_text(store, 1, NULL));
+    ASSERT_NOT_NULL(read_text(store, 1, NULL));
+    text_store_get_stats(store, &stats);
+    ASSERT_GE(stats.cache_hits, hits + 1);
+
+    text_store_close(store);
+
+    /* Packed segments and the dictionary are picked up on open */
+    ASSERT_OK(text_store_open(&store, TEST_DIR));
+    for (node_id_t i = 0; i < 3000; i += 7) {
+        size_t n = make_line(expect, sizeof(expect), i);
+        const char* t = read_text(store, i, NULL);
+        ASSERT_NOT_NULL(t);
+        ASSERT_EQ(memcmp(t, expect, n), 0);
+    }
+    text_store_close(store);
+
+    cleanup_dir(TEST_DIR);
+}
+
+typedef struct {
+    const text_store_t* store;
+    node_id_t first;
+    int failed;
+} reader_t;
+
+/* Read every line back, starting at a different node per thread */
+static void* reader_main(void* arg) {
+    reader_t* r = arg;
+    char buf[4096], expect[4096];
+    for (node_id_t k = 0; k < 3000 && !r->failed; k++) {
+        node_id_t i = (r->first + k * 13) % 3000;
+        size_t n = make_line(expect, sizeof(expect), i);
+        size_t len = 0;
+        if (!text_store_get(r->store, i, buf, sizeof(buf), &len) || len != n ||
+            memcmp(buf, expect, n) != 0) {
+            r->failed = 1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Test concurrent reads while they evict each other's cached blocks and
+ * the packer swaps the segments they read from raw to packed
+ */
+TEST(text_store_concurrent_reads) {
+    cleanup_dir(TEST_DIR);
+    mkdir(TEST_DIR, 0755);
+
+    text_compression_t cfg = TEXT_COMPRESSION_DEFAULT;
+    cfg.block_size = 1024;
+    cfg.cache_entries = 2;
+
+    text_store_t* store = NULL;
+    ASSERT_OK(text_store_create(&store, TEST_DIR, 16 * 1024));
+    ASSERT_OK(text_store_set_compression(store, &cfg));
+
+    char buf[4096];
+    for (node_id_t i = 0; i < 3000; i++) {
+        size_t n = make_line(buf, sizeof(buf), i);
+        ASSERT_OK(text_store_put(store, i, buf, n));
+    }
+
+    reader_t readers[4];
+    pthread_t threads[4];
+    for (int t = 0; t < 4; t++) {
+        readers[t] = (reader_t){ .store = store, .first = (node_id_t)t * 701 };
+        ASSERT_EQ(pthread_create(&threads[t], NULL, reader_main, &readers[t]), 0);
+    }
+
+    /* Keep appending, so segments the readers use go cold under them */
+    for (node_id_t i = 3000; i < 6000; i++) {
+        size_t n = make_line(buf, sizeof(buf), i);
+        ASSERT_OK(text_store_put(store, i, buf, n));
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+        ASSERT_FALSE(readers[t].failed);
+    }
+
+    text_store_flush(store);
+    text_store_stats_t stats;
+    text_store_get_stats(store, &stats);
+    ASSERT_EQ(stats.raw_segments, 2);
+    for (node_id_t i = 0; i < 6000; i += 11) {
+        size_t n = make_line(buf, sizeof(buf), i);
+        size_t len = 0;
+        const char* t = read_text(store, i, &len);
+        ASSERT_NOT_NULL(t);
+        ASSERT_EQ(len, n);
+        ASSERT_EQ(memcmp(t, buf, n), 0);
+    }
+
+    text_store_close(store);
+    cleanup_dir(TEST_DIR);
+}
+
+/* Test text survives close and reopen */
+TEST(text_store_persistence) {
+    cleanup_dir(TEST_DIR);
+    mkdir(TEST_DIR, 0755);
+
+    {
+        text_store_t* store = NULL;
+        ASSERT_OK(text_store_create(&store, TEST_DIR, 32));
+        ASSERT_OK(text_store_put(store, 0, "first message", 13));
+        ASSERT_OK(text_store_put(store, 1, "second message", 14));
+        ASSERT_OK(text_store_put(store, 0, "first, edited", 13));
+        ASSERT_OK(text_store_sync(store));
+        text_store_close(store);
+    }
+    {
+        text_store_t* store = NULL;
+        ASSERT_OK(text_store_open(&store, TEST_DIR));
+
+        size_t len = 0;
+        ASSERT_EQ(strcmp(read_text(store, 0, &len), "first, edited"), 0);
+        ASSERT_EQ(len, 13);
+        ASSERT_EQ(strcmp(read_text(store, 1, NULL), "second message"), 0);
+
+        /* Appends continue after the persisted tail */
+        ASSERT_OK(text_store_put(store, 2, "third", 5));
+        ASSERT_EQ(strcmp(read_text(store, 1, NULL), "second message"), 0);
+        ASSERT_EQ(strcmp(read_text(store, 2, NULL), "third"), 0);
+        text_store_close(store);
+    }
+
+    /* Missing store and missing segment are reported */
+    text_store_t* store = NULL;
+    ASSERT_ERR(text_store_open(&store, "/tmp/test_text_store_missing"), MEM_ERR_OPEN);
+    unlink(TEST_DIR "/segment_0.log");
+    ASSERT_ERR(text_store_open(&store, TEST_DIR), MEM_ERR_INDEX_CORRUPT);
+
+    cleanup_dir(TEST_DIR);
+}
+
+TEST_MAIN()
@@ -0,0 +1,107 @@
+/*
+ * Memory Service - Thread Pool Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/util/threadpool.h"
+
+#include <stdatomic.h>
+#include <unistd.h>
+
+static void increment_task(void* arg) {
+    atomic_fetch_add((_Atomic int*)arg, 1);
+}
+
+/* Blocks a worker until released so the queue can be filled */
+typedef struct {
+    _Atomic int started;
+    _Atomic int release;
+} gate_t;
+
+static void gate_task(void* arg) {
+    gate_t* gate = arg;
+    atomic_store(&gate->started, 1);
+    while (!atomic_load(&gate->release)) {
+        usleep(100);
+    }
+}
+
+/* Test creation with explicit and automatic worker counts */
+TEST(threadpool_create_destroy) {
+    thread_pool_t* pool = NULL;
+    ASSERT_OK(thread_pool_create(&pool, 3, 16));
+    ASSERT_NOT_NULL(pool);
+    ASSERT_EQ(thread_pool_size(pool), 3);
+    thread_pool_destroy(pool);
+
+    pool = NULL;
+    ASSERT_OK(thread_pool_create(&pool, 0, 0));
+    ASSERT_GE(thread_pool_size(pool), 1);
+    thread_pool_destroy(pool);
+
+    ASSERT_ERR(thread_pool_create(NULL, 1, 1), MEM_ERR_INVALID_ARG);
+    thread_pool_destroy(NULL);
+}
+
+/* Test that a group waits for all of its tasks */
+TEST(threadpool_group_wait) {
+    thread_pool_t* pool = NULL;
+    ASSERT_OK(thread_pool_create(&pool, 4, 64));
+
+    task_group_t group;
+    ASSERT_OK(task_group_init(&group));
+
+    _Atomic int counter = 0;
+    for (int i = 0; i < 50; i++) {
+        ASSERT_OK(thread_pool_try_submit(pool, &group, increment_task, &counter));
+    }
+    task_group_wait(&group);
+    ASSERT_EQ(atomic_load(&counter), 50);
+
+    task_group_destroy(&group);
+    thread_pool_destroy(pool);
+}
+
+/* Test that a full queue rejects instead of blocking */
+TEST(threadpool_queue_full) {
+    thread_pool_t* pool = NULL;
+    ASSERT_OK(thread_pool_create(&pool, 1, 2));
+
+    task_group_t group;
+    ASSERT_OK(task_group_init(&group));
+
+    /* Occupy the only worker, then fill the queue */
+    gate_t gate = {0};
+    ASSERT_OK(thread_pool_try_submit(pool, &group, gate_task, &gate));
+    while (!atomic_load(&gate.started)) {
+        usleep(100);
+    }
+
+    _Atomic int counter = 0;
+    ASSERT_OK(thread_pool_try_submit(pool, &group, increment_task, &counter));
+    ASSERT_OK(thread_pool_try_submit(pool, &group, increment_task, &counter));
+    ASSERT_ERR(thread_pool_try_submit(pool, &group, increment_task, &counter),
+               MEM_ERR_FULL);
+
+    atomic_store(&gate.release, 1);
+    task_group_wait(&group);
+    ASSERT_EQ(atomic_load(&counter), 2);
+
+    task_group_destroy(&group);
+    thread_pool_destroy(pool);
+}
+
+/* Test that destroy drains queued tasks */
+TEST(threadpool_destroy_drains) {
+    thread_pool_t* pool = NULL;
+    ASSERT_OK(thread_pool_create(&pool, 2, 32));
+
+    _Atomic int counter = 0;
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(thread_pool_try_submit(pool, NULL, increment_task, &counter));
+    }
+    thread_pool_destroy(pool);
+    ASSERT_EQ(atomic_load(&counter), 20);
+}
+
+TEST_MAIN()
@@ -119,6 +119,35 @@ TEST(tokenizer_encode_truncation) {
     tokenizer_destroy(tok);
 }
 
+/*
+ * TEST: Count matches encode and is not truncated
+ */
+TEST(tokenizer_count_tokens) {
+    tokenizer_t* tok = NULL;
+    ASSERT_OK(tokenizer_create_default(&tok));
+
+    const char* text = "the quick brown fox, jumped over the lazy dog!";
+    tokenizer_output_t output;
+    ASSERT_OK(tokenizer_encode(tok, text, strlen(text), 128, &output));
+
+    /* Same tokens as encode, minus [CLS] and [SEP] */
+    ASSERT_EQ(tokenizer_count(tok, text, strlen(text)), output.length - 2);
+    ASSERT_EQ(tokenizer_count(tok, "", 0), 0);
+    tokenizer_output_free(&output);
+
+    /* 300 words exceed any encode window but are all counted */
+    char long_text[300 * 4 + 1];
+    size_t len = 0;
+    for (int i = 0; i < 300; i++) {
+        memcpy(long_text + len, "the ", 4);
+        len += 4;
+    }
+    long_text[len] = '\0';
+    ASSERT_EQ(tokenizer_count(tok, long_text, len), 300);
+
+    tokenizer_destroy(tok);
+}
+
 /*
  * TEST: Encode batch
  */
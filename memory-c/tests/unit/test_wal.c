@@ -4,16 +4,37 @@
 
 #include "../test_framework.h"
 #include "../../src/storage/wal.h"
+#include "../../src/util/checksum.h"
 #include "../../include/error.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+
+/* Remove a WAL's segment files */
+static void remove_wal(const char* path) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -f %s %s.*", path, path);
+    system(cmd);
+}
+
+/* Number of segment files present for path */
+static int count_segments(const char* path) {
+    char name[256];
+    int n = 0;
+    for (unsigned slot = 0; slot < 64; slot++) {
+        snprintf(name, sizeof(name), WAL_SEGMENT_NAME_FMT, path, slot);
+        if (access(name, F_OK) == 0) n++;
+    }
+    return n;
+}
 
 /* Test WAL creation */
 TEST(wal_create_basic) {
     const char* path = "/tmp/test_wal_create.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     mem_error_t err = wal_create(&wal, path, 1024 * 1024);
@@ -23,12 +44,13 @@ TEST(wal_create_basic) {
     ASSERT_EQ(wal_size(wal), 0);
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Test WAL append and sequence */
 TEST(wal_append_basic) {
     const char* path = "/tmp/test_wal_append.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
@@ -51,7 +73,7 @@ TEST(wal_append_basic) {
     ASSERT_EQ(wal_sequence(wal), 3);
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Replay callback for testing */
@@ -71,6 +93,7 @@ static mem_error_t test_replay_callback(wal_op_type_t op, const void* data,
 /* Test WAL replay */
 TEST(wal_replay_basic) {
     const char* path = "/tmp/test_wal_replay.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
@@ -99,12 +122,13 @@ TEST(wal_replay_basic) {
     ASSERT_EQ(wal_sequence(wal), 4);
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Test WAL checkpoint */
 TEST(wal_checkpoint_basic) {
     const char* path = "/tmp/test_wal_checkpoint.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
@@ -133,12 +157,13 @@ TEST(wal_checkpoint_basic) {
     /* This test just verifies checkpoint marker is written */
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Test WAL truncate */
 TEST(wal_truncate_basic) {
     const char* path = "/tmp/test_wal_truncate.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
@@ -160,12 +185,13 @@ TEST(wal_truncate_basic) {
     ASSERT_GT(wal_size(wal), 0);
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Test WAL needs checkpoint */
 TEST(wal_needs_checkpoint) {
     const char* path = "/tmp/test_wal_needs_cp.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     /* Small max size */
@@ -182,12 +208,13 @@ TEST(wal_needs_checkpoint) {
     ASSERT(wal_needs_checkpoint(wal));
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
 }
 
 /* Test CRC validation */
 TEST(wal_crc_validation) {
     const char* path = "/tmp/test_wal_crc.log";
+    remove_wal(path);
     wal_t* wal = NULL;
 
     ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
@@ -205,7 +232,308 @@ TEST(wal_crc_validation) {
     ASSERT_EQ(g_replay_count, 1);
 
     wal_close(wal);
-    unlink(path);
+    remove_wal(path);
+}
+
+/* Replay callback summing node ids of insert records */
+static mem_error_t sum_nodes_callback(wal_op_type_t op, const void* data,
+                                      size_t len, void* user_data) {
+    if (op == WAL_OP_NODE_INSERT && len == sizeof(wal_node_data_t)) {
+        *(uint64_t*)user_data += ((const wal_node_data_t*)data)->node_id;
+    }
+    g_replay_count++;
+    return MEM_OK;
+}
+
+/* Test batch append writes every record with consecutive sequences */
+TEST(wal_append_batch) {
+    const char* path = "/tmp/test_wal_batch.log";
+    remove_wal(path);
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
+
+    /* More records than one writev can take */
+    enum { N = 3000 };
+    wal_node_data_t* nodes = calloc(N, sizeof(wal_node_data_t));
+    wal_record_t* records = calloc(N, sizeof(wal_record_t));
+    ASSERT_NOT_NULL(nodes);
+    ASSERT_NOT_NULL(records);
+
+    uint64_t expect = 0;
+    for (int i = 0; i < N; i++) {
+        nodes[i].node_id = (node_id_t)i;
+        expect += (uint64_t)i;
+        records[i] = (wal_record_t){ WAL_OP_NODE_INSERT, &nodes[i], sizeof(nodes[i]) };
+    }
+    records[7] = (wal_record_t){ WAL_OP_COMMIT, NULL, 0 };
+    expect -= 7;
+
+    ASSERT_OK(wal_append_batch(wal, records, N));
+    ASSERT_EQ(wal_sequence(wal), N + 1);
+    ASSERT_EQ(wal_size(wal), N * WAL_HEADER_SIZE + (N - 1) * sizeof(wal_node_data_t));
+    ASSERT_OK(wal_append_batch(wal, records, 0));
+    wal_close(wal);
+
+    uint64_t sum = 0;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, N);
+    ASSERT_EQ(sum, expect);
+    ASSERT_EQ(wal_sequence(wal), N + 1);
+
+    ASSERT_ERR(wal_append_batch(NULL, records, 1), MEM_ERR_INVALID_ARG);
+    wal_close(wal);
+    free(records);
+    free(nodes);
+    remove_wal(path);
+}
+
+/* Test records roll over into new segments and truncated ones are reused */
+TEST(wal_segments_roll) {
+    const char* path = "/tmp/test_wal_segments.log";
+    remove_wal(path);
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
+
+    wal_config_t cfg = WAL_CONFIG_DEFAULT;
+    cfg.segment_size = 16 * 1024;
+    cfg.spare_segments = 1;
+    ASSERT_OK(wal_set_config(wal, &cfg));
+
+    uint64_t expect = 0;
+    wal_node_data_t node = {0};
+    for (node_id_t i = 0; i < 500; i++) {
+        node.node_id = i;
+        expect += i;
+        ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &node, sizeof(node)));
+    }
+    ASSERT_GT(wal->segment_count, 4);
+    ASSERT_EQ(wal_size(wal), 500 * (WAL_HEADER_SIZE + sizeof(node)));
+
+    /* A segment never grows past its preallocated size */
+    char name[256];
+    snprintf(name, sizeof(name), WAL_SEGMENT_NAME_FMT, path, wal->segments[0]);
+    struct stat st;
+    ASSERT_EQ(stat(name, &st), 0);
+    ASSERT_EQ(st.st_size, 16 * 1024);
+    wal_close(wal);
+
+    uint64_t sum = 0;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, 500);
+    ASSERT_EQ(sum, expect);
+    ASSERT_EQ(wal_sequence(wal), 501);
+    ASSERT_OK(wal_set_config(wal, &cfg));
+
+    /* Truncate keeps the current segment and one spare */
+    ASSERT_OK(wal_truncate(wal));
+    ASSERT_EQ(wal->segment_count, 1);
+    ASSERT_EQ(wal->spare_count, 1);
+    ASSERT_EQ(count_segments(path), 2);
+
+    /* Filling the current segment reuses the spare instead of a new file */
+    for (node_id_t i = 0; i < 100; i++) {
+        node.node_id = 1;
+        ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &node, sizeof(node)));
+    }
+    ASSERT_EQ(wal->segment_count, 2);
+    ASSERT_EQ(count_segments(path), 2);
+    wal_close(wal);
+
+    /* Only records after the truncate come back; stale ones are skipped */
+    sum = 0;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, 100);
+    ASSERT_EQ(sum, 100);
+    ASSERT_EQ(wal_sequence(wal), 601);
+    wal_close(wal);
+
+    remove_wal(path);
+}
+
+/* Append a mix of record sizes, then check a reopen replays them all */
+static void check_io_mode(const char* path, wal_io_mode_t mode) {
+    remove_wal(path);
+    wal_config_t cfg = WAL_CONFIG_DEFAULT;
+    cfg.segment_size = 64 * 1024;
+    cfg.io_mode = mode;
+
+    char text[3000];
+    memset(text, 't', sizeof(text));
+    uint64_t expect = 0;
+    int records = 0;
+
+    for (int round = 0; round < 2; round++) {
+        wal_t* wal = NULL;
+        ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
+        ASSERT_OK(wal_set_config(wal, &cfg));
+
+        /* Reopening continues after a tail that is not block-aligned */
+        for (node_id_t i = 0; i < 60; i++) {
+            wal_node_data_t node = { .node_id = i };
+            expect += i;
+            ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &node, sizeof(node)));
+            ASSERT_OK(wal_append(wal, WAL_OP_TEXT_SET, text, (i * 37) % sizeof(text)));
+            records += 2;
+        }
+        wal_close(wal);
+    }
+
+    uint64_t sum = 0;
+    g_replay_count = 0;
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, records);
+    ASSERT_EQ(sum, expect);
+    wal_close(wal);
+
+    remove_wal(path);
+}
+
+/* Test O_DSYNC and O_DIRECT appends read back like buffered ones */
+TEST(wal_io_modes) {
+    check_io_mode("/tmp/test_wal_dsync.log", WAL_IO_DSYNC);
+    check_io_mode("/tmp/test_wal_direct.log", WAL_IO_DIRECT);
+}
+
+/* Test a damaged record ends replay and later appends skip past it */
+TEST(wal_damaged_record) {
+    const char* path = "/tmp/test_wal_damaged.log";
+    remove_wal(path);
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
+
+    wal_node_data_t node = { .node_id = 1 };
+    for (int i = 0; i < 3; i++) {
+        ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &node, sizeof(node)));
+    }
+    uint32_t slot = wal->segments[0];
+    size_t end = WAL_SEGMENT_HEADER_SIZE + wal_size(wal);
+    wal_close(wal);
+
+    /* Flip a byte in the last record's payload */
+    char name[256];
+    snprintf(name, sizeof(name), WAL_SEGMENT_NAME_FMT, path, slot);
+    int fd = open(name, O_RDWR);
+    ASSERT_GE(fd, 0);
+    char byte = 0x5a;
+    ASSERT_EQ(pwrite(fd, &byte, 1, (off_t)end - 5), 1);
+    close(fd);
+
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, test_replay_callback, NULL));
+    ASSERT_EQ(g_replay_count, 2);
+    ASSERT_EQ(wal_sequence(wal), 3);
+
+    /* The next record goes to a new segment, not over the damage */
+    ASSERT_OK(wal_append(wal, WAL_OP_NODE_UPDATE, &node, sizeof(node)));
+    ASSERT_EQ(wal->segment_count, 2);
+    wal_close(wal);
+
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, test_replay_callback, NULL));
+    ASSERT_EQ(g_replay_count, 3);
+    ASSERT_EQ(g_last_op, WAL_OP_NODE_UPDATE);
+    ASSERT_EQ(wal_sequence(wal), 4);
+    wal_close(wal);
+
+    remove_wal(path);
+}
+
+/* Test a single-file log from older versions is imported and removed */
+TEST(wal_legacy_import) {
+    const char* path = "/tmp/test_wal_legacy.log";
+    remove_wal(path);
+
+    FILE* f = fopen(path, "wb");
+    ASSERT_NOT_NULL(f);
+    for (uint64_t seq = 1; seq <= 4; seq++) {
+        wal_entry_header_t header = {
+            .magic = WAL_MAGIC,
+            .sequence = seq,
+            .op_type = seq == 2 ? WAL_OP_CHECKPOINT : WAL_OP_COMMIT
+        };
+        ASSERT_EQ(fwrite(&header, sizeof(header), 1, f), 1);
+    }
+    fclose(f);
+
+    wal_t* wal = NULL;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_NE(access(path, F_OK), 0);
+    ASSERT_OK(wal_replay(wal, test_replay_callback, NULL));
+    ASSERT_EQ(g_replay_count, 2);
+    ASSERT_EQ(g_last_op, WAL_OP_COMMIT);
+    wal_close(wal);
+
+    remove_wal(path);
+}
+
+/* Test a version 1 segment (IEEE CRC32) replays and is not appended to */
+TEST(wal_crc32_segment_compat) {
+    const char* path = "/tmp/test_wal_v1.log";
+    remove_wal(path);
+
+    char name[256];
+    snprintf(name, sizeof(name), WAL_SEGMENT_NAME_FMT, path, 0u);
+    int fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 4 * WAL_SEGMENT_HEADER_SIZE), 0);
+
+    wal_segment_header_t seg = {
+        .magic = WAL_SEGMENT_MAGIC,
+        .version = WAL_SEGMENT_VERSION_CRC32,
+        .start_seq = 1
+    };
+    ASSERT_EQ(pwrite(fd, &seg, sizeof(seg), 0), sizeof(seg));
+
+    off_t offset = WAL_SEGMENT_HEADER_SIZE;
+    for (uint64_t seq = 1; seq <= 3; seq++) {
+        wal_node_data_t node = { .node_id = (node_id_t)seq };
+        wal_entry_header_t header = {
+            .magic = WAL_MAGIC,
+            .crc32 = checksum_crc32_ieee(&node, sizeof(node)),
+            .sequence = seq,
+            .op_type = WAL_OP_NODE_INSERT,
+            .data_len = sizeof(node)
+        };
+        ASSERT_EQ(pwrite(fd, &header, sizeof(header), offset), sizeof(header));
+        ASSERT_EQ(pwrite(fd, &node, sizeof(node), offset + (off_t)sizeof(header)), sizeof(node));
+        offset += (off_t)(sizeof(header) + sizeof(node));
+    }
+    close(fd);
+
+    wal_t* wal = NULL;
+    uint64_t sum = 0;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, 3);
+    ASSERT_EQ(sum, 6);
+
+    /* New records carry CRC32C, so they start a version 2 segment */
+    wal_node_data_t node = { .node_id = 4 };
+    ASSERT_OK(wal_append(wal, WAL_OP_NODE_INSERT, &node, sizeof(node)));
+    ASSERT_EQ(wal->segment_count, 2);
+    wal_close(wal);
+
+    sum = 0;
+    g_replay_count = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, sum_nodes_callback, &sum));
+    ASSERT_EQ(g_replay_count, 4);
+    ASSERT_EQ(sum, 10);
+    wal_close(wal);
+
+    remove_wal(path);
 }
 
 /* Test NULL and invalid arguments */
@@ -222,6 +550,11 @@ TEST(wal_invalid_args) {
     ASSERT_EQ(wal_truncate(NULL), MEM_ERR_INVALID_ARG);
     ASSERT_EQ(wal_replay(NULL, test_replay_callback, NULL), MEM_ERR_INVALID_ARG);
 
+    wal_config_t cfg = WAL_CONFIG_DEFAULT;
+    cfg.segment_size = 100;
+    ASSERT_EQ(wal_set_config(NULL, &cfg), MEM_ERR_INVALID_ARG);
+    ASSERT_EQ(wal_prepare_segment(NULL), MEM_ERR_INVALID_ARG);
+
     ASSERT_EQ(wal_sequence(NULL), 0);
     ASSERT_EQ(wal_size(NULL), 0);
 }
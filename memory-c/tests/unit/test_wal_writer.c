@@ -0,0 +1,210 @@
+/*
+ * Memory Service - WAL Group Commit Unit Tests
+ */
+
+#include "../test_framework.h"
+#include "../../src/storage/wal_writer.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define WRITER_THREADS 8
+#define RECORDS_PER_THREAD 200
+
+/* Remove a WAL's segment files */
+static void remove_wal(const char* path) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -f %s %s.*", path, path);
+    system(cmd);
+}
+
+static int g_records = 0;
+static uint64_t g_node_sum = 0;
+
+static mem_error_t count_callback(wal_op_type_t op, const void* data,
+                                  size_t len, void* user_data) {
+    (void)user_data;
+    if (op == WAL_OP_TEXT_SET && len >= sizeof(wal_text_data_t)) {
+        const wal_text_data_t* t = data;
+        if (len != sizeof(*t) + t->len) return MEM_ERR_WAL_CORRUPT;
+        g_node_sum += t->node_id;
+    }
+    g_records++;
+    return MEM_OK;
+}
+
+typedef struct {
+    wal_writer_t*   writer;
+    int             thread;
+    _Atomic int*    failures;
+} writer_arg_t;
+
+/* Log a record and wait for it, like a request handler */
+static void* request_thread(void* arg) {
+    writer_arg_t* a = arg;
+    char text[32];
+
+    for (int i = 0; i < RECORDS_PER_THREAD; i++) {
+        wal_text_data_t rec = {
+            .node_id = (node_id_t)(a->thread * RECORDS_PER_THREAD + i),
+            .len = (uint32_t)snprintf(text, sizeof(text), "text %d/%d", a->thread, i)
+        };
+        struct iovec parts[2] = { { &rec, sizeof(rec) }, { text, rec.len } };
+
+        uint64_t ticket = 0;
+        if (wal_writer_log(a->writer, WAL_OP_TEXT_SET, parts, 2, &ticket) != MEM_OK ||
+            wal_writer_wait(a->writer, ticket) != MEM_OK) {
+            atomic_fetch_add(a->failures, 1);
+        }
+    }
+    return NULL;
+}
+
+/* Test concurrent requests share batches and every record lands */
+TEST(wal_writer_group_commit) {
+    const char* path = "/tmp/test_wal_writer.log";
+    remove_wal(path);
+
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 64 * 1024 * 1024));
+    wal_writer_t* writer = NULL;
+    ASSERT_OK(wal_writer_create(&writer, wal));
+
+    _Atomic int failures = 0;
+    pthread_t threads[WRITER_THREADS];
+    writer_arg_t args[WRITER_THREADS];
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        args[t] = (writer_arg_t){ writer, t, &failures };
+        ASSERT_EQ(pthread_create(&threads[t], NULL, request_thread, &args[t]), 0);
+    }
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    ASSERT_EQ(atomic_load(&failures), 0);
+
+    wal_writer_stats_t stats;
+    wal_writer_get_stats(writer, &stats);
+    ASSERT_EQ(stats.records, WRITER_THREADS * RECORDS_PER_THREAD);
+    ASSERT_GT(stats.batches, 0);
+    ASSERT_LE(stats.batches, stats.records);
+    ASSERT_GE(stats.max_batch, 1);
+
+    wal_writer_destroy(writer);
+    wal_close(wal);
+
+    /* Every record is in the log, intact */
+    g_records = 0;
+    g_node_sum = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, count_callback, NULL));
+    int n = WRITER_THREADS * RECORDS_PER_THREAD;
+    ASSERT_EQ(g_records, n);
+    ASSERT_EQ(g_node_sum, (uint64_t)n * (n - 1) / 2);
+    wal_close(wal);
+    remove_wal(path);
+}
+
+/* Test flush covers records logged without waiting */
+TEST(wal_writer_flush) {
+    const char* path = "/tmp/test_wal_writer_flush.log";
+    remove_wal(path);
+
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 1024 * 1024));
+    wal_writer_t* writer = NULL;
+    ASSERT_OK(wal_writer_create(&writer, wal));
+
+    wal_node_data_t node = { .node_id = 1 };
+    struct iovec part = { &node, sizeof(node) };
+    for (int i = 0; i < 50; i++) {
+        ASSERT_OK(wal_writer_log(writer, WAL_OP_NODE_INSERT, &part, 1, NULL));
+    }
+    ASSERT_OK(wal_writer_log(writer, WAL_OP_COMMIT, NULL, 0, NULL));
+    ASSERT_OK(wal_writer_flush(writer));
+    ASSERT_EQ(wal_sequence(wal), 52);
+
+    wal_writer_stats_t stats;
+    wal_writer_get_stats(writer, &stats);
+    ASSERT_EQ(stats.records, 51);
+    ASSERT_EQ(stats.bytes, 50 * sizeof(node));
+
+    /* Nothing queued: returns at once */
+    ASSERT_OK(wal_writer_flush(writer));
+
+    /* Records queued at destroy are still written */
+    ASSERT_OK(wal_writer_log(writer, WAL_OP_NODE_INSERT, &part, 1, NULL));
+    wal_writer_destroy(writer);
+    ASSERT_EQ(wal_sequence(wal), 53);
+    wal_close(wal);
+
+    ASSERT_ERR(wal_writer_create(NULL, wal), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(wal_writer_log(NULL, WAL_OP_COMMIT, NULL, 0, NULL), MEM_ERR_INVALID_ARG);
+    ASSERT_ERR(wal_writer_wait(NULL, 1), MEM_ERR_INVALID_ARG);
+    wal_writer_destroy(NULL);
+    remove_wal(path);
+}
+
+/* Test batches submitted through io_uring land in order and checkpoint cleanly */
+TEST(wal_writer_io_uring) {
+    const char* path = "/tmp/test_wal_writer_uring.log";
+    remove_wal(path);
+
+    wal_t* wal = NULL;
+    ASSERT_OK(wal_create(&wal, path, 64 * 1024 * 1024));
+    wal_config_t cfg = WAL_CONFIG_DEFAULT;
+    cfg.segment_size = 64 * 1024;
+    cfg.backend = AIO_BACKEND_IO_URING;
+    ASSERT_OK(wal_set_config(wal, &cfg));
+
+    wal_writer_t* writer = NULL;
+    ASSERT_OK(wal_writer_create(&writer, wal));
+
+    _Atomic int failures = 0;
+    pthread_t threads[WRITER_THREADS];
+    writer_arg_t args[WRITER_THREADS];
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        args[t] = (writer_arg_t){ writer, t, &failures };
+        ASSERT_EQ(pthread_create(&threads[t], NULL, request_thread, &args[t]), 0);
+    }
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    ASSERT_EQ(atomic_load(&failures), 0);
+
+    int n = WRITER_THREADS * RECORDS_PER_THREAD;
+    wal_writer_stats_t stats;
+    wal_writer_get_stats(writer, &stats);
+    ASSERT_EQ(stats.records, (uint64_t)n);
+    ASSERT(stats.backend == AIO_BACKEND_IO_URING || stats.backend == AIO_BACKEND_BLOCKING);
+
+    /* Records rolled over several segments; all of them replay */
+    ASSERT_GT(wal->segment_count, 1);
+    wal_writer_destroy(writer);
+    wal_close(wal);
+
+    g_records = 0;
+    g_node_sum = 0;
+    ASSERT_OK(wal_open(&wal, path));
+    ASSERT_OK(wal_replay(wal, count_callback, NULL));
+    ASSERT_EQ(g_records, n);
+    ASSERT_EQ(g_node_sum, (uint64_t)n * (n - 1) / 2);
+
+    /* A checkpoint waits for submitted batches, then empties the log */
+    ASSERT_OK(wal_set_config(wal, &cfg));
+    ASSERT_OK(wal_writer_create(&writer, wal));
+    wal_node_data_t node = { .node_id = 1 };
+    struct iovec part = { &node, sizeof(node) };
+    for (int i = 0; i < 100; i++) {
+        ASSERT_OK(wal_writer_log(writer, WAL_OP_NODE_INSERT, &part, 1, NULL));
+    }
+    ASSERT_OK(wal_writer_checkpoint(writer, NULL, NULL));
+    ASSERT_EQ(wal_size(wal), 0);
+    wal_writer_destroy(writer);
+    wal_close(wal);
+    remove_wal(path);
+}
+
+TEST_MAIN()